@@ -0,0 +1,385 @@
+// turndown.cpp/bench/turndown_bench.cpp
+//
+// Throughput benchmarks over a size-graded synthetic corpus. Every document
+// is measured three ways: parse only, convert only (of an already parsed
+// tree) and end to end. Results default to Google Benchmark's JSON format
+// and carry, per benchmark:
+//   bytes_per_second  input HTML consumed per second
+//   allocs_per_doc    C++ heap allocations per document (operator new)
+//   peak_rss_mb       peak resident set size of the process so far
+// The parser backend is recorded in the JSON context, so runs of builds
+// configured with different TURNDOWN_PARSER_BACKEND values can be compared.
+// Builds with further backends compiled in (TURNDOWN_PARSER_BACKENDS) also
+// run the backend/ family, which parses and converts the same documents
+// with each of them, and with ParserBackend::Auto, in one process.
+#include "dom_source.h"
+#include "turndown.h"
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if !defined(_WIN32)
+  #include <sys/resource.h>
+#endif
+
+#ifndef TURNDOWN_BENCH_BACKEND
+#define TURNDOWN_BENCH_BACKEND "unknown"
+#endif
+
+using namespace turndown_cpp;
+
+// ============================================================================
+// Allocation counting
+// ============================================================================
+// Replacing the global allocation functions counts every C++ allocation in
+// the process. Allocations a C parser makes through malloc are not counted.
+
+namespace {
+std::atomic<std::size_t> allocationCount{0};
+} // namespace
+
+void* operator new(std::size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return ::operator new(size);
+}
+
+void* operator new(std::size_t size, std::nothrow_t const&) noexcept {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size ? size : 1);
+}
+
+void* operator new[](std::size_t size, std::nothrow_t const& tag) noexcept {
+    return ::operator new(size, tag);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::nothrow_t const&) noexcept { std::free(p); }
+void operator delete[](void* p, std::nothrow_t const&) noexcept { std::free(p); }
+
+namespace {
+
+double peakRssMegabytes() {
+#if defined(_WIN32)
+    return 0.0; // not collected on this platform
+#else
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+  #if defined(__APPLE__)
+    return static_cast<double>(usage.ru_maxrss) / (1024.0 * 1024.0); // bytes
+  #else
+    return static_cast<double>(usage.ru_maxrss) / 1024.0; // kilobytes
+  #endif
+#endif
+}
+
+// ============================================================================
+// Corpus
+// ============================================================================
+
+enum class Corpus { Mixed, WideTable, DeepNesting, CodeHeavy, LinkHeavy };
+
+char const* corpusName(Corpus corpus) {
+    switch (corpus) {
+    case Corpus::Mixed: return "mixed";
+    case Corpus::WideTable: return "wide_table";
+    case Corpus::DeepNesting: return "deep_nesting";
+    case Corpus::CodeHeavy: return "code_heavy";
+    case Corpus::LinkHeavy: return "link_heavy";
+    }
+    return "unknown";
+}
+
+// Options each corpus is converted with, chosen to exercise its rules.
+TurndownOptions corpusOptions(Corpus corpus) {
+    TurndownOptions options;
+    if (corpus == Corpus::CodeHeavy) {
+        options.codeBlockStyle = "fenced";
+    } else if (corpus == Corpus::LinkHeavy) {
+        options.linkStyle = "referenced";
+        options.linkReferenceStyle = "full";
+    }
+    return options;
+}
+
+// Appends one repeating unit of the corpus; @p n numbers the unit.
+void appendUnit(Corpus corpus, std::string& html, std::size_t n) {
+    std::string const id = std::to_string(n);
+    switch (corpus) {
+    case Corpus::Mixed:
+        html += "<h2>Section " + id + "</h2>\n"
+                "<p>Lorem <em>ipsum</em> dolor <strong>sit</strong> amet, <a href=\"https://example.com/" + id +
+                "\">consectetur</a> adipiscing_elit * sed [do] eiusmod.</p>\n"
+                "<ul><li>First item with <code>code()</code></li><li>Second\n   item  with   spaces</li></ul>\n"
+                "<blockquote><p>Quoted # text<br>over two lines.</p></blockquote>\n";
+        break;
+    case Corpus::WideTable:
+        html += "<tr>";
+        for (int column = 0; column < 64; ++column) {
+            html += "<td>r" + id + "c" + std::to_string(column) + "</td>";
+        }
+        html += "</tr>\n";
+        break;
+    case Corpus::DeepNesting: {
+        constexpr int kDepth = 48;
+        for (int level = 0; level < kDepth; ++level) html += "<div><ul><li>";
+        html += "leaf " + id;
+        for (int level = 0; level < kDepth; ++level) html += "</li></ul></div>";
+        html += "\n";
+        break;
+    }
+    case Corpus::CodeHeavy:
+        html += "<p>Call <code>run(" + id + ")</code> then <code>`tick`</code>:</p>\n"
+                "<pre><code class=\"language-cpp\">int main() {\n"
+                "    // ``` fence-like text inside code\n"
+                "    for (int i = 0; i &lt; " + id + "; ++i) {\n"
+                "        std::cout &lt;&lt; i &lt;&lt; '\\n';\n"
+                "    }\n"
+                "}\n</code></pre>\n";
+        break;
+    case Corpus::LinkHeavy:
+        html += "<p>";
+        for (int link = 0; link < 16; ++link) {
+            std::string const target = id + "-" + std::to_string(link);
+            html += "<a href=\"https://example.com/page/" + target + "\" title=\"Page " + target + "\">page " +
+                    target + "</a> ";
+        }
+        html += "</p>\n";
+        break;
+    }
+}
+
+// Builds a document of at least @p targetBytes from repeated units.
+std::string generate(Corpus corpus, std::size_t targetBytes) {
+    std::string html = "<html><body>\n";
+    if (corpus == Corpus::WideTable) html += "<table>\n";
+    html.reserve(targetBytes + 4096);
+    for (std::size_t n = 0; html.size() < targetBytes; ++n) {
+        appendUnit(corpus, html, n);
+    }
+    if (corpus == Corpus::WideTable) html += "</table>\n";
+    html += "</body></html>\n";
+    return html;
+}
+
+// Documents are generated once, on first use, and shared by the phases.
+std::string const& document(Corpus corpus, std::size_t targetBytes) {
+    static std::map<std::pair<Corpus, std::size_t>, std::string> cache;
+    auto key = std::make_pair(corpus, targetBytes);
+    auto it = cache.find(key);
+    if (it == cache.end()) {
+        it = cache.emplace(key, generate(corpus, targetBytes)).first;
+    }
+    return it->second;
+}
+
+// ============================================================================
+// Benchmarks
+// ============================================================================
+
+enum class Phase { Parse, Convert, EndToEnd };
+
+void reportCounters(benchmark::State& state, std::size_t bytes, std::size_t allocations) {
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) * static_cast<std::int64_t>(bytes));
+    state.counters["allocs_per_doc"] =
+        benchmark::Counter(static_cast<double>(allocations), benchmark::Counter::kAvgIterations);
+    state.counters["peak_rss_mb"] = peakRssMegabytes();
+}
+
+void BM_Phase(benchmark::State& state, Phase phase, Corpus corpus, std::size_t targetBytes) {
+    std::string const& html = document(corpus, targetBytes);
+    TurndownService service(corpusOptions(corpus));
+    service.turndown("<p>warm up</p>"); // build the rule set outside the loop
+
+    std::size_t allocations = 0;
+    switch (phase) {
+    case Phase::Parse: {
+        std::size_t before = allocationCount.load(std::memory_order_relaxed);
+        for (auto _ : state) {
+            HtmlStringSource source{html};
+            benchmark::DoNotOptimize(source.root());
+        }
+        allocations = allocationCount.load(std::memory_order_relaxed) - before;
+        break;
+    }
+    case Phase::Convert: {
+        HtmlStringSource source{html};
+        dom::NodeView root = source.root();
+        std::size_t before = allocationCount.load(std::memory_order_relaxed);
+        for (auto _ : state) {
+            std::string markdown = service.turndown(root);
+            benchmark::DoNotOptimize(markdown);
+        }
+        allocations = allocationCount.load(std::memory_order_relaxed) - before;
+        break;
+    }
+    case Phase::EndToEnd: {
+        std::size_t before = allocationCount.load(std::memory_order_relaxed);
+        for (auto _ : state) {
+            std::string markdown = service.turndown(html);
+            benchmark::DoNotOptimize(markdown);
+        }
+        allocations = allocationCount.load(std::memory_order_relaxed) - before;
+        break;
+    }
+    }
+    reportCounters(state, html.size(), allocations);
+}
+
+// Parse, or parse and convert, with one backend.
+void BM_Backend(benchmark::State& state, dom::ParserBackend backend, bool convert, Corpus corpus,
+                std::size_t targetBytes) {
+    std::string const& html = document(corpus, targetBytes);
+    TurndownService service(corpusOptions(corpus));
+    service.turndown("<p>warm up</p>");
+
+    std::size_t before = allocationCount.load(std::memory_order_relaxed);
+    for (auto _ : state) {
+        dom::Document parsed = dom::Document::parse(html, backend);
+        if (convert) {
+            std::string markdown = service.turndown(parsed.root());
+            benchmark::DoNotOptimize(markdown);
+        } else {
+            benchmark::DoNotOptimize(parsed.root());
+        }
+    }
+    reportCounters(state, html.size(), allocationCount.load(std::memory_order_relaxed) - before);
+}
+
+// Short snippets, as in comment threads: half plain text, half with markup.
+std::vector<std::string> const& snippets() {
+    static std::vector<std::string> const all = [] {
+        std::vector<std::string> out;
+        for (int i = 0; i < 256; ++i) {
+            std::string const id = std::to_string(i);
+            out.push_back(i % 2 ? "Thanks, that fixed it for build " + id + "."
+                                : "See <a href=\"https://example.com/" + id + "\">issue " + id + "</a>, <em>again</em>.");
+        }
+        return out;
+    }();
+    return all;
+}
+
+// Converts the snippets one at a time, with turndownFragment() or turndown().
+void BM_Fragment(benchmark::State& state, bool fragment) {
+    std::vector<std::string> const& inputs = snippets();
+    TurndownService service;
+    service.turndown("<p>warm up</p>");
+
+    std::size_t bytes = 0;
+    for (auto const& snippet : inputs) bytes += snippet.size();
+    std::size_t before = allocationCount.load(std::memory_order_relaxed);
+    for (auto _ : state) {
+        for (auto const& snippet : inputs) {
+            std::string markdown = fragment ? service.turndownFragment(snippet) : service.turndown(snippet);
+            benchmark::DoNotOptimize(markdown);
+        }
+    }
+    reportCounters(state, bytes, allocationCount.load(std::memory_order_relaxed) - before);
+    state.counters["snippets_per_s"] = benchmark::Counter(
+        static_cast<double>(state.iterations() * inputs.size()), benchmark::Counter::kIsRate);
+}
+
+std::string sizeLabel(std::size_t bytes) {
+    if (bytes >= 1024 * 1024) return std::to_string(bytes / (1024 * 1024)) + "MB";
+    return std::to_string(bytes / 1024) + "KB";
+}
+
+void registerBenchmarks() {
+    constexpr std::size_t KB = 1024;
+    constexpr std::size_t MB = 1024 * KB;
+    struct Entry {
+        Corpus corpus;
+        std::vector<std::size_t> sizes;
+    };
+    std::vector<Entry> const corpus = {
+        {Corpus::Mixed, {1 * KB, 64 * KB, 1 * MB, 8 * MB, 50 * MB}},
+        {Corpus::WideTable, {64 * KB, 1 * MB}},
+        {Corpus::DeepNesting, {64 * KB, 1 * MB}},
+        {Corpus::CodeHeavy, {64 * KB, 1 * MB}},
+        {Corpus::LinkHeavy, {64 * KB, 1 * MB}},
+    };
+    std::pair<Phase, char const*> const phases[] = {
+        {Phase::Parse, "parse"},
+        {Phase::Convert, "convert"},
+        {Phase::EndToEnd, "end_to_end"},
+    };
+
+    for (auto const& entry : corpus) {
+        for (std::size_t bytes : entry.sizes) {
+            for (auto const& [phase, phaseName] : phases) {
+                std::string name = std::string(phaseName) + "/" + corpusName(entry.corpus) + "/" + sizeLabel(bytes);
+                auto* bench = benchmark::RegisterBenchmark(name.c_str(), BM_Phase, phase, entry.corpus, bytes);
+                bench->Unit(bytes >= MB ? benchmark::kMillisecond : benchmark::kMicrosecond);
+            }
+        }
+    }
+
+    benchmark::RegisterBenchmark("fragment/snippets", BM_Fragment, true)->Unit(benchmark::kMicrosecond);
+    benchmark::RegisterBenchmark("fragment/turndown/snippets", BM_Fragment, false)->Unit(benchmark::kMicrosecond);
+
+    std::vector<dom::ParserBackend> backends = dom::availableParserBackends();
+    if (backends.size() < 2) return;
+    backends.push_back(dom::ParserBackend::Auto);
+    for (dom::ParserBackend backend : backends) {
+        for (auto const& entry : corpus) {
+            for (std::size_t bytes : entry.sizes) {
+                if (bytes > 8 * MB) continue;
+                for (bool convert : {false, true}) {
+                    std::string name = std::string("backend/") + dom::toString(backend) + "/" +
+                                       (convert ? "end_to_end/" : "parse/") + corpusName(entry.corpus) + "/" +
+                                       sizeLabel(bytes);
+                    auto* bench = benchmark::RegisterBenchmark(name.c_str(), BM_Backend, backend, convert,
+                                                               entry.corpus, bytes);
+                    bench->Unit(bytes >= MB ? benchmark::kMillisecond : benchmark::kMicrosecond);
+                }
+            }
+        }
+    }
+}
+
+} // namespace
+
+// JSON is the default output; pass --benchmark_format=console to read the
+// results directly.
+int main(int argc, char** argv) {
+    std::vector<char*> args(argv, argv + argc);
+    bool hasFormat = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strncmp(argv[i], "--benchmark_format", 18) == 0) hasFormat = true;
+    }
+    static char jsonFormat[] = "--benchmark_format=json";
+    if (!hasFormat) args.push_back(jsonFormat);
+    int benchArgc = static_cast<int>(args.size());
+
+    benchmark::Initialize(&benchArgc, args.data());
+    if (benchmark::ReportUnrecognizedArguments(benchArgc, args.data())) return 1;
+    benchmark::AddCustomContext("parser_backend", TURNDOWN_BENCH_BACKEND);
+    std::string compiledIn;
+    for (dom::ParserBackend backend : dom::availableParserBackends()) {
+        if (!compiledIn.empty()) compiledIn += ",";
+        compiledIn += dom::toString(backend);
+    }
+    benchmark::AddCustomContext("parser_backends", compiledIn);
+    registerBenchmarks();
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -1,18 +1,44 @@
 #include "turndown.h"
 
+#include "batch_converter.h"
 #include "cli_plugin.h"
+#include "dom_source.h"
+#include "mapped_file.h"
+#include "thread_pool.h"
 
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
-#include <sstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
 #include <vector>
 
 #if defined(_WIN32)
   #include <windows.h>
+  #include <fcntl.h>
+  #include <io.h>
 #else
   #include <dlfcn.h>
+  #include <sys/socket.h>
+  #include <sys/un.h>
+  #include <unistd.h>
 #endif
 
 using namespace turndown_cpp;
@@ -108,14 +134,26 @@ struct LoadedPlugin {
     std::string path;
     std::string name;
     LibraryHandle handle = nullptr;
+    turndown_cpp::cli_plugin::RegisterFn registerFn = nullptr;        // ABI version 1
+    turndown_cpp_plugin_descriptor const* descriptor = nullptr;       // ABI version 2
+    bool registeredThreadSafe = false;                                // ABI version 1 opt-in
+
+    // Register-style plugins hand over opaque C++ rules, so they are only
+    // shared between threads if the plugin says they may be.
+    bool threadSafe() const {
+        return descriptor ? (descriptor->flags & TURNDOWN_CPP_PLUGIN_THREAD_SAFE) != 0 : registeredThreadSafe;
+    }
 
     LoadedPlugin() = default;
     LoadedPlugin(LoadedPlugin const&) = delete;
     LoadedPlugin& operator=(LoadedPlugin const&) = delete;
 
     LoadedPlugin(LoadedPlugin&& other) noexcept
-        : path(std::move(other.path)), name(std::move(other.name)), handle(other.handle) {
+        : path(std::move(other.path)), name(std::move(other.name)), handle(other.handle),
+          registerFn(other.registerFn), descriptor(other.descriptor), registeredThreadSafe(other.registeredThreadSafe) {
         other.handle = nullptr;
+        other.registerFn = nullptr;
+        other.descriptor = nullptr;
     }
     LoadedPlugin& operator=(LoadedPlugin&& other) noexcept {
         if (this == &other) return *this;
@@ -123,7 +161,12 @@ struct LoadedPlugin {
         path = std::move(other.path);
         name = std::move(other.name);
         handle = other.handle;
+        registerFn = other.registerFn;
+        descriptor = other.descriptor;
+        registeredThreadSafe = other.registeredThreadSafe;
         other.handle = nullptr;
+        other.registerFn = nullptr;
+        other.descriptor = nullptr;
         return *this;
     }
 
@@ -135,7 +178,26 @@ struct LoadedPlugin {
     }
 };
 
-LoadedPlugin loadAndRegisterPlugin(std::string const& path, TurndownService& service) {
+// Rejects descriptors the host could not turn into rules, before any
+// conversion runs.
+void validateDescriptor(turndown_cpp_plugin_descriptor const* descriptor, std::string const& path) {
+    if (!descriptor) throw std::runtime_error("Plugin returned no descriptor: " + path);
+    if (descriptor->rule_count != 0 && !descriptor->rules) {
+        throw std::runtime_error("Plugin descriptor has no rule table: " + path);
+    }
+    for (std::size_t i = 0; i < descriptor->rule_count; ++i) {
+        turndown_cpp_plugin_rule const& rule = descriptor->rules[i];
+        std::string const which = "rule " + std::to_string(i) + " of " + path;
+        if (!rule.key || !*rule.key) throw std::runtime_error("Plugin " + which + " has no key");
+        bool const keepOrRemove = rule.flags & (TURNDOWN_CPP_RULE_KEEP | TURNDOWN_CPP_RULE_REMOVE);
+        if ((rule.flags & TURNDOWN_CPP_RULE_KEEP) && (rule.flags & TURNDOWN_CPP_RULE_REMOVE)) {
+            throw std::runtime_error("Plugin " + which + " both keeps and removes");
+        }
+        if (!keepOrRemove && !rule.replacement) throw std::runtime_error("Plugin " + which + " has no replacement");
+    }
+}
+
+LoadedPlugin loadPlugin(std::string const& path) {
     LoadedPlugin plugin;
     plugin.path = path;
     plugin.handle = loadLibrary(path);
@@ -144,13 +206,24 @@ LoadedPlugin loadAndRegisterPlugin(std::string const& path, TurndownService& ser
         loadSymbol(plugin.handle, turndown_cpp::cli_plugin::kAbiVersionSymbol)
     );
     std::uint32_t const abi = abiFn ? abiFn() : 0;
-    if (abi != turndown_cpp::cli_plugin::kAbiVersion) {
+    if (abi != turndown_cpp::cli_plugin::kAbiVersion && abi != turndown_cpp::cli_plugin::kAbiVersionLegacy) {
         throw std::runtime_error(
             "Plugin ABI mismatch for '" + path + "': plugin=" + std::to_string(abi) +
-            ", expected=" + std::to_string(turndown_cpp::cli_plugin::kAbiVersion)
+            ", expected=" + std::to_string(turndown_cpp::cli_plugin::kAbiVersion) +
+            " or " + std::to_string(turndown_cpp::cli_plugin::kAbiVersionLegacy)
         );
     }
 
+    if (abi == turndown_cpp::cli_plugin::kAbiVersion) {
+        auto descriptorFn = reinterpret_cast<turndown_cpp::cli_plugin::DescriptorFn>(
+            loadSymbol(plugin.handle, turndown_cpp::cli_plugin::kDescriptorSymbol)
+        );
+        plugin.descriptor = descriptorFn ? descriptorFn() : nullptr;
+        validateDescriptor(plugin.descriptor, path);
+        plugin.name = plugin.descriptor->name ? plugin.descriptor->name : path;
+        return plugin;
+    }
+
     if (auto nameSym = tryLoadSymbol(plugin.handle, turndown_cpp::cli_plugin::kNameSymbol)) {
         auto nameFn = reinterpret_cast<turndown_cpp::cli_plugin::NameFn>(nameSym);
         if (nameFn) {
@@ -162,32 +235,648 @@ LoadedPlugin loadAndRegisterPlugin(std::string const& path, TurndownService& ser
     if (plugin.name.empty()) {
         plugin.name = path;
     }
+    if (auto threadSafeSym = tryLoadSymbol(plugin.handle, turndown_cpp::cli_plugin::kThreadSafeSymbol)) {
+        auto threadSafeFn = reinterpret_cast<turndown_cpp::cli_plugin::ThreadSafeFn>(threadSafeSym);
+        plugin.registeredThreadSafe = threadSafeFn && threadSafeFn() != 0;
+    }
 
-    auto regFn = reinterpret_cast<turndown_cpp::cli_plugin::RegisterFn>(
+    plugin.registerFn = reinterpret_cast<turndown_cpp::cli_plugin::RegisterFn>(
         loadSymbol(plugin.handle, turndown_cpp::cli_plugin::kRegisterSymbol)
     );
-    if (!regFn) {
+    if (!plugin.registerFn) {
         throw std::runtime_error("Plugin missing register function: " + path);
     }
+    return plugin;
+}
+
+// The host side of the version 2 ABI: the opaque handles a plugin sees are
+// the NodeView, options and output string of the rule being applied.
+dom::NodeView const& nodeOf(turndown_cpp_plugin_node const* node) {
+    return *reinterpret_cast<dom::NodeView const*>(node);
+}
+
+turndown_cpp_plugin_string pluginString(std::string_view text) {
+    return {text.data(), text.size()};
+}
+
+turndown_cpp_plugin_string hostTagName(turndown_cpp_plugin_node const* node) {
+    dom::NodeView const& view = nodeOf(node);
+    std::string_view name = dom::tagName(view.tag_id());
+    if (!name.empty()) return pluginString(name);
+    // Unknown tags have no static name; valid until the next call.
+    thread_local std::string scratch;
+    scratch = view.tag_name();
+    return pluginString(scratch);
+}
+
+turndown_cpp_plugin_string hostAttribute(turndown_cpp_plugin_node const* node, char const* name) {
+    if (!name) return {};
+    return pluginString(nodeOf(node).attribute(name));
+}
+
+turndown_cpp_plugin_string hostOption(turndown_cpp_plugin_options const* options, char const* name) {
+    if (!name) return {};
+    auto const& opts = *reinterpret_cast<TurndownOptions const*>(options);
+    std::string_view key(name);
+    if (key == "headingStyle") return pluginString(opts.headingStyle);
+    if (key == "hr") return pluginString(opts.hr);
+    if (key == "bulletListMarker") return pluginString(opts.bulletListMarker);
+    if (key == "codeBlockStyle") return pluginString(opts.codeBlockStyle);
+    if (key == "fence") return pluginString(opts.fence);
+    if (key == "emDelimiter") return pluginString(opts.emDelimiter);
+    if (key == "strongDelimiter") return pluginString(opts.strongDelimiter);
+    if (key == "linkStyle") return pluginString(opts.linkStyle);
+    if (key == "linkReferenceStyle") return pluginString(opts.linkReferenceStyle);
+    if (key == "br") return pluginString(opts.br);
+    return {};
+}
+
+void hostAppend(turndown_cpp_plugin_output* output, char const* data, std::size_t size) {
+    if (data && size) reinterpret_cast<std::string*>(output)->append(data, size);
+}
 
+constexpr turndown_cpp_plugin_host kPluginHost{hostTagName, hostAttribute, hostOption, hostAppend};
+
+// Turns one descriptor rule into a service rule. Rules whose tags are all
+// known declare them, so they are dispatched by tag like built-in rules;
+// otherwise the filter compares names itself.
+void registerDescriptorRule(turndown_cpp_plugin_rule const& spec, TurndownService& service) {
+    std::vector<std::string> names;
+    dom::TagSet tags;
+    bool allKnown = true;
+    for (char const* const* tag = spec.tags; tag && *tag; ++tag) {
+        std::string name(*tag);
+        std::transform(name.begin(), name.end(), name.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        dom::TagId id = dom::tagIdFromName(name);
+        if (id == dom::TagId::Unknown) allKnown = false;
+        else tags.insert(id);
+        names.push_back(std::move(name));
+    }
+    if (!allKnown) tags = {};
+
+    bool const anyElement = !spec.tags;
+    auto filter = [spec, names, tags, anyElement](dom::NodeView node, TurndownOptions const& options) {
+        if (!node.is_element()) return false;
+        if (!anyElement) {
+            bool const listed = tags.empty() ? std::find(names.begin(), names.end(), node.tag_name()) != names.end()
+                                             : tags.contains(node.tag_id());
+            if (!listed) return false;
+        }
+        if (!spec.filter) return true;
+        return spec.filter(spec.user_data, &kPluginHost, reinterpret_cast<turndown_cpp_plugin_node const*>(&node),
+                           reinterpret_cast<turndown_cpp_plugin_options const*>(&options)) != 0;
+    };
+
+    bool const byTagOnly = !spec.filter && !anyElement && allKnown;
+    if (spec.flags & TURNDOWN_CPP_RULE_KEEP) {
+        if (byTagOnly) service.keep(names);
+        else service.keep(filter);
+        return;
+    }
+    if (spec.flags & TURNDOWN_CPP_RULE_REMOVE) {
+        if (byTagOnly) service.remove(names);
+        else service.remove(filter);
+        return;
+    }
+
+    Rule rule;
+    rule.filter = filter;
+    rule.replacement = [spec](std::string const& content, dom::NodeView node, TurndownOptions const& options) {
+        std::string output;
+        spec.replacement(spec.user_data, &kPluginHost, pluginString(content),
+                         reinterpret_cast<turndown_cpp_plugin_node const*>(&node),
+                         reinterpret_cast<turndown_cpp_plugin_options const*>(&options),
+                         reinterpret_cast<turndown_cpp_plugin_output*>(&output));
+        return output;
+    };
+    rule.tags = tags;
+    service.addRule(spec.key, std::move(rule));
+}
+
+// Runs a loaded plugin's register function, or adds its descriptor's rules,
+// against a service. Server mode calls this for every service it builds,
+// without reopening the library.
+void registerPlugin(LoadedPlugin const& plugin, TurndownService& service) {
     try {
-        regFn(service);
+        if (plugin.descriptor) {
+            for (std::size_t i = 0; i < plugin.descriptor->rule_count; ++i) {
+                registerDescriptorRule(plugin.descriptor->rules[i], service);
+            }
+            return;
+        }
+        plugin.registerFn(service);
     } catch (std::exception const& e) {
         throw std::runtime_error("Plugin '" + plugin.name + "' threw exception: " + std::string(e.what()));
     } catch (...) {
         throw std::runtime_error("Plugin '" + plugin.name + "' threw unknown exception");
     }
+}
 
-    return plugin;
+// One document of a batch: where it is read from and written to.
+struct BatchItem {
+    std::filesystem::path input;
+    std::filesystem::path output;
+    std::string error{}; ///< Why the item is not converted, if it is not
+};
+
+// Fails every item whose output path an earlier item already writes, such
+// as "a.html" next to "a.htm", so that no output is silently overwritten.
+void markOutputCollisions(std::vector<BatchItem>& items) {
+    std::map<std::filesystem::path, std::filesystem::path const*> claimed;
+    for (BatchItem& item : items) {
+        auto [it, inserted] = claimed.emplace(item.output.lexically_normal(), &item.input);
+        if (!inserted) {
+            item.error = "output " + item.output.string() + " is also written for " + it->second->string();
+        }
+    }
+}
+
+// Collects the inputs of --batch: every regular file below a directory
+// (mirrored below the output directory), or the paths listed one per line
+// in a file (mirrored below the output directory relative to the deepest
+// directory that contains them all).
+std::vector<BatchItem> collectBatchItems(std::filesystem::path const& source, std::filesystem::path const& outputDir) {
+    namespace fs = std::filesystem;
+    std::vector<BatchItem> items;
+    if (fs::is_directory(source)) {
+        for (auto const& entry : fs::recursive_directory_iterator(source)) {
+            if (!entry.is_regular_file()) continue;
+            fs::path relative = fs::relative(entry.path(), source);
+            items.push_back({entry.path(), (outputDir / relative).replace_extension(".md")});
+        }
+        std::sort(items.begin(), items.end(),
+                  [](BatchItem const& a, BatchItem const& b) { return a.input < b.input; });
+        markOutputCollisions(items);
+        return items;
+    }
+
+    std::ifstream list(source);
+    if (!list) {
+        throw std::runtime_error("cannot open batch list " + source.string());
+    }
+    std::vector<fs::path> inputs;
+    std::string line;
+    while (std::getline(list, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty()) continue;
+        inputs.emplace_back(line);
+    }
+
+    std::vector<fs::path> absolute;
+    absolute.reserve(inputs.size());
+    fs::path root;
+    for (fs::path const& input : inputs) {
+        absolute.push_back(fs::absolute(input).lexically_normal());
+        fs::path parent = absolute.back().parent_path();
+        if (absolute.size() == 1) {
+            root = parent;
+            continue;
+        }
+        fs::path common;
+        for (auto r = root.begin(), p = parent.begin(); r != root.end() && p != parent.end() && *r == *p; ++r, ++p) {
+            common /= *r;
+        }
+        root = common;
+    }
+
+    for (std::size_t i = 0; i < inputs.size(); ++i) {
+        items.push_back({inputs[i], (outputDir / absolute[i].lexically_relative(root)).replace_extension(".md")});
+    }
+    markOutputCollisions(items);
+    return items;
+}
+
+// Writes converted documents on a background thread so conversion of the
+// next chunk overlaps with output I/O.
+class AsyncWriter {
+public:
+    AsyncWriter() : thread_([this] { run(); }) {}
+
+    AsyncWriter(AsyncWriter const&) = delete;
+    AsyncWriter& operator=(AsyncWriter const&) = delete;
+
+    ~AsyncWriter() { finish(); }
+
+    void write(std::filesystem::path path, std::string contents) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            queue_.push_back({std::move(path), std::move(contents)});
+        }
+        ready_.notify_one();
+    }
+
+    // Waits for the queue to drain and returns the paths that failed.
+    std::vector<std::pair<std::filesystem::path, std::string>> finish() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            done_ = true;
+        }
+        ready_.notify_one();
+        if (thread_.joinable()) thread_.join();
+        return std::move(failures_);
+    }
+
+private:
+    struct Job {
+        std::filesystem::path path;
+        std::string contents;
+    };
+
+    void run() {
+        while (true) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                ready_.wait(lock, [this] { return done_ || !queue_.empty(); });
+                if (queue_.empty()) return;
+                job = std::move(queue_.front());
+                queue_.pop_front();
+            }
+            std::error_code ec;
+            std::filesystem::create_directories(job.path.parent_path(), ec);
+            std::ofstream out(job.path, std::ios::binary);
+            out.write(job.contents.data(), static_cast<std::streamsize>(job.contents.size()));
+            if (!out) {
+                failures_.emplace_back(job.path, "cannot write output");
+            }
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    std::deque<Job> queue_;
+    bool done_ = false;
+    std::vector<std::pair<std::filesystem::path, std::string>> failures_;
+    std::thread thread_;
+};
+
+// Converts every batch item and prints a throughput and failure summary
+// to stderr. Inputs are mapped a chunk at a time to bound open mappings.
+int runBatch(TurndownService const& service, std::filesystem::path const& source,
+             std::filesystem::path const& outputDir, std::size_t workers) {
+    using Clock = std::chrono::steady_clock;
+    auto start = Clock::now();
+
+    std::vector<BatchItem> items = collectBatchItems(source, outputDir);
+    BatchConverter converter(service, workers);
+    std::size_t const chunkSize = std::max<std::size_t>(64, converter.workers() * 16);
+
+    std::vector<std::pair<std::filesystem::path, std::string>> failures;
+    std::size_t inputBytes = 0;
+    std::size_t converted = 0;
+    AsyncWriter writer;
+
+    for (std::size_t first = 0; first < items.size(); first += chunkSize) {
+        std::size_t last = std::min(items.size(), first + chunkSize);
+        std::vector<MappedFile> files;
+        std::vector<std::string_view> documents;
+        std::vector<std::size_t> itemOf;
+        files.reserve(last - first);
+        for (std::size_t i = first; i < last; ++i) {
+            if (!items[i].error.empty()) {
+                failures.emplace_back(items[i].input, items[i].error);
+                continue;
+            }
+            try {
+                files.emplace_back(items[i].input);
+            } catch (std::exception const& e) {
+                failures.emplace_back(items[i].input, e.what());
+                continue;
+            }
+            documents.push_back(files.back().view());
+            itemOf.push_back(i);
+            inputBytes += documents.back().size();
+        }
+
+        std::vector<BatchResult> results = converter.convert(documents);
+        for (std::size_t r = 0; r < results.size(); ++r) {
+            BatchItem const& item = items[itemOf[r]];
+            if (!results[r].ok()) {
+                failures.emplace_back(item.input, results[r].error);
+                continue;
+            }
+            ++converted;
+            writer.write(item.output, std::move(results[r].markdown));
+        }
+    }
+
+    for (auto& failure : writer.finish()) {
+        --converted;
+        failures.push_back(std::move(failure));
+    }
+
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    for (auto const& [path, error] : failures) {
+        std::cerr << "error: " << path.string() << ": " << error << "\n";
+    }
+    char summary[256];
+    std::snprintf(summary, sizeof(summary),
+                  "Converted %zu of %zu files (%zu failed) in %.3f s with %zu workers: %.1f docs/s, %.2f MB/s\n",
+                  converted, items.size(), failures.size(), seconds, converter.workers(),
+                  seconds > 0 ? static_cast<double>(converted) / seconds : 0.0,
+                  seconds > 0 ? static_cast<double>(inputBytes) / (1024.0 * 1024.0) / seconds : 0.0);
+    std::cerr << summary;
+    return failures.empty() ? 0 : 1;
+}
+
+// Unbuffered-ish byte channel over a pair of file descriptors, used by the
+// --serve protocol. Reads are buffered; writes go straight to the fd.
+class FdChannel {
+public:
+    FdChannel(int in, int out) : in_(in), out_(out) {}
+
+    // Reads up to and excluding the next '\n'. Returns false at end of input.
+    bool readLine(std::string& line) {
+        line.clear();
+        while (true) {
+            std::size_t newline = buffer_.find('\n', pos_);
+            if (newline != std::string::npos) {
+                line.append(buffer_, pos_, newline - pos_);
+                pos_ = newline + 1;
+                return true;
+            }
+            line.append(buffer_, pos_, std::string::npos);
+            pos_ = buffer_.size();
+            if (!fill()) return false;
+        }
+    }
+
+    // Reads exactly @p count bytes. Returns false if input ends first.
+    // Storage grows with the bytes that actually arrive, not with @p count.
+    bool readExact(std::size_t count, std::string& data) {
+        data.clear();
+        while (data.size() < count) {
+            if (pos_ == buffer_.size() && !fill()) return false;
+            std::size_t take = std::min(count - data.size(), buffer_.size() - pos_);
+            data.append(buffer_, pos_, take);
+            pos_ += take;
+        }
+        return true;
+    }
+
+    bool write(std::string_view data) {
+        while (!data.empty()) {
+#if defined(_WIN32)
+            int written = ::_write(out_, data.data(), static_cast<unsigned>(std::min<std::size_t>(data.size(), 1u << 30)));
+#else
+            ssize_t written = ::write(out_, data.data(), data.size());
+            if (written < 0 && errno == EINTR) continue;
+#endif
+            if (written <= 0) return false;
+            data.remove_prefix(static_cast<std::size_t>(written));
+        }
+        return true;
+    }
+
+private:
+    bool fill() {
+        buffer_.resize(64 * 1024);
+        pos_ = 0;
+        while (true) {
+#if defined(_WIN32)
+            int got = ::_read(in_, buffer_.data(), static_cast<unsigned>(buffer_.size()));
+#else
+            ssize_t got = ::read(in_, buffer_.data(), buffer_.size());
+            if (got < 0 && errno == EINTR) continue;
+#endif
+            buffer_.resize(got > 0 ? static_cast<std::size_t>(got) : 0);
+            return got > 0;
+        }
+    }
+
+    int in_;
+    int out_;
+    std::string buffer_;
+    std::size_t pos_ = 0;
+};
+
+// Decodes %XX escapes so option values can carry spaces ("br=%20%20").
+std::string percentDecode(std::string_view text) {
+    auto hex = [](char c) -> int {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    };
+    std::string out;
+    out.reserve(text.size());
+    for (std::size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '%' && i + 2 < text.size() && hex(text[i + 1]) >= 0 && hex(text[i + 2]) >= 0) {
+            out.push_back(static_cast<char>(hex(text[i + 1]) * 16 + hex(text[i + 2])));
+            i += 2;
+        } else {
+            out.push_back(text[i]);
+        }
+    }
+    return out;
+}
+
+// Applies one key=value override from a request header.
+void applyOptionOverride(TurndownOptions& options, std::string_view key, std::string value) {
+    if (key == "headingStyle") options.headingStyle = std::move(value);
+    else if (key == "hr") options.hr = std::move(value);
+    else if (key == "bulletListMarker") options.bulletListMarker = std::move(value);
+    else if (key == "codeBlockStyle") options.codeBlockStyle = std::move(value);
+    else if (key == "fence") options.fence = std::move(value);
+    else if (key == "emDelimiter") options.emDelimiter = std::move(value);
+    else if (key == "strongDelimiter") options.strongDelimiter = std::move(value);
+    else if (key == "linkStyle") options.linkStyle = std::move(value);
+    else if (key == "linkReferenceStyle") options.linkReferenceStyle = std::move(value);
+    else if (key == "br") options.br = std::move(value);
+    else if (key == "preformattedCode") options.preformattedCode = value == "true" || value == "1";
+    else throw std::runtime_error("unknown option '" + std::string(key) + "'");
+}
+
+// Serves conversion requests until the input ends. Each request is a header
+// line "<length>[ key=value...]" followed by <length> bytes of HTML; each
+// reply is "ok <length>\n<markdown>" or "error <length>\n<message>".
+// A length above maxRequestBytes is answered with an error and ends the
+// stream, since the body that follows cannot be skipped reliably.
+// Services are cached per distinct set of overrides, so rules are only
+// rebuilt when a request actually asks for different options.
+class Server {
+public:
+    Server(TurndownOptions base, std::vector<LoadedPlugin> const& plugins, std::size_t maxRequestBytes)
+        : base_(std::move(base)), plugins_(plugins), maxRequestBytes_(maxRequestBytes) {}
+
+    // Returns false if the stream became unusable (malformed frame).
+    bool serve(FdChannel& channel) {
+        std::string header;
+        std::string html;
+        while (channel.readLine(header)) {
+            if (!header.empty() && header.back() == '\r') header.pop_back();
+            if (header.empty()) continue;
+
+            std::size_t length = 0;
+            bool tooLarge = false;
+            std::string_view rest(header);
+            std::size_t digits = 0;
+            while (digits < rest.size() && rest[digits] >= '0' && rest[digits] <= '9') {
+                auto digit = static_cast<std::size_t>(rest[digits] - '0');
+                // Stop accumulating before length * 10 + digit passes the limit.
+                if (tooLarge || length > maxRequestBytes_ / 10 || digit > maxRequestBytes_ - length * 10) {
+                    tooLarge = true;
+                } else {
+                    length = length * 10 + digit;
+                }
+                ++digits;
+            }
+            if (digits == 0 || (digits < rest.size() && rest[digits] != ' ')) {
+                reply(channel, "error", "malformed request header");
+                return false;
+            }
+            if (tooLarge) {
+                reply(channel, "error", "request body exceeds the limit of " + std::to_string(maxRequestBytes_) + " bytes");
+                return false;
+            }
+            rest.remove_prefix(digits);
+            if (!channel.readExact(length, html)) {
+                reply(channel, "error", "truncated request body");
+                return false;
+            }
+
+            try {
+                TurndownService& service = serviceFor(rest);
+                reply(channel, "ok", service.turndown(html));
+            } catch (std::exception const& e) {
+                reply(channel, "error", e.what());
+            }
+        }
+        return true;
+    }
+
+private:
+    static constexpr std::size_t kMaxCachedServices = 32;
+
+    TurndownService& serviceFor(std::string_view overrides) {
+        std::vector<std::string_view> tokens;
+        while (!overrides.empty()) {
+            std::size_t space = overrides.find(' ');
+            std::string_view token = overrides.substr(0, space);
+            if (!token.empty()) tokens.push_back(token);
+            if (space == std::string_view::npos) break;
+            overrides.remove_prefix(space + 1);
+        }
+        std::sort(tokens.begin(), tokens.end());
+        std::string signature;
+        for (std::string_view token : tokens) {
+            signature.append(token).push_back(' ');
+        }
+
+        auto it = services_.find(signature);
+        if (it != services_.end()) return *it->second;
+
+        TurndownOptions options = base_;
+        for (std::string_view token : tokens) {
+            std::size_t equals = token.find('=');
+            if (equals == std::string_view::npos) {
+                throw std::runtime_error("malformed option '" + std::string(token) + "'");
+            }
+            applyOptionOverride(options, token.substr(0, equals), percentDecode(token.substr(equals + 1)));
+        }
+        auto service = std::make_unique<TurndownService>(std::move(options));
+        for (auto const& plugin : plugins_) {
+            registerPlugin(plugin, *service);
+        }
+        if (services_.size() >= kMaxCachedServices) services_.clear();
+        return *services_.emplace(std::move(signature), std::move(service)).first->second;
+    }
+
+    static void reply(FdChannel& channel, std::string_view status, std::string_view body) {
+        std::string header(status);
+        header.push_back(' ');
+        header += std::to_string(body.size());
+        header.push_back('\n');
+        channel.write(header);
+        channel.write(body);
+    }
+
+    TurndownOptions base_;
+    std::vector<LoadedPlugin> const& plugins_;
+    std::size_t maxRequestBytes_;
+    std::map<std::string, std::unique_ptr<TurndownService>> services_;
+};
+
+// Runs the server on stdin/stdout, or accepts connections one at a time on
+// a Unix domain socket.
+int runServer(TurndownOptions const& options, std::vector<LoadedPlugin> const& plugins, std::string const& socketPath,
+              std::size_t maxRequestBytes) {
+    Server server(options, plugins, maxRequestBytes);
+    if (socketPath.empty()) {
+#if defined(_WIN32)
+        _setmode(_fileno(stdin), _O_BINARY);
+        _setmode(_fileno(stdout), _O_BINARY);
+        FdChannel channel(_fileno(stdin), _fileno(stdout));
+#else
+        FdChannel channel(STDIN_FILENO, STDOUT_FILENO);
+#endif
+        return server.serve(channel) ? 0 : 1;
+    }
+
+#if defined(_WIN32)
+    std::cerr << "--socket is not supported on this platform\n";
+    return 1;
+#else
+    sockaddr_un address{};
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Socket path too long: " << socketPath << "\n";
+        return 1;
+    }
+    // A client hanging up mid-reply must not kill the server.
+    std::signal(SIGPIPE, SIG_IGN);
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+
+    int listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    ::unlink(socketPath.c_str());
+    if (listener < 0 || ::bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        ::listen(listener, 16) != 0) {
+        std::cerr << "Cannot listen on " << socketPath << ": " << std::strerror(errno) << "\n";
+        if (listener >= 0) ::close(listener);
+        return 1;
+    }
+    while (true) {
+        int connection = ::accept(listener, nullptr, nullptr);
+        if (connection < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "accept failed: " << std::strerror(errno) << "\n";
+            break;
+        }
+        FdChannel channel(connection, connection);
+        // Whatever one client does, the server goes on to the next.
+        try {
+            server.serve(channel);
+        } catch (std::exception const& e) {
+            std::cerr << "connection dropped: " << e.what() << "\n";
+        }
+        ::close(connection);
+    }
+    ::close(listener);
+    ::unlink(socketPath.c_str());
+    return 1;
+#endif
 }
 
 } // namespace
 
 static void usage(char const* prog) {
     std::cerr << "Usage: " << prog << " [--file <path>] [--plugin <path>] [--atx-headings] [--fenced]\n"
+              << "       " << prog << " --batch <dir|list-file> --output-dir <dir> [-j N] [options]\n"
               << "Reads HTML from stdin or --file and writes Markdown to stdout.\n"
               << "Options:\n"
               << "  --file <path>       Read HTML from file instead of stdin\n"
+              << "  --batch <source>    Convert every file below a directory, or every path\n"
+              << "                      listed (one per line) in a file\n"
+              << "  --output-dir <dir>  Where --batch writes <name>.md files\n"
+              << "  -j <N>              Convert N files in parallel (default: all cores); with\n"
+              << "                      --file, convert the document's blocks on N threads\n"
+              << "  --serve             Answer framed requests on stdin/stdout until EOF:\n"
+              << "                      \"<length>[ key=value...]\\n<html>\" -> \"ok <length>\\n<md>\"\n"
+              << "  --socket <path>     With --serve, listen on a Unix domain socket instead\n"
+              << "  --max-request-bytes <N>\n"
+              << "                      With --serve, reject requests longer than N bytes\n"
+              << "                      (default: 64 MiB)\n"
               << "  --plugin <path>     Load a runtime plugin (.so/.dylib/.dll). Can be repeated.\n"
               << "  --atx-headings      Use ATX headings (#)\n"
               << "  --fenced            Use fenced code blocks (```)\n"
@@ -197,13 +886,23 @@ static void usage(char const* prog) {
 }
 
 static std::string read_all(std::istream& in) {
-    std::ostringstream ss;
-    ss << in.rdbuf();
-    return ss.str();
+    std::string data;
+    char chunk[64 * 1024];
+    while (in.read(chunk, sizeof(chunk)) || in.gcount() > 0) {
+        data.append(chunk, static_cast<std::size_t>(in.gcount()));
+    }
+    return data;
 }
 
 int main(int argc, char** argv) {
     std::string filePath;
+    std::string batchSource;
+    std::string outputDir;
+    std::size_t workers = 0;
+    bool workersGiven = false;
+    bool serve = false;
+    std::string socketPath;
+    std::size_t maxRequestBytes = std::size_t{64} << 20;
     turndown_cpp::TurndownOptions opts;
     std::vector<std::string> pluginPaths;
 
@@ -214,6 +913,29 @@ int main(int argc, char** argv) {
             return 0;
         } else if (arg == "--file" && i + 1 < argc) {
             filePath = argv[++i];
+        } else if (arg == "--batch" && i + 1 < argc) {
+            batchSource = argv[++i];
+        } else if (arg == "--output-dir" && i + 1 < argc) {
+            outputDir = argv[++i];
+        } else if (arg == "-j" && i + 1 < argc) {
+            try {
+                workers = static_cast<std::size_t>(std::stoul(argv[++i]));
+                workersGiven = true;
+            } catch (std::exception const&) {
+                usage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "--serve") {
+            serve = true;
+        } else if (arg == "--socket" && i + 1 < argc) {
+            socketPath = argv[++i];
+        } else if (arg == "--max-request-bytes" && i + 1 < argc) {
+            try {
+                maxRequestBytes = static_cast<std::size_t>(std::stoull(argv[++i]));
+            } catch (std::exception const&) {
+                usage(argv[0]);
+                return 1;
+            }
         } else if (arg == "--plugin" && i + 1 < argc) {
             pluginPaths.emplace_back(argv[++i]);
         } else if (arg == "--atx-headings") {
@@ -230,30 +952,80 @@ int main(int argc, char** argv) {
         }
     }
 
-    std::string html;
-    if (!filePath.empty()) {
-        std::ifstream f(filePath);
-        if (!f) {
-            std::cerr << "Failed to open " << filePath << "\n";
-            return 1;
-        }
-        html = read_all(f);
-    } else {
-        html = read_all(std::cin);
+    if (!batchSource.empty() && (outputDir.empty() || !filePath.empty())) {
+        usage(argv[0]);
+        return 1;
+    }
+    if ((serve && (!batchSource.empty() || !filePath.empty())) || (!socketPath.empty() && !serve)) {
+        usage(argv[0]);
+        return 1;
     }
 
     std::vector<LoadedPlugin> loadedPlugins;
-    TurndownService service(opts);
     for (auto const& p : pluginPaths) {
         try {
-            loadedPlugins.push_back(loadAndRegisterPlugin(p, service));
+            loadedPlugins.push_back(loadPlugin(p));
         } catch (std::exception const& e) {
             std::cerr << "Failed to load plugin '" << p << "': " << e.what() << "\n";
             return 1;
         }
     }
 
-    std::cout << service.turndown(html);
+    if (serve) {
+        return runServer(opts, loadedPlugins, socketPath, maxRequestBytes);
+    }
+
+    // A plugin that cannot be called from several threads pins the
+    // conversion to one.
+    auto unsafe = std::find_if(loadedPlugins.begin(), loadedPlugins.end(),
+                               [](LoadedPlugin const& plugin) { return !plugin.threadSafe(); });
+    if (unsafe != loadedPlugins.end()) {
+        if (workersGiven && workers != 1) {
+            std::cerr << "Plugin '" << unsafe->name << "' is not thread-safe; converting on one thread\n";
+        }
+        workers = 1;
+    }
+
+    TurndownService service(opts);
+    for (auto const& plugin : loadedPlugins) {
+        try {
+            registerPlugin(plugin, service);
+        } catch (std::exception const& e) {
+            std::cerr << "Failed to load plugin '" << plugin.path << "': " << e.what() << "\n";
+            return 1;
+        }
+    }
+
+    if (!batchSource.empty()) {
+        try {
+            return runBatch(service, batchSource, outputDir, workers);
+        } catch (std::exception const& e) {
+            std::cerr << "Batch failed: " << e.what() << "\n";
+            return 1;
+        }
+    }
+
+    if (!filePath.empty()) {
+        // Parsed straight from the mapping; the file is never copied.
+        std::optional<MappedFileSource> source;
+        try {
+            source.emplace(filePath);
+        } catch (std::exception const& e) {
+            std::cerr << "Failed to open " << filePath << ": " << e.what() << "\n";
+            return 1;
+        }
+        if (workersGiven && workers != 1 && unsafe == loadedPlugins.end()) {
+            ThreadPool pool(workers);
+            std::cout << service.turndown(source->root(), pool);
+            return 0;
+        }
+        service.turndown(source->root(), [](std::string_view chunk) {
+            std::cout.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+        });
+        return 0;
+    }
+
+    service.turndown(read_all(std::cin), std::cout);
     return 0;
 }
 
@@ -0,0 +1,88 @@
+/// @file batch_converter.h
+/// @brief Parallel conversion of many HTML documents
+///
+/// BatchConverter converts a span of documents on a work-stealing thread
+/// pool (see thread_pool.h) using one configured TurndownService as the
+/// template. A converted service is safe to share between threads: its
+/// rule set is built once and only read afterwards, each conversion owns
+/// its ConversionContext, and with TurndownOptions::useConversionArena
+/// every document gets its own arena. The converter therefore needs no
+/// per-document synchronisation. Each worker parses with its own
+/// dom::Parser, so parser state is reused from one document to the next.
+///
+/// @par Example
+/// @code{.cpp}
+/// TurndownService service;
+/// BatchConverter batch(service);
+/// std::vector<std::string_view> pages = loadPages();
+/// for (BatchResult const& result : batch.convert(pages)) {
+///     if (!result.ok()) std::cerr << result.error << '\n';
+/// }
+/// @endcode
+///
+/// @copyright The MIT License (MIT)
+/// @copyright Copyright (c) 2025 Parsa Amini
+
+#ifndef TURNDOWN_CPP_BATCH_CONVERTER_H
+#define TURNDOWN_CPP_BATCH_CONVERTER_H
+
+#include "dom_adapter.h"
+#include "thread_pool.h"
+
+#include <chrono>
+#include <cstddef>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace turndown_cpp {
+
+class TurndownService;
+
+/// @struct BatchResult
+/// @brief Outcome of converting one document of a batch
+struct BatchResult {
+    std::string markdown;              ///< The Markdown, empty if the conversion failed
+    std::string error;                 ///< What went wrong, empty on success
+    std::chrono::nanoseconds parseTime{0};   ///< Time spent parsing the HTML
+    std::chrono::nanoseconds convertTime{0}; ///< Time spent converting the parsed tree
+    std::size_t worker = 0;            ///< Index of the pool worker that converted it
+    bool cached = false;               ///< True if the service's ConversionCache held the Markdown
+
+    /// @brief Check whether the document converted successfully
+    bool ok() const { return error.empty(); }
+};
+
+/// @class BatchConverter
+/// @brief Converts many documents in parallel with one service
+class BatchConverter {
+public:
+    /// @brief Create a converter backed by its own thread pool
+    /// @param[in] service Configured service used for every document; it
+    ///            must outlive the converter and not be modified while a
+    ///            batch runs
+    /// @param[in] workers Number of workers; 0 uses the hardware concurrency
+    explicit BatchConverter(TurndownService const& service, std::size_t workers = 0);
+
+    /// @brief Convert @p documents
+    ///
+    /// Exceptions thrown while parsing or converting a document are caught
+    /// and reported in its BatchResult; the other documents are unaffected.
+    ///
+    /// @param[in] documents HTML documents; they are read only during the call
+    /// @return One result per document, in input order
+    std::vector<BatchResult> convert(std::span<std::string_view const> documents);
+
+    /// @brief Number of documents converted concurrently
+    std::size_t workers() const { return pool_.size(); }
+
+private:
+    TurndownService const& service_;
+    ThreadPool pool_;
+    std::vector<dom::Parser> parsers_; ///< One per worker
+};
+
+} // namespace turndown_cpp
+
+#endif // TURNDOWN_CPP_BATCH_CONVERTER_H
@@ -5,18 +5,30 @@
 /// `TurndownService::use(...)`. The CLI additionally supports loading plugins
 /// at runtime from shared libraries (.so/.dylib/.dll).
 ///
-/// ABI notes:
-/// - This is a C++ ABI boundary. Plugins must be built with a compatible C++
-///   toolchain/standard library and against matching turndown_cpp headers.
-/// - The exported function names are `extern "C"` to avoid name mangling.
+/// Every plugin exports `turndown_cpp_cli_plugin_abi_version()`, which
+/// selects one of two ABIs:
 ///
-/// A plugin shared library must export:
-/// - `turndown_cpp_cli_plugin_abi_version()` returning `kAbiVersion`
-/// - `turndown_cpp_cli_register_plugin(TurndownService&)` which registers
-///    rules/options on the provided service
+/// - **Version 2** (kAbiVersion): the plugin exports a table of rule
+///   descriptors through `turndown_cpp_cli_plugin_descriptor()`; see
+///   cli_plugin_abi.h. Only C types cross the boundary. The CLI converts
+///   with several threads only if every such plugin sets
+///   TURNDOWN_CPP_PLUGIN_THREAD_SAFE.
+/// - **Version 1** (kAbiVersionLegacy): the plugin exports
+///   `turndown_cpp_cli_register_plugin(TurndownService&)`, which registers
+///   rules/options on the provided service. This is a C++ ABI boundary:
+///   such plugins must be built with a compatible C++ toolchain/standard
+///   library and against matching turndown_cpp headers. The CLI converts
+///   with one thread unless every such plugin exports
+///   `turndown_cpp_cli_plugin_thread_safe()` returning nonzero.
 ///
-/// Optional export:
+/// The exported function names are `extern "C"` to avoid name mangling.
+///
+/// Optional exports:
 /// - `turndown_cpp_cli_plugin_name()` returning a short plugin name
+///   (version 2 plugins name themselves in their descriptor)
+/// - `turndown_cpp_cli_plugin_thread_safe()` returning nonzero if the rules
+///   a version 1 plugin registers may be called from several threads
+///   (version 2 plugins set TURNDOWN_CPP_PLUGIN_THREAD_SAFE instead)
 ///
 /// @copyright The MIT License (MIT)
 /// @copyright Copyright (c) 2025 Parsa Amini
@@ -24,32 +36,33 @@
 #ifndef TURNDOWN_CPP_CLI_PLUGIN_H
 #define TURNDOWN_CPP_CLI_PLUGIN_H
 
+#include "cli_plugin_abi.h"
 #include "turndown.h"
 
 #include <cstdint>
 
-// Export helper for plugin entrypoints.
-#if defined(_WIN32)
-    #define TURNDOWN_CPP_CLI_PLUGIN_EXPORT __declspec(dllexport)
-#else
-    #define TURNDOWN_CPP_CLI_PLUGIN_EXPORT __attribute__((visibility("default")))
-#endif
-
 namespace turndown_cpp::cli_plugin {
 
-/// @brief Runtime plugin ABI version.
-inline constexpr std::uint32_t kAbiVersion = 1;
+/// @brief Current runtime plugin ABI version: rule descriptors.
+inline constexpr std::uint32_t kAbiVersion = 2;
+
+/// @brief Original runtime plugin ABI version: a C++ register function.
+inline constexpr std::uint32_t kAbiVersionLegacy = 1;
 
 /// @brief Required symbol names.
 inline constexpr char kAbiVersionSymbol[] = "turndown_cpp_cli_plugin_abi_version";
+inline constexpr char kDescriptorSymbol[] = "turndown_cpp_cli_plugin_descriptor";
 inline constexpr char kRegisterSymbol[] = "turndown_cpp_cli_register_plugin";
 
-/// @brief Optional symbol name.
+/// @brief Optional symbol names.
 inline constexpr char kNameSymbol[] = "turndown_cpp_cli_plugin_name";
+inline constexpr char kThreadSafeSymbol[] = "turndown_cpp_cli_plugin_thread_safe";
 
 using AbiVersionFn = std::uint32_t (*)();
+using DescriptorFn = turndown_cpp_plugin_descriptor const* (*)();
 using RegisterFn = void (*)(turndown_cpp::TurndownService&);
 using NameFn = char const* (*)();
+using ThreadSafeFn = int (*)();
 
 } // namespace turndown_cpp::cli_plugin
 
@@ -0,0 +1,119 @@
+/** @file cli_plugin_abi.h
+ * @brief C declarations of version 2 of the turndown_cli plugin ABI
+ *
+ * A version 2 plugin describes its rules as data instead of registering
+ * C++ callables: each rule names the tags it applies to and points to
+ * plain C functions. The host turns a descriptor into ordinary rules, so
+ * they take part in the per-tag dispatch like built-in ones. Nothing but
+ * C types crosses the library boundary, so plugins may be written in C or
+ * built with a different C++ toolchain, and need not link turndown_cpp.
+ *
+ * A version 2 plugin exports:
+ * - `turndown_cpp_cli_plugin_abi_version()` returning 2
+ * - `turndown_cpp_cli_plugin_descriptor()` returning its descriptor, which
+ *   must stay valid while the library is loaded
+ *
+ * Strings passed to plugins are not NUL-terminated and are only valid
+ * during the call they are passed to.
+ *
+ * @copyright The MIT License (MIT)
+ * @copyright Copyright (c) 2025 Parsa Amini
+ */
+
+#ifndef TURNDOWN_CPP_CLI_PLUGIN_ABI_H
+#define TURNDOWN_CPP_CLI_PLUGIN_ABI_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Export helper for plugin entrypoints. */
+#if defined(_WIN32)
+    #define TURNDOWN_CPP_CLI_PLUGIN_EXPORT __declspec(dllexport)
+#else
+    #define TURNDOWN_CPP_CLI_PLUGIN_EXPORT __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Plugin flag: rule functions may be called from several threads at once */
+#define TURNDOWN_CPP_PLUGIN_THREAD_SAFE 0x1u
+
+/** @brief Rule flag: render matching elements as HTML; the replacement is not used */
+#define TURNDOWN_CPP_RULE_KEEP 0x1u
+
+/** @brief Rule flag: drop matching elements; the replacement is not used */
+#define TURNDOWN_CPP_RULE_REMOVE 0x2u
+
+/** @brief A borrowed byte string */
+typedef struct turndown_cpp_plugin_string {
+    char const* data;
+    size_t size;
+} turndown_cpp_plugin_string;
+
+/** @brief An element being matched or converted (opaque) */
+typedef struct turndown_cpp_plugin_node turndown_cpp_plugin_node;
+
+/** @brief The options of the conversion (opaque) */
+typedef struct turndown_cpp_plugin_options turndown_cpp_plugin_options;
+
+/** @brief Receives a replacement's Markdown (opaque) */
+typedef struct turndown_cpp_plugin_output turndown_cpp_plugin_output;
+
+/** @brief Functions the host offers to rule functions */
+typedef struct turndown_cpp_plugin_host {
+    /** @brief Lower-case tag name of an element */
+    turndown_cpp_plugin_string (*tag_name)(turndown_cpp_plugin_node const* node);
+    /** @brief Value of an attribute; empty if the element has none by that name */
+    turndown_cpp_plugin_string (*attribute)(turndown_cpp_plugin_node const* node, char const* name);
+    /** @brief A string option by its TurndownOptions name ("emDelimiter", ...); empty if unknown */
+    turndown_cpp_plugin_string (*option)(turndown_cpp_plugin_options const* options, char const* name);
+    /** @brief Append bytes to a replacement's output */
+    void (*append)(turndown_cpp_plugin_output* output, char const* data, size_t size);
+} turndown_cpp_plugin_host;
+
+/** @brief Decide whether a rule applies to an element with one of its tags; nonzero for yes */
+typedef int (*turndown_cpp_plugin_filter_fn)(void* user_data, turndown_cpp_plugin_host const* host,
+                                             turndown_cpp_plugin_node const* node,
+                                             turndown_cpp_plugin_options const* options);
+
+/** @brief Write the Markdown for an element, given its converted content */
+typedef void (*turndown_cpp_plugin_replacement_fn)(void* user_data, turndown_cpp_plugin_host const* host,
+                                                   turndown_cpp_plugin_string content,
+                                                   turndown_cpp_plugin_node const* node,
+                                                   turndown_cpp_plugin_options const* options,
+                                                   turndown_cpp_plugin_output* output);
+
+/** @brief One rule of a plugin */
+typedef struct turndown_cpp_plugin_rule {
+    /** @brief Unique rule key */
+    char const* key;
+    /** @brief Tag names the rule applies to, ending with NULL; NULL for every element */
+    char const* const* tags;
+    /** @brief TURNDOWN_CPP_RULE_* flags */
+    uint32_t flags;
+    /** @brief Further test of an element; NULL to accept every element with one of the tags */
+    turndown_cpp_plugin_filter_fn filter;
+    /** @brief Produces the Markdown; required unless the rule keeps or removes */
+    turndown_cpp_plugin_replacement_fn replacement;
+    /** @brief Passed to filter and replacement */
+    void* user_data;
+} turndown_cpp_plugin_rule;
+
+/** @brief What a version 2 plugin exports */
+typedef struct turndown_cpp_plugin_descriptor {
+    /** @brief Short plugin name, for messages */
+    char const* name;
+    /** @brief TURNDOWN_CPP_PLUGIN_* flags */
+    uint32_t flags;
+    /** @brief The rules, in the order they are added; later rules take precedence */
+    turndown_cpp_plugin_rule const* rules;
+    size_t rule_count;
+} turndown_cpp_plugin_descriptor;
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* TURNDOWN_CPP_CLI_PLUGIN_ABI_H */
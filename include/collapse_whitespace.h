@@ -46,11 +46,21 @@
 #ifndef COLLAPSE_WHITESPACE_H
 #define COLLAPSE_WHITESPACE_H
 
+#include "conversion_limits.h"
 #include "dom_adapter.h"
+#include "dom_concepts.h"
+#include "tag_id.h"
 
-#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <span>
+#include <string_view>
 #include <unordered_map>
-#include <unordered_set>
+#include <vector>
 
 namespace turndown_cpp {
 
@@ -60,18 +70,145 @@ namespace turndown_cpp {
 /// Rather than modifying the DOM tree directly (which is immutable in gumbo),
 /// this structure tracks the changes that should be applied during text
 /// extraction.
+///
+/// The collapse pass numbers the nodes of the tree in preorder, the root
+/// being ordinal 0; this is the numbering NodeTable uses, so the pipeline
+/// looks results up by table index. Per-ordinal state is dense: two
+/// bitsets record which nodes are omitted and which text nodes have
+/// collapsed text, and a table holds that text. Lookups by NodeView map
+/// the node to its ordinal first, through an index built on first use;
+/// several threads may look nodes up at once.
+///
+/// Collapsed text is borrowed wherever possible: text the pass leaves alone
+/// or only trims is a view into the document, and storage is allocated only
+/// for text whose whitespace runs had to be rewritten. Rewritten text is
+/// carved out of one growing buffer, whose blocks never move. The result
+/// is therefore move-only and must not outlive the document.
+///
+/// Elements whose tag is in the pass's pruned set are numbered, but their
+/// descendants get no ordinal, here or in NodeTable, and the rest of the
+/// pipeline does not see them. The pass still collapses their text, since
+/// it decides the whitespace around them, and keeps it as prunedText().
+/// See Rules::prunedTags().
+///
+/// All storage comes from the memory resource given at construction.
+/// Move assignment is not provided, for the same reason the result is
+/// move-only: the views must keep pointing into live storage.
 struct CollapsedWhitespace {
-    /// @brief Map from text node handles to their collapsed text content
+    /// @brief Ordinal value meaning "not part of the collapsed tree"
+    static constexpr std::uint32_t npos = std::numeric_limits<std::uint32_t>::max();
+
+    /// @brief Create an empty result allocating from @p memory
+    /// @param[in] memory Resource the result allocates from
+    /// @param[in] pruned Tags of elements whose descendants are not numbered
+    explicit CollapsedWhitespace(std::pmr::memory_resource* memory = std::pmr::get_default_resource(),
+                                 dom::TagSet pruned = {})
+        : handles_(memory), omitted_(memory), replaced_(memory), texts_(memory), ordinals_(memory),
+          memory_(memory), pruned_(pruned) {}
+    CollapsedWhitespace(CollapsedWhitespace&&) = default;
+    CollapsedWhitespace& operator=(CollapsedWhitespace&&) = delete;
+    CollapsedWhitespace(CollapsedWhitespace const&) = delete;
+    CollapsedWhitespace& operator=(CollapsedWhitespace const&) = delete;
+
+    /// @brief Number of nodes the pass numbered; zero if it had nothing to do
+    std::size_t size() const { return handles_.size(); }
+
+    /// @brief Check whether the node with @p ordinal is skipped entirely
     ///
-    /// Text nodes in this map should use the mapped string value instead
-    /// of their original content.
-    std::unordered_map<dom::NodeHandle, std::string> textReplacements;
+    /// Omitted nodes (typically text that is empty after collapsing, and
+    /// comments) should be skipped during text extraction.
+    bool isOmitted(std::uint32_t ordinal) const { return test(omitted_, ordinal); }
 
-    /// @brief Set of node handles that should be omitted entirely
+    /// @brief Check whether the text node with @p ordinal has collapsed text
+    bool isReplaced(std::uint32_t ordinal) const { return test(replaced_, ordinal); }
+
+    /// @brief Text of a text-like node after collapsing
+    /// @param[in] ordinal The node's ordinal (its NodeTable index)
+    /// @param[in] node The node itself, read if the pass did not visit it
+    /// @return The collapsed text, the node's own text if the pass did not
+    ///         visit it, or an empty view if it was omitted
+    std::string_view text(std::uint32_t ordinal, dom::NodeView node) const {
+        if (isOmitted(ordinal)) return {};
+        return isReplaced(ordinal) ? texts_[ordinal] : node.text();
+    }
+
+    /// @brief Ordinal of @p node, or npos if the pass did not number it
+    std::uint32_t ordinal(dom::NodeView node) const;
+
+    /// @brief Same as isOmitted(std::uint32_t) for a node of the tree
+    bool isOmitted(dom::NodeView node) const { return isOmitted(ordinal(node)); }
+
+    /// @brief Same as text(std::uint32_t, dom::NodeView) for a node of the tree
+    std::string_view text(dom::NodeView node) const { return text(ordinal(node), node); }
+
+    /// @brief Collapsed text of a pruned element's content
     ///
-    /// These nodes (typically empty after whitespace collapsing) should
-    /// be skipped during text extraction.
-    std::unordered_set<dom::NodeHandle> nodesToOmit;
+    /// The text its descendants would have had if the pass had numbered
+    /// them, joined; they affect the whitespace around the element all the
+    /// same. Empty for other nodes and for inert elements.
+    std::string_view prunedText(std::uint32_t ordinal) const {
+        return ordinal < texts_.size() && !isReplaced(ordinal) ? texts_[ordinal] : std::string_view{};
+    }
+
+    /// @brief Number of text nodes whose whitespace runs were rewritten
+    std::size_t rewrittenCount() const { return rewrittenCount_; }
+
+    /// @brief Tags of the elements the pass did not enter
+    dom::TagSet const& pruned() const { return pruned_; }
+
+    /// @name Building
+    /// Used by collapseWhitespace() while it walks the tree.
+    /// @{
+
+    /// @brief Number the next node in preorder
+    /// @return The node's ordinal
+    std::uint32_t addNode(dom::NodeHandle handle);
+
+    /// @brief Mark the node with @p ordinal as omitted
+    void omit(std::uint32_t ordinal) { set(omitted_, ordinal); }
+
+    /// @brief Record the collapsed text of the text node with @p ordinal
+    void replace(std::uint32_t ordinal, std::string_view text) {
+        set(replaced_, ordinal);
+        texts_[ordinal] = text;
+    }
+
+    /// @brief Collapsed text recorded for @p ordinal, for trimming in place
+    std::string_view& replacement(std::uint32_t ordinal) { return texts_[ordinal]; }
+
+    /// @brief Record the collapsed text of the pruned element with @p ordinal
+    /// @param[in] ordinal The pruned element
+    /// @param[in] pieces Collapsed text of its descendants, in document order
+    void setPrunedText(std::uint32_t ordinal, std::span<std::string_view const> pieces);
+
+    /// @brief Replace each run of ASCII spaces, tabs and line breaks with one space
+    /// @param[in] text The text of a node
+    /// @return @p text itself if already collapsed, otherwise a view of the
+    ///         rewritten copy in the result's buffer
+    std::string_view collapseSpaceRuns(std::string_view text);
+
+    /// @}
+
+private:
+    static bool test(std::pmr::vector<std::uint64_t> const& bits, std::uint32_t ordinal) {
+        return ordinal < bits.size() * 64 && (bits[ordinal / 64] >> (ordinal % 64)) & 1u;
+    }
+    static void set(std::pmr::vector<std::uint64_t>& bits, std::uint32_t ordinal) {
+        bits[ordinal / 64] |= std::uint64_t{1} << (ordinal % 64);
+    }
+
+    std::pmr::vector<dom::NodeHandle> handles_;  ///< Node of each ordinal
+    std::pmr::vector<std::uint64_t> omitted_;    ///< Bitset of omitted ordinals
+    std::pmr::vector<std::uint64_t> replaced_;   ///< Bitset of ordinals with collapsed text
+    std::pmr::vector<std::string_view> texts_;   ///< Collapsed text, valid where replaced
+    mutable std::pmr::unordered_map<dom::NodeHandle, std::uint32_t> ordinals_; ///< Built on first use
+    /// Guards building ordinals_, which conversion threads may ask for at once
+    std::unique_ptr<std::once_flag> ordinalsBuilt_ = std::make_unique<std::once_flag>();
+    std::pmr::memory_resource* memory_;
+    dom::TagSet pruned_;
+    /// Owner of rewritten text; created with the first rewrite
+    std::unique_ptr<std::pmr::monotonic_buffer_resource> buffer_;
+    std::size_t rewrittenCount_ = 0;
 };
 
 /// @brief Collapse whitespace in a DOM tree
@@ -83,7 +220,11 @@ struct CollapsedWhitespace {
 /// @param[in] element The root element to process
 /// @param[in] treatCodeAsPre When true, treat \<code\> elements like \<pre\>
 ///                           (preserve their whitespace)
+/// @param[in] memory Resource the result allocates from
+/// @param[in] pruned Tags of elements to treat as empty (see Rules::prunedTags())
+/// @param[in,out] limits Polled between nodes; null for no limits
 /// @return Structure containing text replacements and nodes to skip
+/// @throws ConversionLimitExceeded if @p limits reports a deadline or cancellation
 ///
 /// @par Algorithm Details
 ///
@@ -101,7 +242,239 @@ struct CollapsedWhitespace {
 ///
 /// -# At the end:
 ///    - Trailing whitespace from the last text node is trimmed
-CollapsedWhitespace collapseWhitespace(dom::NodeView element, bool treatCodeAsPre);
+CollapsedWhitespace collapseWhitespace(dom::NodeView element, bool treatCodeAsPre,
+                                       std::pmr::memory_resource* memory = std::pmr::get_default_resource(),
+                                       dom::TagSet const& pruned = {}, detail::LimitGuard* limits = nullptr);
+
+namespace detail {
+
+/// @brief Identity of any node as the facade's handle type
+template <dom::DOMNodeWithHandle Node>
+dom::NodeHandle handleOf(Node const& node) {
+    return dom::NodeHandle(node.handle().raw());
+}
+
+/// @brief \<pre\>, or \<code\> when it is treated as preformatted
+template <dom::DOMNode Node>
+bool isPreNode(Node const& node, bool treatCodeAsPre) {
+    dom::TagId tag = node.tag_id();
+    if (tag == dom::TagId::Pre) return true;
+    return treatCodeAsPre && tag == dom::TagId::Code;
+}
+
+/// @brief Check whether the walk numbers @p node but does not enter it
+///
+/// Non-elements report TagId::Unknown, which is never pruned.
+template <dom::DOMNode Node>
+bool isPruned(Node const& node, dom::TagSet const& pruned) {
+    return pruned.contains(node.tag_id());
+}
+
+} // namespace detail
+
+/// @brief Collapse whitespace in a tree of any DOMNodeWithHandle type
+///
+/// The algorithm of collapseWhitespace(dom::NodeView, bool, std::pmr::memory_resource*),
+/// instantiated for @p Node, so a concrete backend's navigation calls can
+/// be inlined. The facade overload calls it with the selected backend's
+/// node type whenever it is given a backend tree. Handles in the result
+/// are the nodes' raw pointers, the same for a backend node and the
+/// dom::NodeView wrapping it.
+///
+/// @tparam Node A node type modelling dom::DOMNodeWithHandle
+/// @param[in] element The root element to process
+/// @param[in] treatCodeAsPre When true, treat \<code\> elements like \<pre\>
+/// @param[in] memory Resource the result allocates from
+/// @param[in] pruned Tags of elements to treat as empty
+/// @param[in,out] limits Polled between nodes; null for no limits
+/// @return Structure containing text replacements and nodes to skip
+template <dom::DOMNodeWithHandle Node>
+CollapsedWhitespace collapseWhitespace(Node element, bool treatCodeAsPre,
+                                       std::pmr::memory_resource* memory = std::pmr::get_default_resource(),
+                                       dom::TagSet const& pruned = {}, detail::LimitGuard* limits = nullptr) {
+    using detail::handleOf;
+    CollapsedWhitespace result(memory, pruned);
+    if (!element || detail::isPreNode(element, treatCodeAsPre) || !element.first_child()) {
+        return result;
+    }
+    result.addNode(handleOf(element));
+
+    // Every node is numbered when the walk first reaches it. Subtrees the
+    // walk does not enter (preformatted content) are numbered in passing,
+    // so ordinals stay aligned with a preorder walk that skips the
+    // descendants of pruned elements.
+    //
+    // The content of a pruned element is walked all the same, so that the
+    // whitespace around it collapses as if it were converted, but it is
+    // not numbered: its text goes to shadow slots, and once the walk is
+    // done each pruned element's slots are joined into its prunedText().
+    struct Shadowed {
+        std::uint32_t ordinal; ///< The pruned element
+        std::size_t first;     ///< Its first shadow slot
+        std::size_t last;      ///< One past its last shadow slot
+    };
+    std::pmr::vector<std::string_view> shadowTexts(memory);
+    std::pmr::vector<Shadowed> shadowed(memory);
+    Node shadowRoot; ///< Outermost pruned element being walked, if any
+
+    std::uint32_t ordinal = 0;
+    auto enter = [&](Node const& node) {
+        if (!shadowRoot) ordinal = result.addNode(handleOf(node));
+        return node;
+    };
+    // Inside pruned content, the text of such subtrees is kept as it is.
+    auto numberDescendants = [&](Node const& node) {
+        Node current = node.first_child();
+        while (current) {
+            if (!shadowRoot) {
+                result.addNode(handleOf(current));
+            } else if (current.is_text_like() && !current.text().empty()) {
+                shadowTexts.push_back(current.text());
+            }
+            Node child = detail::isPruned(current, pruned) ? Node{} : current.first_child();
+            if (child) {
+                current = child;
+                continue;
+            }
+            while (current != node && !current.next_sibling()) {
+                current = current.parent();
+            }
+            current = current == node ? Node{} : current.next_sibling();
+        }
+    };
+    // The next node in document order, given the current and previous ones.
+    // Skips into children unless we just came from a child or the current
+    // node is preformatted (in which case we skip its contents) or inert
+    // (in which case its contents are not part of the document). Entering
+    // a pruned element starts a shadow walk; returning to it ends one.
+    auto nextNode = [&](Node const& prev, Node const& current) -> Node {
+        bool prevIsParent = prev && prev.parent() == current;
+        if (prevIsParent && current == shadowRoot) {
+            shadowed.back().last = shadowTexts.size();
+            shadowRoot = Node{};
+        }
+        if (!prevIsParent && current != element && detail::isPruned(current, pruned)) {
+            Node child = current.first_child();
+            if (child && !dom::kInertTags.contains(current.tag_id())) {
+                if (!shadowRoot) {
+                    shadowed.push_back({ordinal, shadowTexts.size(), shadowTexts.size()});
+                    shadowRoot = current;
+                }
+                return enter(child);
+            }
+            if (Node sibling = current.next_sibling()) return enter(sibling);
+            return current.parent();
+        }
+        if (prevIsParent || detail::isPreNode(current, treatCodeAsPre)) {
+            if (!prevIsParent) numberDescendants(current);
+            if (Node sibling = current.next_sibling()) return enter(sibling);
+            return current.parent();
+        }
+        if (Node child = current.first_child()) return enter(child);
+        if (Node sibling = current.next_sibling()) return enter(sibling);
+        return current.parent();
+    };
+    // The node that follows if @p node is removed from processing.
+    auto afterRemoval = [&](Node const& node) -> Node {
+        numberDescendants(node);
+        if (Node sibling = node.next_sibling()) return enter(sibling);
+        return node.parent();
+    };
+
+    // The last text kept, as an ordinal or, inside pruned content, a
+    // shadow slot.
+    constexpr std::size_t none = std::numeric_limits<std::size_t>::max();
+    std::size_t prevText = none;
+    bool prevIsShadow = false;
+    auto previous = [&]() -> std::string_view& {
+        return prevIsShadow ? shadowTexts[prevText] : result.replacement(static_cast<std::uint32_t>(prevText));
+    };
+    // Drops a trailing space from the last text before a block or the end.
+    auto trimTrailingSpace = [&] {
+        std::string_view& text = previous();
+        if (!text.empty() && text.back() == ' ') {
+            text.remove_suffix(1);
+            if (text.empty() && !prevIsShadow) result.omit(static_cast<std::uint32_t>(prevText));
+        }
+    };
+    bool keepLeadingWhitespace = false;
+
+    Node prevNode;
+    Node currentNode = nextNode(prevNode, element);
+
+    while (currentNode && currentNode != element) {
+        if (limits && limits->poll()) limits->raise();
+        if (currentNode.is_text_like()) {
+            std::string_view text = result.collapseSpaceRuns(currentNode.text());
+
+            bool prevEndedWithSpace = false;
+            if (prevText != none) {
+                std::string_view last = previous();
+                prevEndedWithSpace = !last.empty() && last.back() == ' ';
+            }
+
+            if ((prevText == none || prevEndedWithSpace) && !keepLeadingWhitespace && !text.empty() && text.front() == ' ') {
+                text.remove_prefix(1);
+            }
+
+            if (text.empty()) {
+                if (!shadowRoot) result.omit(ordinal);
+                // The tree is not modified, so remember where we came from;
+                // otherwise returning to the parent would descend into it again.
+                prevNode = currentNode;
+                currentNode = afterRemoval(currentNode);
+                continue;
+            }
+
+            if (shadowRoot) {
+                prevText = shadowTexts.size();
+                shadowTexts.push_back(text);
+            } else {
+                result.replace(ordinal, text);
+                prevText = ordinal;
+            }
+            prevIsShadow = static_cast<bool>(shadowRoot);
+        } else if (currentNode.is_element()) {
+            dom::TagId tag = currentNode.tag_id();
+            bool blockLike = dom::kBlockTags.contains(tag);
+            bool isBr = tag == dom::TagId::Br;
+            bool preNode = detail::isPreNode(currentNode, treatCodeAsPre);
+            bool voidNode = dom::kVoidTags.contains(tag);
+
+            if (blockLike || isBr) {
+                if (prevText != none) {
+                    trimTrailingSpace();
+                }
+                prevText = none;
+                keepLeadingWhitespace = false;
+            } else if (voidNode || preNode) {
+                prevText = none;
+                keepLeadingWhitespace = true;
+            } else if (prevText != none) {
+                keepLeadingWhitespace = false;
+            }
+        } else {
+            if (!shadowRoot) result.omit(ordinal);
+            prevNode = currentNode;
+            currentNode = afterRemoval(currentNode);
+            continue;
+        }
+
+        Node next = nextNode(prevNode, currentNode);
+        prevNode = currentNode;
+        currentNode = next;
+    }
+
+    if (prevText != none) {
+        trimTrailingSpace();
+    }
+
+    for (Shadowed const& entry : shadowed) {
+        result.setPrunedText(entry.ordinal, {shadowTexts.data() + entry.first, entry.last - entry.first});
+    }
+
+    return result;
+}
 
 } // namespace turndown_cpp
 
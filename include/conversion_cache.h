@@ -0,0 +1,177 @@
+/// @file conversion_cache.h
+/// @brief Content-addressed cache of conversion results
+///
+/// Crawled corpora repeat themselves: identical pages, and per-site
+/// boilerplate (navigation, footers, cookie banners) that recurs across
+/// thousands of otherwise different pages. A ConversionCache attached to a
+/// TurndownService remembers Markdown at two levels:
+///
+/// - **Documents**: the HTML string overloads of TurndownService::turndown()
+///   and BatchConverter look the whole input up before parsing it.
+/// - **Subtrees**: while converting, block elements whose subtree holds at
+///   least minSubtreeBytes() of tag names, attributes and text are looked
+///   up by a hash of that content, so repeated boilerplate is converted
+///   once and afterwards copied.
+///
+/// Keys combine a fingerprint of the service's options and rule set with
+/// a 64-bit hash and the length of the content. The cache holds at most
+/// capacityBytes() of Markdown (plus a fixed per-entry overhead) and evicts
+/// the least recently used entries beyond that. It is internally
+/// synchronised; share one instance between threads, services and
+/// BatchConverter runs through the std::shared_ptr it is attached with.
+///
+/// @par Example
+/// @code{.cpp}
+/// auto cache = std::make_shared<ConversionCache>(256 * 1024 * 1024);
+/// service.setCache(cache);
+/// std::string markdown = service.turndown(html);
+/// ConversionCacheStats stats = cache->stats();
+/// @endcode
+///
+/// @copyright The MIT License (MIT)
+/// @copyright Copyright (c) 2025 Parsa Amini
+
+#ifndef TURNDOWN_CPP_CONVERSION_CACHE_H
+#define TURNDOWN_CPP_CONVERSION_CACHE_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace turndown_cpp {
+
+/// @brief Hash used for cache keys
+///
+/// A 64-bit hash that consumes its input eight bytes at a time. It is not
+/// cryptographic: inputs chosen to collide can make two keys equal.
+///
+/// @param[in] data Bytes to hash
+/// @param[in] seed Starting value; different seeds give unrelated hashes
+/// @return Hash of @p data
+std::uint64_t contentHash(std::string_view data, std::uint64_t seed = 0);
+
+/// @brief Combine two hashes, order-sensitively
+std::uint64_t combineHash(std::uint64_t seed, std::uint64_t value);
+
+/// @enum CacheLevel
+/// @brief What a cache entry holds the Markdown of
+enum class CacheLevel {
+    Document, ///< A whole HTML document
+    Subtree   ///< One element and its descendants, in context
+};
+
+/// @struct ConversionCacheStats
+/// @brief Counters of a ConversionCache since construction or clear()
+struct ConversionCacheStats {
+    std::size_t documentHits = 0;   ///< Documents answered from the cache
+    std::size_t documentMisses = 0; ///< Documents looked up and converted
+    std::size_t subtreeHits = 0;    ///< Subtrees answered from the cache
+    std::size_t subtreeMisses = 0;  ///< Subtrees looked up and converted
+    std::size_t insertions = 0;     ///< Entries stored
+    std::size_t evictions = 0;      ///< Entries dropped to stay within capacity
+    std::size_t entries = 0;        ///< Entries currently held
+    std::size_t bytes = 0;          ///< Bytes currently charged, overhead included
+};
+
+/// @class ConversionCache
+/// @brief Bounded, thread-safe map from content keys to Markdown
+///
+/// Entries are spread over independently locked shards, so concurrent
+/// conversions rarely contend. Each shard keeps its own LRU order and an
+/// equal part of the capacity.
+class ConversionCache {
+public:
+    /// @struct Key
+    /// @brief Identity of a cached result
+    struct Key {
+        std::uint64_t config = 0;  ///< Fingerprint of the options and rules
+        std::uint64_t content = 0; ///< Hash of the input
+        std::uint64_t context = 0; ///< Hash of surroundings the result depends on (subtrees)
+        std::uint64_t size = 0;    ///< Length of the input
+        CacheLevel level = CacheLevel::Document;
+
+        bool operator==(Key const&) const = default;
+    };
+
+    /// @brief Default capacity: 64 MiB
+    static constexpr std::size_t kDefaultCapacity = std::size_t{64} << 20;
+
+    /// @brief Default subtree threshold: 1 KiB
+    static constexpr std::size_t kDefaultMinSubtreeBytes = 1024;
+
+    /// @brief Bytes charged to every entry on top of its Markdown
+    static constexpr std::size_t kEntryOverhead = 128;
+
+    /// @brief Create an empty cache
+    /// @param[in] capacityBytes Upper bound on the bytes charged to entries
+    /// @param[in] minSubtreeBytes Smallest subtree content looked up; 0 disables the subtree level
+    explicit ConversionCache(std::size_t capacityBytes = kDefaultCapacity,
+                             std::size_t minSubtreeBytes = kDefaultMinSubtreeBytes);
+
+    ConversionCache(ConversionCache const&) = delete;
+    ConversionCache& operator=(ConversionCache const&) = delete;
+
+    /// @brief Look a key up, counting a hit or a miss at its level
+    /// @return The cached Markdown, or null on a miss
+    std::shared_ptr<std::string const> find(Key const& key);
+
+    /// @brief Store the Markdown for a key
+    ///
+    /// Replaces an existing entry. Results larger than a shard's part of
+    /// the capacity are not stored.
+    void insert(Key const& key, std::string markdown);
+
+    /// @brief Drop every entry and reset the counters
+    void clear();
+
+    /// @brief Snapshot of the counters
+    ConversionCacheStats stats() const;
+
+    /// @brief Upper bound on the bytes charged to entries
+    std::size_t capacityBytes() const { return capacity_; }
+
+    /// @brief Smallest subtree content, in bytes, looked up at the subtree level
+    std::size_t minSubtreeBytes() const { return minSubtreeBytes_; }
+
+private:
+    static constexpr std::size_t kShards = 16;
+
+    struct KeyHash {
+        std::size_t operator()(Key const& key) const;
+    };
+
+    struct Entry {
+        Key key;
+        std::shared_ptr<std::string const> markdown;
+    };
+
+    struct Shard {
+        mutable std::mutex mutex;
+        std::list<Entry> lru; ///< Most recently used first
+        std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+        std::size_t bytes = 0;
+    };
+
+    Shard& shardFor(Key const& key);
+
+    std::size_t capacity_;
+    std::size_t minSubtreeBytes_;
+    std::array<Shard, kShards> shards_;
+    std::atomic<std::size_t> documentHits_{0};
+    std::atomic<std::size_t> documentMisses_{0};
+    std::atomic<std::size_t> subtreeHits_{0};
+    std::atomic<std::size_t> subtreeMisses_{0};
+    std::atomic<std::size_t> insertions_{0};
+    std::atomic<std::size_t> evictions_{0};
+};
+
+} // namespace turndown_cpp
+
+#endif // TURNDOWN_CPP_CONVERSION_CACHE_H
@@ -0,0 +1,184 @@
+/// @file conversion_context.h
+/// @brief Per-conversion state for the HTML to Markdown pipeline
+///
+/// Every call to TurndownService::turndown() creates one ConversionContext
+/// and threads it through the conversion. Anything that describes a single
+/// document — such as the result of whitespace collapsing, or the link
+/// references a rule collects — lives here rather than in globals or in the
+/// (shared) rule set, which is what makes concurrent conversions with one
+/// service safe.
+///
+/// @copyright The MIT License (MIT)
+/// @copyright Copyright (c) 2025 Parsa Amini
+
+#ifndef CONVERSION_CONTEXT_H
+#define CONVERSION_CONTEXT_H
+
+#include "collapse_whitespace.h"
+#include "dom_adapter.h"
+#include "node.h"
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace turndown_cpp {
+
+/// @struct RuleState
+/// @brief Base class for state a rule keeps for the length of one conversion
+///
+/// Rules that need to remember something between calls (for example the
+/// references collected by the reference link rule) derive a state type
+/// from RuleState and fetch it with ConversionContext::ruleState().
+struct RuleState {
+    virtual ~RuleState() = default;
+
+    /// @brief Take over the state a later part of the same document left
+    ///
+    /// A parallel conversion converts parts of a document with contexts of
+    /// their own, then merges their states in document order into the
+    /// state of the first part. State types that cannot be combined keep
+    /// this default, which makes the conversion start again sequentially.
+    ///
+    /// @param[in,out] later State of the part that follows this one
+    /// @retval true if @p later was merged into this state
+    virtual bool merge(RuleState& later) {
+        (void)later;
+        return false;
+    }
+};
+
+/// @class ConversionContext
+/// @brief State owned by a single conversion
+class ConversionContext {
+public:
+    /// @brief Create a context for a document that has been collapsed
+    ///
+    /// Annotates the tree once (see NodeTable) so the pipeline never has
+    /// to re-walk a subtree to answer questions about it.
+    ///
+    /// @param[in] root The root node being converted
+    /// @param[in] collapsed Result of collapseWhitespace() for the document
+    /// @param[in] preformattedCode Whether code elements preserve whitespace
+    /// @param[in] memory Resource for per-conversion storage, typically the
+    ///            conversion arena when TurndownOptions::useConversionArena is set
+    ConversionContext(dom::NodeView root, CollapsedWhitespace collapsed, bool preformattedCode,
+                      std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+        : memory_(memory),
+          owned_(std::in_place, root, std::move(collapsed), preformattedCode, memory),
+          document_(&*owned_) {}
+
+    /// @brief Create a context for one part of another context's document
+    ///
+    /// Used by parallel conversions: the part shares the annotations of
+    /// @p document, which must outlive it, and has rule state of its own.
+    ///
+    /// @param[in] document Context of the whole document
+    /// @param[in] priorApplications Times each stateful rule, by key, ran
+    ///            on the parts of the document before this one
+    /// @param[in] memory Resource for this part's storage
+    ConversionContext(ConversionContext const& document,
+                      std::vector<std::pair<std::string, std::size_t>> priorApplications,
+                      std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+        : memory_(memory), document_(document.document_), priorApplications_(std::move(priorApplications)) {}
+
+    ConversionContext(ConversionContext const&) = delete;
+    ConversionContext& operator=(ConversionContext const&) = delete;
+
+    /// @brief Whitespace collapse result for the document being converted
+    /// @return Text replacements and omitted nodes to apply when reading text
+    CollapsedWhitespace const& collapsedWhitespace() const { return document_->collapsed; }
+
+    /// @brief Node annotations for the document being converted
+    /// @return Table indexed in document order, the root at index 0
+    NodeTable const& nodes() const { return document_->nodes; }
+
+    /// @brief Memory resource for storage that lives as long as the conversion
+    ///
+    /// Rules may allocate their per-conversion state from it. With the
+    /// conversion arena enabled, deallocation is a no-op and everything is
+    /// released when the conversion finishes.
+    std::pmr::memory_resource* memory() const { return memory_; }
+
+    /// @brief Access state stored for a rule during this conversion
+    ///
+    /// The state is default-constructed the first time it is requested for
+    /// @p key and destroyed together with the context.
+    ///
+    /// @tparam State A default-constructible type derived from RuleState
+    /// @param[in] key Identifier of the state, typically the rule's key
+    /// @return Reference to the state for @p key
+    /// @pre Every request for @p key uses the same @p State type
+    template <typename State>
+    State& ruleState(std::string const& key) {
+        static_assert(std::is_base_of_v<RuleState, State>, "State must derive from RuleState");
+        auto& slot = ruleStates_[key];
+        if (!slot) {
+            slot = std::make_unique<State>();
+        }
+        return static_cast<State&>(*slot);
+    }
+
+    /// @brief How often a rule ran before the part this context converts
+    ///
+    /// Zero, except for the parts of a parallel conversion after the
+    /// first. Rules that number what they collect (such as reference
+    /// links) start counting from here, so the numbers come out as in a
+    /// sequential conversion.
+    ///
+    /// @param[in] ruleKey Key of the rule
+    /// @return Number of times the rule ran earlier in the document
+    std::size_t priorApplications(std::string_view ruleKey) const {
+        for (auto const& [key, count] : priorApplications_) {
+            if (key == ruleKey) return count;
+        }
+        return 0;
+    }
+
+    /// @brief Merge the rule states of the context of the next part
+    ///
+    /// @param[in,out] later Context of the part following this one
+    /// @retval false if a state could not be merged (see RuleState::merge())
+    bool mergeRuleStates(ConversionContext& later) {
+        for (auto& [key, state] : later.ruleStates_) {
+            auto& slot = ruleStates_[key];
+            if (!slot) {
+                slot = std::move(state);
+            } else if (!slot->merge(*state)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// @brief Drop every rule state
+    void clearRuleStates() { ruleStates_.clear(); }
+
+private:
+    /// @brief Annotations of the document, shared by the parts of a parallel conversion
+    struct Annotations {
+        Annotations(dom::NodeView root, CollapsedWhitespace collapsedResult, bool preformattedCode,
+                 std::pmr::memory_resource* memory)
+            : collapsed(std::move(collapsedResult)), nodes(root, collapsed, preformattedCode, memory) {}
+
+        CollapsedWhitespace collapsed;
+        NodeTable nodes;
+    };
+
+    std::pmr::memory_resource* memory_;
+    std::optional<Annotations> owned_;
+    Annotations const* document_;
+    std::vector<std::pair<std::string, std::size_t>> priorApplications_;
+    std::unordered_map<std::string, std::unique_ptr<RuleState>> ruleStates_;
+};
+
+} // namespace turndown_cpp
+
+#endif // CONVERSION_CONTEXT_H
@@ -0,0 +1,206 @@
+/// @file conversion_limits.h
+/// @brief Budgets and cancellation for a single conversion
+///
+/// A conversion normally runs to the end of its input. Services with a
+/// latency budget pass ConversionLimits to TurndownService::turndown()
+/// instead: a deadline, caps on the nodes visited, the output size and the
+/// nesting depth, and a std::stop_token another thread can cancel the
+/// conversion through. The limits are checked between nodes, while
+/// whitespace is collapsed and while the tree is walked; a rule that is
+/// already running is not interrupted.
+///
+/// When a limit is reached the conversion either stops and returns the
+/// Markdown of what it has visited so far (LimitAction::Truncate) or throws
+/// ConversionLimitExceeded (LimitAction::Throw).
+///
+/// @par Example
+/// @code{.cpp}
+/// ConversionLimits limits;
+/// limits.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(50);
+/// limits.maxOutputBytes = 1 << 20;
+/// LimitedConversion result = service.turndown(html, limits);
+/// if (!result.complete()) log("truncated by " + std::string(toString(result.limit)));
+/// @endcode
+///
+/// @copyright The MIT License (MIT)
+/// @copyright Copyright (c) 2025 Parsa Amini
+
+#ifndef TURNDOWN_CPP_CONVERSION_LIMITS_H
+#define TURNDOWN_CPP_CONVERSION_LIMITS_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <stop_token>
+#include <string>
+
+namespace turndown_cpp {
+
+/// @enum LimitKind
+/// @brief Which limit stopped a conversion
+enum class LimitKind : std::uint8_t {
+    None,        ///< No limit was reached
+    Deadline,    ///< ConversionLimits::deadline passed
+    Nodes,       ///< More than ConversionLimits::maxNodes nodes were visited
+    OutputBytes, ///< The output grew beyond ConversionLimits::maxOutputBytes
+    Depth,       ///< An element was nested deeper than ConversionLimits::maxNestingDepth
+    Cancelled    ///< ConversionLimits::cancellation was requested to stop
+};
+
+/// @brief Name of a limit, for logs and error messages
+constexpr char const* toString(LimitKind kind) {
+    switch (kind) {
+        case LimitKind::None: return "none";
+        case LimitKind::Deadline: return "deadline";
+        case LimitKind::Nodes: return "node limit";
+        case LimitKind::OutputBytes: return "output limit";
+        case LimitKind::Depth: return "depth limit";
+        case LimitKind::Cancelled: return "cancelled";
+    }
+    return "unknown";
+}
+
+/// @enum LimitAction
+/// @brief What a conversion does when it reaches a limit
+enum class LimitAction {
+    Truncate, ///< Stop and return the Markdown converted so far
+    Throw     ///< Throw ConversionLimitExceeded
+};
+
+/// @struct ConversionLimits
+/// @brief Budgets for one conversion; the defaults impose none
+struct ConversionLimits {
+    /// @brief Time by which the conversion must have finished
+    std::optional<std::chrono::steady_clock::time_point> deadline;
+
+    /// @brief Nodes of any type the walk may visit; 0 for no limit
+    std::size_t maxNodes = 0;
+
+    /// @brief Bytes of Markdown the result may hold; 0 for no limit
+    ///
+    /// A truncated result is cut to at most this many bytes, at a UTF-8
+    /// character boundary.
+    std::size_t maxOutputBytes = 0;
+
+    /// @brief Depth beyond which elements stop the conversion; 0 for no limit
+    ///
+    /// Counted like TurndownOptions::maxDepth, which instead converts such
+    /// elements as text and carries on.
+    std::size_t maxNestingDepth = 0;
+
+    /// @brief Stops the conversion once a stop is requested through its source
+    std::stop_token cancellation;
+
+    /// @brief What to do when a limit is reached
+    LimitAction onLimit = LimitAction::Truncate;
+};
+
+/// @class ConversionLimitExceeded
+/// @brief Thrown when a conversion under LimitAction::Throw reaches a limit
+class ConversionLimitExceeded : public std::runtime_error {
+public:
+    /// @brief Report that @p kind was reached
+    explicit ConversionLimitExceeded(LimitKind kind)
+        : std::runtime_error(std::string("conversion stopped: ") + toString(kind)), kind_(kind) {}
+
+    /// @brief The limit that was reached
+    LimitKind kind() const noexcept { return kind_; }
+
+private:
+    LimitKind kind_;
+};
+
+/// @struct LimitedConversion
+/// @brief Result of a conversion under ConversionLimits
+struct LimitedConversion {
+    std::string markdown;             ///< The Markdown, possibly of a prefix of the document
+    LimitKind limit = LimitKind::None; ///< The limit the conversion stopped at, if any
+
+    /// @brief Check whether the whole document was converted
+    bool complete() const { return limit == LimitKind::None; }
+};
+
+namespace detail {
+
+/// @class LimitGuard
+/// @brief Checks ConversionLimits while one conversion runs
+///
+/// The counters are plain members; the clock and the stop token are only
+/// read every kPollInterval checks, and on the first one.
+class LimitGuard {
+public:
+    /// @brief Calls between reads of the clock and the stop token
+    static constexpr std::uint32_t kPollInterval = 256;
+
+    explicit LimitGuard(ConversionLimits const& limits) : limits_(limits) {}
+
+    /// @brief Count a visited node
+    /// @param[in] outputBytes Bytes of Markdown buffered so far
+    /// @retval true once a limit is reached
+    bool visit(std::size_t outputBytes) {
+        if (reached_ != LimitKind::None) return true;
+        if (limits_.maxNodes != 0 && ++nodes_ > limits_.maxNodes) return reach(LimitKind::Nodes);
+        if (limits_.maxOutputBytes != 0 && outputBytes > limits_.maxOutputBytes) return reach(LimitKind::OutputBytes);
+        return poll();
+    }
+
+    /// @brief Check an element about to be entered at @p depth
+    /// @retval true once a limit is reached
+    bool enter(std::size_t depth) {
+        if (reached_ != LimitKind::None) return true;
+        if (limits_.maxNestingDepth != 0 && depth >= limits_.maxNestingDepth) return reach(LimitKind::Depth);
+        return false;
+    }
+
+    /// @brief Check the deadline and the stop token, every kPollInterval calls
+    /// @retval true once a limit is reached
+    bool poll() {
+        if (reached_ != LimitKind::None) return true;
+        if (++sincePoll_ < kPollInterval) return false;
+        sincePoll_ = 0;
+        if (limits_.cancellation.stop_requested()) return reach(LimitKind::Cancelled);
+        if (limits_.deadline && std::chrono::steady_clock::now() >= *limits_.deadline) return reach(LimitKind::Deadline);
+        return false;
+    }
+
+    /// @brief Abandon the current stage after a check returned true
+    [[noreturn]] void raise() const { throw ConversionLimitExceeded(reached_); }
+
+    /// @brief Hold the finished output to maxOutputBytes
+    ///
+    /// Rules applied to the elements still open when the walk stopped, and
+    /// append functions, can add to the output after the last check.
+    void limitOutput(std::string& markdown) {
+        if (limits_.maxOutputBytes == 0 || markdown.size() <= limits_.maxOutputBytes) return;
+        if (reached_ == LimitKind::None) reach(LimitKind::OutputBytes);
+        std::size_t end = limits_.maxOutputBytes;
+        while (end > 0 && (static_cast<unsigned char>(markdown[end]) & 0xC0) == 0x80) --end;
+        markdown.resize(end);
+    }
+
+    /// @brief The limit reached, or LimitKind::None
+    LimitKind reached() const { return reached_; }
+
+    /// @brief Check whether reaching a limit throws
+    bool throws() const { return limits_.onLimit == LimitAction::Throw; }
+
+private:
+    bool reach(LimitKind kind) {
+        reached_ = kind;
+        if (throws()) raise();
+        return true;
+    }
+
+    ConversionLimits const& limits_;
+    std::size_t nodes_ = 0;
+    std::uint32_t sincePoll_ = kPollInterval - 1;
+    LimitKind reached_ = LimitKind::None;
+};
+
+} // namespace detail
+
+} // namespace turndown_cpp
+
+#endif // TURNDOWN_CPP_CONVERSION_LIMITS_H
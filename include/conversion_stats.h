@@ -0,0 +1,78 @@
+/// @file conversion_stats.h
+/// @brief Profiling counters for a single conversion
+///
+/// Pass a ConversionStats to the instrumented TurndownService::turndown()
+/// overloads to find out where a slow document spends its time. The
+/// instrumentation is a compile-time policy of the pipeline: the plain
+/// overloads run a build of it with every counter compiled out, so callers
+/// that do not ask for statistics pay nothing for them.
+///
+/// @par Example
+/// @code{.cpp}
+/// ConversionStats stats;
+/// std::string markdown = service.turndown(html, stats);
+/// for (auto const& [key, rule] : stats.rules) {
+///     std::cerr << key << ": " << rule.hits << " hits, "
+///               << rule.replacementTime.count() << " ns\n";
+/// }
+/// @endcode
+///
+/// @copyright The MIT License (MIT)
+/// @copyright Copyright (c) 2025 Parsa Amini
+
+#ifndef TURNDOWN_CPP_CONVERSION_STATS_H
+#define TURNDOWN_CPP_CONVERSION_STATS_H
+
+#include <chrono>
+#include <cstddef>
+#include <map>
+#include <string>
+
+namespace turndown_cpp {
+
+/// @struct RuleStats
+/// @brief How often one rule was applied and how long it took
+struct RuleStats {
+    std::size_t hits = 0;                        ///< Elements the rule converted
+    std::chrono::nanoseconds replacementTime{0}; ///< Time inside the rule's replacement function
+};
+
+/// @struct ConversionStats
+/// @brief Stage timings and counters collected while converting one document
+///
+/// Stage times are wall-clock. The timed stages run one after another, so
+/// they add up to about @c totalTime. The exception is @c escapeTime and
+/// the rule replacement times, which are part of @c convertTime.
+struct ConversionStats {
+    std::chrono::nanoseconds parseTime{0};    ///< Parsing the HTML; zero when converting a tree
+    std::chrono::nanoseconds collapseTime{0}; ///< collapseWhitespace()
+    std::chrono::nanoseconds annotateTime{0}; ///< Building the node table
+    std::chrono::nanoseconds convertTime{0};  ///< Walking the tree: rule matching, replacements, escaping
+    std::chrono::nanoseconds escapeTime{0};   ///< Escaping text nodes (part of convertTime)
+    std::chrono::nanoseconds appendTime{0};   ///< Rule append functions (e.g. link references)
+    std::chrono::nanoseconds finalizeTime{0}; ///< NBSP encoding and trimming the output
+    std::chrono::nanoseconds totalTime{0};    ///< The whole call
+
+    /// @brief Per-rule counters, keyed by Rule::key; rules never applied are absent
+    std::map<std::string, RuleStats> rules;
+
+    std::size_t nodesVisited = 0;     ///< Nodes the conversion walked, of any type
+    std::size_t elementsVisited = 0;  ///< Element nodes among them
+    std::size_t textNodesVisited = 0; ///< Text, whitespace and CDATA nodes among them
+
+    std::size_t bytesIn = 0;  ///< Size of the HTML input; zero when converting a tree
+    std::size_t bytesOut = 0; ///< Size of the Markdown output
+
+    /// @brief Allocations of per-conversion storage
+    ///
+    /// Counts requests made to the conversion's memory resource (see
+    /// ConversionContext::memory()): the whitespace collapse result, the
+    /// node table and any rule state allocated from it. Strings exchanged
+    /// with rules are not included.
+    std::size_t allocations = 0;
+    std::size_t allocatedBytes = 0; ///< Bytes requested by those allocations
+};
+
+} // namespace turndown_cpp
+
+#endif // TURNDOWN_CPP_CONVERSION_STATS_H
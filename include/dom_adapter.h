@@ -5,7 +5,9 @@
 /// (`dom::NodeView`, `dom::Document`, etc.) without pulling in the headers of
 /// the selected parser backend (Gumbo, Tidy, or Lexbor).
 ///
-/// The concrete backend is selected when building the turndown_cpp library.
+/// The default backend is selected when building the turndown_cpp library
+/// (TURNDOWN_PARSER_BACKEND); further ones can be compiled in alongside it
+/// (TURNDOWN_PARSER_BACKENDS) and picked per Document::parse() call.
 /// Consumers of the installed library should not need backend headers to
 /// compile, as long as they only use the turndown_cpp public API.
 ///
@@ -18,8 +20,10 @@
 #include "dom_concepts.h"
 
 #include <cstddef>
+#include <cstdint>
 #include <iterator>
 #include <memory>
+#include <memory_resource>
 #include <string>
 #include <string_view>
 #include <utility>
@@ -28,8 +32,99 @@
 namespace turndown_cpp::dom {
 
 class Document;
+class FlatDocument;
 class ChildRange;
 class AttributeRange;
+class NodeView;
+
+namespace detail {
+
+struct BackendAccess;
+
+/// @brief Steps through one kind of tree's attribute lists
+///
+/// AttributeRange calls these with the cursors the tree handed out;
+/// next() of the last attribute returns the range's end cursor.
+struct AttributeOps {
+    AttributeView (*get)(AttributeCursor at);
+    AttributeCursor (*next)(AttributeCursor at);
+};
+
+/// @brief Operations of nodes that are not nodes of the parser backend
+///
+/// A NodeView with a table dispatches through it instead of calling into
+/// the backend. FlatDocument provides one table per snapshot; @c context
+/// points at the snapshot.
+struct NodeOps {
+    void const* context = nullptr;
+    NodeType (*type)(NodeOps const&, void const* node);
+    NodeView (*parent)(NodeOps const&, void const* node);
+    NodeView (*next_sibling)(NodeOps const&, void const* node);
+    NodeView (*first_child)(NodeOps const&, void const* node);
+    std::string_view (*tag_name)(NodeOps const&, void const* node);
+    TagId (*tag_id)(NodeOps const&, void const* node);
+    /// Value of attribute @p name, or null when the element has no such attribute
+    std::string_view const* (*attribute)(NodeOps const&, void const* node, std::string_view name);
+    AttributeRange (*attributes)(NodeOps const&, void const* node);
+    std::string_view (*text)(NodeOps const&, void const* node);
+    /// Markup of the node in the parsed input; null when the tree keeps none
+    std::string_view (*source_html)(NodeOps const&, void const* node) = nullptr;
+};
+
+/// @brief Allocate for a backend from a caller's memory resource
+///
+/// The block remembers its resource and size, so that the C callbacks of
+/// a backend, which pass neither back, can free and resize it.
+void* allocateFrom(std::pmr::memory_resource* memory, std::size_t bytes);
+
+/// @brief Resize a non-null block from allocateFrom(), keeping its contents
+void* reallocateFrom(void* block, std::size_t bytes);
+
+/// @brief Free a block from allocateFrom(); null is ignored
+void deallocateFrom(void* block);
+
+} // namespace detail
+
+/// @enum ParserBackend
+/// @brief HTML parser a Document is built with
+enum class ParserBackend : std::uint8_t {
+    Auto,   ///< Chosen per input by selectParserBackend()
+    Gumbo,  ///< Google's gumbo-parser
+    Tidy,   ///< HTML Tidy
+    Lexbor, ///< lexbor
+    Libxml2 ///< libxml2's HTML parser
+};
+
+/// @brief Lower-case name of a backend, as TURNDOWN_PARSER_BACKEND spells it
+char const* toString(ParserBackend backend);
+
+/// @brief The backend selected by TURNDOWN_PARSER_BACKEND
+///
+/// Document::parse(std::string_view), DocumentBuilder and Parser always
+/// use it, and its nodes take the library's fastest traversal paths.
+ParserBackend defaultParserBackend();
+
+/// @brief Check whether @p backend was compiled into the library
+///
+/// True for ParserBackend::Auto, which is always available.
+bool isParserBackendAvailable(ParserBackend backend);
+
+/// @brief The backends compiled into the library, the default one first
+std::vector<ParserBackend> availableParserBackends();
+
+/// @brief Input size from which ParserBackend::Auto prefers lexbor
+inline constexpr std::size_t kAutoLargeInputBytes = std::size_t{256} << 10;
+
+/// @brief Resolve ParserBackend::Auto for an input
+///
+/// Inputs of at least kAutoLargeInputBytes go to lexbor when it is
+/// compiled in, since it parses large pages fastest; everything else goes
+/// to the default backend. Other values are returned unchanged.
+///
+/// @param[in] requested Backend asked for
+/// @param[in] inputBytes Size of the HTML to parse
+/// @return A backend other than ParserBackend::Auto
+ParserBackend selectParserBackend(ParserBackend requested, std::size_t inputBytes);
 
 /// @brief Opaque handle for node identity (hash-map key)
 ///
@@ -77,6 +172,7 @@ public:
 
     // Element operations
     std::string tag_name() const;
+    TagId tag_id() const;
     bool has_tag(std::string_view tag) const;
     NodeView find_child(std::string_view tag) const;
     NodeView first_text_child() const;
@@ -92,11 +188,22 @@ public:
     void set_text(std::string const& text);
     std::string_view text() const;
 
+    /// @brief The node's markup exactly as it appears in the parsed input
+    ///
+    /// Empty when the backend does not record source positions (only
+    /// Gumbo does), for nodes the parser inserted or whose end tag was
+    /// implied, and for FlatDocument nodes. Valid while the input is.
+    std::string_view source_html() const;
+
 private:
     friend class Document;
+    friend class FlatDocument;
+    friend struct detail::BackendAccess;
     explicit NodeView(void* node) : node_(node) {}
+    NodeView(void* node, detail::NodeOps const* ops) : node_(node), ops_(ops) {}
 
     void* node_ = nullptr;
+    detail::NodeOps const* ops_ = nullptr; ///< Null for backend nodes
 };
 
 /// @brief Range for iterating over child nodes (backend-agnostic)
@@ -150,21 +257,59 @@ private:
 
 /// @brief Range for iterating over attributes (backend-agnostic)
 ///
-/// This range is materialized as a vector of `AttributeView` values.
+/// Walks the tree's own attribute storage (a GumboVector, a backend's
+/// attribute list, a FlatDocument run) one attribute at a time; nothing is
+/// copied. The views are valid as long as the node is.
 class AttributeRange {
 public:
-    using iterator = std::vector<AttributeView>::const_iterator;
+    class iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = AttributeView;
+        using difference_type = std::ptrdiff_t;
+        using pointer = AttributeView*;
+        using reference = AttributeView;
+
+        iterator() = default;
+        iterator(detail::AttributeOps const* ops, AttributeCursor at) : ops_(ops), at_(at) {}
+
+        AttributeView operator*() const { return ops_->get(at_); }
+        iterator& operator++() {
+            at_ = ops_->next(at_);
+            return *this;
+        }
+        iterator operator++(int) {
+            iterator tmp = *this;
+            ++(*this);
+            return tmp;
+        }
+        bool operator==(iterator const& other) const { return at_ == other.at_; }
+        bool operator!=(iterator const& other) const { return !(*this == other); }
+
+    private:
+        detail::AttributeOps const* ops_ = nullptr;
+        AttributeCursor at_{};
+    };
 
     AttributeRange() = default;
-    explicit AttributeRange(std::vector<AttributeView> attrs) : attrs_(std::move(attrs)) {}
+    AttributeRange(detail::AttributeOps const* ops, AttributeCursor first, AttributeCursor last = {})
+        : ops_(ops), first_(first), last_(last) {}
 
-    iterator begin() const { return attrs_.begin(); }
-    iterator end() const { return attrs_.end(); }
-    bool empty() const { return attrs_.empty(); }
-    std::size_t size() const { return attrs_.size(); }
+    iterator begin() const { return iterator(ops_, first_); }
+    iterator end() const { return iterator(ops_, last_); }
+    bool empty() const { return first_ == last_; }
+    std::size_t size() const {
+        std::size_t count = 0;
+        for (auto it = begin(); it != end(); ++it) {
+            ++count;
+        }
+        return count;
+    }
 
 private:
-    std::vector<AttributeView> attrs_;
+    detail::AttributeOps const* ops_ = nullptr;
+    AttributeCursor first_{};
+    AttributeCursor last_{};
 };
 
 static_assert(DOMNode<NodeView>, "NodeView must satisfy DOMNode concept");
@@ -176,7 +321,20 @@ static_assert(DOMNodeWithHandle<NodeView>, "NodeView must satisfy DOMNodeWithHan
 class Document {
 public:
     Document();
-    static Document parse(std::string const& html);
+    static Document parse(std::string_view html);
+
+    /// @brief Parse with a chosen backend
+    ///
+    /// Nodes of a backend other than defaultParserBackend() are traversed
+    /// through a table of functions, like FlatDocument nodes; converting
+    /// them gives the same Markdown, somewhat more slowly.
+    ///
+    /// @param[in] html HTML document
+    /// @param[in] backend Backend to parse with; ParserBackend::Auto picks
+    ///                    one by selectParserBackend()
+    /// @return The document; empty if parsing failed
+    /// @throws std::invalid_argument if @p backend was not compiled in
+    static Document parse(std::string_view html, ParserBackend backend);
 
     Document(Document const&) = delete;
     Document& operator=(Document const&) = delete;
@@ -187,18 +345,131 @@ public:
 
     explicit operator bool() const;
 
+    /// @brief The backend that parsed the document
+    ParserBackend backend() const;
+
     NodeView root() const;
     NodeView document() const;
     NodeView html() const;
     NodeView body() const;
 
 private:
+    friend class DocumentBuilder;
+    friend class Parser;
     struct Impl;
     std::unique_ptr<Impl> impl_;
 };
 
 static_assert(DOMDocument<Document, NodeView>, "Document must satisfy DOMDocument concept");
 
+/// @brief Parses a document delivered in pieces
+///
+/// Feed the HTML as it arrives, e.g. while it is still being downloaded,
+/// then call finish(). Chunks may be split anywhere, including inside a
+/// tag or a UTF-8 sequence. With the lexbor and libxml2 backends the
+/// parser consumes every chunk as it is fed, so parsing overlaps with
+/// receiving the input and the whole document is never held as one
+/// string. The Gumbo and Tidy backends have no incremental parser; they
+/// buffer the chunks and parse on finish().
+///
+/// @par Example
+/// @code{.cpp}
+/// dom::DocumentBuilder builder;
+/// while (auto chunk = socket.read()) builder.feed(*chunk);
+/// dom::Document document = builder.finish();
+/// std::string markdown = service.turndown(document.root());
+/// @endcode
+class DocumentBuilder {
+public:
+    DocumentBuilder();
+
+    DocumentBuilder(DocumentBuilder const&) = delete;
+    DocumentBuilder& operator=(DocumentBuilder const&) = delete;
+    DocumentBuilder(DocumentBuilder&& other) noexcept;
+    DocumentBuilder& operator=(DocumentBuilder&& other) noexcept;
+
+    ~DocumentBuilder();
+
+    /// @brief Parse the next piece of the document
+    /// @param[in] chunk Bytes following those fed so far; only read during the call
+    void feed(std::string_view chunk);
+
+    /// @brief Finish parsing
+    ///
+    /// The builder starts a new, empty document afterwards.
+    ///
+    /// @return The document; empty if parsing failed
+    Document finish();
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+/// @brief Parses many documents one after another, reusing parser state
+///
+/// Document::parse() sets a backend parser up and tears it down for every
+/// document, which is a sizeable share of the cost of a small one. A
+/// Parser keeps that state between parses: libxml2 reuses one parser
+/// context and its name dictionary, and lexbor refills a recycled
+/// document, whose memory pools survive lxb_html_document_clean(). Gumbo
+/// and Tidy have nothing to reuse; their Parser behaves like
+/// Document::parse(). A Parser is not thread-safe; use one per thread.
+///
+/// A Parser can also be given the memory its trees are allocated from. A
+/// pool resource then recycles the memory of recycled documents for the
+/// next ones without going back to the heap. Gumbo (through the allocator
+/// of its GumboOptions, where the installed version has one) and Tidy
+/// (through a TidyAllocator) allocate everything from it. lexbor and
+/// libxml2 only accept process-wide allocators and keep using their own
+/// memory, which a Parser already reuses as described above.
+///
+/// @par Example
+/// @code{.cpp}
+/// dom::Parser parser;
+/// for (auto const& html : documents) {
+///     dom::Document document = parser.parse(html);
+///     emit(service.turndown(document.root()));
+///     parser.recycle(std::move(document));
+/// }
+/// @endcode
+class Parser {
+public:
+    Parser();
+
+    /// @brief Parse into memory from @p memory
+    /// @param[in] memory Resource the parse trees are allocated from; it
+    ///                   must outlive every document of this parser and be
+    ///                   usable from the threads that free them. Null
+    ///                   behaves like Parser().
+    explicit Parser(std::pmr::memory_resource* memory);
+
+    Parser(Parser const&) = delete;
+    Parser& operator=(Parser const&) = delete;
+    Parser(Parser&& other) noexcept;
+    Parser& operator=(Parser&& other) noexcept;
+
+    ~Parser();
+
+    /// @brief Parse a complete document
+    /// @param[in] html HTML document
+    /// @return The document; empty if parsing failed
+    Document parse(std::string_view html);
+
+    /// @brief Hand a document back once its nodes are no longer used
+    ///
+    /// Frees @p document, keeping its memory for the next parse where the
+    /// backend allows it. Documents parsed by another Parser, or by
+    /// Document::parse(), may be recycled as well.
+    ///
+    /// @param[in] document Document to release; empty afterwards
+    void recycle(Document&& document);
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
 } // namespace turndown_cpp::dom
 
 #endif // TURNDOWN_CPP_DOM_ADAPTER_H
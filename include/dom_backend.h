@@ -0,0 +1,82 @@
+/// @file dom_backend.h
+/// @brief The parser backend selected at library build time
+///
+/// For use inside the library only: this header pulls in the selected
+/// backend's headers, which consumers of the installed library need not
+/// have. It names the backend's concrete NodeView, so traversals written
+/// against the dom_concepts.h concepts can be instantiated on it instead of
+/// going through the type-erased dom::NodeView for every step.
+///
+/// The backend is selected via the TURNDOWN_PARSER_BACKEND_* compile
+/// definitions. Backends compiled in besides it (TURNDOWN_HAS_PARSER_*)
+/// are not named here; their nodes are not backend nodes in the sense of
+/// BackendAccess.
+///
+/// @copyright The MIT License (MIT)
+/// @copyright Copyright (c) 2025 Parsa Amini
+
+#ifndef TURNDOWN_CPP_DOM_BACKEND_H
+#define TURNDOWN_CPP_DOM_BACKEND_H
+
+#include "dom_adapter.h"
+
+#include <utility>
+
+#if defined(TURNDOWN_PARSER_BACKEND_LEXBOR)
+    #include "lexbor_adapter.h"
+    namespace turndown_cpp::dom::detail {
+        namespace backend = turndown_cpp::lexbor;
+        inline constexpr ParserBackend kBackend = ParserBackend::Lexbor;
+    }
+#elif defined(TURNDOWN_PARSER_BACKEND_TIDY)
+    #include "tidy_adapter.h"
+    namespace turndown_cpp::dom::detail {
+        namespace backend = turndown_cpp::tidy;
+        inline constexpr ParserBackend kBackend = ParserBackend::Tidy;
+    }
+#elif defined(TURNDOWN_PARSER_BACKEND_LIBXML2)
+    #include "libxml2_adapter.h"
+    namespace turndown_cpp::dom::detail {
+        namespace backend = turndown_cpp::libxml2;
+        inline constexpr ParserBackend kBackend = ParserBackend::Libxml2;
+    }
+#else
+    #include "gumbo_adapter.h"
+    namespace turndown_cpp::dom::detail {
+        namespace backend = turndown_cpp::gumbo;
+        inline constexpr ParserBackend kBackend = ParserBackend::Gumbo;
+    }
+#endif
+
+namespace turndown_cpp::dom::detail {
+
+/// @struct BackendAccess
+/// @brief Conversions between dom::NodeView and the backend's NodeView
+///
+/// A backend node and the dom::NodeView wrapping it share their raw
+/// pointer, so their handles compare equal.
+struct BackendAccess {
+    using Node = backend::NodeView;
+    using NodePtr = decltype(std::declval<Node const&>().get());
+
+    /// @brief Check whether @p node is a node of a backend tree
+    ///
+    /// False for null views and for nodes of other trees, such as a
+    /// FlatDocument snapshot.
+    static bool isBackendNode(NodeView node) { return node.node_ && !node.ops_; }
+
+    /// @brief The backend node @p node wraps; requires isBackendNode(node)
+    static Node unwrap(NodeView node) { return Node(static_cast<NodePtr>(node.node_)); }
+
+    /// @brief The facade view of a backend node
+    static NodeView wrap(Node node) { return NodeView(const_cast<void*>(static_cast<void const*>(node.get()))); }
+
+    /// @brief A view of a node that dispatches through @p ops
+    ///
+    /// Used for the nodes of backends compiled in besides the default one.
+    static NodeView wrap(void const* node, NodeOps const* ops) { return NodeView(const_cast<void*>(node), ops); }
+};
+
+} // namespace turndown_cpp::dom::detail
+
+#endif // TURNDOWN_CPP_DOM_BACKEND_H
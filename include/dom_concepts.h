@@ -11,6 +11,8 @@
 #ifndef TURNDOWN_CPP_DOM_CONCEPTS_H
 #define TURNDOWN_CPP_DOM_CONCEPTS_H
 
+#include "tag_id.h"
+
 #include <concepts>
 #include <cstddef>
 #include <functional>
@@ -38,6 +40,18 @@ struct AttributeView {
     std::string_view value;
 };
 
+/// @brief Position in an element's attribute list
+///
+/// Lets the type-erased dom::AttributeRange walk a tree's own attribute
+/// storage. What the fields hold is up to the tree (a backend attribute,
+/// an index); the default value is past the end of every list.
+struct AttributeCursor {
+    void const* item = nullptr;
+    std::size_t index = 0;
+
+    bool operator==(AttributeCursor const&) const = default;
+};
+
 /// @brief Concept for a type that can be used as a node handle for hashing
 template<typename T>
 concept NodeHandleLike = requires(T const& h, T const& other) {
@@ -86,6 +100,7 @@ concept DOMNode = requires(T const& node, T& mut_node, T const& other, std::stri
     
     // Element operations
     { node.tag_name() } -> std::convertible_to<std::string>;
+    { node.tag_id() } -> std::same_as<TagId>;
     { node.has_tag(sv) } -> std::same_as<bool>;
     { node.find_child(sv) } -> std::same_as<T>;
     { node.first_text_child() } -> std::same_as<T>;
@@ -112,7 +127,7 @@ concept DOMNodeWithHandle = DOMNode<T> && requires(T const& node) {
 
 /// @brief Concept for a parsed DOM document
 template<typename D, typename NodeT>
-concept DOMDocument = requires(D const& doc, D& mut_doc, D&& rval, std::string const& html) {
+concept DOMDocument = requires(D const& doc, D& mut_doc, D&& rval, std::string_view html) {
     // Parsing
     { D::parse(html) } -> std::same_as<D>;
     
@@ -2,8 +2,11 @@
 #define TURNDOWN_CPP_DOM_SOURCE_H
 
 #include "dom_adapter.h"
+#include "mapped_file.h"
 
+#include <filesystem>
 #include <string>
+#include <string_view>
 
 namespace turndown_cpp {
 
@@ -42,6 +45,32 @@ private:
     mutable dom::Document document_;
 };
 
+/// @brief Parses an HTML file straight from a read-only memory mapping
+///
+/// The file is never copied into a heap string; the mapping lives as long
+/// as the source, so trees that point into their input stay valid.
+class MappedFileSource final : public DomSource {
+public:
+    /// @throws std::runtime_error if the file cannot be opened or mapped
+    explicit MappedFileSource(std::filesystem::path const& path);
+    MappedFileSource(MappedFileSource&& other) noexcept = default;
+    MappedFileSource& operator=(MappedFileSource&& other) noexcept = default;
+
+    MappedFileSource(MappedFileSource const&) = delete;
+    MappedFileSource& operator=(MappedFileSource const&) = delete;
+
+    ~MappedFileSource() override = default;
+
+    dom::NodeView root() const override;
+    std::string_view html() const { return file_.view(); }
+
+private:
+    void parseIfNeeded() const;
+
+    MappedFile file_;
+    mutable dom::Document document_;
+};
+
 } // namespace turndown_cpp
 
 #endif // TURNDOWN_CPP_DOM_SOURCE_H
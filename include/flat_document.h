@@ -0,0 +1,80 @@
+/// @file flat_document.h
+/// @brief Contiguous, backend-independent snapshot of a parsed document
+///
+/// A FlatDocument copies a DOM tree into preorder-indexed arrays: node
+/// types, tag ids and parent/first-child/next-sibling indices each live in
+/// their own array, node text and tag names are spans of one byte buffer
+/// and attributes are contiguous runs of one attribute array. Its nodes are
+/// ordinary dom::NodeView values, so the conversion pipeline runs over the
+/// snapshot unchanged, with the same memory layout whichever parser backend
+/// produced the tree. The backend tree can be destroyed as soon as the
+/// snapshot is built.
+///
+/// @par Example
+/// @code{.cpp}
+/// dom::FlatDocument flat = dom::FlatDocument::parse(html); // backend tree already freed
+/// std::string markdown = service.turndown(flat.root());
+/// @endcode
+///
+/// @copyright The MIT License (MIT)
+/// @copyright Copyright (c) 2025 Parsa Amini
+
+#ifndef TURNDOWN_CPP_FLAT_DOCUMENT_H
+#define TURNDOWN_CPP_FLAT_DOCUMENT_H
+
+#include "dom_adapter.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace turndown_cpp::dom {
+
+/// @class FlatDocument
+/// @brief Structure-of-arrays copy of a DOM subtree
+///
+/// NodeView values obtained from a FlatDocument stay valid until the
+/// snapshot is destroyed or moved from. The snapshot is read-only.
+class FlatDocument {
+public:
+    FlatDocument();
+
+    /// @brief Snapshot the subtree rooted at @p root
+    /// @param[in] root Node to copy; it becomes the snapshot's root
+    /// @return The snapshot; empty if @p root is null
+    static FlatDocument build(NodeView root);
+
+    /// @brief Parse @p html and snapshot the whole document
+    ///
+    /// The backend tree is released before returning.
+    ///
+    /// @param[in] html HTML document
+    /// @return The snapshot; empty if parsing failed
+    static FlatDocument parse(std::string_view html);
+
+    FlatDocument(FlatDocument const&) = delete;
+    FlatDocument& operator=(FlatDocument const&) = delete;
+    FlatDocument(FlatDocument&& other) noexcept;
+    FlatDocument& operator=(FlatDocument&& other) noexcept;
+
+    ~FlatDocument();
+
+    /// @brief Check whether the snapshot holds any nodes
+    explicit operator bool() const;
+
+    /// @brief The snapshot's root node (index 0)
+    NodeView root() const;
+
+    /// @brief Number of nodes in the snapshot
+    std::size_t size() const;
+
+private:
+    static NodeView makeView(void* node, detail::NodeOps const* ops);
+
+    struct Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+} // namespace turndown_cpp::dom
+
+#endif // TURNDOWN_CPP_FLAT_DOCUMENT_H
@@ -18,6 +18,8 @@
 #include <cstddef>
 #include <functional>
 #include <iterator>
+#include <memory>
+#include <memory_resource>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -100,6 +102,10 @@ public:
 
     AttributeIterator() = default;
     AttributeIterator(GumboVector const* vec, unsigned index);
+    explicit AttributeIterator(dom::AttributeCursor cursor);
+
+    /// @brief The position, for dom::AttributeRange
+    dom::AttributeCursor cursor() const;
 
     dom::AttributeView operator*() const;
     AttributeIterator& operator++();
@@ -155,6 +161,7 @@ public:
 
     // Element operations
     std::string tag_name() const;
+    dom::TagId tag_id() const;
     bool has_tag(std::string_view tag) const;
     NodeView find_child(std::string_view tag) const;
     NodeView first_text_child() const;
@@ -169,6 +176,7 @@ public:
     std::string text_content() const;
     void set_text(std::string const& text);
     std::string_view text() const;
+    std::string_view source_html() const;
 
 private:
     GumboNode* node_ = nullptr;
@@ -181,7 +189,7 @@ static_assert(dom::DOMNodeWithHandle<NodeView>, "NodeView must satisfy DOMNodeWi
 class Document {
 public:
     Document() = default;
-    static Document parse(std::string const& html);
+    static Document parse(std::string_view html);
 
     Document(Document const&) = delete;
     Document& operator=(Document const&) = delete;
@@ -198,15 +206,62 @@ public:
     GumboOutput* get() const { return output_; }
 
 private:
+    friend class DocumentBuilder;
+    friend class Parser;
     explicit Document(GumboOutput* output) : output_(output) {}
     GumboOutput* output_ = nullptr;
+    /// Options the tree is destroyed with; they name its deallocator
+    GumboOptions const* options_ = &kGumboDefaultOptions;
+    /// Input owned by the document, for trees built by a DocumentBuilder:
+    /// original tags and text point into it
+    std::unique_ptr<std::string const> source_;
 };
 
 static_assert(dom::DOMDocument<Document, NodeView>, "Document must satisfy DOMDocument concept");
 
+/// @brief Collects a document fed in pieces and parses it on finish()
+///
+/// Gumbo has no incremental parser, so the pieces are buffered.
+class DocumentBuilder {
+public:
+    DocumentBuilder();
+
+    DocumentBuilder(DocumentBuilder const&) = delete;
+    DocumentBuilder& operator=(DocumentBuilder const&) = delete;
+    DocumentBuilder(DocumentBuilder&& other) noexcept;
+    DocumentBuilder& operator=(DocumentBuilder&& other) noexcept;
+
+    ~DocumentBuilder();
+
+    void feed(std::string_view chunk);
+    Document finish();
+
+private:
+    std::string html_;
+};
+
+/// @brief Parses documents one after another
+///
+/// Gumbo keeps no state between parses that could be reused; parse() is
+/// Document::parse() and recycle() frees the document. Given a memory
+/// resource, trees are allocated from it through GumboOptions::allocator
+/// (TURNDOWN_GUMBO_HAS_ALLOCATOR); gumbo releases without one ignore it.
+class Parser {
+public:
+    Parser() = default;
+    explicit Parser(std::pmr::memory_resource* memory) : memory_(memory) {}
+
+    Document parse(std::string_view html);
+    void recycle(Document&& document);
+
+private:
+    std::pmr::memory_resource* memory_ = nullptr;
+};
+
 // Utility functions
 std::string_view to_string_view(GumboStringPiece const& piece);
 std::string lookup_tag_name(GumboNode* node);
+dom::TagId lookup_tag_id(GumboNode* node);
 bool has_tag(GumboNode* node, std::string_view tag);
 inline bool is_element(GumboNode* node) {
     return node && node->type == GUMBO_NODE_ELEMENT;
@@ -0,0 +1,98 @@
+/// @file incremental_converter.h
+/// @brief Re-conversion of a document that changes a little at a time
+///
+/// An editor that converts an article on every autosave sees the same
+/// document again and again with one paragraph changed. IncrementalConverter
+/// keeps the Markdown of the previous conversions' block elements in a
+/// private ConversionCache, keyed by a structural hash of each subtree (tag
+/// names, attributes and text) and of what its rule can see around it. On
+/// the next call the walk joins unchanged blocks from the cache without
+/// entering them, so rules only run for the elements on the paths to what
+/// was edited, and the ancestors joining them.
+///
+/// Subtrees in which a rule with per-conversion state ran, such as links
+/// under TurndownOptions::linkStyle "referenced", are never reused: their
+/// Markdown depends on what precedes them in the document, so they are
+/// converted again each time and reference numbers stay correct. Parsing,
+/// whitespace collapsing and hashing still visit the whole document; they
+/// are a small part of the cost of converting it.
+///
+/// @par Example
+/// @code{.cpp}
+/// IncrementalConverter converter(service);
+/// std::string markdown = converter.convert(draft);
+/// // ... the user edits one paragraph ...
+/// markdown = converter.convert(editedDraft);
+/// IncrementalStats stats = converter.lastStats(); // mostly reused
+/// @endcode
+///
+/// @copyright The MIT License (MIT)
+/// @copyright Copyright (c) 2025 Parsa Amini
+
+#ifndef TURNDOWN_CPP_INCREMENTAL_CONVERTER_H
+#define TURNDOWN_CPP_INCREMENTAL_CONVERTER_H
+
+#include "conversion_cache.h"
+#include "dom_adapter.h"
+#include "turndown.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace turndown_cpp {
+
+/// @struct IncrementalStats
+/// @brief What the last IncrementalConverter::convert() call reused
+struct IncrementalStats {
+    bool unchanged = false;            ///< The whole document was seen before
+    std::size_t reusedSubtrees = 0;    ///< Blocks joined from earlier conversions
+    std::size_t convertedSubtrees = 0; ///< Blocks looked up and converted again
+};
+
+/// @class IncrementalConverter
+/// @brief Converts successive versions of a document, reusing unchanged blocks
+///
+/// Converts with a clone of the given service, so later changes to that
+/// service do not apply. Blocks in which an added rule that is not
+/// Rule::cacheable was consulted are converted again on every call. Not
+/// thread-safe; use one converter per document being edited.
+class IncrementalConverter {
+public:
+    /// @brief Default bytes of Markdown kept between calls: 16 MiB
+    static constexpr std::size_t kDefaultCapacity = std::size_t{16} << 20;
+
+    /// @brief Default smallest block content reused: 64 bytes
+    static constexpr std::size_t kDefaultMinSubtreeBytes = 64;
+
+    /// @brief Create a converter with nothing remembered yet
+    /// @param[in] service Configured service to convert with
+    /// @param[in] capacityBytes Markdown kept between calls; older blocks are evicted first
+    /// @param[in] minSubtreeBytes Smallest block content, in bytes, worth remembering
+    explicit IncrementalConverter(TurndownService const& service, std::size_t capacityBytes = kDefaultCapacity,
+                                  std::size_t minSubtreeBytes = kDefaultMinSubtreeBytes);
+
+    /// @brief Convert the current version of an HTML document
+    std::string convert(std::string const& html);
+
+    /// @brief Convert the current version of a parsed document
+    std::string convert(dom::NodeView root);
+
+    /// @brief What the last convert() call reused
+    IncrementalStats const& lastStats() const { return last_; }
+
+    /// @brief Forget every remembered block
+    void reset();
+
+private:
+    template <typename Input>
+    std::string convertCounting(Input const& input);
+
+    TurndownService service_;
+    std::shared_ptr<ConversionCache> cache_;
+    IncrementalStats last_;
+};
+
+} // namespace turndown_cpp
+
+#endif // TURNDOWN_CPP_INCREMENTAL_CONVERTER_H
@@ -23,6 +23,7 @@
 #include <cstddef>
 #include <functional>
 #include <iterator>
+#include <memory_resource>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -103,6 +104,10 @@ public:
 
     AttributeIterator() = default;
     explicit AttributeIterator(lxb_dom_attr_t* attr) : current_(attr) {}
+    explicit AttributeIterator(dom::AttributeCursor cursor);
+
+    /// @brief The position, for dom::AttributeRange
+    dom::AttributeCursor cursor() const { return {current_, 0}; }
 
     dom::AttributeView operator*() const;
     AttributeIterator& operator++();
@@ -147,15 +152,16 @@ public:
     bool is_element() const { return type() == dom::NodeType::Element; }
     bool is_text_like() const;
 
-    // Navigation
-    NodeView parent() const;
-    NodeView next_sibling() const;
-    NodeView first_child() const;
+    // Navigation (inline: the conversion's traversals call these per node)
+    NodeView parent() const { return node_ ? NodeView(node_->parent) : NodeView{}; }
+    NodeView next_sibling() const { return node_ ? NodeView(node_->next) : NodeView{}; }
+    NodeView first_child() const { return node_ ? NodeView(node_->first_child) : NodeView{}; }
     std::vector<NodeView> children() const;
     ChildRange child_range() const;
 
     // Element operations
     std::string tag_name() const;
+    dom::TagId tag_id() const;
     bool has_tag(std::string_view tag) const;
     NodeView find_child(std::string_view tag) const;
     NodeView first_text_child() const;
@@ -170,6 +176,7 @@ public:
     std::string text_content() const;
     void set_text(std::string const& text);
     std::string_view text() const;
+    std::string_view source_html() const;
 
 private:
     lxb_dom_node_t* node_ = nullptr;
@@ -182,7 +189,7 @@ static_assert(dom::DOMNodeWithHandle<NodeView>, "NodeView must satisfy DOMNodeWi
 class Document {
 public:
     Document() = default;
-    static Document parse(std::string const& html);
+    static Document parse(std::string_view html);
 
     Document(Document const&) = delete;
     Document& operator=(Document const&) = delete;
@@ -199,14 +206,62 @@ public:
     lxb_html_document_t* get() const { return doc_; }
 
 private:
+    friend class DocumentBuilder;
+    friend class Parser;
     explicit Document(lxb_html_document_t* doc) : doc_(doc) {}
     lxb_html_document_t* doc_ = nullptr;
 };
 
 static_assert(dom::DOMDocument<Document, NodeView>, "Document must satisfy DOMDocument concept");
 
+/// @brief Parses a document fed in pieces, using Lexbor's chunk parser
+class DocumentBuilder {
+public:
+    DocumentBuilder();
+
+    DocumentBuilder(DocumentBuilder const&) = delete;
+    DocumentBuilder& operator=(DocumentBuilder const&) = delete;
+    DocumentBuilder(DocumentBuilder&& other) noexcept;
+    DocumentBuilder& operator=(DocumentBuilder&& other) noexcept;
+
+    ~DocumentBuilder();
+
+    void feed(std::string_view chunk);
+    Document finish();
+
+private:
+    lxb_html_document_t* doc_ = nullptr;
+    bool failed_ = false;
+};
+
+/// @brief Parses documents one after another, refilling recycled documents
+///
+/// A recycled document is cleaned with lxb_html_document_clean(), which
+/// keeps its memory pools, and the next parse fills it again instead of
+/// creating a document.
+class Parser {
+public:
+    Parser() = default;
+    /// @brief lexbor allocates through process-wide hooks only; @p memory is unused
+    explicit Parser(std::pmr::memory_resource*) {}
+
+    Parser(Parser const&) = delete;
+    Parser& operator=(Parser const&) = delete;
+    Parser(Parser&& other) noexcept;
+    Parser& operator=(Parser&& other) noexcept;
+
+    ~Parser();
+
+    Document parse(std::string_view html);
+    void recycle(Document&& document);
+
+private:
+    lxb_html_document_t* spare_ = nullptr;
+};
+
 // Utility functions
 std::string lookup_tag_name(lxb_dom_node_t* node);
+dom::TagId lookup_tag_id(lxb_dom_node_t* node);
 bool has_tag(lxb_dom_node_t* node, std::string_view tag);
 inline bool is_element(lxb_dom_node_t* node) {
     return node && node->type == LXB_DOM_NODE_TYPE_ELEMENT;
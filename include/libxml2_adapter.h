@@ -18,6 +18,7 @@
 #include <cstddef>
 #include <functional>
 #include <iterator>
+#include <memory_resource>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -98,6 +99,10 @@ public:
 
     AttributeIterator() = default;
     explicit AttributeIterator(xmlAttrPtr attr) : current_(attr) {}
+    explicit AttributeIterator(dom::AttributeCursor cursor);
+
+    /// @brief The position, for dom::AttributeRange
+    dom::AttributeCursor cursor() const { return {current_, 0}; }
 
     dom::AttributeView operator*() const;
     AttributeIterator& operator++();
@@ -146,15 +151,16 @@ public:
     bool is_element() const { return type() == dom::NodeType::Element; }
     bool is_text_like() const;
 
-    // Navigation
-    NodeView parent() const;
-    NodeView next_sibling() const;
-    NodeView first_child() const;
+    // Navigation (inline: the conversion's traversals call these per node)
+    NodeView parent() const { return node_ ? NodeView(node_->parent) : NodeView{}; }
+    NodeView next_sibling() const { return node_ ? NodeView(node_->next) : NodeView{}; }
+    NodeView first_child() const { return node_ ? NodeView(node_->children) : NodeView{}; }
     std::vector<NodeView> children() const;
     ChildRange child_range() const;
 
     // Element operations
     std::string tag_name() const;
+    dom::TagId tag_id() const;
     bool has_tag(std::string_view tag) const;
     NodeView find_child(std::string_view tag) const;
     NodeView first_text_child() const;
@@ -169,6 +175,7 @@ public:
     std::string text_content() const;
     void set_text(std::string const& text);
     std::string_view text() const;
+    std::string_view source_html() const;
 
 private:
     xmlNodePtr node_ = nullptr;
@@ -181,7 +188,7 @@ static_assert(dom::DOMNodeWithHandle<NodeView>, "NodeView must satisfy DOMNodeWi
 class Document {
 public:
     Document() = default;
-    static Document parse(std::string const& html);
+    static Document parse(std::string_view html);
 
     Document(Document const&) = delete;
     Document& operator=(Document const&) = delete;
@@ -198,14 +205,64 @@ public:
     xmlDocPtr get() const { return doc_; }
 
 private:
+    friend class DocumentBuilder;
+    friend class Parser;
     explicit Document(xmlDocPtr doc) : doc_(doc) {}
     xmlDocPtr doc_ = nullptr;
 };
 
 static_assert(dom::DOMDocument<Document, NodeView>, "Document must satisfy DOMDocument concept");
 
+/// @brief Parses a document fed in pieces, using libxml2's push parser
+class DocumentBuilder {
+public:
+    DocumentBuilder();
+
+    DocumentBuilder(DocumentBuilder const&) = delete;
+    DocumentBuilder& operator=(DocumentBuilder const&) = delete;
+    DocumentBuilder(DocumentBuilder&& other) noexcept;
+    DocumentBuilder& operator=(DocumentBuilder&& other) noexcept;
+
+    ~DocumentBuilder();
+
+    void feed(std::string_view chunk);
+    Document finish();
+
+private:
+    xmlParserCtxtPtr ctxt_ = nullptr;
+    bool pendingAngle_ = false; ///< The last chunk ended in '<', escaped according to the next byte
+    std::string sanitized_;
+};
+
+/// @brief Parses documents one after another with one parser context
+///
+/// The context, including its name dictionary, and the sanitizing buffer
+/// are reused by every parse. libxml2 documents cannot be refilled, so
+/// recycle() only frees the document.
+class Parser {
+public:
+    Parser();
+    /// @brief libxml2 allocates through process-wide hooks only; @p memory is unused
+    explicit Parser(std::pmr::memory_resource*) : Parser() {}
+
+    Parser(Parser const&) = delete;
+    Parser& operator=(Parser const&) = delete;
+    Parser(Parser&& other) noexcept;
+    Parser& operator=(Parser&& other) noexcept;
+
+    ~Parser();
+
+    Document parse(std::string_view html);
+    void recycle(Document&& document);
+
+private:
+    xmlParserCtxtPtr ctxt_ = nullptr;
+    std::string sanitized_;
+};
+
 // Utility functions
 std::string lookup_tag_name(xmlNodePtr node);
+dom::TagId lookup_tag_id(xmlNodePtr node);
 bool has_tag(xmlNodePtr node, std::string_view tag);
 inline bool is_element(xmlNodePtr node) {
     return node && node->type == XML_ELEMENT_NODE;
@@ -0,0 +1,50 @@
+/// @file mapped_file.h
+/// @brief Read-only memory mapping of an input file
+///
+/// Mapping a file lets a parser read the document straight from the page
+/// cache: no heap copy of the input is made, however large the file.
+///
+/// @copyright The MIT License (MIT)
+/// @copyright Copyright (c) 2025 Parsa Amini
+
+#ifndef TURNDOWN_CPP_MAPPED_FILE_H
+#define TURNDOWN_CPP_MAPPED_FILE_H
+
+#include <cstddef>
+#include <filesystem>
+#include <string_view>
+
+namespace turndown_cpp {
+
+/// @class MappedFile
+/// @brief Owns a read-only mapping of a whole file
+///
+/// Empty files are not mapped (mapping zero bytes fails on most systems)
+/// and simply view nothing.
+class MappedFile {
+public:
+    /// @brief Map @p path
+    /// @param[in] path File to map
+    /// @throws std::runtime_error if the file cannot be opened or mapped
+    explicit MappedFile(std::filesystem::path const& path);
+
+    MappedFile(MappedFile const&) = delete;
+    MappedFile& operator=(MappedFile const&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    ~MappedFile();
+
+    /// @brief The file's bytes; valid while the mapping lives
+    std::string_view view() const { return {data_, size_}; }
+
+private:
+    void unmap();
+
+    char const* data_ = nullptr;
+    std::size_t size_ = 0;
+};
+
+} // namespace turndown_cpp
+
+#endif // TURNDOWN_CPP_MAPPED_FILE_H
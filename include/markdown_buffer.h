@@ -0,0 +1,93 @@
+/// @file markdown_buffer.h
+/// @brief Growable output buffer used by the conversion pipeline
+///
+/// The conversion pipeline appends every text node and rule replacement
+/// into a single MarkdownBuffer instead of returning and re-concatenating
+/// strings at each level of the tree. The newline-collapsing join that
+/// Turndown applies between chunks runs in place against the tail of the
+/// buffer, so appending a sibling costs time proportional to the addition
+/// rather than to everything emitted so far.
+///
+/// Element content is collected as a nested segment: the pipeline opens a
+/// segment, converts the children into it, then takes the segment back out
+/// to hand it to the element's rule. Joins never look past the start of the
+/// innermost open segment, which keeps the result identical to joining each
+/// element's children in isolation.
+///
+/// A streaming conversion takes the settled start of the buffer out with
+/// takeSettled() whenever no segment is open, so the buffer only holds the
+/// text a later join may still change.
+///
+/// @copyright The MIT License (MIT)
+/// @copyright Copyright (c) 2025 Parsa Amini
+
+#ifndef MARKDOWN_BUFFER_H
+#define MARKDOWN_BUFFER_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace turndown_cpp {
+
+/// @class MarkdownBuffer
+/// @brief Single growable buffer that Markdown chunks are joined into
+class MarkdownBuffer {
+public:
+    /// @brief Join a chunk onto the end of the current segment
+    ///
+    /// Trailing newlines of the segment and leading newlines of the addition
+    /// are replaced by a separator of max(trimmed left, trimmed right)
+    /// newlines, capped at 2 (a blank line). If the segment is empty the
+    /// addition is appended unchanged; an empty addition is ignored.
+    ///
+    /// @param[in] addition The chunk to join
+    void append(std::string_view addition);
+
+    /// @brief Start a nested segment at the current end of the buffer
+    /// @return Token that must be passed to takeSegment() to close it
+    std::size_t beginSegment();
+
+    /// @brief Close the innermost segment and return its contents
+    ///
+    /// The segment's bytes are removed from the buffer and the enclosing
+    /// segment becomes current again.
+    ///
+    /// @param[in] token The value returned by the matching beginSegment()
+    /// @return The text that was joined into the segment
+    std::string takeSegment(std::size_t token);
+
+    /// @brief Check whether the current segment holds no text
+    /// @retval true if nothing was appended since the segment began
+    bool segmentEmpty() const { return data_.size() == segmentStart_; }
+
+    /// @brief Access the underlying storage
+    /// @return Reference to the buffer contents
+    std::string& str() { return data_; }
+
+    /// @copydoc str()
+    std::string const& str() const { return data_; }
+
+    /// @brief Move out the text no later join can change
+    ///
+    /// Only meaningful while no segment is open: returns everything before
+    /// the trailing run of whitespace and removes it from the buffer. Later
+    /// joins behave as if the removed text were still there.
+    ///
+    /// @return The settled text; empty if a segment is open or nothing settled
+    std::string takeSettled();
+
+    /// @brief Move the buffer contents out, leaving the buffer empty
+    /// @return The accumulated text
+    std::string release();
+
+private:
+    std::string data_;
+    std::size_t segmentStart_ = 0;
+    std::size_t depth_ = 0;   ///< Number of open segments
+    bool settled_ = false;    ///< True once takeSettled() removed text
+};
+
+} // namespace turndown_cpp
+
+#endif // MARKDOWN_BUFFER_H
@@ -17,11 +17,23 @@
 #define NODE_H
 
 #include "dom_adapter.h"
+#include "dom_concepts.h"
 
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
 namespace turndown_cpp {
 
+struct CollapsedWhitespace;
+
 /// @struct FlankingWhitespace
 /// @brief Whitespace at the leading and trailing edges of an element
 ///
@@ -68,6 +80,17 @@ enum class FlankSide {
 /// @return The leading and trailing whitespace
 FlankingWhitespace flankingWhitespace(dom::NodeView node, bool preformattedCode);
 
+/// @brief Compute the flanking whitespace for a node from collapsed text
+///
+/// Same as flankingWhitespace(dom::NodeView, bool), but reads the node's
+/// and its siblings' text through the supplied collapse result.
+///
+/// @param[in] node The DOM node to analyze
+/// @param[in] preformattedCode Whether code elements preserve whitespace
+/// @param[in] collapsed Result of collapseWhitespace() for the tree
+/// @return The leading and trailing whitespace
+FlankingWhitespace flankingWhitespace(dom::NodeView node, bool preformattedCode, CollapsedWhitespace const& collapsed);
+
 /// @brief Determine if a node is blank (contains only whitespace)
 ///
 /// A node is considered blank if:
@@ -81,6 +104,13 @@ FlankingWhitespace flankingWhitespace(dom::NodeView node, bool preformattedCode)
 /// @retval false otherwise
 bool isBlank(dom::NodeView node);
 
+/// @brief Determine if a node is blank, reading collapsed text
+/// @param[in] node The DOM node to check
+/// @param[in] collapsed Result of collapseWhitespace() for the tree
+/// @retval true if the node is blank
+/// @retval false otherwise
+bool isBlank(dom::NodeView node, CollapsedWhitespace const& collapsed);
+
 /// @brief Check if a node is flanked by whitespace on a given side
 ///
 /// Used to determine whether to strip ASCII whitespace from the flanking
@@ -94,6 +124,15 @@ bool isBlank(dom::NodeView node);
 /// @retval false otherwise
 bool isFlankedByWhitespace(FlankSide side, dom::NodeView node, bool preformattedCode);
 
+/// @brief Check if a node is flanked by whitespace, reading collapsed text
+/// @param[in] side Which side to check (Left or Right)
+/// @param[in] node The DOM node to check around
+/// @param[in] preformattedCode Whether code elements are preformatted
+/// @param[in] collapsed Result of collapseWhitespace() for the tree
+/// @retval true if the adjacent content ends/starts with ASCII space
+/// @retval false otherwise
+bool isFlankedByWhitespace(FlankSide side, dom::NodeView node, bool preformattedCode, CollapsedWhitespace const& collapsed);
+
 /// @brief Analyze a node and compute all metadata
 ///
 /// Computes various properties of a DOM node that are needed during
@@ -105,6 +144,202 @@ bool isFlankedByWhitespace(FlankSide side, dom::NodeView node, bool preformatted
 /// @return Computed metadata for the node
 NodeMetadata analyzeNode(dom::NodeView node, bool preformattedCode);
 
+/// @brief Analyze a node against the collapse result of a conversion
+///
+/// This is the form the conversion pipeline uses: all text is read
+/// through @p collapsed, so no global state is involved and concurrent
+/// conversions do not interfere.
+///
+/// @param[in] node The DOM node to analyze
+/// @param[in] preformattedCode Whether code elements preserve whitespace
+/// @param[in] collapsed Result of collapseWhitespace() for the tree
+/// @return Computed metadata for the node
+NodeMetadata analyzeNode(dom::NodeView node, bool preformattedCode, CollapsedWhitespace const& collapsed);
+
+/// @struct TextSpan
+/// @brief Byte range in the whitespace storage of a NodeTable
+struct TextSpan {
+    std::uint32_t offset = 0; ///< First byte
+    std::uint32_t length = 0; ///< Number of bytes
+};
+
+/// @struct NodeInfo
+/// @brief Per-node facts gathered by NodeTable in a single pass
+///
+/// Text-derived fields describe the node's text content after whitespace
+/// collapsing, i.e. what getNodeText(node, collapsed) would return. The
+/// edge whitespace itself is kept by the table; resolve the spans with
+/// NodeTable::whitespace().
+struct NodeInfo {
+    dom::NodeView node;                  ///< The annotated node
+    std::uint32_t parent;                ///< Index of the parent (NodeTable::npos for the root)
+    std::uint32_t firstChild;            ///< Index of the first child, or NodeTable::npos
+    std::uint32_t previousSibling;       ///< Index of the previous sibling, or NodeTable::npos
+    std::uint32_t nextSibling;           ///< Index of the next sibling, or NodeTable::npos
+    std::size_t textLength = 0;          ///< Byte length of the collapsed text content
+    TextSpan leadingWhitespace{};        ///< Unicode whitespace the text starts with (all of it if the text is blank)
+    TextSpan trailingWhitespace{};       ///< Unicode whitespace the text ends with (empty if the text is blank)
+    char firstChar = '\0';               ///< First byte of the text, or NUL if empty
+    char lastChar = '\0';                ///< Last byte of the text, or NUL if empty
+    dom::NodeType type = dom::NodeType::Unknown; ///< Type of the node
+    dom::TagId tag = dom::TagId::Unknown;        ///< Tag of an element node
+    bool parentIsElement = false;        ///< True if the parent is an element (siblings are only considered then)
+    bool isBlock = false;                ///< See isBlock()
+    bool isCode = false;                 ///< See isCodeNode()
+    bool isVoid = false;                 ///< See isVoid()
+    bool isMeaningfulWhenBlank = false;  ///< See isMeaningfulWhenBlank()
+    bool hasVoidDescendant = false;      ///< See hasVoid()
+    bool hasMeaningfulWhenBlank = false; ///< See hasMeaningfulWhenBlank()
+    bool isWhitespaceOnly = true;        ///< True if the text is empty or only Unicode whitespace
+    bool isPruned = false;               ///< Pruned element: its descendants are not in the table
+    bool hasPrunedContent = false;       ///< A pruned element here or below held something other than whitespace
+    bool isPre = false;                  ///< True for \<pre\> and nodes inside one
+    bool isLastElement = false;          ///< True for the last element child of its parent
+    std::uint32_t elementIndex = 0;      ///< Number of element siblings before this node
+    std::uint32_t listDepth = 0;         ///< Number of enclosing \<ul\> and \<ol\> elements
+};
+
+/// @class NodeTable
+/// @brief Side table of node annotations for one conversion
+///
+/// Built once per conversion: a preorder pass numbers the nodes and links
+/// parents, children and siblings, then a bottom-up pass derives each
+/// node's text facts from its children. Every query that used to walk a
+/// subtree (isBlank(), flankingWhitespace(), hasVoid(), ...) becomes a
+/// lookup, so converting a document costs O(size) rather than
+/// O(depth × size).
+///
+/// Nodes are indexed in document order; a node's descendants follow it
+/// directly. Elements pruned by the collapse pass (see
+/// CollapsedWhitespace::pruned()) are leaves of the table: their
+/// descendants are never numbered, but the text facts of their collapsed
+/// content (CollapsedWhitespace::prunedText()) and whether it held anything
+/// besides whitespace are recorded, so blankness and flanking whitespace
+/// are unchanged. The pipeline walks the table through the child and sibling
+/// links; find() maps an arbitrary NodeView back to its index, and may be
+/// called from several threads at once.
+///
+/// All storage comes from the memory resource given at construction, so a
+/// conversion arena releases the table in one go.
+class NodeTable {
+public:
+    /// @brief Index value meaning "no such node"
+    static constexpr std::uint32_t npos = std::numeric_limits<std::uint32_t>::max();
+
+    /// @brief Annotate the tree rooted at @p root
+    ///
+    /// Nodes are numbered like the collapse result's ordinals, so a node's
+    /// index is also its ordinal in @p collapsed.
+    ///
+    /// @param[in] root The root node of the conversion
+    /// @param[in] collapsed Result of collapseWhitespace() for the same root
+    /// @param[in] preformattedCode Whether code elements preserve whitespace
+    /// @param[in] memory Resource the table allocates from
+    NodeTable(dom::NodeView root, CollapsedWhitespace const& collapsed, bool preformattedCode,
+              std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+
+    /// @brief Number of annotated nodes
+    std::size_t size() const { return nodes_.size(); }
+
+    /// @brief Access the annotation for a node index
+    NodeInfo const& operator[](std::uint32_t index) const { return nodes_[index]; }
+
+    /// @brief Resolve a whitespace span of a NodeInfo
+    std::string_view whitespace(TextSpan span) const {
+        return std::string_view(whitespace_).substr(span.offset, span.length);
+    }
+
+    /// @brief Find the index of a node
+    /// @param[in] node A node inside the annotated tree
+    /// @return The node's index, or npos if it is not part of the tree
+    std::uint32_t find(dom::NodeView node) const;
+
+    /// @brief Same as isBlank(dom::NodeView, CollapsedWhitespace const&)
+    bool isBlank(std::uint32_t index) const;
+
+    /// @brief Same as flankingWhitespace(dom::NodeView, bool, CollapsedWhitespace const&)
+    FlankingWhitespace flankingWhitespace(std::uint32_t index) const;
+
+    /// @brief Same as analyzeNode(dom::NodeView, bool, CollapsedWhitespace const&)
+    NodeMetadata metadata(std::uint32_t index) const;
+
+private:
+    template <dom::DOMNode Node>
+    void numberNodes(Node root, dom::TagSet const& pruned);
+    bool isFlankedByWhitespace(FlankSide side, std::uint32_t index) const;
+    TextSpan appendWhitespace(TextSpan span, TextSpan piece);
+    TextSpan storeWhitespace(std::string_view text);
+
+    std::pmr::vector<NodeInfo> nodes_;
+    std::pmr::string whitespace_;
+    bool preformattedCode_;
+    mutable std::pmr::unordered_map<dom::NodeHandle, std::uint32_t> byHandle_; ///< Built by the first find()
+    std::unique_ptr<std::once_flag> byHandleBuilt_ = std::make_unique<std::once_flag>();
+};
+
+/// @class TraversalContext
+/// @brief Where the node being converted sits, and what it inherits
+///
+/// The conversion hands one to Rule::traversalFilter and
+/// Rule::traversalReplacement. Every query is a lookup in the NodeTable
+/// (positions among siblings and inherited flags are recorded when the
+/// table is built), so rules need not rescan siblings or ancestors: a
+/// list item asks for its index instead of counting the items before it.
+///
+/// A TraversalContext is a view; it is valid while the conversion runs.
+class TraversalContext {
+public:
+    /// @brief Context of the node at @p index of @p table
+    TraversalContext(NodeTable const& table, std::uint32_t index) : table_(&table), index_(index) {}
+
+    /// @brief Index of the node in the conversion's NodeTable
+    std::uint32_t index() const { return index_; }
+
+    /// @brief The node itself
+    dom::NodeView node() const { return info().node; }
+
+    /// @brief The node's parent, or a null view at the root
+    dom::NodeView parent() const { return at(info().parent); }
+
+    /// @brief The node's previous sibling of any type, or a null view
+    dom::NodeView previousSibling() const { return at(info().previousSibling); }
+
+    /// @brief The node's next sibling of any type, or a null view
+    dom::NodeView nextSibling() const { return at(info().nextSibling); }
+
+    /// @brief Position among the parent's element children, counting from 0
+    /// @return The index, or -1 if the node is not an element or its parent is not
+    int elementIndex() const { return hasElementParent() ? static_cast<int>(info().elementIndex) : -1; }
+
+    /// @brief Check whether the node is its parent's last element child
+    bool isLastElementChild() const { return hasElementParent() && info().isLastElement; }
+
+    /// @brief Check whether the parent has element children besides this node
+    bool hasElementSiblings() const {
+        return hasElementParent() && !(info().elementIndex == 0 && info().isLastElement);
+    }
+
+    /// @brief Number of \<ul\> and \<ol\> elements enclosing the node
+    std::size_t listDepth() const { return info().listDepth; }
+
+    /// @brief Check whether the node is \<code\> or inside one
+    bool isInsideCode() const { return info().isCode; }
+
+    /// @brief Check whether the node is \<pre\> or inside one
+    bool isInsidePre() const { return info().isPre; }
+
+private:
+    NodeInfo const& info() const { return (*table_)[index_]; }
+    dom::NodeView at(std::uint32_t index) const { return index == NodeTable::npos ? dom::NodeView{} : (*table_)[index].node; }
+    bool hasElementParent() const {
+        NodeInfo const& self = info();
+        return self.type == dom::NodeType::Element && self.parentIsElement;
+    }
+
+    NodeTable const* table_;
+    std::uint32_t index_;
+};
+
 } // namespace turndown_cpp
 
 #endif // NODE_H
@@ -35,14 +35,21 @@
 #define RULES_H
 
 #include "dom_adapter.h"
+#include "tag_id.h"
 
+#include <array>
+#include <cstdint>
 #include <functional>
+#include <memory>
 #include <string>
 #include <vector>
 
 namespace turndown_cpp {
 
 struct TurndownOptions;
+class ConversionContext;
+struct NodeMetadata;
+class TraversalContext;
 
 /// @struct Rule
 /// @brief A conversion rule for HTML to Markdown
@@ -75,7 +82,7 @@ struct Rule {
     /// @param[in] options Current conversion options
     /// @retval true if this rule should handle the node
     /// @retval false otherwise
-    std::function<bool(dom::NodeView, TurndownOptions const&)> filter;
+    std::function<bool(dom::NodeView, TurndownOptions const&)> filter{};
 
     /// @brief Replacement function to convert the element to Markdown
     ///
@@ -86,7 +93,7 @@ struct Rule {
     /// @param[in] node The DOM node being converted
     /// @param[in] options Current conversion options
     /// @return The Markdown string for this element
-    std::function<std::string(std::string const&, dom::NodeView, TurndownOptions const&)> replacement;
+    std::function<std::string(std::string const&, dom::NodeView, TurndownOptions const&)> replacement{};
 
     /// @brief Optional append function called after all processing
     ///
@@ -95,13 +102,83 @@ struct Rule {
     ///
     /// @param[in] options Current conversion options
     /// @return Content to append to the end of the document
-    std::function<std::string(TurndownOptions const&)> append;
+    std::function<std::string(TurndownOptions const&)> append{};
 
     /// @brief Unique identifier for this rule
     ///
     /// Used for debugging and rule management. Should be descriptive
     /// of what the rule handles (e.g., "paragraph", "emphasis", "code").
-    std::string key;
+    std::string key{};
+
+    /// @brief Replacement function with access to the conversion context
+    ///
+    /// Used instead of #replacement when set. Rules that keep state while
+    /// a document is converted store it in the context (see
+    /// ConversionContext::ruleState()) so one Rules instance can serve
+    /// concurrent conversions.
+    ///
+    /// @param[in] content The processed Markdown content of child elements
+    /// @param[in] node The DOM node being converted
+    /// @param[in] options Current conversion options
+    /// @param[in,out] context State of the current conversion
+    /// @return The Markdown string for this element
+    std::function<std::string(std::string const&, dom::NodeView, TurndownOptions const&, ConversionContext&)> contextReplacement{};
+
+    /// @brief Append function with access to the conversion context
+    ///
+    /// Used instead of #append when set.
+    ///
+    /// @param[in] options Current conversion options
+    /// @param[in,out] context State of the current conversion
+    /// @return Content to append to the end of the document
+    std::function<std::string(TurndownOptions const&, ConversionContext&)> contextAppend{};
+
+    /// @brief Filter function with access to the node's traversal context
+    ///
+    /// Used instead of #filter during a conversion when set; lookups
+    /// without a conversion (Rules::forNode(dom::NodeView)) still call
+    /// #filter, and skip the rule if it is empty. The context answers
+    /// questions about siblings and ancestors (see TraversalContext) in
+    /// constant time.
+    ///
+    /// @param[in] node The DOM node to test
+    /// @param[in] options Current conversion options
+    /// @param[in] traversal Position of @p node in the document
+    /// @retval true if this rule should handle the node
+    std::function<bool(dom::NodeView, TurndownOptions const&, TraversalContext const&)> traversalFilter{};
+
+    /// @brief Replacement function with access to the node's traversal context
+    ///
+    /// Used instead of #replacement when set, unless #contextReplacement
+    /// is. Unlike the context, the traversal context is read-only, so the
+    /// rule stays stateless.
+    ///
+    /// @param[in] content The processed Markdown content of child elements
+    /// @param[in] node The DOM node being converted
+    /// @param[in] options Current conversion options
+    /// @param[in] traversal Position of @p node in the document
+    /// @return The Markdown string for this element
+    std::function<std::string(std::string const&, dom::NodeView, TurndownOptions const&, TraversalContext const&)> traversalReplacement{};
+
+    /// @brief Tags the filter can match
+    ///
+    /// A non-empty set promises that #filter returns false for any element
+    /// whose tag is not in the set, which lets Rules::compile() skip the
+    /// rule for those elements. Leave it empty for filters that look at
+    /// anything else (attributes, custom element names, ...); such rules
+    /// are tried for every element.
+    dom::TagSet tags{};
+
+    /// @brief Whether a subtree cache may store Markdown this rule produced
+    ///
+    /// A ConversionCache keys an element's Markdown by its subtree, its
+    /// parent's tag and attributes and what its TraversalContext reports
+    /// about its position. Set this only if the filter and replacement
+    /// read nothing else: no grandparents, no sibling text, no position
+    /// among other tables or sections. Subtrees in which a rule without it
+    /// ran are converted afresh every time. The CommonMark rules and
+    /// tag-name keep and remove rules set it.
+    bool cacheable = false;
 };
 
 /// @class Rules
@@ -117,16 +194,27 @@ struct Rule {
 /// -# First matching keep rule
 /// -# First matching remove rule
 /// -# Default rule
+///
+/// @par Compiled Dispatch
+/// compile() indexes the rules by the tags they declare (Rule::tags), so
+/// forNode() only runs the filters of rules that can match the element's
+/// tag plus the generic ones, in the same order as the full scan. Adding
+/// rules marks the index stale and forNode() scans every rule until the
+/// next compile().
 class Rules {
 public:
     /// @brief Construct a Rules object with the given options
     ///
-    /// Initializes the built-in rules (blank, keep replacement, default)
-    /// based on the provided options.
+    /// Initializes the built-in rules (blank, keep replacement, default).
+    /// Rules are called with the options of the conversion they run in; a
+    /// copy of @p options only serves the lookups made outside one.
     ///
     /// @param[in] options The conversion options
     explicit Rules(TurndownOptions const& options);
 
+    /// @brief Copy a rule set, to change it while the original stays in use
+    Rules(Rules const& other);
+
     /// @brief Destructor
     ~Rules();
 
@@ -179,6 +267,47 @@ public:
     /// @return Reference to the matching rule
     Rule const& forNode(dom::NodeView node) const;
 
+    /// @brief Find the appropriate rule for a node whose metadata is known
+    ///
+    /// Same as forNode(dom::NodeView), but takes blankness from @p meta
+    /// instead of walking the node's subtree again.
+    ///
+    /// @param[in] node The DOM node to find a rule for
+    /// @param[in] meta Metadata computed for @p node
+    /// @return Reference to the matching rule
+    Rule const& forNode(dom::NodeView node, NodeMetadata const& meta) const;
+
+    /// @brief Find the appropriate rule for a node during a conversion
+    ///
+    /// Same as forNode(dom::NodeView, NodeMetadata const&), but filters
+    /// are given the conversion's options, and rules with a
+    /// Rule::traversalFilter are matched through it.
+    ///
+    /// @param[in] node The DOM node to find a rule for
+    /// @param[in] meta Metadata computed for @p node
+    /// @param[in] options Options of the conversion
+    /// @param[in] traversal Position of @p node in the document
+    /// @return Reference to the matching rule
+    Rule const& forNode(dom::NodeView node, NodeMetadata const& meta, TurndownOptions const& options,
+                        TraversalContext const& traversal) const;
+
+    /// @brief Check whether a lookup consulted a rule that is not Rule::cacheable
+    ///
+    /// forNode() tries an element's candidate rules in order until one
+    /// matches, so the lookup read every filter up to @p rule's; any of
+    /// them may have looked further than a subtree cache key covers.
+    /// Without a current compile() every rule may have been consulted.
+    ///
+    /// @param[in] tag Tag of the element looked up
+    /// @param[in] rule The rule forNode() returned for it
+    /// @retval true if @p rule, or a candidate tried before it, is not cacheable
+    bool consultsUncacheable(dom::TagId tag, Rule const& rule) const;
+
+    /// @brief Check whether forNode() fell back to the default rule
+    /// @param[in] rule A rule returned by forNode()
+    /// @retval true if @p rule is the fallback for unrecognized elements
+    bool isDefaultRule(Rule const& rule) const { return &rule == &defaultRule; }
+
     /// @brief Iterate over all rules in the rules array
     ///
     /// Used primarily for calling append functions after processing.
@@ -186,6 +315,31 @@ public:
     /// @param[in] fn Callback function to call for each rule
     void forEach(std::function<void(Rule const&)> fn) const;
 
+    /// @brief Build the tag dispatch index used by forNode()
+    ///
+    /// Call after the rule set is complete. Any later addRule(), keep() or
+    /// remove() invalidates the index until compile() is called again.
+    void compile();
+
+    /// @brief Check whether the dispatch index is current
+    /// @retval true if compile() ran after the last rule was added
+    bool isCompiled() const { return compiled; }
+
+    /// @brief Identity of the rule set as last compiled
+    ///
+    /// Every compile() assigns a new value, unique within the process, so
+    /// results cached under one revision are never reused once rules change.
+    std::uint64_t revision() const { return compiledRevision; }
+
+    /// @brief Tags whose elements can be pruned before the conversion
+    ///
+    /// An element is prunable when no rule of rulesArray or keepRules can
+    /// match its tag and either a tag-name remove rule or dom::kInertTags
+    /// covers it: whatever the element holds, it converts to nothing (or
+    /// to the blank replacement). The pipeline then never visits its
+    /// descendants. Empty until compile() runs.
+    dom::TagSet const& prunedTags() const { return prunedTags_; }
+
 private:
     /// @brief Create a filter function that matches tag names
     /// @param[in] filters Vector of tag names to match (case-insensitive)
@@ -195,20 +349,39 @@ private:
     /// @brief Add a keep rule with a generated key
     /// @param[in] filter The filter function
     /// @param[in] keySuffix Suffix for the generated key
-    void addKeepRule(std::function<bool(dom::NodeView, TurndownOptions const&)> filter, std::string const& keySuffix);
+    /// @param[in] tags Tags the filter can match (empty for any element)
+    void addKeepRule(std::function<bool(dom::NodeView, TurndownOptions const&)> filter, std::string const& keySuffix, dom::TagSet tags = {});
 
     /// @brief Add a remove rule with a generated key
     /// @param[in] filter The filter function
     /// @param[in] keySuffix Suffix for the generated key
-    void addRemoveRule(std::function<bool(dom::NodeView, TurndownOptions const&)> filter, std::string const& keySuffix);
+    /// @param[in] tags Tags the filter can match (empty for any element)
+    void addRemoveRule(std::function<bool(dom::NodeView, TurndownOptions const&)> filter, std::string const& keySuffix, dom::TagSet tags = {});
+
+    /// @brief Run a rule's filter, the traversal one when it has one and @p traversal is given
+    bool matches(Rule const& rule, dom::NodeView node, TurndownOptions const& opts, TraversalContext const* traversal) const;
 
     /// @brief Search a rule vector for the first matching rule
     /// @param[in] candidates Vector of rules to search
     /// @param[in] node The node to match against
+    /// @param[in] opts Options handed to the filters
+    /// @param[in] traversal Position of @p node, or null outside a conversion
     /// @return Pointer to matching rule, or nullptr if none found
-    Rule const* findRule(std::vector<Rule> const& candidates, dom::NodeView node) const;
+    Rule const* findRule(std::vector<Rule> const& candidates, dom::NodeView node, TurndownOptions const& opts,
+                         TraversalContext const* traversal) const;
 
-    TurndownOptions const& options;     ///< Reference to conversion options
+    /// @brief Find the first matching rule among rulesArray, keepRules and removeRules
+    /// @param[in] node The node to match against
+    /// @param[in] opts Options handed to the filters
+    /// @param[in] traversal Position of @p node, or null outside a conversion
+    /// @return Pointer to matching rule, or nullptr if none found
+    Rule const* findMatchingRule(dom::NodeView node, TurndownOptions const& opts, TraversalContext const* traversal) const;
+
+    /// @brief Resolve a dispatch entry to its rule
+    /// @param[in] index Position in rulesArray, then keepRules, then removeRules
+    Rule const& ruleAt(std::uint32_t index) const;
+
+    std::shared_ptr<TurndownOptions const> options; ///< Options for lookups outside a conversion
     std::vector<Rule> rulesArray;       ///< Main rules (added + CommonMark)
     std::vector<Rule> keepRules;        ///< Rules for keeping elements as HTML
     std::vector<Rule> removeRules;      ///< Rules for removing elements
@@ -216,6 +389,14 @@ private:
     Rule blankRule;                     ///< Handles whitespace-only elements
     Rule keepReplacementRule;           ///< Replacement for kept elements
     Rule defaultRule;                   ///< Fallback for unrecognized elements
+
+    /// Candidate rule indices (see ruleAt()) grouped by tag, in priority order
+    std::vector<std::uint32_t> dispatch;
+    /// Start of each tag's candidates in #dispatch; one extra end entry
+    std::array<std::uint32_t, dom::kTagCount + 1> dispatchOffsets{};
+    bool compiled = false;              ///< True while #dispatch matches the rules
+    std::uint64_t compiledRevision = 0; ///< See revision()
+    dom::TagSet prunedTags_;            ///< See prunedTags()
 };
 
 } // namespace turndown_cpp
@@ -0,0 +1,193 @@
+/// @file simd_scan.h
+/// @brief Vectorised byte scanning for hot text paths
+///
+/// Escaping and whitespace handling spend most of their time looking for a
+/// handful of ASCII bytes in long runs of ordinary text. findAny() compares
+/// a whole vector of input against every needle at once (32 bytes with
+/// AVX2, 16 with SSE2 or NEON) and only drops to the byte loop for the
+/// tail, so text without special bytes is skipped at memory speed.
+/// findFirstNotOf() and findLastNotOf() skip runs of the needles instead,
+/// from either end.
+///
+/// The instruction set is picked at compile time from the target flags.
+/// Define TURNDOWN_NO_SIMD to force the portable scalar loop.
+///
+/// @copyright The MIT License (MIT)
+/// @copyright Copyright (c) 2025 Parsa Amini
+
+#ifndef TURNDOWN_CPP_SIMD_SCAN_H
+#define TURNDOWN_CPP_SIMD_SCAN_H
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#if !defined(TURNDOWN_NO_SIMD)
+#if defined(__AVX2__)
+#define TURNDOWN_SIMD_AVX2 1
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TURNDOWN_SIMD_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define TURNDOWN_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+#endif
+
+#if defined(TURNDOWN_SIMD_AVX2) || defined(TURNDOWN_SIMD_SSE2) || defined(TURNDOWN_SIMD_NEON)
+#define TURNDOWN_SIMD_VECTOR 1
+#endif
+
+namespace turndown_cpp::simd {
+
+namespace detail {
+
+#if defined(TURNDOWN_SIMD_VECTOR)
+/// @brief One vector of input compared against a set of bytes
+///
+/// matches() returns a mask with kBitsPerByte bits per input byte, the
+/// lowest bits for the first byte, all set where the byte is a needle.
+struct Vector {
+#if defined(TURNDOWN_SIMD_AVX2)
+    static constexpr std::size_t kWidth = 32;
+    static constexpr unsigned kBitsPerByte = 1;
+
+    template <char... Needles>
+    static std::uint64_t matches(char const* data) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(data));
+        __m256i hits = _mm256_setzero_si256();
+        ((hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(Needles)))), ...);
+        return static_cast<std::uint32_t>(_mm256_movemask_epi8(hits));
+    }
+#elif defined(TURNDOWN_SIMD_SSE2)
+    static constexpr std::size_t kWidth = 16;
+    static constexpr unsigned kBitsPerByte = 1;
+
+    template <char... Needles>
+    static std::uint64_t matches(char const* data) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<__m128i const*>(data));
+        __m128i hits = _mm_setzero_si128();
+        ((hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chunk, _mm_set1_epi8(Needles)))), ...);
+        return static_cast<std::uint32_t>(_mm_movemask_epi8(hits));
+    }
+#elif defined(TURNDOWN_SIMD_NEON)
+    static constexpr std::size_t kWidth = 16;
+    static constexpr unsigned kBitsPerByte = 4;
+
+    template <char... Needles>
+    static std::uint64_t matches(char const* data) {
+        uint8x16_t chunk = vld1q_u8(reinterpret_cast<std::uint8_t const*>(data));
+        uint8x16_t hits = vdupq_n_u8(0);
+        ((hits = vorrq_u8(hits, vceqq_u8(chunk, vdupq_n_u8(static_cast<std::uint8_t>(Needles))))), ...);
+        // Narrow each 0x00/0xFF lane to a nibble so the mask fits in 64 bits.
+        uint8x8_t narrowed = vshrn_n_u16(vreinterpretq_u16_u8(hits), 4);
+        return vget_lane_u64(vreinterpret_u64_u8(narrowed), 0);
+    }
+#endif
+};
+
+/// All mask bits of one vector
+inline constexpr std::uint64_t kFullMask =
+    Vector::kWidth * Vector::kBitsPerByte == 64 ? ~std::uint64_t{0}
+                                                : (std::uint64_t{1} << (Vector::kWidth * Vector::kBitsPerByte)) - 1;
+#endif
+
+} // namespace detail
+
+/// @brief Position of the first byte equal to one of @p Needles, byte by byte
+///
+/// Reference implementation and tail loop of findAny().
+///
+/// @tparam Needles The bytes to look for
+/// @param[in] text The text to scan
+/// @param[in] from Offset to start scanning at
+/// @return Offset of the first match, or std::string_view::npos
+template <char... Needles>
+std::size_t findAnyScalar(std::string_view text, std::size_t from = 0) {
+    for (std::size_t i = from; i < text.size(); ++i) {
+        char c = text[i];
+        if (((c == Needles) || ...)) return i;
+    }
+    return std::string_view::npos;
+}
+
+/// @brief Position of the first byte equal to one of @p Needles
+/// @tparam Needles The bytes to look for
+/// @param[in] text The text to scan
+/// @param[in] from Offset to start scanning at
+/// @return Offset of the first match, or std::string_view::npos
+template <char... Needles>
+std::size_t findAny(std::string_view text, std::size_t from = 0) {
+    static_assert(sizeof...(Needles) > 0, "findAny needs at least one needle");
+    std::size_t i = from;
+#if defined(TURNDOWN_SIMD_VECTOR)
+    using detail::Vector;
+    for (; i + Vector::kWidth <= text.size(); i += Vector::kWidth) {
+        std::uint64_t mask = Vector::matches<Needles...>(text.data() + i);
+        if (mask != 0) return i + static_cast<std::size_t>(std::countr_zero(mask)) / Vector::kBitsPerByte;
+    }
+#endif
+    return findAnyScalar<Needles...>(text, i);
+}
+
+/// @brief Position of the first byte that is none of @p Needles
+///
+/// The complement of findAny(): skips a run of the needle bytes, e.g.
+/// leading whitespace, a vector at a time.
+///
+/// @tparam Needles The bytes to skip
+/// @param[in] text The text to scan
+/// @param[in] from Offset to start scanning at
+/// @return Offset of the first other byte, or std::string_view::npos
+template <char... Needles>
+std::size_t findFirstNotOf(std::string_view text, std::size_t from = 0) {
+    static_assert(sizeof...(Needles) > 0, "findFirstNotOf needs at least one needle");
+    std::size_t i = from;
+#if defined(TURNDOWN_SIMD_VECTOR)
+    using detail::Vector;
+    for (; i + Vector::kWidth <= text.size(); i += Vector::kWidth) {
+        std::uint64_t mask = Vector::matches<Needles...>(text.data() + i) ^ detail::kFullMask;
+        if (mask != 0) return i + static_cast<std::size_t>(std::countr_zero(mask)) / Vector::kBitsPerByte;
+    }
+#endif
+    for (; i < text.size(); ++i) {
+        char c = text[i];
+        if (!((c == Needles) || ...)) return i;
+    }
+    return std::string_view::npos;
+}
+
+/// @brief Position of the last byte before @p end that is none of @p Needles
+///
+/// Scans backwards, a vector at a time, e.g. over trailing whitespace.
+///
+/// @tparam Needles The bytes to skip
+/// @param[in] text The text to scan
+/// @param[in] end Offset one past the last byte to consider
+/// @return Offset of the last other byte, or std::string_view::npos
+template <char... Needles>
+std::size_t findLastNotOf(std::string_view text, std::size_t end = std::string_view::npos) {
+    static_assert(sizeof...(Needles) > 0, "findLastNotOf needs at least one needle");
+    std::size_t i = end < text.size() ? end : text.size();
+#if defined(TURNDOWN_SIMD_VECTOR)
+    using detail::Vector;
+    for (; i >= Vector::kWidth; i -= Vector::kWidth) {
+        std::uint64_t mask = Vector::matches<Needles...>(text.data() + i - Vector::kWidth) ^ detail::kFullMask;
+        if (mask != 0) {
+            auto highest = static_cast<std::size_t>(63 - std::countl_zero(mask)) / Vector::kBitsPerByte;
+            return i - Vector::kWidth + highest;
+        }
+    }
+#endif
+    while (i-- > 0) {
+        char c = text[i];
+        if (!((c == Needles) || ...)) return i;
+    }
+    return std::string_view::npos;
+}
+
+} // namespace turndown_cpp::simd
+
+#endif // TURNDOWN_CPP_SIMD_SCAN_H
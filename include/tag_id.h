@@ -0,0 +1,183 @@
+/// @file tag_id.h
+/// @brief Interned HTML tag identifiers
+///
+/// Every backend maps its native tag representation (Gumbo's `GumboTag`,
+/// Lexbor's `lxb_tag_id_t`, Tidy's `TidyTagId`, libxml2's element name) to
+/// the parser-agnostic TagId enumeration below. Element classification then
+/// becomes a load and a mask against a TagSet instead of allocating the tag
+/// name and comparing it with a list of strings.
+///
+/// Elements the enumeration does not know (custom elements, obsolete or
+/// foreign tags) report TagId::Unknown; their name is still available from
+/// `NodeView::tag_name()`.
+///
+/// @copyright The MIT License (MIT)
+/// @copyright Copyright (c) 2025 Parsa Amini
+
+#ifndef TURNDOWN_CPP_TAG_ID_H
+#define TURNDOWN_CPP_TAG_ID_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <string_view>
+
+namespace turndown_cpp::dom {
+
+/// @brief X-macro list of known tags as (enumerator, name)
+///
+/// Kept in lexicographic order of the names so tagIdFromName() can binary
+/// search the name table.
+#define TURNDOWN_TAG_LIST(X) \
+    X(A, "a") X(Abbr, "abbr") X(Acronym, "acronym") X(Address, "address") \
+    X(Applet, "applet") X(Area, "area") X(Article, "article") X(Aside, "aside") \
+    X(Audio, "audio") X(B, "b") X(Base, "base") X(Basefont, "basefont") \
+    X(Bdi, "bdi") X(Bdo, "bdo") X(Bgsound, "bgsound") X(Big, "big") \
+    X(Blink, "blink") X(Blockquote, "blockquote") X(Body, "body") X(Br, "br") \
+    X(Button, "button") X(Canvas, "canvas") X(Caption, "caption") X(Center, "center") \
+    X(Cite, "cite") X(Code, "code") X(Col, "col") X(Colgroup, "colgroup") \
+    X(Command, "command") X(Data, "data") X(Datalist, "datalist") X(Dd, "dd") \
+    X(Del, "del") X(Details, "details") X(Dfn, "dfn") X(Dialog, "dialog") \
+    X(Dir, "dir") X(Div, "div") X(Dl, "dl") X(Dt, "dt") \
+    X(Em, "em") X(Embed, "embed") X(Fieldset, "fieldset") X(Figcaption, "figcaption") \
+    X(Figure, "figure") X(Font, "font") X(Footer, "footer") X(Form, "form") \
+    X(Frame, "frame") X(Frameset, "frameset") X(H1, "h1") X(H2, "h2") \
+    X(H3, "h3") X(H4, "h4") X(H5, "h5") X(H6, "h6") \
+    X(Head, "head") X(Header, "header") X(Hgroup, "hgroup") X(Hr, "hr") \
+    X(Html, "html") X(I, "i") X(Iframe, "iframe") X(Image, "image") \
+    X(Img, "img") X(Input, "input") X(Ins, "ins") X(Isindex, "isindex") \
+    X(Kbd, "kbd") X(Keygen, "keygen") X(Label, "label") X(Legend, "legend") \
+    X(Li, "li") X(Link, "link") X(Listing, "listing") X(Main, "main") \
+    X(Map, "map") X(Mark, "mark") X(Marquee, "marquee") X(Math, "math") \
+    X(Menu, "menu") X(Menuitem, "menuitem") X(Meta, "meta") X(Meter, "meter") \
+    X(Nav, "nav") X(Nobr, "nobr") X(Noembed, "noembed") X(Noframes, "noframes") \
+    X(Noscript, "noscript") X(Object, "object") X(Ol, "ol") X(Optgroup, "optgroup") \
+    X(Option, "option") X(Output, "output") X(P, "p") X(Param, "param") \
+    X(Picture, "picture") X(Plaintext, "plaintext") X(Pre, "pre") X(Progress, "progress") \
+    X(Q, "q") X(Rb, "rb") X(Rp, "rp") X(Rt, "rt") \
+    X(Rtc, "rtc") X(Ruby, "ruby") X(S, "s") X(Samp, "samp") \
+    X(Script, "script") X(Search, "search") X(Section, "section") X(Select, "select") \
+    X(Slot, "slot") X(Small, "small") X(Source, "source") X(Spacer, "spacer") \
+    X(Span, "span") X(Strike, "strike") X(Strong, "strong") X(Style, "style") \
+    X(Sub, "sub") X(Summary, "summary") X(Sup, "sup") X(Svg, "svg") \
+    X(Table, "table") X(Tbody, "tbody") X(Td, "td") X(Template, "template") \
+    X(Textarea, "textarea") X(Tfoot, "tfoot") X(Th, "th") X(Thead, "thead") \
+    X(Time, "time") X(Title, "title") X(Tr, "tr") X(Track, "track") \
+    X(Tt, "tt") X(U, "u") X(Ul, "ul") X(Var, "var") \
+    X(Video, "video") X(Wbr, "wbr") X(Xmp, "xmp")
+
+/// @brief Parser-agnostic tag identifier
+enum class TagId : std::uint8_t {
+    Unknown = 0, ///< Not an element, or an element not listed below
+#define TURNDOWN_TAG_ENUMERATOR(id, name) id,
+    TURNDOWN_TAG_LIST(TURNDOWN_TAG_ENUMERATOR)
+#undef TURNDOWN_TAG_ENUMERATOR
+};
+
+/// @brief Number of TagId values, including TagId::Unknown
+inline constexpr std::size_t kTagCount = 1
+#define TURNDOWN_TAG_COUNT(id, name) + 1
+    TURNDOWN_TAG_LIST(TURNDOWN_TAG_COUNT)
+#undef TURNDOWN_TAG_COUNT
+    ;
+
+/// @brief Map a tag name to its identifier
+/// @param[in] name Element name, compared ASCII case-insensitively
+/// @return The identifier, or TagId::Unknown for names not in the list
+TagId tagIdFromName(std::string_view name);
+
+/// @brief Get the lowercase name of a tag identifier
+/// @param[in] tag The identifier
+/// @return The tag name, or an empty view for TagId::Unknown
+std::string_view tagName(TagId tag);
+
+/// @class TagSet
+/// @brief Fixed-size bitset over TagId
+///
+/// All operations are constexpr so the classification tables below are
+/// built at compile time.
+class TagSet {
+public:
+    constexpr TagSet() = default;
+
+    /// @brief Create a set holding @p tags
+    constexpr TagSet(std::initializer_list<TagId> tags) {
+        for (TagId tag : tags) {
+            insert(tag);
+        }
+    }
+
+    /// @brief Add @p tag to the set
+    constexpr void insert(TagId tag) {
+        auto index = static_cast<std::size_t>(tag);
+        words_[index / 64] |= std::uint64_t{1} << (index % 64);
+    }
+
+    /// @brief Remove @p tag from the set
+    constexpr void erase(TagId tag) {
+        auto index = static_cast<std::size_t>(tag);
+        words_[index / 64] &= ~(std::uint64_t{1} << (index % 64));
+    }
+
+    /// @brief Check whether @p tag is in the set
+    constexpr bool contains(TagId tag) const {
+        auto index = static_cast<std::size_t>(tag);
+        return (words_[index / 64] >> (index % 64)) & 1u;
+    }
+
+    /// @brief Check whether the set holds no tags
+    constexpr bool empty() const {
+        for (std::uint64_t word : words_) {
+            if (word != 0) return false;
+        }
+        return true;
+    }
+
+private:
+    std::array<std::uint64_t, (kTagCount + 63) / 64> words_{};
+};
+
+/// @brief Block elements from the HTML spec that affect document flow
+///
+/// Matches the original JavaScript Turndown blockElements array.
+inline constexpr TagSet kBlockTags{
+    TagId::Address, TagId::Article, TagId::Aside, TagId::Audio, TagId::Blockquote,
+    TagId::Body, TagId::Canvas, TagId::Center, TagId::Dd, TagId::Dir, TagId::Div,
+    TagId::Dl, TagId::Dt, TagId::Fieldset, TagId::Figcaption, TagId::Figure,
+    TagId::Footer, TagId::Form, TagId::Frameset, TagId::H1, TagId::H2, TagId::H3,
+    TagId::H4, TagId::H5, TagId::H6, TagId::Header, TagId::Hgroup, TagId::Hr,
+    TagId::Html, TagId::Isindex, TagId::Li, TagId::Main, TagId::Menu, TagId::Nav,
+    TagId::Noframes, TagId::Noscript, TagId::Ol, TagId::Output, TagId::P, TagId::Pre,
+    TagId::Section, TagId::Table, TagId::Tbody, TagId::Td, TagId::Tfoot, TagId::Th,
+    TagId::Thead, TagId::Tr, TagId::Ul
+};
+
+/// @brief Void elements, which are self-closing and cannot have content
+///
+/// Matches the original JavaScript Turndown voidElements array.
+inline constexpr TagSet kVoidTags{
+    TagId::Area, TagId::Base, TagId::Br, TagId::Col, TagId::Command, TagId::Embed,
+    TagId::Hr, TagId::Img, TagId::Input, TagId::Keygen, TagId::Link, TagId::Meta,
+    TagId::Param, TagId::Source, TagId::Track, TagId::Wbr
+};
+
+/// @brief Elements that have meaning even without content
+///
+/// Matches the original JavaScript Turndown meaningfulWhenBlankElements.
+inline constexpr TagSet kMeaningfulWhenBlankTags{
+    TagId::A, TagId::Table, TagId::Thead, TagId::Tbody, TagId::Tfoot, TagId::Th,
+    TagId::Td, TagId::Iframe, TagId::Script, TagId::Audio, TagId::Video
+};
+
+/// @brief Elements whose content is not part of the document
+///
+/// Browsers keep the children of \<template\> in a separate document
+/// fragment, so Turndown never sees them; parsers here put them in the
+/// tree. Unless a rule claims them, these elements are converted as if
+/// they were empty.
+inline constexpr TagSet kInertTags{TagId::Template};
+
+} // namespace turndown_cpp::dom
+
+#endif // TURNDOWN_CPP_TAG_ID_H
@@ -0,0 +1,93 @@
+/// @file thread_pool.h
+/// @brief Work-stealing thread pool for data-parallel loops
+///
+/// The pool keeps a fixed set of worker threads alive between jobs. A job is
+/// a loop over an index range: parallelFor() hands every worker a contiguous
+/// slice of the range, workers take indices from the front of their own
+/// slice, and a worker that runs dry steals the back half of the largest
+/// remaining slice. Uneven items (a few huge documents among many small
+/// ones) therefore do not leave threads idle while one worker still has a
+/// queue.
+///
+/// @copyright The MIT License (MIT)
+/// @copyright Copyright (c) 2025 Parsa Amini
+
+#ifndef TURNDOWN_CPP_THREAD_POOL_H
+#define TURNDOWN_CPP_THREAD_POOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace turndown_cpp {
+
+/// @class ThreadPool
+/// @brief Fixed-size pool that runs index loops with work stealing
+///
+/// The calling thread takes part in every job as worker 0, so a pool of
+/// N workers starts N - 1 threads.
+class ThreadPool {
+public:
+    /// @brief Loop body: receives the item index and the worker running it
+    ///
+    /// The worker index is below size(); bodies use it to reach per-worker
+    /// state without locking.
+    using Body = std::function<void(std::size_t index, std::size_t worker)>;
+
+    /// @brief Start a pool
+    /// @param[in] workers Number of workers; 0 uses the hardware concurrency
+    explicit ThreadPool(std::size_t workers = 0);
+
+    /// @brief Stop and join the worker threads
+    ~ThreadPool();
+
+    ThreadPool(ThreadPool const&) = delete;
+    ThreadPool& operator=(ThreadPool const&) = delete;
+
+    /// @brief Number of workers, including the calling thread
+    std::size_t size() const { return slices_.size(); }
+
+    /// @brief Run @p body for every index in [0, @p count) and wait for it
+    ///
+    /// Calls from several threads are serialised. If a body throws, the
+    /// remaining indices still run and the first exception is rethrown once
+    /// the loop has finished.
+    ///
+    /// @param[in] count Number of items
+    /// @param[in] body Function called once per item
+    void parallelFor(std::size_t count, Body const& body);
+
+private:
+    struct Slice {
+        std::mutex mutex;
+        std::size_t begin = 0;
+        std::size_t end = 0;
+    };
+
+    void workerLoop(std::size_t worker);
+    void runSlices(std::size_t worker);
+    bool takeIndex(std::size_t worker, std::size_t& index);
+    bool steal(std::size_t worker);
+
+    std::vector<std::unique_ptr<Slice>> slices_;
+    std::vector<std::thread> threads_;
+
+    std::mutex jobMutex_;      // serialises parallelFor()
+    std::mutex stateMutex_;    // guards the fields below
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    Body const* body_ = nullptr;
+    std::size_t generation_ = 0;
+    std::size_t busyWorkers_ = 0;
+    bool stopping_ = false;
+    std::exception_ptr error_;
+};
+
+} // namespace turndown_cpp
+
+#endif // TURNDOWN_CPP_THREAD_POOL_H
@@ -19,6 +19,8 @@
 #include <cstddef>
 #include <functional>
 #include <iterator>
+#include <memory>
+#include <memory_resource>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -99,6 +101,10 @@ public:
 
     AttributeIterator() = default;
     explicit AttributeIterator(TidyAttr attr) : current_(attr) {}
+    explicit AttributeIterator(dom::AttributeCursor cursor);
+
+    /// @brief The position, for dom::AttributeRange
+    dom::AttributeCursor cursor() const { return {current_, 0}; }
 
     dom::AttributeView operator*() const;
     AttributeIterator& operator++();
@@ -152,6 +158,7 @@ public:
 
     // Element operations
     std::string tag_name() const;
+    dom::TagId tag_id() const;
     bool has_tag(std::string_view tag) const;
     NodeView find_child(std::string_view tag) const;
     NodeView first_text_child() const;
@@ -166,6 +173,7 @@ public:
     std::string text_content() const;
     void set_text(std::string const& text);
     std::string_view text() const;
+    std::string_view source_html() const;
 
 private:
     TidyNode node_ = nullptr;
@@ -178,7 +186,7 @@ static_assert(dom::DOMNodeWithHandle<NodeView>, "NodeView must satisfy DOMNodeWi
 class Document {
 public:
     Document() = default;
-    static Document parse(std::string const& html);
+    static Document parse(std::string_view html);
 
     Document(Document const&) = delete;
     Document& operator=(Document const&) = delete;
@@ -195,14 +203,57 @@ public:
     TidyDoc get() const { return doc_; }
 
 private:
+    friend class Parser;
     explicit Document(TidyDoc doc) : doc_(doc) {}
     TidyDoc doc_ = nullptr;
+    /// Allocator the document was created with, when not Tidy's default;
+    /// released after the document
+    std::shared_ptr<TidyAllocator> allocator_;
 };
 
 static_assert(dom::DOMDocument<Document, NodeView>, "Document must satisfy DOMDocument concept");
 
+/// @brief Collects a document fed in pieces and parses it on finish()
+///
+/// Tidy has no incremental parser, so the pieces are buffered.
+class DocumentBuilder {
+public:
+    DocumentBuilder();
+
+    DocumentBuilder(DocumentBuilder const&) = delete;
+    DocumentBuilder& operator=(DocumentBuilder const&) = delete;
+    DocumentBuilder(DocumentBuilder&& other) noexcept;
+    DocumentBuilder& operator=(DocumentBuilder&& other) noexcept;
+
+    ~DocumentBuilder();
+
+    void feed(std::string_view chunk);
+    Document finish();
+
+private:
+    std::string html_;
+};
+
+/// @brief Parses documents one after another
+///
+/// A Tidy document cannot be parsed into twice, so parse() configures a
+/// new one like Document::parse() and recycle() frees it. Given a memory
+/// resource, documents are created with a TidyAllocator over it.
+class Parser {
+public:
+    Parser() = default;
+    explicit Parser(std::pmr::memory_resource* memory);
+
+    Document parse(std::string_view html);
+    void recycle(Document&& document);
+
+private:
+    std::shared_ptr<TidyAllocator> allocator_;
+};
+
 // Utility functions
 std::string lookup_tag_name(TidyNode node);
+dom::TagId lookup_tag_id(TidyNode node);
 bool has_tag(TidyNode node, std::string_view tag);
 inline bool is_element(TidyNode node) {
     if (!node) return false;
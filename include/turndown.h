@@ -17,14 +17,23 @@
 #ifndef TURNDOWN_H
 #define TURNDOWN_H
 
+#include "conversion_cache.h"
+#include "conversion_limits.h"
+#include "conversion_stats.h"
 #include "dom_source.h"
 #include "dom_adapter.h"
 #include "rules.h"
 #include "utilities.h"
 
+#include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <iosfwd>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 
@@ -111,6 +120,36 @@ struct TurndownOptions {
     /// @see https://github.com/lucthev/collapse-whitespace/issues/16
     bool preformattedCode;
 
+    /// @brief Whether to allocate per-conversion storage from an arena
+    ///
+    /// When true, each conversion owns a monotonic memory arena: the
+    /// whitespace collapse result, the node annotations and other internal
+    /// temporaries are carved out of it and released together when the
+    /// conversion returns, instead of being freed one by one. This trades
+    /// a higher peak footprint for far fewer calls into the allocator.
+    /// Strings exchanged with rules are unaffected.
+    bool useConversionArena;
+
+    /// @brief Whether to convert HTML strings from a flat snapshot
+    ///
+    /// When true, turndown() on an HTML string copies the parsed tree into
+    /// a dom::FlatDocument (see flat_document.h) and frees the backend tree
+    /// before converting. The pipeline then walks contiguous arrays laid
+    /// out the same way for every parser backend. Conversions of an
+    /// existing tree (turndown(dom::NodeView)) are unaffected.
+    bool useFlatDocument;
+
+    /// @brief Deepest element nesting converted by rules; 0 for no limit
+    ///
+    /// The conversion walks the tree with an explicit stack, so no depth
+    /// overflows the call stack. Each nesting level still costs a pass of
+    /// its rule over the content of the level beneath it. Elements nested
+    /// more than @c maxDepth levels below the root are therefore not given
+    /// to rules. Their text content is emitted as if it were a single text
+    /// node, which degrades machine-generated or hostile documents
+    /// gracefully instead of failing.
+    std::size_t maxDepth;
+
     /// @brief Custom escape function for Markdown characters
     ///
     /// A function that takes a string and returns a version with
@@ -166,7 +205,9 @@ struct TurndownOptions {
     TurndownOptions();
 };
 
+class BatchConverter;
 class DomSource;
+class ThreadPool;
 
 /// @class TurndownService
 /// @brief Main service class for converting HTML to Markdown
@@ -203,6 +244,17 @@ class DomSource;
 ///     }
 /// });
 /// @endcode
+///
+/// @par Thread Safety
+/// Once configured, a TurndownService may be shared by any number of
+/// threads through a const reference: the const turndown() overloads keep
+/// all per-document state in a context of their own and only read the
+/// service's options and rules. The rule set is built on first use under an
+/// internal lock, so callers need no synchronization of their own.
+/// Configuration methods (addRule(), keep(), remove(), options(), ...) are
+/// not safe to call while conversions run on other threads. Custom rules
+/// that keep state between calls must store it in the ConversionContext
+/// (see Rule::contextReplacement) for this guarantee to hold.
 class TurndownService {
 public:
     /// @typedef Plugin
@@ -227,6 +279,13 @@ public:
     /// @copydoc KeepFilter
     using RemoveFilter = KeepFilter;
 
+    /// @typedef MarkdownSink
+    /// @brief Receives the pieces of a streamed conversion
+    ///
+    /// Called with consecutive pieces of the Markdown; the view is only
+    /// valid during the call.
+    using MarkdownSink = std::function<void(std::string_view)>;
+
     /// @enum RulePlacement
     /// @brief Specifies when custom rule factories should be applied
     enum class RulePlacement {
@@ -241,7 +300,29 @@ public:
     /// @param[in] options Configuration options for the conversion
     explicit TurndownService(TurndownOptions options);
 
+    /// @brief Copy the service, sharing its built rule set
+    ///
+    /// The copy has the same options, rules, plugins' effects and cache.
+    /// The rule set is built first if it has not been, then shared rather
+    /// than rebuilt; either service's next rule change (addRule(), keep(),
+    /// remove()) applies to a private copy of it. Option changes never
+    /// rebuild rules, because rules read the options they are called with.
+    /// This makes a short-lived, slightly customized service cheap:
+    ///
+    /// @code{.cpp}
+    /// TurndownService perTenant = shared.clone();
+    /// perTenant.configureOptions([](TurndownOptions& o) { o.emDelimiter = "*"; });
+    /// @endcode
+    ///
+    /// @return The copy
+    TurndownService clone() const;
+
     /// @brief Configure options using a callback function
+    ///
+    /// Does not rebuild the rule set: the built-in rules read the options
+    /// passed to their filter and replacement functions at call time.
+    /// Custom rules should do the same rather than capture options.
+    ///
     /// @param[in] fn A function that receives and modifies the options
     /// @return Reference to this service for chaining
     TurndownService& configureOptions(std::function<void(TurndownOptions&)> fn);
@@ -340,17 +421,132 @@ public:
     ///
     /// @param[in] html The HTML string to convert
     /// @return The Markdown representation of the HTML
-    std::string turndown(std::string const& html);
+    std::string turndown(std::string const& html) const;
+
+    /// @brief Convert a small HTML snippet to Markdown
+    ///
+    /// Gives the same Markdown as turndown(std::string const&), tuned for
+    /// high volumes of short inputs such as comments, titles and chat
+    /// messages. A snippet without markup, character references or
+    /// control characters is not parsed at all: only its whitespace is
+    /// collapsed and its text escaped. That shortcut is only taken while
+    /// the service has no rules, keep or remove filters or keepTags of its
+    /// own, which could match the elements a parser wraps text in. Other
+    /// snippets are parsed with a
+    /// dom::Parser kept per thread, so parser state is reused from one
+    /// snippet to the next.
+    ///
+    /// @param[in] html The HTML snippet, converted as the content of a body
+    /// @return The Markdown representation of the snippet
+    std::string turndownFragment(std::string_view html) const;
 
     /// @brief Convert a DOM node to Markdown
     /// @param[in] root The root node to convert
     /// @return The Markdown representation of the DOM tree
-    std::string turndown(dom::NodeView root);
+    std::string turndown(dom::NodeView root) const;
 
     /// @brief Convert a DomSource to Markdown
     /// @param[in] dom The DOM source to convert
     /// @return The Markdown representation
-    std::string turndown(DomSource const& dom);
+    std::string turndown(DomSource const& dom) const;
+
+    /// @brief Convert an HTML string to Markdown and profile the conversion
+    ///
+    /// Produces the same Markdown as turndown(std::string const&) and
+    /// fills @p stats with stage times, per-rule counters, node and byte
+    /// counts. Only this overload pays for the instrumentation.
+    ///
+    /// @param[in] html The HTML string to convert
+    /// @param[out] stats Overwritten with the statistics of this conversion
+    /// @return The Markdown representation of the HTML
+    std::string turndown(std::string const& html, ConversionStats& stats) const;
+
+    /// @brief Convert a DOM node to Markdown and profile the conversion
+    /// @param[in] root The root node to convert
+    /// @param[out] stats Overwritten with the statistics of this conversion
+    /// @return The Markdown representation of the DOM tree
+    std::string turndown(dom::NodeView root, ConversionStats& stats) const;
+
+    /// @brief Convert an HTML string to Markdown, streaming it to a sink
+    ///
+    /// The sink receives the same Markdown turndown(std::string const&)
+    /// returns, in pieces: each top-level block is passed on as soon as the
+    /// block after it starts, so the output is never held in full. Text
+    /// added at the end by rule append functions, such as reference link
+    /// definitions, arrives last.
+    ///
+    /// @code{.cpp}
+    /// service.turndown(html, [&](std::string_view chunk) { socket.write(chunk); });
+    /// @endcode
+    ///
+    /// @param[in] html The HTML string to convert
+    /// @param[in] sink Called with each piece of Markdown, in order
+    void turndown(std::string const& html, MarkdownSink const& sink) const;
+
+    /// @brief Convert a DOM node to Markdown, streaming it to a sink
+    /// @param[in] root The root node to convert
+    /// @param[in] sink Called with each piece of Markdown, in order
+    void turndown(dom::NodeView root, MarkdownSink const& sink) const;
+
+    /// @brief Convert an HTML string to Markdown, writing it to a stream
+    ///
+    /// Streams like turndown(std::string const&, MarkdownSink const&).
+    ///
+    /// @param[in] html The HTML string to convert
+    /// @param[in,out] out Stream the Markdown is written to
+    void turndown(std::string const& html, std::ostream& out) const;
+
+    /// @brief Convert an HTML string to Markdown within limits
+    ///
+    /// Produces the same Markdown as turndown(std::string const&) unless a
+    /// limit in @p limits is reached (see conversion_limits.h). Parsing is
+    /// not interrupted; the limits are checked from the whitespace pass on.
+    /// Under LimitAction::Truncate the result then holds the Markdown of the
+    /// nodes visited before the limit and names the limit; truncated
+    /// results are not stored in the cache. A document the cache holds is
+    /// answered from it, subject only to ConversionLimits::maxOutputBytes.
+    ///
+    /// @param[in] html The HTML string to convert
+    /// @param[in] limits Budgets for this call
+    /// @return The Markdown and the limit reached, if any
+    /// @throws ConversionLimitExceeded under LimitAction::Throw, when a limit is reached
+    LimitedConversion turndown(std::string const& html, ConversionLimits const& limits) const;
+
+    /// @brief Convert a DOM node to Markdown within limits
+    /// @param[in] root The root node to convert
+    /// @param[in] limits Budgets for this call
+    /// @return The Markdown and the limit reached, if any
+    /// @throws ConversionLimitExceeded under LimitAction::Throw, when a limit is reached
+    LimitedConversion turndown(dom::NodeView root, ConversionLimits const& limits) const;
+
+    /// @brief Convert an HTML string to Markdown on several threads
+    ///
+    /// Produces the same Markdown as turndown(std::string const&). The
+    /// blocks at the top of the document (below html, body and any other
+    /// wrappers converted as plain blocks) are converted on @p pool in
+    /// contiguous groups, each with rule state of its own, and joined in
+    /// order. Reference links are numbered as in a sequential conversion.
+    /// This helps with single very large documents. A document with fewer
+    /// than two such blocks, or one whose rule state cannot be merged (see
+    /// RuleState::merge()), is converted on the calling thread.
+    ///
+    /// Rules are called from several threads at once, under the same
+    /// requirements as concurrent conversions (see the class notes). Do
+    /// not call this from a job running on @p pool.
+    ///
+    /// @param[in] html The HTML string to convert
+    /// @param[in,out] pool Pool the blocks are converted on
+    /// @return The Markdown representation of the HTML
+    std::string turndown(std::string const& html, ThreadPool& pool) const;
+
+    /// @brief Convert a DOM node to Markdown on several threads
+    ///
+    /// Same as turndown(std::string const&, ThreadPool&) for a parsed tree.
+    ///
+    /// @param[in] root The root node to convert
+    /// @param[in,out] pool Pool the blocks are converted on
+    /// @return The Markdown representation of the DOM tree
+    std::string turndown(dom::NodeView root, ThreadPool& pool) const;
 
     /// @brief Escape Markdown syntax in a string
     ///
@@ -372,17 +568,52 @@ public:
     /// @return Const reference to the options
     TurndownOptions const& options() const;
 
+    /// @brief Attach a cache of conversion results
+    ///
+    /// See conversion_cache.h. Whole documents are looked up by
+    /// turndown(std::string const&) and BatchConverter; element subtrees by
+    /// every conversion. Subtree entries rely on rules depending only on the
+    /// element's subtree, its parent and its position among its element
+    /// siblings, so subtrees in which a rule not marked Rule::cacheable was
+    /// consulted, or a rule with per-conversion state or an append
+    /// function ran, are not stored. Neither is any subtree while the
+    /// blank, keep or default replacement option is not its default.
+    ///
+    /// Entries are keyed by the options and the rule set, so any rule
+    /// change and any option change made through configureOptions() start
+    /// afresh. Function-valued options are told apart when they hold a
+    /// plain function or their default; while one holds any other callable
+    /// (a lambda with captures, say) the cache is not used.
+    ///
+    /// @param[in] cache The cache to use, possibly shared; null detaches it
+    /// @return Reference to this service for chaining
+    TurndownService& setCache(std::shared_ptr<ConversionCache> cache);
+
+    /// @brief The attached cache, or null
+    std::shared_ptr<ConversionCache> const& cache() const { return cache_; }
+
 private:
+    friend class BatchConverter;
+
+    TurndownService(TurndownService const& other);
     void invalidateRules();
-    Rules& ensureRules();
-    std::string runPipeline(dom::NodeView root);
+    std::shared_ptr<Rules const> ensureRules() const;
+    std::shared_ptr<Rules> ensureRulesForSharing() const;
+    template <typename Stats>
+    std::string runPipeline(dom::NodeView root, Stats stats, MarkdownSink const* sink = nullptr,
+                            ThreadPool* pool = nullptr, detail::LimitGuard* limits = nullptr) const;
+    std::string convertHtml(std::string_view html, ThreadPool* pool, detail::LimitGuard* limits = nullptr,
+                            dom::Parser* parser = nullptr) const;
     void enqueueRuleMutation(std::function<void(Rules&)> fn);
+    std::optional<ConversionCache::Key> documentKey(std::string_view html) const;
 
     TurndownOptions options_;
-    std::unique_ptr<Rules> rules_;
+    mutable std::mutex rulesMutex_;
+    mutable std::shared_ptr<Rules> rules_;
     std::vector<RuleFactory> preRuleFactories_;
     std::vector<RuleFactory> postRuleFactories_;
     std::vector<std::function<void(Rules&)>> ruleMutations_;
+    std::shared_ptr<ConversionCache> cache_;
 };
 
 /// @brief Convenience function to convert HTML to Markdown
@@ -4,6 +4,7 @@
 #include <array>
 #include <cstddef>
 #include <cstdint>
+#include <string_view>
 
 namespace turndown_cpp::utf8 {
 
@@ -69,6 +70,53 @@ struct CodepointSlice {
     std::size_t length;
 };
 
+// Decodes the code point starting at `index`. Invalid or truncated sequences
+// degrade to the lead byte, as a code point of that value, so callers keep
+// progressing through malformed input. Returns false at the end of the text.
+inline bool decodeAt(std::string_view text, std::size_t index, CodepointSlice& slice) {
+    if (index >= text.size()) return false;
+    unsigned char lead = static_cast<unsigned char>(text[index]);
+    slice = CodepointSlice{lead, index, 1};
+    if (isAsciiLead(lead)) return true;
+
+    std::size_t expected_len = expectedLength(lead);
+    if (expected_len == 1 || index + expected_len > text.size()) return true;
+
+    std::uint32_t codepoint = lead & (kLeadPayloadMask >> expected_len); // strip leading prefix bits
+    for (std::size_t j = 1; j < expected_len; ++j) {
+        unsigned char cont = static_cast<unsigned char>(text[index + j]);
+        if (!isContinuation(cont)) return true;
+        codepoint = (codepoint << 6) | (cont & kContinuationPayload);
+    }
+    if (isInvalidCodepoint(codepoint, expected_len)) return true;
+    slice = CodepointSlice{codepoint, index, expected_len};
+    return true;
+}
+
+// Decodes the code point ending just before `end`, as decodeAt() would have
+// split the text reading forwards: a forward decode restarts at every byte
+// that is not a continuation byte, so the nearest such byte starts either
+// the sequence or a run of single continuation bytes. `end` must be a code
+// point boundary. Returns false at the start of the text.
+inline bool decodeBefore(std::string_view text, std::size_t end, CodepointSlice& slice) {
+    if (end == 0 || end > text.size()) return false;
+    std::size_t last = end - 1;
+    unsigned char byte = static_cast<unsigned char>(text[last]);
+    slice = CodepointSlice{byte, last, 1};
+    if (isAsciiLead(byte) || !isContinuation(byte)) return true;
+
+    std::size_t start = last;
+    while (start > 0 && last - start < 3 && isContinuation(static_cast<unsigned char>(text[start]))) {
+        --start;
+    }
+    unsigned char lead = static_cast<unsigned char>(text[start]);
+    if (isAsciiLead(lead) || isContinuation(lead)) return true;
+    CodepointSlice sequence;
+    decodeAt(text, start, sequence);
+    if (sequence.start + sequence.length == end) slice = sequence;
+    return true;
+}
+
 } // namespace turndown_cpp::utf8
 
 #endif // UTF8_HELPERS_H
@@ -23,39 +23,13 @@
 
 #include <cstdint>
 #include <string>
-#include <unordered_map>
-#include <unordered_set>
+#include <string_view>
 
 
 namespace turndown_cpp {
 
 struct TurndownOptions; // Forward declaration
-
-/// @defgroup whitespace_context Whitespace Collapse Context
-/// @brief Thread-local context for whitespace-collapsed text lookup
-///
-/// These functions manage a context that allows text helpers to read
-/// pre-collapsed whitespace while converting nodes. This avoids passing
-/// the collapse results through every function call.
-/// @{
-
-/// @brief Set the whitespace collapse context for text extraction
-///
-/// When set, text extraction functions will use the collapsed text
-/// instead of the original node content.
-///
-/// @param[in] collapsedText Map of node handles to their collapsed text
-/// @param[in] nodesToOmit Set of node handles that should be skipped
-void setWhitespaceCollapseContext(
-    std::unordered_map<dom::NodeHandle, std::string> const& collapsedText,
-    std::unordered_set<dom::NodeHandle> const& nodesToOmit);
-
-/// @brief Clear the whitespace collapse context
-///
-/// Should be called after processing is complete to release references.
-void clearWhitespaceCollapseContext();
-
-/// @} // end of whitespace_context
+struct CollapsedWhitespace; // Forward declaration
 
 /// @defgroup char_classification Character Classification
 /// @{
@@ -131,7 +105,7 @@ bool isPre(dom::NodeView node);
 
 /// @brief Check if a node is a \<code\> element or inside one
 ///
-/// Recursively checks the node and its ancestors for \<code\> elements.
+/// Checks the node and its ancestors for \<code\> elements.
 ///
 /// @param[in] node The DOM node to check
 /// @retval true if the node is \<code\> or has a \<code\> ancestor
@@ -168,13 +142,42 @@ bool hasVoid(dom::NodeView node);
 
 /// @brief Extract text content from a DOM node
 ///
-/// Recursively extracts all text content from a node and its descendants.
-/// Uses the whitespace collapse context if one is set.
+/// Extracts all text content from a node and its descendants,
+/// exactly as it appears in the parsed document. Whitespace collapsing
+/// does not rewrite the document, so rules that want the collapsed text
+/// use getNodeText(dom::NodeView, CollapsedWhitespace const&) with
+/// ConversionContext::collapsedWhitespace() from a contextReplacement.
 ///
 /// @param[in] node The DOM node to extract text from
 /// @return Concatenated text content
 std::string getNodeText(dom::NodeView node);
 
+/// @brief Extract whitespace-collapsed text content from a DOM node
+///
+/// Like getNodeText(dom::NodeView), but skips nodes the collapse pass
+/// omitted and substitutes collapsed text for the nodes it rewrote.
+///
+/// @param[in] node The DOM node to extract text from
+/// @param[in] collapsed Result of collapseWhitespace() for the tree
+/// @return Concatenated text content
+std::string getNodeText(dom::NodeView node, CollapsedWhitespace const& collapsed);
+
+/// @brief Borrow the whitespace-collapsed text content of a DOM node
+///
+/// Same text as getNodeText(dom::NodeView, CollapsedWhitespace const&),
+/// without copying it where possible: when the text comes from a single
+/// text node (the node itself, or an element's only non-empty text
+/// descendant) the result views the document or the collapse result.
+/// Otherwise the pieces are concatenated into @p scratch, which the result
+/// then views.
+///
+/// @param[in] node The DOM node to extract text from
+/// @param[in] collapsed Result of collapseWhitespace() for the tree
+/// @param[in,out] scratch Storage used when the text has several pieces
+/// @return View of the text, valid while the document, @p collapsed and
+///         @p scratch are
+std::string_view getNodeTextView(dom::NodeView node, CollapsedWhitespace const& collapsed, std::string& scratch);
+
 /// @} // end of text_extraction
 
 /// @defgroup string_utilities String Utilities
@@ -188,6 +191,28 @@ std::string getNodeText(dom::NodeView node);
 /// @return Trimmed string
 std::string trimStr(std::string const& s);
 
+/// @brief Byte length of the Unicode whitespace a string starts with
+///
+/// Runs of ASCII whitespace are skipped a vector at a time (see
+/// simd_scan.h); only non-ASCII bytes are decoded. Nothing is allocated.
+///
+/// @param[in] text UTF-8 text; malformed bytes decode as in trimStr()
+/// @return Length of the leading whitespace, text.size() if it is all whitespace
+std::size_t leadingWhitespaceLength(std::string_view text);
+
+/// @brief Byte length of the Unicode whitespace a string ends with
+///
+/// Scans from the end like leadingWhitespaceLength() scans from the start.
+///
+/// @param[in] text UTF-8 text
+/// @return Length of the trailing whitespace, text.size() if it is all whitespace
+std::size_t trailingWhitespaceLength(std::string_view text);
+
+/// @brief Check whether a string is empty or only Unicode whitespace
+/// @param[in] text UTF-8 text
+/// @retval true if every code point is whitespace
+bool isWhitespaceOnly(std::string_view text);
+
 /// @brief Repeat a character a specified number of times
 ///
 /// @param[in] c The character to repeat
@@ -237,6 +262,26 @@ std::string repeatChar(char c, int count);
 /// @return Escaped string safe for Markdown output
 std::string advancedEscape(std::string const& input);
 
+/// @brief Check whether advancedEscape() would change @p input
+///
+/// Scans the text once; callers can skip the escaped copy entirely for
+/// the common case of text without Markdown syntax.
+///
+/// @param[in] input The string to check
+/// @retval true if at least one character would be escaped
+/// @retval false if advancedEscape() returns @p input unchanged
+bool needsAdvancedEscape(std::string_view input);
+
+/// @brief Append the advancedEscape() form of @p input to a buffer
+///
+/// Finds every special byte in a single vectorised pass (see simd_scan.h)
+/// and handles the line-start cases on the way, without intermediate
+/// strings.
+///
+/// @param[in] input The string to escape
+/// @param[in,out] output Buffer the escaped text is appended to
+void advancedEscapeInto(std::string_view input, std::string& output);
+
 /// @brief Minimal escape function for Markdown syntax
 ///
 /// Only escapes backslash and square brackets. Useful when most
@@ -266,6 +311,25 @@ std::string escapeMarkdown(std::string const& text, TurndownOptions const& optio
 /// @return HTML string representation
 std::string serializeNode(dom::NodeView node);
 
+/// @brief Reproduce a DOM node's HTML exactly as it appeared in the input
+///
+/// Returns the node's bytes from the source document when the backend
+/// keeps them (see dom::NodeView::source_html()) and falls back to
+/// serializeNode() otherwise. The copy skips re-serializing the subtree and
+/// preserves the author's attribute quoting, entities and whitespace. It
+/// is verbatim: markup the parser moved out of the element (for example
+/// foster-parented table content) is still part of the slice. Opt in by
+/// using it as the keep replacement:
+/// @code{.cpp}
+/// options.keepReplacement = [](std::string const&, dom::NodeView node) {
+///     return serializeNodeSource(node);
+/// };
+/// @endcode
+///
+/// @param[in] node The DOM node to reproduce
+/// @return HTML of the node
+std::string serializeNodeSource(dom::NodeView node);
+
 /// @} // end of html_serialization
 
 } // namespace turndown_cpp
@@ -0,0 +1,76 @@
+/// @file batch_converter.cpp
+/// @brief Parallel conversion of many HTML documents
+///
+/// @copyright The MIT License (MIT)
+/// @copyright Copyright (c) 2025 Parsa Amini
+
+#include "batch_converter.h"
+#include "flat_document.h"
+#include "turndown.h"
+
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace turndown_cpp {
+
+BatchConverter::BatchConverter(TurndownService const& service, std::size_t workers)
+    : service_(service), pool_(workers), parsers_(pool_.size()) {}
+
+// Parses and converts each document on the pool, timing the two phases.
+// Documents the service's cache holds are neither parsed nor converted.
+std::vector<BatchResult> BatchConverter::convert(std::span<std::string_view const> documents) {
+    using Clock = std::chrono::steady_clock;
+    std::vector<BatchResult> results(documents.size());
+    if (documents.empty()) return results;
+    ConversionCache* cache = service_.cache().get();
+
+    pool_.parallelFor(documents.size(), [&](std::size_t index, std::size_t worker) {
+        BatchResult& result = results[index];
+        result.worker = worker;
+        dom::Parser& parser = parsers_[worker];
+        try {
+            std::optional<ConversionCache::Key> key;
+            if (cache) key = service_.documentKey(documents[index]);
+            if (key) {
+                if (auto markdown = cache->find(*key)) {
+                    result.markdown = *markdown;
+                    result.cached = true;
+                    return;
+                }
+            }
+            auto start = Clock::now();
+            dom::Document document = parser.parse(documents[index]);
+            dom::FlatDocument flat;
+            dom::NodeView root = document.root();
+            if (service_.options().useFlatDocument) {
+                // The backend tree is handed back before the conversion.
+                flat = dom::FlatDocument::build(root);
+                parser.recycle(std::move(document));
+                root = flat.root();
+            }
+            auto parsed = Clock::now();
+            result.markdown = service_.turndown(root);
+            auto converted = Clock::now();
+            parser.recycle(std::move(document));
+            if (key) cache->insert(*key, result.markdown);
+            result.parseTime = parsed - start;
+            result.convertTime = converted - parsed;
+        } catch (std::exception const& e) {
+            result.markdown.clear();
+            result.error = e.what();
+        } catch (...) {
+            result.markdown.clear();
+            result.error = "unknown error";
+        }
+    });
+    return results;
+}
+
+} // namespace turndown_cpp
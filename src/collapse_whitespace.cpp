@@ -29,171 +29,127 @@
 
 #include "collapse_whitespace.h"
 #include "dom_adapter.h"
-#include "utilities.h"
+#include "dom_backend.h"
 
-#include <cassert>
-#include <regex>
-#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <span>
+#include <string_view>
 
 namespace turndown_cpp {
 
 namespace {
 
-/**
- * @brief Check if node is a preformatted element
- *
- * Returns true for \<pre\> elements, and optionally for \<code\> elements
- * when treatCodeAsPre is true. Preformatted elements preserve their
- * whitespace and should not have whitespace collapsed.
- *
- * @param[in] node The node to check
- * @param[in] treatCodeAsPre Whether to treat \<code\> as preformatted
- * @retval true if the node is preformatted
- * @retval false otherwise
- */
-bool isPreNode(dom::NodeView node, bool treatCodeAsPre) {
-    if (!node || !node.is_element()) return false;
-    std::string tag = node.tag_name();
-    if (tag == "pre") return true;
-    return treatCodeAsPre && tag == "code";
+// True for the bytes the collapse pass treats as whitespace.
+bool isCollapsibleSpace(char c) {
+    return c == ' ' || c == '\r' || c == '\n' || c == '\t';
 }
 
+} // namespace
+
 /**
- * @brief Get the next node in document order
- *
- * Returns the next node in the sequence, given the current and previous nodes.
- * Skips into children unless we just came from a child or the current node
- * is preformatted (in which case we skip its contents).
+ * @brief Replace each run of ASCII spaces, tabs and line breaks with one space
  *
- * @param[in] prev The previously visited node
- * @param[in] current The current node
- * @param[in] treatCodeAsPre Whether to treat \<code\> as preformatted
- * @return The next node in document order
+ * Hand-written equivalent of replacing /[ \\r\\n\\t]+/g with " ". Runs once per
+ * text node, so it avoids constructing and executing a regular expression.
+ * Text that is already collapsed (no tab or line break, no double space) is
+ * returned as-is; otherwise it is rewritten into the result's buffer.
+ * Collapsing never lengthens text, so the rewrite fits in a block of the
+ * original size.
  */
-dom::NodeView nextNode(dom::NodeView prev, dom::NodeView current, bool treatCodeAsPre) {
-    if (!current) return {};
-    bool prevIsParent = prev && prev.parent() == current;
-    if (prevIsParent || isPreNode(current, treatCodeAsPre)) {
-        if (auto sibling = current.next_sibling()) {
-            return sibling;
+std::string_view CollapsedWhitespace::collapseSpaceRuns(std::string_view text) {
+    bool collapsed = true;
+    for (std::size_t i = 0; i < text.size() && collapsed; ++i) {
+        char c = text[i];
+        if (c == '\r' || c == '\n' || c == '\t') {
+            collapsed = false;
+        } else if (c == ' ' && i + 1 < text.size() && isCollapsibleSpace(text[i + 1])) {
+            collapsed = false;
         }
-        return current.parent();
     }
-    if (auto child = current.first_child()) {
-        return child;
+    if (collapsed) return text;
+
+    if (!buffer_) {
+        buffer_ = std::make_unique<std::pmr::monotonic_buffer_resource>(memory_);
     }
-    if (auto sibling = current.next_sibling()) {
-        return sibling;
+    char* out = static_cast<char*>(buffer_->allocate(text.size(), 1));
+    std::size_t length = 0;
+    bool inRun = false;
+    for (char c : text) {
+        if (isCollapsibleSpace(c)) {
+            if (!inRun) out[length++] = ' ';
+            inRun = true;
+        } else {
+            out[length++] = c;
+            inRun = false;
+        }
     }
-    return current.parent();
+    ++rewrittenCount_;
+    return std::string_view(out, length);
 }
 
-/**
- * @brief Get the node that would follow if this node were removed
- *
- * Used to continue traversal after removing a node from processing.
- *
- * @param[in] node The node being removed
- * @return The next node in the sequence
- */
-dom::NodeView afterRemoval(dom::NodeView node) {
-    if (!node) return {};
-    if (auto sibling = node.next_sibling()) {
-        return sibling;
+// Numbers a node, growing the per-ordinal tables.
+std::uint32_t CollapsedWhitespace::addNode(dom::NodeHandle handle) {
+    auto ordinal = static_cast<std::uint32_t>(handles_.size());
+    handles_.push_back(handle);
+    texts_.emplace_back();
+    if (ordinal % 64 == 0) {
+        omitted_.push_back(0);
+        replaced_.push_back(0);
     }
-    return node.parent();
+    return ordinal;
 }
 
-} // namespace
-
-/// Collapse whitespace in a DOM tree.
-CollapsedWhitespace collapseWhitespace(dom::NodeView element, bool treatCodeAsPre) {
-    CollapsedWhitespace result;
-    if (!element || isPreNode(element, treatCodeAsPre) || !element.first_child()) {
-        return result;
+// Joins the pieces, borrowing the only non-empty one when there is one.
+void CollapsedWhitespace::setPrunedText(std::uint32_t ordinal, std::span<std::string_view const> pieces) {
+    std::size_t length = 0;
+    std::string_view only;
+    for (std::string_view piece : pieces) {
+        if (piece.empty()) continue;
+        only = length == 0 ? piece : std::string_view{};
+        length += piece.size();
     }
-
-    dom::NodeView prevTextNode;
-    bool keepLeadingWhitespace = false;
-
-    dom::NodeView prevNode;
-    dom::NodeView currentNode = nextNode(prevNode, element, treatCodeAsPre);
-
-    while (currentNode && currentNode != element) {
-        if (currentNode.is_text_like()) {
-            std::string text = currentNode.text_content();
-            text = std::regex_replace(text, std::regex("[ \\r\\n\\t]+"), " ");
-
-            bool prevEndedWithSpace = false;
-            if (prevTextNode) {
-                auto handle = prevTextNode.handle();
-                auto it = result.textReplacements.find(handle);
-                if (it != result.textReplacements.end() && !it->second.empty() && it->second.back() == ' ') {
-                    prevEndedWithSpace = true;
-                }
-            }
-
-            if ((!prevTextNode || prevEndedWithSpace) && !keepLeadingWhitespace && !text.empty() && text.front() == ' ') {
-                text.erase(text.begin());
-            }
-
-            if (text.empty()) {
-                result.nodesToOmit.insert(currentNode.handle());
-                currentNode = afterRemoval(currentNode);
-                continue;
-            }
-
-            result.textReplacements[currentNode.handle()] = text;
-            prevTextNode = currentNode;
-        } else if (currentNode.is_element()) {
-            std::string tag = currentNode.tag_name();
-            bool blockLike = isBlock(currentNode);
-            bool isBr = tag == "br";
-            bool preNode = isPreNode(currentNode, treatCodeAsPre);
-            bool voidNode = isVoid(currentNode);
-
-            if (blockLike || isBr) {
-                if (prevTextNode) {
-                    auto handle = prevTextNode.handle();
-                    auto it = result.textReplacements.find(handle);
-                    if (it != result.textReplacements.end() && !it->second.empty() && it->second.back() == ' ') {
-                        it->second.pop_back();
-                        if (it->second.empty()) {
-                            result.nodesToOmit.insert(handle);
-                        }
-                    }
-                }
-                prevTextNode = {};
-                keepLeadingWhitespace = false;
-            } else if (voidNode || preNode) {
-                prevTextNode = {};
-                keepLeadingWhitespace = true;
-            } else if (prevTextNode) {
-                keepLeadingWhitespace = false;
-            }
-        } else {
-            result.nodesToOmit.insert(currentNode.handle());
-            currentNode = afterRemoval(currentNode);
-            continue;
-        }
-
-        dom::NodeView next = nextNode(prevNode, currentNode, treatCodeAsPre);
-        prevNode = currentNode;
-        currentNode = next;
+    if (length == 0 || !only.empty()) {
+        texts_[ordinal] = only;
+        return;
+    }
+    if (!buffer_) {
+        buffer_ = std::make_unique<std::pmr::monotonic_buffer_resource>(memory_);
+    }
+    char* out = static_cast<char*>(buffer_->allocate(length, 1));
+    std::size_t used = 0;
+    for (std::string_view piece : pieces) {
+        piece.copy(out + used, piece.size());
+        used += piece.size();
     }
+    texts_[ordinal] = std::string_view(out, length);
+}
 
-    if (prevTextNode) {
-        auto handle = prevTextNode.handle();
-        auto it = result.textReplacements.find(handle);
-        if (it != result.textReplacements.end() && !it->second.empty() && it->second.back() == ' ') {
-            it->second.pop_back();
-            if (it->second.empty()) {
-                result.nodesToOmit.insert(handle);
-            }
+// Maps a node to its ordinal, indexing the numbered nodes on first use.
+// Parallel conversions share the result, so the index is built once.
+std::uint32_t CollapsedWhitespace::ordinal(dom::NodeView node) const {
+    std::call_once(*ordinalsBuilt_, [this] {
+        ordinals_.reserve(handles_.size());
+        for (std::size_t i = 0; i < handles_.size(); ++i) {
+            ordinals_.emplace(handles_[i], static_cast<std::uint32_t>(i));
         }
-    }
+    });
+    auto it = ordinals_.find(node.handle());
+    return it == ordinals_.end() ? npos : it->second;
+}
 
-    return result;
+/// Collapse whitespace in a DOM tree, walking backend nodes directly when
+/// the tree is the backend's own.
+CollapsedWhitespace collapseWhitespace(dom::NodeView element, bool treatCodeAsPre, std::pmr::memory_resource* memory,
+                                       dom::TagSet const& pruned, detail::LimitGuard* limits) {
+    using Access = dom::detail::BackendAccess;
+    if (Access::isBackendNode(element)) {
+        return collapseWhitespace<Access::Node>(Access::unwrap(element), treatCodeAsPre, memory, pruned, limits);
+    }
+    return collapseWhitespace<dom::NodeView>(element, treatCodeAsPre, memory, pruned, limits);
 }
 
 } // namespace turndown_cpp
\ No newline at end of file
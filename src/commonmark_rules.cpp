@@ -25,16 +25,19 @@
 /// @copyright C++ port copyright (c) 2025 Parsa Amini
 
 #include "commonmark_rules.h"
+#include "conversion_context.h"
 #include "dom_adapter.h"
+#include "node.h"
 #include "rules.h"
+#include "tag_id.h"
 #include "turndown.h"
 #include "utilities.h"
 
 #include <algorithm>
 #include <cassert>
 #include <cstring>
+#include <iterator>
 #include <memory>
-#include <regex>
 #include <sstream>
 #include <string>
 #include <string_view>
@@ -42,6 +45,54 @@
 
 namespace turndown_cpp {
 
+namespace {
+
+// References collected by the referenceLink rule while one document is
+// converted; emitted by the rule's append function at the end.
+struct ReferenceLinkState : RuleState {
+    std::vector<std::string> references;
+
+    bool merge(RuleState& later) override {
+        auto& next = static_cast<ReferenceLinkState&>(later);
+        references.insert(references.end(), std::make_move_iterator(next.references.begin()),
+                          std::make_move_iterator(next.references.end()));
+        return true;
+    }
+};
+
+bool equalsIgnoreCase(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) return false;
+    for (std::size_t i = 0; i < a.size(); ++i) {
+        auto lower = [](char c) { return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c; };
+        if (lower(a[i]) != lower(b[i])) return false;
+    }
+    return true;
+}
+
+// Attributes the link and image rules read, collected in one pass over the
+// element's attribute list instead of one lookup each.
+struct LinkAttributes {
+    std::string_view url; ///< href of a link, src of an image
+    std::string_view title;
+    std::string_view alt;
+};
+
+LinkAttributes linkAttributes(dom::NodeView node, std::string_view urlName) {
+    LinkAttributes found;
+    for (dom::AttributeView attr : node.attribute_range()) {
+        if (equalsIgnoreCase(attr.name, urlName)) {
+            found.url = attr.value;
+        } else if (equalsIgnoreCase(attr.name, "title")) {
+            found.title = attr.value;
+        } else if (equalsIgnoreCase(attr.name, "alt")) {
+            found.alt = attr.value;
+        }
+    }
+    return found;
+}
+
+} // namespace
+
 // Helper function to get next sibling element in Gumbo (ignoring text/whitespace)
 static dom::NodeView getNextSiblingView(dom::NodeView node) {
     for (auto sibling = node.next_sibling(); sibling; sibling = sibling.next_sibling()) {
@@ -87,8 +138,17 @@ static dom::NodeView findChildElementView(dom::NodeView node, std::string_view t
     return node.find_child(tag);
 }
 
-static bool isElementWithNameView(dom::NodeView node, std::string_view name) {
-    return node.has_tag(name);
+static bool isElementWithTag(dom::NodeView node, dom::TagId tag) {
+    return node.tag_id() == tag;
+}
+
+// Declares the tags a CommonMark rule's filter can match, so Rules::compile()
+// only offers the rule for those elements. The CommonMark rules read only
+// what a subtree cache key covers, so their output may be cached.
+static Rule tagged(dom::TagSet tags, Rule rule) {
+    rule.tags = tags;
+    rule.cacheable = true;
+    return rule;
 }
 
 static bool isLastElementChildView(dom::NodeView parent, dom::NodeView node) {
@@ -102,9 +162,65 @@ static bool isLastElementChildView(dom::NodeView parent, dom::NodeView node) {
     return lastElement && lastElement == node;
 }
 
+// Matches the regex class \s of the JavaScript implementation for ASCII input.
+static bool isRegexSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
+
+// Equivalent of replacing /(\n+\s*)+/g with "\n": a newline swallows all
+// whitespace that follows it.
 static std::string cleanAttribute(std::string_view attribute) {
-    if (attribute.empty()) return "";
-    return std::regex_replace(std::string(attribute), std::regex(R"((\n+\s*)+)"), "\n");
+    std::string result;
+    result.reserve(attribute.size());
+    for (std::size_t i = 0; i < attribute.size();) {
+        if (attribute[i] != '\n') {
+            result.push_back(attribute[i++]);
+            continue;
+        }
+        result.push_back('\n');
+        while (i < attribute.size() && isRegexSpace(attribute[i])) ++i;
+    }
+    return result;
+}
+
+// Replaces every occurrence of @p from in @p text with @p to.
+static std::string replaceChar(std::string_view text, char from, std::string_view to) {
+    std::string result;
+    result.reserve(text.size());
+    for (char ch : text) {
+        if (ch == from) {
+            result.append(to);
+        } else {
+            result.push_back(ch);
+        }
+    }
+    return result;
+}
+
+// Value of the first `language-(\S+)` match in a class attribute, or empty.
+static std::string_view languageFromClass(std::string_view className) {
+    constexpr std::string_view prefix = "language-";
+    for (auto pos = className.find(prefix); pos != std::string_view::npos; pos = className.find(prefix, pos + 1)) {
+        std::size_t begin = pos + prefix.size();
+        std::size_t end = begin;
+        while (end < className.size() && !isRegexSpace(className[end])) ++end;
+        if (end > begin) return className.substr(begin, end - begin);
+    }
+    return {};
+}
+
+// Longest run of three or more @p fenceChar at the start of a line, or 0.
+static std::size_t longestFenceRun(std::string_view code, char fenceChar) {
+    std::size_t longest = 0;
+    for (std::size_t lineStart = 0; lineStart < code.size();) {
+        std::size_t run = 0;
+        while (lineStart + run < code.size() && code[lineStart + run] == fenceChar) ++run;
+        if (run >= 3) longest = std::max(longest, run);
+        auto newline = code.find('\n', lineStart + run);
+        if (newline == std::string_view::npos) break;
+        lineStart = newline + 1;
+    }
+    return longest;
 }
 
 static std::string ltrimNewlines(std::string const& text) {
@@ -127,53 +243,106 @@ static bool hasNextSiblingNodeView(dom::NodeView node) {
     return static_cast<bool>(getNextSiblingView(node));
 }
 
-// Pointer wrappers for existing call sites
-void defineCommonMarkRules(Rules& rules, TurndownOptions const& options) {
-    rules.addRule("paragraph", {
-        [](dom::NodeView node, TurndownOptions const&) {
-            return isElementWithNameView(node, "p");
+static std::string listReplacement(std::string const& content, bool lastInListItem) {
+    std::string inner = trimNewlines(content);
+    if (lastInListItem) return "\n" + inner;
+    return "\n\n" + inner + "\n\n";
+}
+
+// @p index is the item's position among the list's elements, or -1.
+static std::string listItemReplacement(std::string const& content, dom::NodeView node, TurndownOptions const& options,
+                                       int index, bool hasNext) {
+    std::string result = ltrimNewlines(content);
+    std::string trimmed = rtrimNewlines(result);
+    bool hadTrailingNewlines = trimmed.size() != result.size();
+    result = trimmed;
+    if (hadTrailingNewlines) {
+        result += "\n";
+    }
+    result = replaceChar(result, '\n', "\n    ");
+
+    std::string prefix = options.bulletListMarker + "   ";
+    auto parent = getParentView(node);
+    if (isElementWithTag(parent, dom::TagId::Ol)) {
+        std::string_view startAttr = parent.attribute("start");
+        int start = startAttr.empty() ? 1 : std::stoi(std::string(startAttr));
+        prefix = (index >= 0 ? std::to_string(start + index) : "1") + ".  ";
+    }
+    if (hasNext && result.find('\n') != std::string::npos) {
+        // Ensure a blank, indented line between multi-paragraph items and the next list item.
+        // Same as replacing /\n\s*$/: the first newline followed only by whitespace.
+        std::size_t lastContent = 0;
+        for (std::size_t i = result.size(); i > 0; --i) {
+            if (!isRegexSpace(result[i - 1])) {
+                lastContent = i;
+                break;
+            }
+        }
+        auto newline = result.find('\n', lastContent);
+        if (newline != std::string::npos) {
+            result.replace(newline, std::string::npos, "\n    ");
+        }
+    }
+    bool needsTrailingNewline = hasNext && (result.empty() || result.back() != '\n');
+    return prefix + result + (needsTrailingNewline ? "\n" : "");
+}
+
+// Gives a rule variants that read sibling positions from the conversion's
+// NodeTable; the DOM-walking originals remain for lookups outside one.
+static Rule withTraversal(Rule rule,
+                          decltype(Rule::traversalFilter) filter,
+                          decltype(Rule::traversalReplacement) replacement) {
+    rule.traversalFilter = std::move(filter);
+    rule.traversalReplacement = std::move(replacement);
+    return rule;
+}
+
+// The rules read the options they are called with, so one rule set serves
+// services whose options differ.
+void defineCommonMarkRules(Rules& rules, TurndownOptions const&) {
+    rules.addRule("paragraph", tagged({dom::TagId::P}, {
+        .filter = [](dom::NodeView node, TurndownOptions const&) {
+            return isElementWithTag(node, dom::TagId::P);
         },
-        [](std::string const& content, dom::NodeView, TurndownOptions const&) -> std::string {
+        .replacement = [](std::string const& content, dom::NodeView, TurndownOptions const&) -> std::string {
             return "\n\n" + content + "\n\n";
         },
-        nullptr,
-        "paragraph"
-    });
+        .key = "paragraph"
+    }));
 
-    rules.addRule("lineBreak", {
-        [](dom::NodeView node, TurndownOptions const&) {
-            return isElementWithNameView(node, "br");
+    rules.addRule("lineBreak", tagged({dom::TagId::Br}, {
+        .filter = [](dom::NodeView node, TurndownOptions const&) {
+            return isElementWithTag(node, dom::TagId::Br);
         },
-        [&options](std::string const&, dom::NodeView, TurndownOptions const&) -> std::string {
+        .replacement = [](std::string const&, dom::NodeView, TurndownOptions const& options) -> std::string {
             return options.br + "\n";
         },
-        nullptr,
-        "lineBreak"
-    });
+        .key = "lineBreak"
+    }));
 
     for (int i = 1; i <= 6; ++i) {
         std::string tagName = "h" + std::to_string(i);
-        rules.addRule(tagName, {
-            [tagName](dom::NodeView node, TurndownOptions const&) {
-                return isElementWithNameView(node, tagName);
+        dom::TagId tag = dom::tagIdFromName(tagName);
+        rules.addRule(tagName, tagged({tag}, {
+            .filter = [tag](dom::NodeView node, TurndownOptions const&) {
+                return isElementWithTag(node, tag);
             },
-            [&options, i](std::string const& content, dom::NodeView, TurndownOptions const&) -> std::string {
+            .replacement = [i](std::string const& content, dom::NodeView, TurndownOptions const& options) -> std::string {
                 if (options.headingStyle == "setext" && i <= 2) {
                     std::string underline = repeatChar((i == 1 ? '=' : '-'), content.length());
                     return "\n\n" + content + "\n" + underline + "\n\n";
                 }
                 return "\n\n" + std::string(i, '#') + " " + content + "\n\n";
             },
-            nullptr,
-            tagName
-        });
+            .key = tagName
+        }));
     }
 
-    rules.addRule("blockquote", {
-        [](dom::NodeView node, TurndownOptions const&) {
-            return isElementWithNameView(node, "blockquote");
+    rules.addRule("blockquote", tagged({dom::TagId::Blockquote}, {
+        .filter = [](dom::NodeView node, TurndownOptions const&) {
+            return isElementWithTag(node, dom::TagId::Blockquote);
         },
-        [](std::string const& content, dom::NodeView, TurndownOptions const&) -> std::string {
+        .replacement = [](std::string const& content, dom::NodeView, TurndownOptions const&) -> std::string {
             // Keep this simple and non-regex: MSVC std::regex_replace has been
             // observed to treat `$` as end-of-line and strip internal blank lines.
             std::string trimmed = trimNewlines(content);
@@ -185,283 +354,260 @@ void defineCommonMarkRules(Rules& rules, TurndownOptions const& options) {
             }
             return "\n\n" + block + "\n\n";
         },
-        nullptr,
-        "blockquote"
-    });
+        .key = "blockquote"
+    }));
 
-    rules.addRule("list", {
-        [](dom::NodeView node, TurndownOptions const&) {
-            return isElementWithNameView(node, "ul") || isElementWithNameView(node, "ol");
+    rules.addRule("list", withTraversal(tagged({dom::TagId::Ul, dom::TagId::Ol}, {
+        .filter = [](dom::NodeView node, TurndownOptions const&) {
+            return isElementWithTag(node, dom::TagId::Ul) || isElementWithTag(node, dom::TagId::Ol);
         },
-        [](std::string const& content, dom::NodeView node, TurndownOptions const&) -> std::string {
-            std::string inner = trimNewlines(content);
+        .replacement = [](std::string const& content, dom::NodeView node, TurndownOptions const&) -> std::string {
             auto parent = getParentView(node);
-            if (isElementWithNameView(parent, "li")) {
-                if (isLastElementChildView(parent, node)) {
-                    return "\n" + inner;
-                }
-            }
-            return "\n\n" + inner + "\n\n";
+            return listReplacement(content, isElementWithTag(parent, dom::TagId::Li) && isLastElementChildView(parent, node));
         },
-        nullptr,
-        "list"
-    });
-
-    rules.addRule("listItem", {
-        [](dom::NodeView node, TurndownOptions const&) {
-            return isElementWithNameView(node, "li");
+        .key = "list"
+    }), nullptr,
+        [](std::string const& content, dom::NodeView, TurndownOptions const&, TraversalContext const& traversal) -> std::string {
+            return listReplacement(content, isElementWithTag(traversal.parent(), dom::TagId::Li) && traversal.isLastElementChild());
+        }));
+
+    rules.addRule("listItem", withTraversal(tagged({dom::TagId::Li}, {
+        .filter = [](dom::NodeView node, TurndownOptions const&) {
+            return isElementWithTag(node, dom::TagId::Li);
         },
-        [&options](std::string const& content, dom::NodeView node, TurndownOptions const&) -> std::string {
-            std::string result = ltrimNewlines(content);
-            std::string trimmed = rtrimNewlines(result);
-            bool hadTrailingNewlines = trimmed.size() != result.size();
-            result = trimmed;
-            if (hadTrailingNewlines) {
-                result += "\n";
-            }
-            result = std::regex_replace(result, std::regex(R"(\n)"), "\n    ");
-
-            std::string prefix = options.bulletListMarker + "   ";
-            auto parent = getParentView(node);
-            if (isElementWithNameView(parent, "ol")) {
-                int index = getNodeIndexView(node);
-                std::string_view startAttr = parent.attribute("start");
-                int start = startAttr.empty() ? 1 : std::stoi(std::string(startAttr));
-                prefix = (index >= 0 ? std::to_string(start + index) : "1") + ".  ";
-            }
-            bool hasNext = hasNextSiblingNodeView(node);
-            if (hasNext && result.find('\n') != std::string::npos) {
-                // Ensure a blank, indented line between multi-paragraph items and the next list item.
-                result = std::regex_replace(result, std::regex(R"(\n\s*$)"), "\n    ");
-            }
-            bool needsTrailingNewline = hasNext && !std::regex_search(result, std::regex(R"(\n$)"));
-            return prefix + result + (needsTrailingNewline ? "\n" : "");
+        .replacement = [](std::string const& content, dom::NodeView node, TurndownOptions const& options) -> std::string {
+            return listItemReplacement(content, node, options, getNodeIndexView(node), hasNextSiblingNodeView(node));
         },
-        nullptr,
-        "listItem"
-    });
-
-    rules.addRule("indentedCodeBlock", {
-        [&options](dom::NodeView node, TurndownOptions const&) {
+        .key = "listItem"
+    }), nullptr,
+        [](std::string const& content, dom::NodeView node, TurndownOptions const& options, TraversalContext const& traversal) -> std::string {
+            return listItemReplacement(content, node, options, traversal.elementIndex(), !traversal.isLastElementChild());
+        }));
+
+    rules.addRule("indentedCodeBlock", tagged({dom::TagId::Pre}, {
+        .filter = [](dom::NodeView node, TurndownOptions const& options) {
             return options.codeBlockStyle == "indented" &&
-                   isElementWithNameView(node, "pre") &&
+                   isElementWithTag(node, dom::TagId::Pre) &&
                    findChildElementView(node, "code");
         },
-        [](std::string const&, dom::NodeView node, TurndownOptions const&) -> std::string {
+        .replacement = [](std::string const&, dom::NodeView node, TurndownOptions const&) -> std::string {
             auto codeNode = findChildElementView(node, "code");
             auto source = codeNode ? codeNode : node;
             std::string code = getNodeText(source);
             if (!code.empty() && code.back() == '\n') {
                 code.pop_back();
             }
-            code = std::regex_replace(code, std::regex(R"(\n)"), "\n    ");
+            code = replaceChar(code, '\n', "\n    ");
             return "\n\n    " + code + "\n\n";
         },
-        nullptr,
-        "indentedCodeBlock"
-    });
+        .key = "indentedCodeBlock"
+    }));
 
-    rules.addRule("fencedCodeBlock", {
-        [&options](dom::NodeView node, TurndownOptions const&) {
+    rules.addRule("fencedCodeBlock", tagged({dom::TagId::Pre}, {
+        .filter = [](dom::NodeView node, TurndownOptions const& options) {
             if (options.codeBlockStyle != "fenced") return false;
-            if (!isElementWithNameView(node, "pre")) return false;
+            if (!isElementWithTag(node, dom::TagId::Pre)) return false;
             return static_cast<bool>(findChildElementView(node, "code"));
         },
-        [&options](std::string const&, dom::NodeView node, TurndownOptions const&) -> std::string {
+        .replacement = [](std::string const&, dom::NodeView node, TurndownOptions const& options) -> std::string {
             dom::NodeView codeNode = findChildElementView(node, "code");
-            std::string className;
-            std::string_view classAttr = codeNode.attribute("class");
-            if (!classAttr.empty()) className = std::string(classAttr);
-            std::regex langRegex(R"(language-(\S+))");
-            std::smatch langMatch;
-            std::string language;
-            if (std::regex_search(className, langMatch, langRegex) && langMatch.size() > 1) {
-                language = langMatch[1].str();
-            }
+            std::string language(languageFromClass(codeNode.attribute("class")));
 
             std::string code = getNodeText(codeNode);
             char fenceChar = options.fence.empty() ? '`' : options.fence.front();
-            int fenceSize = 3;
-            std::regex fenceInside(std::string("(^|\\n)") + fenceChar + "{3,}");
-            for (std::sregex_iterator it(code.begin(), code.end(), fenceInside), end; it != end; ++it) {
-                std::string match = it->str();
-                std::size_t run = match.size();
-                if (!match.empty() && match.front() == '\n') {
-                    --run;
-                }
-                fenceSize = std::max(fenceSize, static_cast<int>(run) + 1);
-            }
+            // The fence must be longer than any fence-like line inside the code.
+            std::size_t longestRun = longestFenceRun(code, fenceChar);
+            int fenceSize = longestRun ? std::max(3, static_cast<int>(longestRun) + 1) : 3;
             std::string fence = repeatChar(fenceChar, fenceSize);
             if (!code.empty() && code.back() == '\n') {
                 code.pop_back();
             }
             return "\n\n" + fence + language + "\n" + code + "\n" + fence + "\n\n";
         },
-        nullptr,
-        "fencedCodeBlock"
-    });
+        .key = "fencedCodeBlock"
+    }));
 
-    rules.addRule("horizontalRule", {
-        [](dom::NodeView node, TurndownOptions const&) {
-            return isElementWithNameView(node, "hr");
+    rules.addRule("horizontalRule", tagged({dom::TagId::Hr}, {
+        .filter = [](dom::NodeView node, TurndownOptions const&) {
+            return isElementWithTag(node, dom::TagId::Hr);
         },
-        [&options](std::string const&, dom::NodeView, TurndownOptions const&) -> std::string {
+        .replacement = [](std::string const&, dom::NodeView, TurndownOptions const& options) -> std::string {
             return "\n\n" + options.hr + "\n\n";
         },
-        nullptr,
-        "horizontalRule"
-    });
+        .key = "horizontalRule"
+    }));
 
-    rules.addRule("inlineLink", {
-        [&options](dom::NodeView node, TurndownOptions const&) {
+    rules.addRule("inlineLink", tagged({dom::TagId::A}, {
+        .filter = [](dom::NodeView node, TurndownOptions const& options) {
             return options.linkStyle == "inlined" &&
-                   isElementWithNameView(node, "a") &&
+                   isElementWithTag(node, dom::TagId::A) &&
                    !node.attribute("href").empty();
         },
-        [](std::string const& content, dom::NodeView node, TurndownOptions const&) -> std::string {
-            std::string href(node.attribute("href"));
+        .replacement = [](std::string const& content, dom::NodeView node, TurndownOptions const&) -> std::string {
+            LinkAttributes attrs = linkAttributes(node, "href");
             std::string escapedHref;
-            escapedHref.reserve(href.size() * 2);
-            for (char ch : href) {
+            escapedHref.reserve(attrs.url.size() * 2);
+            for (char ch : attrs.url) {
                 if (ch == '(' || ch == ')') {
                     escapedHref.push_back('\\');
                 }
                 escapedHref.push_back(ch);
             }
             std::string title;
-            std::string_view titleAttr = node.attribute("title");
-            if (!titleAttr.empty()) {
-                title = cleanAttribute(titleAttr);
+            if (!attrs.title.empty()) {
+                title = cleanAttribute(attrs.title);
             }
-            std::string titlePart = title.empty() ? "" : " \"" + std::regex_replace(title, std::regex(R"(")"), "\\\"") + "\"";
+            std::string titlePart = title.empty() ? "" : " \"" + replaceChar(title, '"', "\\\"") + "\"";
             return "[" + content + "](" + escapedHref + titlePart + ")";
         },
-        nullptr,
-        "inlineLink"
-    });
-
-    auto referenceStore = std::make_shared<std::vector<std::string>>();
-    rules.addRule("referenceLink", {
-        [&options](dom::NodeView node, TurndownOptions const&) {
-            return options.linkStyle == "referenced" &&
-                   isElementWithNameView(node, "a") &&
-                   !node.attribute("href").empty();
-        },
-        [referenceStore, &options](std::string const& content, dom::NodeView node, TurndownOptions const&) -> std::string {
-            std::string href(node.attribute("href"));
-            std::string title;
-            std::string_view titleAttr = node.attribute("title");
-            if (!titleAttr.empty()) {
-                title = cleanAttribute(titleAttr);
-            }
-            std::string titlePart = title.empty() ? "" : " \"" + title + "\"";
-            std::string replacement;
-            std::string reference;
-            if (options.linkReferenceStyle == "collapsed") {
-                replacement = "[" + content + "][]";
-                reference = "[" + content + "]: " + href + titlePart;
-            } else if (options.linkReferenceStyle == "shortcut") {
-                replacement = "[" + content + "]";
-                reference = "[" + content + "]: " + href + titlePart;
-            } else {
-                std::string id = std::to_string(referenceStore->size() + 1);
-                replacement = "[" + content + "][" + id + "]";
-                reference = "[" + id + "]: " + href + titlePart;
-            }
-            referenceStore->push_back(reference);
-            return replacement;
-        },
-        [referenceStore](TurndownOptions const&) -> std::string {
-            if (referenceStore->empty()) return "";
-            std::string output = "\n\n";
-            for (auto const& ref : *referenceStore) {
-                output += ref + "\n";
-            }
-            output += "\n\n";
-            referenceStore->clear();
-            return output;
-        },
-        "referenceLink"
-    });
-
-    rules.addRule("emphasis", {
-        [](dom::NodeView node, TurndownOptions const&) {
-            return isElementWithNameView(node, "em") || isElementWithNameView(node, "i");
+        .key = "inlineLink"
+    }));
+
+    Rule referenceLink;
+    referenceLink.key = "referenceLink";
+    referenceLink.tags = {dom::TagId::A};
+    referenceLink.cacheable = true;
+    referenceLink.filter = [](dom::NodeView node, TurndownOptions const& options) {
+        return options.linkStyle == "referenced" &&
+               isElementWithTag(node, dom::TagId::A) &&
+               !node.attribute("href").empty();
+    };
+    referenceLink.contextReplacement = [](std::string const& content, dom::NodeView node, TurndownOptions const& options,
+                                          ConversionContext& context) -> std::string {
+        auto& store = context.ruleState<ReferenceLinkState>("referenceLink");
+        LinkAttributes attrs = linkAttributes(node, "href");
+        std::string href(attrs.url);
+        std::string title;
+        if (!attrs.title.empty()) {
+            title = cleanAttribute(attrs.title);
+        }
+        std::string titlePart = title.empty() ? "" : " \"" + title + "\"";
+        std::string replacement;
+        std::string reference;
+        if (options.linkReferenceStyle == "collapsed") {
+            replacement = "[" + content + "][]";
+            reference = "[" + content + "]: " + href + titlePart;
+        } else if (options.linkReferenceStyle == "shortcut") {
+            replacement = "[" + content + "]";
+            reference = "[" + content + "]: " + href + titlePart;
+        } else {
+            std::string id = std::to_string(context.priorApplications("referenceLink") + store.references.size() + 1);
+            replacement = "[" + content + "][" + id + "]";
+            reference = "[" + id + "]: " + href + titlePart;
+        }
+        store.references.push_back(reference);
+        return replacement;
+    };
+    referenceLink.contextAppend = [](TurndownOptions const&, ConversionContext& context) -> std::string {
+        auto const& store = context.ruleState<ReferenceLinkState>("referenceLink");
+        if (store.references.empty()) return "";
+        std::string output = "\n\n";
+        for (auto const& ref : store.references) {
+            output += ref + "\n";
+        }
+        output += "\n\n";
+        return output;
+    };
+    rules.addRule("referenceLink", std::move(referenceLink));
+
+    rules.addRule("emphasis", tagged({dom::TagId::Em, dom::TagId::I}, {
+        .filter = [](dom::NodeView node, TurndownOptions const&) {
+            return isElementWithTag(node, dom::TagId::Em) || isElementWithTag(node, dom::TagId::I);
         },
-        [&options](std::string const& content, dom::NodeView, TurndownOptions const&) -> std::string {
+        .replacement = [](std::string const& content, dom::NodeView, TurndownOptions const& options) -> std::string {
             if (trimStr(content).empty()) return "";
             return options.emDelimiter + content + options.emDelimiter;
         },
-        nullptr,
-        "emphasis"
-    });
+        .key = "emphasis"
+    }));
 
-    rules.addRule("strong", {
-        [](dom::NodeView node, TurndownOptions const&) {
-            return isElementWithNameView(node, "strong") || isElementWithNameView(node, "b");
+    rules.addRule("strong", tagged({dom::TagId::Strong, dom::TagId::B}, {
+        .filter = [](dom::NodeView node, TurndownOptions const&) {
+            return isElementWithTag(node, dom::TagId::Strong) || isElementWithTag(node, dom::TagId::B);
         },
-        [&options](std::string const& content, dom::NodeView, TurndownOptions const&) -> std::string {
+        .replacement = [](std::string const& content, dom::NodeView, TurndownOptions const& options) -> std::string {
             if (trimStr(content).empty()) return "";
             return options.strongDelimiter + content + options.strongDelimiter;
         },
-        nullptr,
-        "strong"
-    });
+        .key = "strong"
+    }));
 
-    rules.addRule("code", {
-        [](dom::NodeView node, TurndownOptions const&) {
+    rules.addRule("code", withTraversal(tagged({dom::TagId::Code}, {
+        .filter = [](dom::NodeView node, TurndownOptions const&) {
             dom::NodeView parent = getParentView(node);
-            bool isCodeBlock = parent && isElementWithNameView(parent, "pre") && !hasSiblingsView(node);
-            return isElementWithNameView(node, "code") && !isCodeBlock;
+            bool isCodeBlock = parent && isElementWithTag(parent, dom::TagId::Pre) && !hasSiblingsView(node);
+            return isElementWithTag(node, dom::TagId::Code) && !isCodeBlock;
         },
-        [](std::string const& content, dom::NodeView, TurndownOptions const&) -> std::string {
+        .replacement = [](std::string const& content, dom::NodeView, TurndownOptions const&) -> std::string {
             if (content.empty()) return "";
-            std::string normalized = std::regex_replace(content, std::regex(R"(\r?\n|\r)"), " ");
-            std::regex extraSpaceRegex(R"(^`|^ .*?[^ ].* $|`$)");
-            bool needsSpace = std::regex_search(normalized, extraSpaceRegex);
-
-            std::vector<std::string> matches;
-            std::regex ticks("`+");
-            for (std::sregex_iterator it(normalized.begin(), normalized.end(), ticks), end; it != end; ++it) {
-                matches.push_back(it->str());
+            // Line breaks (\r\n, \n or \r) become single spaces.
+            std::string normalized;
+            normalized.reserve(content.size());
+            for (std::size_t i = 0; i < content.size(); ++i) {
+                if (content[i] == '\r') {
+                    if (i + 1 < content.size() && content[i + 1] == '\n') ++i;
+                    normalized.push_back(' ');
+                } else if (content[i] == '\n') {
+                    normalized.push_back(' ');
+                } else {
+                    normalized.push_back(content[i]);
+                }
             }
-            auto contains = [&matches](std::string const& needle) {
-                return std::find(matches.begin(), matches.end(), needle) != matches.end();
-            };
-            std::string delimiter = "`";
-            while (contains(delimiter)) {
-                delimiter.push_back('`');
+            // Pad when the code starts or ends with a backtick, or is wrapped
+            // in spaces around some non-space content (/^`|^ .*?[^ ].* $|`$/).
+            bool needsSpace = normalized.front() == '`' || normalized.back() == '`' ||
+                              (normalized.front() == ' ' && normalized.back() == ' ' &&
+                               normalized.find_first_not_of(' ') != std::string::npos);
+
+            // The delimiter is the shortest backtick run not present in the code.
+            std::vector<bool> runLengths;
+            for (std::size_t i = 0; i < normalized.size();) {
+                if (normalized[i] != '`') {
+                    ++i;
+                    continue;
+                }
+                std::size_t run = 0;
+                while (i < normalized.size() && normalized[i] == '`') {
+                    ++run;
+                    ++i;
+                }
+                if (runLengths.size() <= run) runLengths.resize(run + 1, false);
+                runLengths[run] = true;
             }
+            std::size_t delimiterSize = 1;
+            while (delimiterSize < runLengths.size() && runLengths[delimiterSize]) ++delimiterSize;
+            std::string delimiter(delimiterSize, '`');
             std::string pad = needsSpace ? " " : "";
             return delimiter + pad + normalized + pad + delimiter;
         },
-        nullptr,
-        "code"
-    });
+        .key = "code"
+    }),
+        [](dom::NodeView node, TurndownOptions const&, TraversalContext const& traversal) {
+            bool isCodeBlock = isElementWithTag(traversal.parent(), dom::TagId::Pre) && !traversal.hasElementSiblings();
+            return isElementWithTag(node, dom::TagId::Code) && !isCodeBlock;
+        },
+        nullptr));
 
-    rules.addRule("image", {
-        [](dom::NodeView node, TurndownOptions const&) {
-            return isElementWithNameView(node, "img");
+    rules.addRule("image", tagged({dom::TagId::Img}, {
+        .filter = [](dom::NodeView node, TurndownOptions const&) {
+            return isElementWithTag(node, dom::TagId::Img);
         },
-        [](std::string const&, dom::NodeView node, TurndownOptions const&) -> std::string {
+        .replacement = [](std::string const&, dom::NodeView node, TurndownOptions const&) -> std::string {
+            LinkAttributes attrs = linkAttributes(node, "src");
+            if (attrs.url.empty()) return "";
             std::string alt;
-            std::string_view altAttr = node.attribute("alt");
-            if (!altAttr.empty()) {
-                alt = cleanAttribute(altAttr);
+            if (!attrs.alt.empty()) {
+                alt = cleanAttribute(attrs.alt);
             }
-            std::string src(node.attribute("src"));
             std::string title;
-            std::string_view titleAttr = node.attribute("title");
-            if (!titleAttr.empty()) {
-                title = cleanAttribute(titleAttr);
+            if (!attrs.title.empty()) {
+                title = cleanAttribute(attrs.title);
             }
-            if (src.empty()) return "";
             std::string titlePart = title.empty() ? "" : " \"" + title + "\"";
-            return "![" + alt + "](" + src + titlePart + ")";
+            return "![" + alt + "](" + std::string(attrs.url) + titlePart + ")";
         },
-        nullptr,
-        "image"
-    });
+        .key = "image"
+    }));
 }
 
 } // namespace turndown_cpp
\ No newline at end of file
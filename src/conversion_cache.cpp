@@ -0,0 +1,170 @@
+/// @file conversion_cache.cpp
+/// @brief Content-addressed conversion cache implementation
+///
+/// @copyright The MIT License (MIT)
+/// @copyright Copyright (c) 2025 Parsa Amini
+
+#include "conversion_cache.h"
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace turndown_cpp {
+
+namespace {
+
+constexpr std::uint64_t kMul0 = 0x9E3779B97F4A7C15ull;
+constexpr std::uint64_t kMul1 = 0xBF58476D1CE4E5B9ull;
+constexpr std::uint64_t kMul2 = 0x94D049BB133111EBull;
+
+// The splitmix64 finalizer: every input bit affects every output bit.
+std::uint64_t finalize(std::uint64_t x) {
+    x ^= x >> 30;
+    x *= kMul1;
+    x ^= x >> 27;
+    x *= kMul2;
+    x ^= x >> 31;
+    return x;
+}
+
+std::uint64_t load64(char const* p) {
+    std::uint64_t value;
+    std::memcpy(&value, p, sizeof value);
+    return value;
+}
+
+std::uint64_t round(std::uint64_t lane, std::uint64_t word, std::uint64_t multiplier, int rotation) {
+    return std::rotl(lane ^ (word * multiplier), rotation) * kMul0;
+}
+
+} // namespace
+
+// Two lanes take alternate words, so consecutive multiplications do not
+// wait on each other.
+std::uint64_t contentHash(std::string_view data, std::uint64_t seed) {
+    char const* p = data.data();
+    std::size_t const n = data.size();
+    std::uint64_t a = seed ^ (static_cast<std::uint64_t>(n) * kMul0);
+    std::uint64_t b = a ^ kMul1;
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        a = round(a, load64(p + i), kMul1, 31);
+        b = round(b, load64(p + i + 8), kMul2, 29);
+    }
+    if (i + 8 <= n) {
+        a = round(a, load64(p + i), kMul1, 31);
+        i += 8;
+    }
+    if (i < n) {
+        std::uint64_t tail = 0;
+        std::memcpy(&tail, p + i, n - i);
+        b = round(b, tail, kMul2, 29);
+    }
+    return finalize(a ^ std::rotl(b, 17));
+}
+
+std::uint64_t combineHash(std::uint64_t seed, std::uint64_t value) {
+    return finalize(seed ^ (value + kMul0 + (seed << 6) + (seed >> 2)));
+}
+
+std::size_t ConversionCache::KeyHash::operator()(Key const& key) const {
+    std::uint64_t h = combineHash(key.config, key.content);
+    h = combineHash(h, key.context);
+    h = combineHash(h, key.size);
+    return static_cast<std::size_t>(combineHash(h, static_cast<std::uint64_t>(key.level)));
+}
+
+ConversionCache::ConversionCache(std::size_t capacityBytes, std::size_t minSubtreeBytes)
+    : capacity_(capacityBytes), minSubtreeBytes_(minSubtreeBytes) {}
+
+// The content hash is already uniform, so its top bits pick the shard; the
+// low bits feed the shard's own hash table.
+ConversionCache::Shard& ConversionCache::shardFor(Key const& key) {
+    return shards_[(key.content ^ key.context) >> 60 & (kShards - 1)];
+}
+
+std::shared_ptr<std::string const> ConversionCache::find(Key const& key) {
+    bool const document = key.level == CacheLevel::Document;
+    Shard& shard = shardFor(key);
+    std::shared_ptr<std::string const> markdown;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.index.find(key);
+        if (it != shard.index.end()) {
+            shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+            markdown = it->second->markdown;
+        }
+    }
+    auto& counter = markdown ? (document ? documentHits_ : subtreeHits_)
+                             : (document ? documentMisses_ : subtreeMisses_);
+    counter.fetch_add(1, std::memory_order_relaxed);
+    return markdown;
+}
+
+void ConversionCache::insert(Key const& key, std::string markdown) {
+    std::size_t const shardCapacity = capacity_ / kShards;
+    std::size_t const cost = markdown.size() + kEntryOverhead;
+    if (cost > shardCapacity) return;
+
+    auto value = std::make_shared<std::string const>(std::move(markdown));
+    Shard& shard = shardFor(key);
+    std::size_t evicted = 0;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.index.find(key);
+        if (it != shard.index.end()) {
+            shard.bytes -= it->second->markdown->size() + kEntryOverhead;
+            shard.lru.erase(it->second);
+            shard.index.erase(it);
+        }
+        while (!shard.lru.empty() && shard.bytes + cost > shardCapacity) {
+            Entry const& victim = shard.lru.back();
+            shard.bytes -= victim.markdown->size() + kEntryOverhead;
+            shard.index.erase(victim.key);
+            shard.lru.pop_back();
+            ++evicted;
+        }
+        shard.lru.push_front(Entry{key, std::move(value)});
+        shard.index.emplace(key, shard.lru.begin());
+        shard.bytes += cost;
+    }
+    insertions_.fetch_add(1, std::memory_order_relaxed);
+    if (evicted) evictions_.fetch_add(evicted, std::memory_order_relaxed);
+}
+
+void ConversionCache::clear() {
+    for (Shard& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.index.clear();
+        shard.lru.clear();
+        shard.bytes = 0;
+    }
+    for (auto* counter : {&documentHits_, &documentMisses_, &subtreeHits_, &subtreeMisses_, &insertions_, &evictions_}) {
+        counter->store(0, std::memory_order_relaxed);
+    }
+}
+
+ConversionCacheStats ConversionCache::stats() const {
+    ConversionCacheStats stats;
+    stats.documentHits = documentHits_.load(std::memory_order_relaxed);
+    stats.documentMisses = documentMisses_.load(std::memory_order_relaxed);
+    stats.subtreeHits = subtreeHits_.load(std::memory_order_relaxed);
+    stats.subtreeMisses = subtreeMisses_.load(std::memory_order_relaxed);
+    stats.insertions = insertions_.load(std::memory_order_relaxed);
+    stats.evictions = evictions_.load(std::memory_order_relaxed);
+    for (Shard const& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        stats.entries += shard.lru.size();
+        stats.bytes += shard.bytes;
+    }
+    return stats;
+}
+
+} // namespace turndown_cpp
@@ -4,46 +4,45 @@
 /// This translation unit implements `turndown_cpp::dom::NodeView` and
 /// `turndown_cpp::dom::Document` without exposing backend headers to consumers.
 ///
-/// The concrete backend is selected when building the library via
-/// TURNDOWN_PARSER_BACKEND_* compile definitions.
+/// The default backend is selected when building the library via
+/// TURNDOWN_PARSER_BACKEND_* compile definitions (see dom_backend.h). Other
+/// backends compiled in (TURNDOWN_HAS_PARSER_*) are reached through
+/// detail::NodeOps tables instantiated here.
 ///
 /// @copyright The MIT License (MIT)
 /// @copyright Copyright (c) 2025 Parsa Amini
 
 #include "dom_adapter.h"
+#include "dom_backend.h"
 
+#if defined(TURNDOWN_HAS_PARSER_GUMBO)
+    #include "gumbo_adapter.h"
+#endif
+#if defined(TURNDOWN_HAS_PARSER_TIDY)
+    #include "tidy_adapter.h"
+#endif
+#if defined(TURNDOWN_HAS_PARSER_LEXBOR)
+    #include "lexbor_adapter.h"
+#endif
+#if defined(TURNDOWN_HAS_PARSER_LIBXML2)
+    #include "libxml2_adapter.h"
+#endif
+
+#include <cstddef>
+#include <cstring>
 #include <memory>
+#include <memory_resource>
+#include <new>
+#include <stdexcept>
 #include <string>
 #include <utility>
 #include <vector>
 
-#if defined(TURNDOWN_PARSER_BACKEND_LEXBOR)
-    #include "lexbor_adapter.h"
-    namespace turndown_cpp::dom::detail {
-        namespace backend = turndown_cpp::lexbor;
-    }
-#elif defined(TURNDOWN_PARSER_BACKEND_TIDY)
-    #include "tidy_adapter.h"
-    namespace turndown_cpp::dom::detail {
-        namespace backend = turndown_cpp::tidy;
-    }
-#elif defined(TURNDOWN_PARSER_BACKEND_LIBXML2)
-    #include "libxml2_adapter.h"
-    namespace turndown_cpp::dom::detail {
-        namespace backend = turndown_cpp::libxml2;
-    }
-#else
-    #include "gumbo_adapter.h"
-    namespace turndown_cpp::dom::detail {
-        namespace backend = turndown_cpp::gumbo;
-    }
-#endif
-
 namespace turndown_cpp::dom {
 
 namespace {
 
-using BackendNodePtr = decltype(std::declval<detail::backend::NodeView const&>().get());
+using BackendNodePtr = detail::BackendAccess::NodePtr;
 
 template<typename PtrT>
 void* to_void_ptr(PtrT p) {
@@ -54,31 +53,262 @@ detail::backend::NodeView as_backend(void* raw) {
     return detail::backend::NodeView(static_cast<BackendNodePtr>(raw));
 }
 
+// Steps through a backend's attribute lists by its AttributeIterator, which
+// converts to and from the cursors AttributeRange holds.
+template<typename Node>
+struct BackendAttributes {
+    using Iterator = decltype(std::declval<Node const&>().attribute_range().begin());
+
+    static AttributeRange range(Node node) {
+        auto attrs = node.attribute_range();
+        return AttributeRange(&table, attrs.begin().cursor(), attrs.end().cursor());
+    }
+
+    static inline detail::AttributeOps const table{
+        [](AttributeCursor at) { return *Iterator(at); },
+        [](AttributeCursor at) { return (++Iterator(at)).cursor(); },
+    };
+};
+
+// --- Other backends ---
+
+// Exposes the nodes of a backend other than the default one through a
+// NodeOps table, one per backend node type.
+template<typename Node>
+struct ForeignOps {
+    using Ptr = decltype(std::declval<Node const&>().get());
+
+    static Node unwrap(void const* node) { return Node(static_cast<Ptr>(const_cast<void*>(node))); }
+
+    static NodeView wrap(Node node) {
+        if (!node) return {};
+        return detail::BackendAccess::wrap(static_cast<void const*>(node.get()), &table);
+    }
+
+    static detail::NodeOps makeTable() {
+        detail::NodeOps ops{};
+        ops.type = [](detail::NodeOps const&, void const* n) { return unwrap(n).type(); };
+        ops.parent = [](detail::NodeOps const&, void const* n) { return wrap(unwrap(n).parent()); };
+        ops.next_sibling = [](detail::NodeOps const&, void const* n) { return wrap(unwrap(n).next_sibling()); };
+        ops.first_child = [](detail::NodeOps const&, void const* n) { return wrap(unwrap(n).first_child()); };
+        // The table hands out views; names the tag table does not know are
+        // copied into a per-thread buffer, which the caller reads at once.
+        ops.tag_name = [](detail::NodeOps const&, void const* n) -> std::string_view {
+            Node node = unwrap(n);
+            std::string_view known = tagName(node.tag_id());
+            if (!known.empty()) return known;
+            thread_local std::string scratch;
+            scratch = node.tag_name();
+            return scratch;
+        };
+        ops.tag_id = [](detail::NodeOps const&, void const* n) { return unwrap(n).tag_id(); };
+        ops.attribute = [](detail::NodeOps const&, void const* n, std::string_view name) -> std::string_view const* {
+            Node node = unwrap(n);
+            if (!node.has_attribute(name)) return nullptr;
+            thread_local std::string_view value;
+            value = node.attribute(name);
+            return &value;
+        };
+        ops.attributes = [](detail::NodeOps const&, void const* n) { return BackendAttributes<Node>::range(unwrap(n)); };
+        ops.text = [](detail::NodeOps const&, void const* n) { return unwrap(n).text(); };
+        ops.source_html = [](detail::NodeOps const&, void const* n) { return unwrap(n).source_html(); };
+        return ops;
+    }
+
+    static inline detail::NodeOps const table = makeTable();
+};
+
+// A parsed document of a backend other than the default one.
+class ForeignDocument {
+public:
+    virtual ~ForeignDocument() = default;
+    virtual bool valid() const = 0;
+    virtual NodeView root() const = 0;
+    virtual NodeView document() const = 0;
+    virtual NodeView html() const = 0;
+    virtual NodeView body() const = 0;
+};
+
+template<typename BackendDocument>
+class ForeignDocumentOf final : public ForeignDocument {
+public:
+    using Ops = ForeignOps<decltype(std::declval<BackendDocument const&>().root())>;
+
+    explicit ForeignDocumentOf(BackendDocument doc) : doc_(std::move(doc)) {}
+
+    bool valid() const override { return static_cast<bool>(doc_); }
+    NodeView root() const override { return Ops::wrap(doc_.root()); }
+    NodeView document() const override { return Ops::wrap(doc_.document()); }
+    NodeView html() const override { return Ops::wrap(doc_.html()); }
+    NodeView body() const override { return Ops::wrap(doc_.body()); }
+
+private:
+    BackendDocument doc_;
+};
+
+template<typename BackendDocument>
+std::unique_ptr<ForeignDocument> parseForeign(std::string_view html) {
+    return std::make_unique<ForeignDocumentOf<BackendDocument>>(BackendDocument::parse(html));
+}
+
+std::unique_ptr<ForeignDocument> parseWith(ParserBackend backend, std::string_view html) {
+    switch (backend) {
+#if defined(TURNDOWN_HAS_PARSER_GUMBO)
+        case ParserBackend::Gumbo: return parseForeign<gumbo::Document>(html);
+#endif
+#if defined(TURNDOWN_HAS_PARSER_TIDY)
+        case ParserBackend::Tidy: return parseForeign<tidy::Document>(html);
+#endif
+#if defined(TURNDOWN_HAS_PARSER_LEXBOR)
+        case ParserBackend::Lexbor: return parseForeign<lexbor::Document>(html);
+#endif
+#if defined(TURNDOWN_HAS_PARSER_LIBXML2)
+        case ParserBackend::Libxml2: return parseForeign<libxml2::Document>(html);
+#endif
+        default: break;
+    }
+    throw std::invalid_argument(std::string("parser backend not compiled in: ") + toString(backend));
+}
+
+} // namespace
+
+// --- Backend allocation ---
+
+namespace {
+
+// Precedes every block from allocateFrom(); its size keeps the block
+// maximally aligned.
+struct alignas(std::max_align_t) BlockHeader {
+    std::pmr::memory_resource* memory;
+    std::size_t bytes;
+};
+
+BlockHeader* headerOf(void* block) {
+    return static_cast<BlockHeader*>(block) - 1;
+}
+
+} // namespace
+
+void* detail::allocateFrom(std::pmr::memory_resource* memory, std::size_t bytes) {
+    void* raw = memory->allocate(sizeof(BlockHeader) + bytes, alignof(BlockHeader));
+    auto* header = ::new (raw) BlockHeader{memory, bytes};
+    return header + 1;
+}
+
+void* detail::reallocateFrom(void* block, std::size_t bytes) {
+    BlockHeader* header = headerOf(block);
+    if (bytes <= header->bytes) return block;
+    void* grown = allocateFrom(header->memory, bytes);
+    std::memcpy(grown, block, header->bytes);
+    deallocateFrom(block);
+    return grown;
+}
+
+void detail::deallocateFrom(void* block) {
+    if (!block) return;
+    BlockHeader* header = headerOf(block);
+    header->memory->deallocate(header, sizeof(BlockHeader) + header->bytes, alignof(BlockHeader));
+}
+
+// --- ParserBackend ---
+
+char const* toString(ParserBackend backend) {
+    switch (backend) {
+        case ParserBackend::Auto: return "auto";
+        case ParserBackend::Gumbo: return "gumbo";
+        case ParserBackend::Tidy: return "tidy";
+        case ParserBackend::Lexbor: return "lexbor";
+        case ParserBackend::Libxml2: return "libxml2";
+    }
+    return "unknown";
+}
+
+ParserBackend defaultParserBackend() {
+    return detail::kBackend;
+}
+
+bool isParserBackendAvailable(ParserBackend backend) {
+    if (backend == ParserBackend::Auto || backend == detail::kBackend) return true;
+    switch (backend) {
+#if defined(TURNDOWN_HAS_PARSER_GUMBO)
+        case ParserBackend::Gumbo: return true;
+#endif
+#if defined(TURNDOWN_HAS_PARSER_TIDY)
+        case ParserBackend::Tidy: return true;
+#endif
+#if defined(TURNDOWN_HAS_PARSER_LEXBOR)
+        case ParserBackend::Lexbor: return true;
+#endif
+#if defined(TURNDOWN_HAS_PARSER_LIBXML2)
+        case ParserBackend::Libxml2: return true;
+#endif
+        default: return false;
+    }
+}
+
+std::vector<ParserBackend> availableParserBackends() {
+    std::vector<ParserBackend> backends{detail::kBackend};
+    for (ParserBackend backend : {ParserBackend::Gumbo, ParserBackend::Tidy, ParserBackend::Lexbor, ParserBackend::Libxml2}) {
+        if (backend != detail::kBackend && isParserBackendAvailable(backend)) backends.push_back(backend);
+    }
+    return backends;
+}
+
+ParserBackend selectParserBackend(ParserBackend requested, std::size_t inputBytes) {
+    if (requested != ParserBackend::Auto) return requested;
+    if (inputBytes >= kAutoLargeInputBytes && isParserBackendAvailable(ParserBackend::Lexbor)) {
+        return ParserBackend::Lexbor;
+    }
+    return detail::kBackend;
+}
+
+// A NodeView with an ops table is not a backend node (see detail::NodeOps);
+// the derived queries are answered from the table's primitives.
+
+namespace {
+
+bool equals_ignore_case(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) return false;
+    for (std::size_t i = 0; i < a.size(); ++i) {
+        auto lower = [](char c) { return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c; };
+        if (lower(a[i]) != lower(b[i])) return false;
+    }
+    return true;
+}
+
 } // namespace
 
 // --- NodeView ---
 
 NodeType NodeView::type() const {
+    if (ops_) return ops_->type(*ops_, node_);
     return node_ ? as_backend(node_).type() : NodeType::Unknown;
 }
 
 bool NodeView::is_text_like() const {
+    if (ops_) {
+        NodeType t = type();
+        return t == NodeType::Text || t == NodeType::Whitespace || t == NodeType::CData;
+    }
     return node_ ? as_backend(node_).is_text_like() : false;
 }
 
 NodeView NodeView::parent() const {
+    if (ops_) return ops_->parent(*ops_, node_);
     if (!node_) return {};
     auto p = as_backend(node_).parent();
     return NodeView(to_void_ptr(p.get()));
 }
 
 NodeView NodeView::next_sibling() const {
+    if (ops_) return ops_->next_sibling(*ops_, node_);
     if (!node_) return {};
     auto sib = as_backend(node_).next_sibling();
     return NodeView(to_void_ptr(sib.get()));
 }
 
 NodeView NodeView::first_child() const {
+    if (ops_) return ops_->first_child(*ops_, node_);
     if (!node_) return {};
     auto child = as_backend(node_).first_child();
     return NodeView(to_void_ptr(child.get()));
@@ -97,61 +327,104 @@ ChildRange NodeView::child_range() const {
 }
 
 std::string NodeView::tag_name() const {
+    if (ops_) return std::string(ops_->tag_name(*ops_, node_));
     return node_ ? as_backend(node_).tag_name() : std::string{};
 }
 
+TagId NodeView::tag_id() const {
+    if (ops_) return ops_->tag_id(*ops_, node_);
+    return node_ ? as_backend(node_).tag_id() : TagId::Unknown;
+}
+
 bool NodeView::has_tag(std::string_view tag) const {
+    if (ops_) return type() == NodeType::Element && equals_ignore_case(ops_->tag_name(*ops_, node_), tag);
     return node_ ? as_backend(node_).has_tag(tag) : false;
 }
 
 NodeView NodeView::find_child(std::string_view tag) const {
+    if (ops_) {
+        for (auto child : child_range()) {
+            if (child.has_tag(tag)) return child;
+        }
+        return {};
+    }
     if (!node_) return {};
     auto found = as_backend(node_).find_child(tag);
     return NodeView(to_void_ptr(found.get()));
 }
 
 NodeView NodeView::first_text_child() const {
+    if (ops_) {
+        for (auto child : child_range()) {
+            if (child.is_text_like()) return child;
+        }
+        return {};
+    }
     if (!node_) return {};
     auto found = as_backend(node_).first_text_child();
     return NodeView(to_void_ptr(found.get()));
 }
 
 std::string_view NodeView::attribute(std::string_view name) const {
+    if (ops_) {
+        std::string_view const* value = ops_->attribute(*ops_, node_, name);
+        return value ? *value : std::string_view{};
+    }
     return node_ ? as_backend(node_).attribute(name) : std::string_view{};
 }
 
 bool NodeView::has_attribute(std::string_view name) const {
+    if (ops_) return ops_->attribute(*ops_, node_, name) != nullptr;
     return node_ ? as_backend(node_).has_attribute(name) : false;
 }
 
 AttributeRange NodeView::attribute_range() const {
-    if (!node_) return AttributeRange{};
-
-    std::vector<AttributeView> attrs;
-    for (auto attr : as_backend(node_).attribute_range()) {
-        attrs.push_back(attr);
-    }
-    return AttributeRange(std::move(attrs));
+    if (ops_) return ops_->attributes(*ops_, node_);
+    return node_ ? BackendAttributes<detail::backend::NodeView>::range(as_backend(node_)) : AttributeRange{};
 }
 
 std::string NodeView::text_content() const {
+    if (ops_) {
+        // Preorder over the subtree, concatenating the text nodes.
+        std::string out;
+        NodeView node = *this;
+        while (node) {
+            if (node.is_text_like()) out += node.text();
+            NodeView next = node.first_child();
+            while (!next && node && node != *this) {
+                next = node.next_sibling();
+                if (!next) node = node.parent();
+            }
+            if (node == *this && !next) break;
+            node = next;
+        }
+        return out;
+    }
     return node_ ? as_backend(node_).text_content() : std::string{};
 }
 
 void NodeView::set_text(std::string const& text) {
-    if (!node_) return;
+    if (ops_ || !node_) return;
     auto backend_node = as_backend(node_);
     backend_node.set_text(text);
 }
 
 std::string_view NodeView::text() const {
+    if (ops_) return ops_->text(*ops_, node_);
     return node_ ? as_backend(node_).text() : std::string_view{};
 }
 
+std::string_view NodeView::source_html() const {
+    if (ops_) return ops_->source_html ? ops_->source_html(*ops_, node_) : std::string_view{};
+    return node_ ? as_backend(node_).source_html() : std::string_view{};
+}
+
 // --- Document ---
 
 struct Document::Impl {
     detail::backend::Document doc;
+    std::unique_ptr<ForeignDocument> foreign; ///< Set when another backend parsed the document
+    ParserBackend backend = detail::kBackend;
 };
 
 Document::Document() = default;
@@ -160,40 +433,112 @@ Document::~Document() = default;
 Document::Document(Document&& other) noexcept = default;
 Document& Document::operator=(Document&& other) noexcept = default;
 
-Document Document::parse(std::string const& html) {
+Document Document::parse(std::string_view html) {
     Document doc;
     doc.impl_ = std::make_unique<Impl>();
     doc.impl_->doc = detail::backend::Document::parse(html);
     return doc;
 }
 
+Document Document::parse(std::string_view html, ParserBackend backend) {
+    backend = selectParserBackend(backend, html.size());
+    if (backend == detail::kBackend) return parse(html);
+    Document doc;
+    doc.impl_ = std::make_unique<Impl>();
+    doc.impl_->foreign = parseWith(backend, html);
+    doc.impl_->backend = backend;
+    return doc;
+}
+
 Document::operator bool() const {
-    return impl_ && static_cast<bool>(impl_->doc);
+    if (!impl_) return false;
+    return impl_->foreign ? impl_->foreign->valid() : static_cast<bool>(impl_->doc);
+}
+
+ParserBackend Document::backend() const {
+    return impl_ ? impl_->backend : detail::kBackend;
 }
 
 NodeView Document::root() const {
     if (!*this) return {};
+    if (impl_->foreign) return impl_->foreign->root();
     auto n = impl_->doc.root();
     return NodeView(to_void_ptr(n.get()));
 }
 
 NodeView Document::document() const {
     if (!*this) return {};
+    if (impl_->foreign) return impl_->foreign->document();
     auto n = impl_->doc.document();
     return NodeView(to_void_ptr(n.get()));
 }
 
 NodeView Document::html() const {
     if (!*this) return {};
+    if (impl_->foreign) return impl_->foreign->html();
     auto n = impl_->doc.html();
     return NodeView(to_void_ptr(n.get()));
 }
 
 NodeView Document::body() const {
     if (!*this) return {};
+    if (impl_->foreign) return impl_->foreign->body();
     auto n = impl_->doc.body();
     return NodeView(to_void_ptr(n.get()));
 }
 
+// --- DocumentBuilder ---
+
+struct DocumentBuilder::Impl {
+    detail::backend::DocumentBuilder builder;
+};
+
+DocumentBuilder::DocumentBuilder() : impl_(std::make_unique<Impl>()) {}
+DocumentBuilder::~DocumentBuilder() = default;
+
+DocumentBuilder::DocumentBuilder(DocumentBuilder&& other) noexcept = default;
+DocumentBuilder& DocumentBuilder::operator=(DocumentBuilder&& other) noexcept = default;
+
+void DocumentBuilder::feed(std::string_view chunk) {
+    if (!impl_) impl_ = std::make_unique<Impl>(); // moved from
+    impl_->builder.feed(chunk);
+}
+
+Document DocumentBuilder::finish() {
+    if (!impl_) impl_ = std::make_unique<Impl>();
+    Document doc;
+    doc.impl_ = std::make_unique<Document::Impl>();
+    doc.impl_->doc = impl_->builder.finish();
+    impl_ = std::make_unique<Impl>();
+    return doc;
+}
+
+// --- Parser ---
+
+struct Parser::Impl {
+    detail::backend::Parser parser;
+};
+
+Parser::Parser() : impl_(std::make_unique<Impl>()) {}
+Parser::Parser(std::pmr::memory_resource* memory) : impl_(std::make_unique<Impl>(Impl{detail::backend::Parser(memory)})) {}
+Parser::~Parser() = default;
+
+Parser::Parser(Parser&& other) noexcept = default;
+Parser& Parser::operator=(Parser&& other) noexcept = default;
+
+Document Parser::parse(std::string_view html) {
+    if (!impl_) impl_ = std::make_unique<Impl>(); // moved from
+    Document doc;
+    doc.impl_ = std::make_unique<Document::Impl>();
+    doc.impl_->doc = impl_->parser.parse(html);
+    return doc;
+}
+
+void Parser::recycle(Document&& document) {
+    if (!impl_) impl_ = std::make_unique<Impl>();
+    if (document.impl_ && !document.impl_->foreign) impl_->parser.recycle(std::move(document.impl_->doc));
+    document.impl_.reset();
+}
+
 } // namespace turndown_cpp::dom
 
@@ -20,5 +20,19 @@ dom::NodeView HtmlStringSource::root() const {
     return document_.root();
 }
 
+MappedFileSource::MappedFileSource(std::filesystem::path const& path)
+    : file_(path) {}
+
+void MappedFileSource::parseIfNeeded() const {
+    if (!document_) {
+        document_ = dom::Document::parse(file_.view());
+    }
+}
+
+dom::NodeView MappedFileSource::root() const {
+    parseIfNeeded();
+    return document_.root();
+}
+
 } // namespace turndown_cpp
 
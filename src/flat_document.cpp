@@ -0,0 +1,236 @@
+/// @file flat_document.cpp
+/// @brief Contiguous DOM snapshot implementation
+///
+/// @copyright The MIT License (MIT)
+/// @copyright Copyright (c) 2025 Parsa Amini
+
+#include "flat_document.h"
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace turndown_cpp::dom {
+
+namespace {
+
+using Index = std::uint32_t;
+constexpr Index kNone = std::numeric_limits<Index>::max();
+
+/// @brief Offset and length of a string inside the snapshot's byte buffer
+struct Span {
+    std::uint32_t offset = 0;
+    std::uint32_t length = 0;
+};
+
+bool equalsIgnoreCase(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) return false;
+    for (std::size_t i = 0; i < a.size(); ++i) {
+        auto lower = [](char c) { return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c; };
+        if (lower(a[i]) != lower(b[i])) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+struct FlatDocument::Impl {
+    // One entry per node, in preorder; index 0 is the root.
+    std::vector<NodeType> types;
+    std::vector<TagId> tags;
+    std::vector<Index> parents;
+    std::vector<Index> firstChildren;
+    std::vector<Index> nextSiblings;
+    std::vector<Span> names; ///< Tag names of elements
+    std::vector<Span> texts; ///< Contents of text, CDATA and comment nodes
+    /// Attributes of node i are attrNames/attrValues[attrBegin[i], attrBegin[i + 1])
+    std::vector<Index> attrBegin;
+
+    std::vector<Span> attrNames;
+    std::vector<std::string_view> attrValues; ///< Views into bytes, filled once bytes is final
+    std::vector<Span> attrValueSpans;         ///< Spans of attrValues while building
+
+    std::string bytes;
+    detail::NodeOps ops{};
+
+    /// Attribute cursors hold the snapshot and an index into attrNames
+    static detail::AttributeOps const attributeOps;
+
+    Span store(std::string_view s) {
+        Span span{static_cast<std::uint32_t>(bytes.size()), static_cast<std::uint32_t>(s.size())};
+        bytes.append(s);
+        return span;
+    }
+
+    std::string_view view(Span span) const { return std::string_view(bytes).substr(span.offset, span.length); }
+
+    Index indexOf(void const* node) const { return static_cast<Index>(static_cast<NodeType const*>(node) - types.data()); }
+
+    NodeView node(Index index) const {
+        if (index == kNone) return {};
+        return makeView(const_cast<NodeType*>(&types[index]), &ops);
+    }
+
+    static Impl const& of(detail::NodeOps const& ops) { return *static_cast<Impl const*>(ops.context); }
+
+    void append(NodeView source, Index parent);
+    void initOps();
+};
+
+detail::AttributeOps const FlatDocument::Impl::attributeOps{
+    [](AttributeCursor at) {
+        auto const& impl = *static_cast<Impl const*>(at.item);
+        return AttributeView{impl.view(impl.attrNames[at.index]), impl.attrValues[at.index]};
+    },
+    [](AttributeCursor at) { return AttributeCursor{at.item, at.index + 1}; },
+};
+
+// Adds @p source with an unset child/sibling link; the caller links it.
+void FlatDocument::Impl::append(NodeView source, Index parent) {
+    NodeType type = source.type();
+    types.push_back(type);
+    tags.push_back(source.tag_id());
+    parents.push_back(parent);
+    firstChildren.push_back(kNone);
+    nextSiblings.push_back(kNone);
+    names.push_back(type == NodeType::Element ? store(source.tag_name()) : Span{});
+    texts.push_back(type != NodeType::Element ? store(source.text()) : Span{});
+    attrBegin.push_back(static_cast<Index>(attrNames.size()));
+    if (type == NodeType::Element) {
+        for (AttributeView attr : source.attribute_range()) {
+            attrNames.push_back(store(attr.name));
+            attrValueSpans.push_back(store(attr.value));
+        }
+    }
+}
+
+void FlatDocument::Impl::initOps() {
+    ops.context = this;
+    ops.type = [](detail::NodeOps const& o, void const* n) {
+        auto const& impl = of(o);
+        return impl.types[impl.indexOf(n)];
+    };
+    ops.parent = [](detail::NodeOps const& o, void const* n) {
+        auto const& impl = of(o);
+        return impl.node(impl.parents[impl.indexOf(n)]);
+    };
+    ops.next_sibling = [](detail::NodeOps const& o, void const* n) {
+        auto const& impl = of(o);
+        return impl.node(impl.nextSiblings[impl.indexOf(n)]);
+    };
+    ops.first_child = [](detail::NodeOps const& o, void const* n) {
+        auto const& impl = of(o);
+        return impl.node(impl.firstChildren[impl.indexOf(n)]);
+    };
+    ops.tag_name = [](detail::NodeOps const& o, void const* n) {
+        auto const& impl = of(o);
+        return impl.view(impl.names[impl.indexOf(n)]);
+    };
+    ops.tag_id = [](detail::NodeOps const& o, void const* n) {
+        auto const& impl = of(o);
+        return impl.tags[impl.indexOf(n)];
+    };
+    ops.attribute = [](detail::NodeOps const& o, void const* n, std::string_view name) -> std::string_view const* {
+        auto const& impl = of(o);
+        Index i = impl.indexOf(n);
+        for (Index a = impl.attrBegin[i]; a < impl.attrBegin[i + 1]; ++a) {
+            if (equalsIgnoreCase(impl.view(impl.attrNames[a]), name)) return &impl.attrValues[a];
+        }
+        return nullptr;
+    };
+    ops.attributes = [](detail::NodeOps const& o, void const* n) {
+        auto const& impl = of(o);
+        Index i = impl.indexOf(n);
+        return AttributeRange(&impl.attributeOps, {&impl, impl.attrBegin[i]}, {&impl, impl.attrBegin[i + 1]});
+    };
+    ops.text = [](detail::NodeOps const& o, void const* n) {
+        auto const& impl = of(o);
+        return impl.view(impl.texts[impl.indexOf(n)]);
+    };
+}
+
+NodeView FlatDocument::makeView(void* node, detail::NodeOps const* ops) {
+    return NodeView(node, ops);
+}
+
+FlatDocument::FlatDocument() = default;
+FlatDocument::~FlatDocument() = default;
+
+FlatDocument::FlatDocument(FlatDocument&& other) noexcept = default;
+FlatDocument& FlatDocument::operator=(FlatDocument&& other) noexcept = default;
+
+// Copies the subtree in one preorder walk. Each node is appended before its
+// descendants; each open ancestor remembers its last child, to link the next
+// sibling to, and its source node, to resume the walk after it.
+FlatDocument FlatDocument::build(NodeView root) {
+    FlatDocument flat;
+    if (!root) return flat;
+    flat.impl_ = std::make_unique<Impl>();
+    Impl& impl = *flat.impl_;
+
+    struct Open {
+        Index index;
+        Index lastChild;
+        NodeView source;
+    };
+    std::vector<Open> open;
+    impl.append(root, kNone);
+    open.push_back({0, kNone, root});
+
+    NodeView node = root.first_child();
+    while (!open.empty()) {
+        if (!node) {
+            // Children of the innermost open node are done; resume after it.
+            NodeView closed = open.back().source;
+            open.pop_back();
+            if (open.empty()) break;
+            node = closed.next_sibling();
+            continue;
+        }
+        Index index = static_cast<Index>(impl.types.size());
+        Open& parent = open.back();
+        impl.append(node, parent.index);
+        if (parent.lastChild == kNone) {
+            impl.firstChildren[parent.index] = index;
+        } else {
+            impl.nextSiblings[parent.lastChild] = index;
+        }
+        parent.lastChild = index;
+        open.push_back({index, kNone, node});
+        node = node.first_child();
+    }
+    impl.attrBegin.push_back(static_cast<Index>(impl.attrNames.size()));
+
+    impl.attrValues.reserve(impl.attrValueSpans.size());
+    for (Span span : impl.attrValueSpans) {
+        impl.attrValues.push_back(impl.view(span));
+    }
+    std::vector<Span>().swap(impl.attrValueSpans);
+    impl.initOps();
+    return flat;
+}
+
+FlatDocument FlatDocument::parse(std::string_view html) {
+    Document document = Document::parse(html);
+    if (!document) return {};
+    return build(document.root());
+}
+
+FlatDocument::operator bool() const {
+    return impl_ && !impl_->types.empty();
+}
+
+NodeView FlatDocument::root() const {
+    if (!*this) return {};
+    return impl_->node(0);
+}
+
+std::size_t FlatDocument::size() const {
+    return impl_ ? impl_->types.size() : 0;
+}
+
+} // namespace turndown_cpp::dom
@@ -5,12 +5,15 @@
 /// @copyright Copyright (c) 2025 Parsa Amini
 
 #include "gumbo_adapter.h"
+#include "dom_adapter.h"
 
 #include <algorithm>
+#include <array>
 #include <cctype>
 #include <sstream>
 #include <string>
 #include <string_view>
+#include <utility>
 #include <vector>
 
 namespace turndown_cpp::gumbo {
@@ -28,6 +31,17 @@ GumboVector* children_vector(GumboNode* node) {
     return nullptr;
 }
 
+// ASCII case-insensitive, as HTML attribute names are.
+bool equals_ignore_case(char const* name, std::string_view needle) {
+    for (char c : needle) {
+        if (*name == '\0' || std::tolower(static_cast<unsigned char>(*name)) != std::tolower(static_cast<unsigned char>(c))) {
+            return false;
+        }
+        ++name;
+    }
+    return *name == '\0';
+}
+
 GumboVector* attributes_vector(GumboNode* node) {
     if (!node) return nullptr;
     if (node->type == GUMBO_NODE_ELEMENT || node->type == GUMBO_NODE_TEMPLATE) {
@@ -105,6 +119,25 @@ std::string lookup_tag_name(GumboNode* node) {
     return name;
 }
 
+// Maps Gumbo's tag enum to a TagId through a table built on first use;
+// unknown tags are looked up by their original name.
+dom::TagId lookup_tag_id(GumboNode* node) {
+    if (!is_element(node)) return dom::TagId::Unknown;
+    GumboTag tag = node->v.element.tag;
+    if (tag == GUMBO_TAG_UNKNOWN || tag >= GUMBO_TAG_LAST) {
+        return dom::tagIdFromName(lookup_tag_name(node));
+    }
+    static std::array<dom::TagId, GUMBO_TAG_LAST> const kTagIds = [] {
+        std::array<dom::TagId, GUMBO_TAG_LAST> ids{};
+        for (std::size_t i = 0; i < ids.size(); ++i) {
+            char const* name = gumbo_normalized_tagname(static_cast<GumboTag>(i));
+            ids[i] = name ? dom::tagIdFromName(name) : dom::TagId::Unknown;
+        }
+        return ids;
+    }();
+    return kTagIds[tag];
+}
+
 bool has_tag(GumboNode* node, std::string_view tag) {
     return is_element(node) && lookup_tag_name(node) == tag;
 }
@@ -161,6 +194,15 @@ std::size_t ChildRange::size() const {
 AttributeIterator::AttributeIterator(GumboVector const* vec, unsigned index)
     : vec_(vec), index_(index) {}
 
+AttributeIterator::AttributeIterator(dom::AttributeCursor cursor)
+    : vec_(static_cast<GumboVector const*>(cursor.item)), index_(static_cast<unsigned>(cursor.index)) {}
+
+// Every position past the end maps to the end cursor.
+dom::AttributeCursor AttributeIterator::cursor() const {
+    if (!vec_ || index_ >= vec_->length) return {};
+    return {vec_, index_};
+}
+
 dom::AttributeView AttributeIterator::operator*() const {
     if (!vec_ || index_ >= vec_->length) return {};
     GumboAttribute* attr = static_cast<GumboAttribute*>(vec_->data[index_]);
@@ -267,6 +309,10 @@ std::string NodeView::tag_name() const {
     return lookup_tag_name(node_);
 }
 
+dom::TagId NodeView::tag_id() const {
+    return lookup_tag_id(node_);
+}
+
 bool NodeView::has_tag(std::string_view tag) const {
     return node_ && is_element() && lookup_tag_name(node_) == tag;
 }
@@ -295,11 +341,18 @@ std::string NodeView::text_content() const {
     return out.str();
 }
 
+// Matches names like gumbo_get_attribute(), without a NUL-terminated copy
+// of the name.
 std::string_view NodeView::attribute(std::string_view name) const {
     if (!node_ || node_->type != GUMBO_NODE_ELEMENT) return {};
-    GumboAttribute* attr = gumbo_get_attribute(&node_->v.element.attributes, std::string(name).c_str());
-    if (!attr || !attr->value) return {};
-    return attr->value;
+    GumboVector const& attrs = node_->v.element.attributes;
+    for (unsigned i = 0; i < attrs.length; ++i) {
+        auto* attr = static_cast<GumboAttribute const*>(attrs.data[i]);
+        if (attr->name && equals_ignore_case(attr->name, name)) {
+            return attr->value ? std::string_view(attr->value) : std::string_view{};
+        }
+    }
+    return {};
 }
 
 bool NodeView::has_attribute(std::string_view name) const {
@@ -326,33 +379,126 @@ std::string_view NodeView::text() const {
     }
 }
 
+// Spans the original start tag to the original end tag. An element whose
+// end tag was implied is only complete in the source if it is empty.
+std::string_view NodeView::source_html() const {
+    if (!node_) return {};
+    switch (node_->type) {
+        case GUMBO_NODE_ELEMENT:
+        case GUMBO_NODE_TEMPLATE: {
+            GumboElement const& element = node_->v.element;
+            GumboStringPiece const& start = element.original_tag;
+            GumboStringPiece const& end = element.original_end_tag;
+            if (!start.data || start.length == 0) return {}; // inserted by the parser
+            if (end.data && end.length != 0 && end.data >= start.data) {
+                return std::string_view(start.data, static_cast<std::size_t>(end.data - start.data) + end.length);
+            }
+            if (element.children.length == 0) return to_string_view(start);
+            return {};
+        }
+        case GUMBO_NODE_TEXT:
+        case GUMBO_NODE_WHITESPACE:
+        case GUMBO_NODE_CDATA:
+        case GUMBO_NODE_COMMENT:
+            return to_string_view(node_->v.text.original_text);
+        default:
+            return {};
+    }
+}
+
 AttributeRange NodeView::attribute_range() const {
     return AttributeRange(node_);
 }
 
 // --- Document implementation ---
 
-Document Document::parse(std::string const& html) {
-    return Document(gumbo_parse(html.c_str()));
+Document Document::parse(std::string_view html) {
+    char const* bytes = html.empty() ? "" : html.data(); // a defaulted view has no buffer
+    return Document(gumbo_parse_with_options(&kGumboDefaultOptions, bytes, html.size()));
+}
+
+// --- Parser ---
+
+#if defined(TURNDOWN_GUMBO_HAS_ALLOCATOR)
+namespace {
+
+void* allocate_from(void* memory, std::size_t bytes) {
+    return dom::detail::allocateFrom(static_cast<std::pmr::memory_resource*>(memory), bytes);
+}
+
+void deallocate_from(void*, void* block) {
+    dom::detail::deallocateFrom(block);
+}
+
+// Blocks know their resource, so destroying a tree needs no userdata.
+GumboOptions const kPooledOptions = [] {
+    GumboOptions options = kGumboDefaultOptions;
+    options.allocator = &allocate_from;
+    options.deallocator = &deallocate_from;
+    return options;
+}();
+
+} // namespace
+#endif
+
+Document Parser::parse(std::string_view html) {
+#if defined(TURNDOWN_GUMBO_HAS_ALLOCATOR)
+    if (memory_) {
+        GumboOptions options = kPooledOptions;
+        options.userdata = memory_;
+        char const* bytes = html.empty() ? "" : html.data();
+        Document doc(gumbo_parse_with_options(&options, bytes, html.size()));
+        doc.options_ = &kPooledOptions;
+        return doc;
+    }
+#endif
+    return Document::parse(html);
+}
+
+void Parser::recycle(Document&& document) {
+    Document released = std::move(document);
+}
+
+// --- DocumentBuilder ---
+
+DocumentBuilder::DocumentBuilder() = default;
+DocumentBuilder::DocumentBuilder(DocumentBuilder&& other) noexcept = default;
+DocumentBuilder& DocumentBuilder::operator=(DocumentBuilder&& other) noexcept = default;
+DocumentBuilder::~DocumentBuilder() = default;
+
+void DocumentBuilder::feed(std::string_view chunk) {
+    html_.append(chunk);
+}
+
+// The tree points into its input, so the document keeps the buffer.
+Document DocumentBuilder::finish() {
+    auto source = std::make_unique<std::string const>(std::move(html_));
+    html_.clear();
+    Document doc = Document::parse(*source);
+    doc.source_ = std::move(source);
+    return doc;
 }
 
-Document::Document(Document&& other) noexcept : output_(other.output_) {
+Document::Document(Document&& other) noexcept
+    : output_(other.output_), options_(other.options_), source_(std::move(other.source_)) {
     other.output_ = nullptr;
 }
 
 Document& Document::operator=(Document&& other) noexcept {
     if (this == &other) return *this;
     if (output_) {
-        gumbo_destroy_output(&kGumboDefaultOptions, output_);
+        gumbo_destroy_output(options_, output_);
     }
     output_ = other.output_;
+    options_ = other.options_;
     other.output_ = nullptr;
+    source_ = std::move(other.source_);
     return *this;
 }
 
 Document::~Document() {
     if (output_) {
-        gumbo_destroy_output(&kGumboDefaultOptions, output_);
+        gumbo_destroy_output(options_, output_);
         output_ = nullptr;
     }
 }
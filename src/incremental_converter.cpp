@@ -0,0 +1,47 @@
+/// @file incremental_converter.cpp
+/// @brief Re-conversion of a document that changes a little at a time
+///
+/// @copyright The MIT License (MIT)
+/// @copyright Copyright (c) 2025 Parsa Amini
+
+#include "incremental_converter.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace turndown_cpp {
+
+IncrementalConverter::IncrementalConverter(TurndownService const& service, std::size_t capacityBytes,
+                                           std::size_t minSubtreeBytes)
+    : service_(service.clone()), cache_(std::make_shared<ConversionCache>(capacityBytes, minSubtreeBytes)) {
+    service_.setCache(cache_);
+}
+
+std::string IncrementalConverter::convert(std::string const& html) {
+    return convertCounting(html);
+}
+
+std::string IncrementalConverter::convert(dom::NodeView root) {
+    return convertCounting(root);
+}
+
+void IncrementalConverter::reset() {
+    cache_->clear();
+    last_ = {};
+}
+
+// The cache is private to the converter, so the change in its counters is
+// what this call did.
+template <typename Input>
+std::string IncrementalConverter::convertCounting(Input const& input) {
+    ConversionCacheStats const before = cache_->stats();
+    std::string markdown = service_.turndown(input);
+    ConversionCacheStats const after = cache_->stats();
+    last_.unchanged = after.documentHits > before.documentHits;
+    last_.reusedSubtrees = after.subtreeHits - before.subtreeHits;
+    last_.convertedSubtrees = after.subtreeMisses - before.subtreeMisses;
+    return markdown;
+}
+
+} // namespace turndown_cpp
@@ -7,26 +7,22 @@
 #include "lexbor_adapter.h"
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <cctype>
 #include <cstddef>
+#include <cstdint>
 #include <cstring>
 #include <sstream>
 #include <string>
 #include <string_view>
-#include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace turndown_cpp::lexbor {
 
 namespace {
 
-// Thread-local storage for cached text content
-thread_local std::unordered_map<lxb_dom_node_t*, std::string> tl_text_cache;
-
-void clear_text_cache() {
-    tl_text_cache.clear();
-}
-
 dom::NodeType to_node_type(lxb_dom_node_t* node) {
     if (!node) return dom::NodeType::Unknown;
     switch (node->type) {
@@ -140,6 +136,25 @@ std::string lookup_tag_name(lxb_dom_node_t* node) {
     return result;
 }
 
+// Maps Lexbor's tag id to a TagId. Lexbor has no document-independent
+// id-to-name lookup, so each built-in id is resolved by name the first
+// time a node carries it (slot value is TagId + 1, zero while unresolved).
+dom::TagId lookup_tag_id(lxb_dom_node_t* node) {
+    if (!is_element(node)) return dom::TagId::Unknown;
+    lxb_tag_id_t id = node->local_name;
+    if (id >= LXB_TAG__LAST_ENTRY) {
+        return dom::tagIdFromName(lookup_tag_name(node));
+    }
+    static_assert(dom::kTagCount < 256, "TagId + 1 must fit in a slot");
+    static std::array<std::atomic<std::uint8_t>, LXB_TAG__LAST_ENTRY> memo{};
+    std::uint8_t cached = memo[id].load(std::memory_order_relaxed);
+    if (cached == 0) {
+        cached = static_cast<std::uint8_t>(static_cast<std::uint8_t>(dom::tagIdFromName(lookup_tag_name(node))) + 1);
+        memo[id].store(cached, std::memory_order_relaxed);
+    }
+    return static_cast<dom::TagId>(cached - 1);
+}
+
 bool has_tag(lxb_dom_node_t* node, std::string_view tag) {
     return is_element(node) && lookup_tag_name(node) == tag;
 }
@@ -204,6 +219,9 @@ dom::AttributeView AttributeIterator::operator*() const {
     };
 }
 
+AttributeIterator::AttributeIterator(dom::AttributeCursor cursor)
+    : current_(static_cast<lxb_dom_attr_t*>(const_cast<void*>(cursor.item))) {}
+
 AttributeIterator& AttributeIterator::operator++() {
     if (current_) {
         current_ = current_->next;
@@ -261,18 +279,6 @@ bool NodeView::is_text_like() const {
     }
 }
 
-NodeView NodeView::parent() const {
-    return node_ ? NodeView(node_->parent) : NodeView{};
-}
-
-NodeView NodeView::first_child() const {
-    return node_ ? NodeView(node_->first_child) : NodeView{};
-}
-
-NodeView NodeView::next_sibling() const {
-    return node_ ? NodeView(node_->next) : NodeView{};
-}
-
 std::vector<NodeView> NodeView::children() const {
     std::vector<NodeView> result;
     if (!node_) return result;
@@ -291,6 +297,10 @@ std::string NodeView::tag_name() const {
     return lookup_tag_name(node_);
 }
 
+dom::TagId NodeView::tag_id() const {
+    return lookup_tag_id(node_);
+}
+
 bool NodeView::has_tag(std::string_view tag) const {
     return node_ && is_element() && lookup_tag_name(node_) == tag;
 }
@@ -351,19 +361,24 @@ std::string_view NodeView::text() const {
     return get_text_content(node_);
 }
 
+// Lexbor does not keep token positions in the tree.
+std::string_view NodeView::source_html() const {
+    return {};
+}
+
 AttributeRange NodeView::attribute_range() const {
     return AttributeRange(node_);
 }
 
 // --- Document implementation ---
 
-Document Document::parse(std::string const& html) {
+Document Document::parse(std::string_view html) {
     lxb_html_document_t* doc = lxb_html_document_create();
     if (!doc) return Document(nullptr);
     
     lxb_status_t status = lxb_html_document_parse(
         doc,
-        reinterpret_cast<lxb_char_t const*>(html.c_str()),
+        reinterpret_cast<lxb_char_t const*>(html.data()),
         html.size()
     );
     
@@ -372,9 +387,92 @@ Document Document::parse(std::string const& html) {
         return Document(nullptr);
     }
     
-    // Clear text cache for new document
-    clear_text_cache();
-    
+    return Document(doc);
+}
+
+// --- Parser ---
+
+Parser::Parser(Parser&& other) noexcept : spare_(std::exchange(other.spare_, nullptr)) {}
+
+Parser& Parser::operator=(Parser&& other) noexcept {
+    if (this == &other) return *this;
+    if (spare_) lxb_html_document_destroy(spare_);
+    spare_ = std::exchange(other.spare_, nullptr);
+    return *this;
+}
+
+Parser::~Parser() {
+    if (spare_) lxb_html_document_destroy(spare_);
+}
+
+Document Parser::parse(std::string_view html) {
+    lxb_html_document_t* doc = spare_ ? std::exchange(spare_, nullptr) : lxb_html_document_create();
+    if (!doc) return Document(nullptr);
+
+    lxb_status_t status = lxb_html_document_parse(
+        doc,
+        reinterpret_cast<lxb_char_t const*>(html.data()),
+        html.size()
+    );
+
+    if (status != LXB_STATUS_OK) {
+        lxb_html_document_destroy(doc);
+        return Document(nullptr);
+    }
+
+    return Document(doc);
+}
+
+// Keeps one cleaned document for the next parse.
+void Parser::recycle(Document&& document) {
+    lxb_html_document_t* doc = std::exchange(document.doc_, nullptr);
+    if (!doc) return;
+    if (spare_) {
+        lxb_html_document_destroy(doc);
+        return;
+    }
+    lxb_html_document_clean(doc);
+    spare_ = doc;
+}
+
+// --- DocumentBuilder ---
+
+DocumentBuilder::DocumentBuilder() : doc_(lxb_html_document_create()) {
+    if (!doc_ || lxb_html_document_parse_chunk_begin(doc_) != LXB_STATUS_OK) {
+        failed_ = true;
+    }
+}
+
+DocumentBuilder::DocumentBuilder(DocumentBuilder&& other) noexcept
+    : doc_(std::exchange(other.doc_, nullptr)), failed_(std::exchange(other.failed_, false)) {}
+
+DocumentBuilder& DocumentBuilder::operator=(DocumentBuilder&& other) noexcept {
+    if (this == &other) return *this;
+    if (doc_) lxb_html_document_destroy(doc_);
+    doc_ = std::exchange(other.doc_, nullptr);
+    failed_ = std::exchange(other.failed_, false);
+    return *this;
+}
+
+DocumentBuilder::~DocumentBuilder() {
+    if (doc_) lxb_html_document_destroy(doc_);
+}
+
+void DocumentBuilder::feed(std::string_view chunk) {
+    if (failed_ || chunk.empty()) return;
+    lxb_status_t status = lxb_html_document_parse_chunk(
+        doc_, reinterpret_cast<lxb_char_t const*>(chunk.data()), chunk.size());
+    if (status != LXB_STATUS_OK) failed_ = true;
+}
+
+Document DocumentBuilder::finish() {
+    lxb_html_document_t* doc = std::exchange(doc_, nullptr);
+    bool ok = !failed_ && doc && lxb_html_document_parse_chunk_end(doc) == LXB_STATUS_OK;
+    failed_ = true;
+    if (!ok) {
+        if (doc) lxb_html_document_destroy(doc);
+        return Document(nullptr);
+    }
     return Document(doc);
 }
 
@@ -12,6 +12,8 @@
 
 #include <algorithm>
 #include <cctype>
+#include <limits>
+#include <mutex>
 #include <sstream>
 #include <string>
 #include <string_view>
@@ -23,25 +25,53 @@ namespace turndown_cpp::libxml2 {
 
 namespace {
 
-thread_local xmlDocPtr tl_current_doc = nullptr;
-thread_local std::unordered_map<xmlAttrPtr, std::string> tl_attr_value_cache;
-
-void clear_attr_cache_for_current_doc(xmlDocPtr doc) {
-    if (tl_current_doc == doc) {
-        tl_attr_value_cache.clear();
-        tl_current_doc = nullptr;
+// Attribute values made of more than one text node have to be concatenated
+// into owned storage. That storage hangs off the document's _private slot so
+// lookups work from any thread converting the document.
+struct AttrValueCache {
+    std::mutex mutex;
+    std::unordered_map<xmlAttrPtr, std::string> values;
+};
+
+// ASCII case-insensitive, like xmlStrcasecmp(), without a NUL-terminated
+// copy of the needle.
+bool equals_ignore_case(xmlChar const* name, std::string_view needle) {
+    for (char c : needle) {
+        if (*name == 0 || std::tolower(*name) != std::tolower(static_cast<unsigned char>(c))) return false;
+        ++name;
     }
+    return *name == 0;
+}
+
+void attach_attr_cache(xmlDocPtr doc) {
+    doc->_private = new AttrValueCache();
 }
 
-void set_current_doc(xmlDocPtr doc) {
-    tl_current_doc = doc;
-    tl_attr_value_cache.clear();
+void release_doc(xmlDocPtr doc) {
+    delete static_cast<AttrValueCache*>(doc->_private);
+    doc->_private = nullptr;
+    xmlFreeDoc(doc);
 }
 
 std::string_view cached_attr_value(xmlAttrPtr attr) {
     if (!attr) return {};
-    auto it = tl_attr_value_cache.find(attr);
-    if (it != tl_attr_value_cache.end()) {
+
+    // The HTML parser decodes entities while parsing, so values are almost
+    // always a single text node that can be viewed in place.
+    xmlNodePtr value_node = attr->children;
+    if (!value_node) return {};
+    if (value_node->type == XML_TEXT_NODE && !value_node->next) {
+        return value_node->content
+            ? std::string_view(reinterpret_cast<char const*>(value_node->content))
+            : std::string_view{};
+    }
+
+    auto* cache = attr->doc ? static_cast<AttrValueCache*>(attr->doc->_private) : nullptr;
+    if (!cache) return {};
+
+    std::lock_guard lock(cache->mutex);
+    auto it = cache->values.find(attr);
+    if (it != cache->values.end()) {
         return it->second;
     }
 
@@ -52,7 +82,7 @@ std::string_view cached_attr_value(xmlAttrPtr attr) {
         xmlFree(value);
     }
 
-    auto [ins_it, _] = tl_attr_value_cache.emplace(attr, std::move(str));
+    auto [ins_it, _] = cache->values.emplace(attr, std::move(str));
     return ins_it->second;
 }
 
@@ -112,30 +142,50 @@ std::string lowercase(std::string_view s) {
 // mis-handle a literal '<' in text (e.g. "< 1") by treating it as markup.
 // To better match other backends (and HTML5 parsing rules), we escape '<'
 // when it is not starting a tag open sequence.
-std::string escape_non_tag_angle_brackets(std::string const& html) {
-    auto is_ascii_alpha = [](unsigned char c) {
-        return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
-    };
+// True if a '<' followed by @p next opens a tag (0 means end of input).
+bool opens_tag(unsigned char next) {
+    bool alpha = (next >= 'A' && next <= 'Z') || (next >= 'a' && next <= 'z');
+    return alpha || next == '/' || next == '!' || next == '?';
+}
 
-    std::string out;
-    out.reserve(html.size());
+// Appends @p html to @p out with stray '<' escaped. A '<' at the very end
+// is left out and reported: whether it opens a tag depends on the next
+// byte, which the caller may not have yet.
+bool append_escaped(std::string_view html, std::string& out) {
     for (std::size_t i = 0; i < html.size(); ++i) {
         char c = html[i];
         if (c == '<') {
-            unsigned char next = (i + 1 < html.size())
-                ? static_cast<unsigned char>(html[i + 1])
-                : 0;
-            bool tag_open = is_ascii_alpha(next) || next == '/' || next == '!' || next == '?';
-            if (!tag_open) {
+            if (i + 1 == html.size()) return true;
+            if (!opens_tag(static_cast<unsigned char>(html[i + 1]))) {
                 out += "&lt;";
                 continue;
             }
         }
         out.push_back(c);
     }
-    return out;
+    return false;
 }
 
+// Returns @p html itself when it has no stray '<', which is the common
+// case; otherwise the escaped copy, built in @p scratch.
+std::string_view escape_non_tag_angle_brackets(std::string_view html, std::string& scratch) {
+    bool stray = false;
+    for (std::size_t i = html.find('<'); i != std::string_view::npos; i = html.find('<', i + 1)) {
+        if (i + 1 == html.size() || !opens_tag(static_cast<unsigned char>(html[i + 1]))) {
+            stray = true;
+            break;
+        }
+    }
+    if (!stray) return html.empty() ? std::string_view("") : html;
+    scratch.clear();
+    scratch.reserve(html.size() + 16);
+    if (append_escaped(html, scratch)) scratch += "&lt;";
+    return scratch;
+}
+
+// Parse as HTML (tolerant), suppress errors/warnings, and forbid network fetches.
+int const kParseOptions = HTML_PARSE_RECOVER | HTML_PARSE_NOERROR | HTML_PARSE_NOWARNING | HTML_PARSE_NONET;
+
 } // namespace
 
 // --- Utility functions ---
@@ -146,11 +196,15 @@ std::string lookup_tag_name(xmlNodePtr node) {
     return lowercase(sv);
 }
 
+// Maps an element name to a TagId (case-insensitive, no allocation).
+dom::TagId lookup_tag_id(xmlNodePtr node) {
+    if (!node || node->type != XML_ELEMENT_NODE || !node->name) return dom::TagId::Unknown;
+    return dom::tagIdFromName(reinterpret_cast<char const*>(node->name));
+}
+
 bool has_tag(xmlNodePtr node, std::string_view tag) {
     if (!node || node->type != XML_ELEMENT_NODE || !node->name) return false;
-    std::string needle(tag);
-    // HTML is case-insensitive; compare with libxml2 helper.
-    return xmlStrcasecmp(node->name, reinterpret_cast<xmlChar const*>(needle.c_str())) == 0;
+    return equals_ignore_case(node->name, tag);
 }
 
 // --- ChildIterator implementation ---
@@ -207,6 +261,9 @@ dom::AttributeView AttributeIterator::operator*() const {
     return dom::AttributeView{name, value};
 }
 
+AttributeIterator::AttributeIterator(dom::AttributeCursor cursor)
+    : current_(static_cast<xmlAttrPtr>(const_cast<void*>(cursor.item))) {}
+
 AttributeIterator& AttributeIterator::operator++() {
     if (current_) {
         current_ = current_->next;
@@ -261,18 +318,6 @@ bool NodeView::is_text_like() const {
     }
 }
 
-NodeView NodeView::parent() const {
-    return node_ ? NodeView(node_->parent) : NodeView{};
-}
-
-NodeView NodeView::next_sibling() const {
-    return node_ ? NodeView(node_->next) : NodeView{};
-}
-
-NodeView NodeView::first_child() const {
-    return node_ ? NodeView(node_->children) : NodeView{};
-}
-
 std::vector<NodeView> NodeView::children() const {
     std::vector<NodeView> result;
     if (!node_) return result;
@@ -290,6 +335,10 @@ std::string NodeView::tag_name() const {
     return lookup_tag_name(node_);
 }
 
+dom::TagId NodeView::tag_id() const {
+    return lookup_tag_id(node_);
+}
+
 bool NodeView::has_tag(std::string_view tag) const {
     // Qualify to avoid calling NodeView::has_tag recursively (name hiding).
     return ::turndown_cpp::libxml2::has_tag(node_, tag);
@@ -315,12 +364,8 @@ NodeView NodeView::first_text_child() const {
 
 std::string_view NodeView::attribute(std::string_view name) const {
     if (!node_ || node_->type != XML_ELEMENT_NODE) return {};
-    std::string needle(name);
     for (xmlAttrPtr attr = node_->properties; attr; attr = attr->next) {
-        if (!attr->name) continue;
-        if (xmlStrcasecmp(attr->name, reinterpret_cast<xmlChar const*>(needle.c_str())) == 0) {
-            return cached_attr_value(attr);
-        }
+        if (attr->name && equals_ignore_case(attr->name, name)) return cached_attr_value(attr);
     }
     return {};
 }
@@ -357,30 +402,36 @@ std::string_view NodeView::text() const {
     }
 }
 
+// libxml2 records line numbers only, and parses a sanitized copy.
+std::string_view NodeView::source_html() const {
+    return {};
+}
+
 // --- Document implementation ---
 
-Document Document::parse(std::string const& html) {
+Document Document::parse(std::string_view html) {
     // Ensure libxml2 is initialized.
     xmlInitParser();
 
-    // Parse as HTML (tolerant), suppress errors/warnings, and forbid network fetches.
-    int const options = HTML_PARSE_RECOVER | HTML_PARSE_NOERROR | HTML_PARSE_NOWARNING | HTML_PARSE_NONET;
-
-    std::string sanitized = escape_non_tag_angle_brackets(html);
+    std::string scratch;
+    std::string_view sanitized = escape_non_tag_angle_brackets(html, scratch);
+    if (sanitized.size() > static_cast<std::size_t>(std::numeric_limits<int>::max())) {
+        return Document(nullptr); // beyond what libxml2 takes in one buffer
+    }
 
     htmlDocPtr doc = htmlReadMemory(
-        sanitized.c_str(),
+        sanitized.data(),
         static_cast<int>(sanitized.size()),
         nullptr,          // URL
         "UTF-8",          // encoding
-        options
+        kParseOptions
     );
 
     if (!doc) {
         return Document(nullptr);
     }
 
-    set_current_doc(doc);
+    attach_attr_cache(doc);
     return Document(doc);
 }
 
@@ -391,8 +442,7 @@ Document::Document(Document&& other) noexcept : doc_(other.doc_) {
 Document& Document::operator=(Document&& other) noexcept {
     if (this == &other) return *this;
     if (doc_) {
-        clear_attr_cache_for_current_doc(doc_);
-        xmlFreeDoc(doc_);
+        release_doc(doc_);
     }
     doc_ = other.doc_;
     other.doc_ = nullptr;
@@ -401,12 +451,121 @@ Document& Document::operator=(Document&& other) noexcept {
 
 Document::~Document() {
     if (doc_) {
-        clear_attr_cache_for_current_doc(doc_);
-        xmlFreeDoc(doc_);
+        release_doc(doc_);
         doc_ = nullptr;
     }
 }
 
+// --- Parser ---
+
+Parser::Parser() {
+    xmlInitParser();
+    ctxt_ = htmlNewParserCtxt();
+}
+
+Parser::Parser(Parser&& other) noexcept
+    : ctxt_(std::exchange(other.ctxt_, nullptr)), sanitized_(std::move(other.sanitized_)) {}
+
+Parser& Parser::operator=(Parser&& other) noexcept {
+    if (this == &other) return *this;
+    if (ctxt_) htmlFreeParserCtxt(ctxt_);
+    ctxt_ = std::exchange(other.ctxt_, nullptr);
+    sanitized_ = std::move(other.sanitized_);
+    return *this;
+}
+
+Parser::~Parser() {
+    if (ctxt_) htmlFreeParserCtxt(ctxt_);
+}
+
+// Parses like Document::parse(); htmlCtxtReadMemory() resets the context.
+Document Parser::parse(std::string_view html) {
+    // htmlReadMemory() and htmlCtxtReadMemory() disagree on empty input.
+    if (!ctxt_ || html.empty()) return Document::parse(html);
+    std::string_view sanitized = escape_non_tag_angle_brackets(html, sanitized_);
+    if (sanitized.size() > static_cast<std::size_t>(std::numeric_limits<int>::max())) {
+        return Document(nullptr);
+    }
+
+    htmlDocPtr doc = htmlCtxtReadMemory(ctxt_,
+                                        sanitized.data(),
+                                        static_cast<int>(sanitized.size()),
+                                        nullptr,
+                                        "UTF-8",
+                                        kParseOptions);
+    if (!doc) return Document(nullptr);
+    attach_attr_cache(doc);
+    return Document(doc);
+}
+
+void Parser::recycle(Document&& document) {
+    Document released = std::move(document);
+}
+
+// --- DocumentBuilder ---
+
+DocumentBuilder::DocumentBuilder() {
+    xmlInitParser();
+    ctxt_ = htmlCreatePushParserCtxt(nullptr, nullptr, nullptr, 0, nullptr, XML_CHAR_ENCODING_UTF8);
+    if (ctxt_) {
+        htmlCtxtUseOptions(ctxt_, kParseOptions);
+    }
+}
+
+DocumentBuilder::DocumentBuilder(DocumentBuilder&& other) noexcept
+    : ctxt_(std::exchange(other.ctxt_, nullptr)),
+      pendingAngle_(std::exchange(other.pendingAngle_, false)),
+      sanitized_(std::move(other.sanitized_)) {}
+
+DocumentBuilder& DocumentBuilder::operator=(DocumentBuilder&& other) noexcept {
+    if (this == &other) return *this;
+    if (ctxt_) {
+        if (ctxt_->myDoc) xmlFreeDoc(ctxt_->myDoc);
+        htmlFreeParserCtxt(ctxt_);
+    }
+    ctxt_ = std::exchange(other.ctxt_, nullptr);
+    pendingAngle_ = std::exchange(other.pendingAngle_, false);
+    sanitized_ = std::move(other.sanitized_);
+    return *this;
+}
+
+DocumentBuilder::~DocumentBuilder() {
+    if (ctxt_) {
+        if (ctxt_->myDoc) xmlFreeDoc(ctxt_->myDoc);
+        htmlFreeParserCtxt(ctxt_);
+    }
+}
+
+// Sanitizes the chunk like Document::parse() and pushes it to the parser.
+void DocumentBuilder::feed(std::string_view chunk) {
+    if (!ctxt_ || chunk.empty()) return;
+    sanitized_.clear();
+    if (pendingAngle_) {
+        sanitized_ += opens_tag(static_cast<unsigned char>(chunk.front())) ? "<" : "&lt;";
+        pendingAngle_ = false;
+    }
+    pendingAngle_ = append_escaped(chunk, sanitized_);
+    if (!sanitized_.empty()) {
+        htmlParseChunk(ctxt_, sanitized_.data(), static_cast<int>(sanitized_.size()), 0);
+    }
+}
+
+Document DocumentBuilder::finish() {
+    if (!ctxt_) return Document(nullptr);
+    if (pendingAngle_) {
+        htmlParseChunk(ctxt_, "&lt;", 4, 0);
+        pendingAngle_ = false;
+    }
+    htmlParseChunk(ctxt_, nullptr, 0, 1);
+    htmlDocPtr doc = ctxt_->myDoc;
+    ctxt_->myDoc = nullptr;
+    htmlFreeParserCtxt(ctxt_);
+    ctxt_ = nullptr;
+    if (!doc) return Document(nullptr);
+    attach_attr_cache(doc);
+    return Document(doc);
+}
+
 NodeView Document::document() const {
     if (!doc_) return {};
     return NodeView(reinterpret_cast<xmlNodePtr>(doc_));
@@ -0,0 +1,126 @@
+/// @file mapped_file.cpp
+/// @brief Read-only file mapping implementation
+///
+/// @copyright The MIT License (MIT)
+/// @copyright Copyright (c) 2025 Parsa Amini
+
+#include "mapped_file.h"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#if defined(_WIN32)
+  #include <windows.h>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+namespace turndown_cpp {
+
+namespace {
+
+#if defined(_WIN32)
+std::string lastError() {
+    DWORD err = GetLastError();
+    if (err == 0) return "unknown error";
+
+    LPSTR buf = nullptr;
+    DWORD len = FormatMessageA(
+        FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS,
+        nullptr,
+        err,
+        MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT),
+        reinterpret_cast<LPSTR>(&buf),
+        0,
+        nullptr
+    );
+    std::string msg = (len && buf) ? std::string(buf, len) : "unknown error";
+    if (buf) LocalFree(buf);
+    return msg;
+}
+#endif
+
+} // namespace
+
+MappedFile::MappedFile(std::filesystem::path const& path) {
+#if defined(_WIN32)
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("cannot open: " + lastError());
+    }
+    LARGE_INTEGER size{};
+    GetFileSizeEx(file, &size);
+    if (size.QuadPart > 0) {
+        HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping) {
+            data_ = static_cast<char const*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+            CloseHandle(mapping);
+        }
+        if (!data_) {
+            std::string error = lastError();
+            CloseHandle(file);
+            throw std::runtime_error("cannot map: " + error);
+        }
+        size_ = static_cast<std::size_t>(size.QuadPart);
+    }
+    CloseHandle(file);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error(std::string("cannot open: ") + std::strerror(errno));
+    }
+    struct stat info {};
+    if (::fstat(fd, &info) != 0) {
+        std::string error = std::strerror(errno);
+        ::close(fd);
+        throw std::runtime_error("cannot stat: " + error);
+    }
+    if (info.st_size > 0) {
+        void* data = ::mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            std::string error = std::strerror(errno);
+            ::close(fd);
+            throw std::runtime_error("cannot map: " + error);
+        }
+        data_ = static_cast<char const*>(data);
+        size_ = static_cast<std::size_t>(info.st_size);
+    }
+    ::close(fd);
+#endif
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0)) {}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        unmap();
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+    }
+    return *this;
+}
+
+MappedFile::~MappedFile() {
+    unmap();
+}
+
+void MappedFile::unmap() {
+    if (!data_) return;
+#if defined(_WIN32)
+    UnmapViewOfFile(data_);
+#else
+    ::munmap(const_cast<char*>(data_), size_);
+#endif
+    data_ = nullptr;
+    size_ = 0;
+}
+
+} // namespace turndown_cpp
@@ -0,0 +1,84 @@
+/// @file markdown_buffer.cpp
+/// @brief Implementation of the pipeline output buffer
+///
+/// @copyright The MIT License (MIT)
+/// @copyright Copyright (c) 2025 Parsa Amini
+
+#include "markdown_buffer.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace turndown_cpp {
+
+namespace {
+
+bool isNewline(char ch) {
+    return ch == '\n' || ch == '\r';
+}
+
+} // namespace
+
+void MarkdownBuffer::append(std::string_view addition) {
+    if (addition.empty()) return;
+    // Text taken by takeSettled() still counts as the outermost segment's.
+    if (segmentEmpty() && !(depth_ == 0 && settled_)) {
+        data_.append(addition);
+        return;
+    }
+
+    std::size_t end = data_.size();
+    while (end > segmentStart_ && isNewline(data_[end - 1])) {
+        --end;
+    }
+    std::size_t begin = 0;
+    while (begin < addition.size() && isNewline(addition[begin])) {
+        ++begin;
+    }
+
+    std::size_t separatorLength = std::min<std::size_t>(2, std::max(data_.size() - end, begin));
+    data_.resize(end);
+    data_.append(separatorLength, '\n');
+    data_.append(addition.substr(begin));
+}
+
+std::size_t MarkdownBuffer::beginSegment() {
+    std::size_t token = segmentStart_;
+    segmentStart_ = data_.size();
+    ++depth_;
+    return token;
+}
+
+std::string MarkdownBuffer::takeSegment(std::size_t token) {
+    std::string segment = data_.substr(segmentStart_);
+    data_.resize(segmentStart_);
+    segmentStart_ = token;
+    --depth_;
+    return segment;
+}
+
+std::string MarkdownBuffer::takeSettled() {
+    if (depth_ != 0) return {};
+    // Joins only rewrite the trailing newlines, and the final trim the
+    // trailing whitespace; everything before them is settled.
+    std::size_t end = data_.size();
+    while (end > 0 && (isNewline(data_[end - 1]) || data_[end - 1] == ' ' || data_[end - 1] == '\t')) {
+        --end;
+    }
+    if (end == 0) return {};
+    std::string settled = data_.substr(0, end);
+    data_.erase(0, end);
+    settled_ = true;
+    return settled;
+}
+
+std::string MarkdownBuffer::release() {
+    std::string result = std::move(data_);
+    data_.clear();
+    segmentStart_ = 0;
+    depth_ = 0;
+    settled_ = false;
+    return result;
+}
+
+} // namespace turndown_cpp
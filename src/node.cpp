@@ -12,7 +12,10 @@
 /// @copyright C++ port copyright (c) 2025 Parsa Amini
 
 #include "node.h"
+#include "collapse_whitespace.h"
 #include "dom_adapter.h"
+#include "dom_backend.h"
+#include "tag_id.h"
 #include "utf8_helpers.h"
 #include "utilities.h"
 
@@ -22,6 +25,10 @@
 #include <cstdint>
 #include <cstring>
 #include <iterator>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 namespace turndown_cpp {
@@ -30,67 +37,6 @@ namespace {
 
 using utf8::CodepointSlice;
 
-// Decodes a single UTF-8 code point starting at `index`. Invalid or truncated
-// sequences degrade to the leading byte so callers keep progressing through
-// malformed input.
-bool decodeCodepoint(std::string const& text, std::size_t index, CodepointSlice& slice) {
-    if (index >= text.size()) return false;
-
-    auto set_result = [&](std::uint32_t cp, std::size_t length) {
-        slice.codepoint = cp;
-        slice.start = index;
-        slice.length = length;
-        return true;
-    };
-
-    unsigned char lead = static_cast<unsigned char>(text[index]);
-
-    // ASCII fast-path.
-    if (utf8::isAsciiLead(lead)) {
-        return set_result(lead, 1);
-    }
-
-    // Determine expected length from the leading byte.
-    std::size_t expected_len = utf8::expectedLength(lead);
-
-    // If the prefix is invalid or truncated, treat as a single byte.
-    if (expected_len == 1 || index + expected_len > text.size()) {
-        return set_result(lead, 1);
-    }
-
-    // Build code point while validating continuation bytes.
-    std::uint32_t codepoint = lead & (utf8::kLeadPayloadMask >> expected_len); // strip leading prefix bits
-    for (std::size_t j = 1; j < expected_len; ++j) {
-        unsigned char cont = static_cast<unsigned char>(text[index + j]);
-        if (!utf8::isContinuation(cont)) {
-            return set_result(lead, 1);
-        }
-        codepoint = (codepoint << 6) | (cont & utf8::kContinuationPayload);
-    }
-
-    // Reject overlong sequences, surrogates, or out-of-range code points.
-    if (utf8::isInvalidCodepoint(codepoint, expected_len)) {
-        return set_result(lead, 1);
-        }
-
-    return set_result(codepoint, expected_len);
-    }
-
-// Decodes an entire UTF-8 string into codepoint slices with byte spans.
-std::vector<CodepointSlice> toCodepoints(std::string const& text) {
-    std::vector<CodepointSlice> codepoints;
-    std::size_t index = 0;
-    while (index < text.size()) {
-        CodepointSlice slice;
-        if (!decodeCodepoint(text, index, slice)) {
-            break;
-        }
-        codepoints.push_back(slice);
-        index += slice.length;
-    }
-    return codepoints;
-}
-
 /**
  * @struct EdgeWhitespaceParts
  * @brief Structured edge whitespace parts
@@ -121,109 +67,58 @@ struct EdgeWhitespaceParts {
  * @param[in] text The string to analyze
  * @return Structured whitespace parts
  */
-EdgeWhitespaceParts computeEdgeWhitespace(std::string const& text) {
+EdgeWhitespaceParts computeEdgeWhitespace(std::string_view text) {
     EdgeWhitespaceParts parts;
-    auto codepoints = toCodepoints(text);
-    if (codepoints.empty()) {
-        return parts;
-    }
+    std::size_t leading = leadingWhitespaceLength(text);
+    std::size_t trailing = leading == text.size() ? 0 : trailingWhitespaceLength(text);
 
-    // Append/prepend helpers keep byte order correct for each side.
-    auto appendLeading = [&](std::string const& bytes, bool isAscii) {
-        parts.leading += bytes;
-        (isAscii ? parts.leadingAscii : parts.leadingNonAscii) += bytes;
-    };
-    auto prependTrailing = [&](std::string const& bytes, bool isAscii) {
-        parts.trailing = bytes + parts.trailing;
-        if (isAscii) {
-            parts.trailingAscii = bytes + parts.trailingAscii;
-        } else {
-            parts.trailingNonAscii = bytes + parts.trailingNonAscii;
+    // Sorts the code points of an edge into its ASCII and other whitespace.
+    auto split = [text](std::size_t begin, std::size_t end, std::string& ascii, std::string& nonAscii) {
+        CodepointSlice slice;
+        for (std::size_t index = begin; index < end && utf8::decodeAt(text, index, slice); index += slice.length) {
+            (isAsciiWhitespaceCodePoint(slice.codepoint) ? ascii : nonAscii).append(text.substr(index, slice.length));
         }
     };
-
-    auto is_ws = [](CodepointSlice const& s) {
-        return isUnicodeWhitespace(s.codepoint);
-    };
-
-    // Locate the span of leading whitespace.
-    auto leading_end = std::find_if_not(codepoints.begin(), codepoints.end(), is_ws);
-
-    // Collect leading whitespace bytes from the front.
-    std::for_each(codepoints.begin(), leading_end, [&](CodepointSlice const& slice) {
-        std::string bytes = text.substr(slice.start, slice.length);
-        appendLeading(bytes, isAsciiWhitespaceCodePoint(slice.codepoint));
-    });
-
-    // If all codepoints were whitespace, we are done.
-    if (leading_end == codepoints.end()) {
-        return parts;
-    }
-
-    // Locate the span of trailing whitespace.
-    auto trailing_start = std::find_if_not(codepoints.rbegin(), codepoints.rend(), is_ws);
-
-    // Collect trailing whitespace bytes from the back.
-    std::for_each(codepoints.rbegin(), trailing_start, [&](CodepointSlice const& slice) {
-        std::string bytes = text.substr(slice.start, slice.length);
-        prependTrailing(bytes, isAsciiWhitespaceCodePoint(slice.codepoint));
-    });
-
+    parts.leading.assign(text.substr(0, leading));
+    split(0, leading, parts.leadingAscii, parts.leadingNonAscii);
+    parts.trailing.assign(text.substr(text.size() - trailing));
+    split(text.size() - trailing, text.size(), parts.trailingAscii, parts.trailingNonAscii);
     return parts;
 }
 
 // True if the string begins with an ASCII space.
-bool startsWithAsciiSpace(std::string const& text) {
+bool startsWithAsciiSpace(std::string_view text) {
     return !text.empty() && text.front() == ' ';
 }
 
 // True if the string ends with an ASCII space.
-bool endsWithAsciiSpace(std::string const& text) {
+bool endsWithAsciiSpace(std::string_view text) {
     return !text.empty() && text.back() == ' ';
 }
 
-// Returns the zero-based index of a node within its parent, or -1 if absent.
-int childIndex(dom::NodeView node) {
-    auto parent = node.parent();
-    if (!parent.is_element()) return -1;
-    auto range = parent.child_range();
-    int index = 0;
-    for (auto it = range.begin(); it != range.end(); ++it, ++index) {
-        if (*it == node) return index;
-    }
-    return -1;
-}
-
 // Returns the adjacent sibling on the requested side, or empty if none.
 dom::NodeView adjacentSibling(dom::NodeView node, FlankSide side) {
     auto parent = node.parent();
     if (!parent.is_element()) return {};
-    auto range = parent.child_range();
+    if (side == FlankSide::Right) return node.next_sibling();
+    // Views have no previous-sibling link, so the left side is a scan.
     dom::NodeView previous{};
-    bool found = false;
-    for (auto child : range) {
-        if (found) {
-            // We are at the right sibling.
-            return child;
-        }
-        if (child == node) {
-            if (side == FlankSide::Left) {
-                return previous;
-            }
-            found = true;
-        } else {
-            previous = child;
-        }
+    for (auto child : parent.child_range()) {
+        if (child == node) return previous;
+        previous = child;
     }
     return {}; // not found or no sibling on requested side
 }
 
 // Returns the text content of a sibling node (empty if null).
-std::string siblingTextContent(dom::NodeView node) {
-    if (!node) return "";
-    return getNodeText(node);
+std::string_view siblingTextContent(dom::NodeView node, CollapsedWhitespace const& collapsed, std::string& scratch) {
+    if (!node) return {};
+    return getNodeTextView(node, collapsed, scratch);
 }
 
+// Used by the overloads that read text exactly as parsed.
+CollapsedWhitespace const kUncollapsed{};
+
 } // namespace
 
 /**
@@ -253,23 +148,29 @@ static std::string encodeNbsp(std::string const& text) {
 
 /// Compute flanking whitespace for a node.
 FlankingWhitespace flankingWhitespace(dom::NodeView node, bool preformattedCode) {
+    return flankingWhitespace(node, preformattedCode, kUncollapsed);
+}
+
+/// Compute flanking whitespace for a node from collapsed text.
+FlankingWhitespace flankingWhitespace(dom::NodeView node, bool preformattedCode, CollapsedWhitespace const& collapsed) {
     FlankingWhitespace ws{"", ""};
     if (!node) return ws;
     if (isBlock(node) || (preformattedCode && isCodeNode(node))) {
         return ws;
     }
 
-    std::string text = getNodeText(node);
+    std::string scratch;
+    std::string_view text = getNodeTextView(node, collapsed, scratch);
     if (text.empty()) return ws;
 
     EdgeWhitespaceParts edges = computeEdgeWhitespace(text);
     ws.leading = edges.leading;
     ws.trailing = edges.trailing;
 
-    if (!edges.leadingAscii.empty() && isFlankedByWhitespace(FlankSide::Left, node, preformattedCode)) {
+    if (!edges.leadingAscii.empty() && isFlankedByWhitespace(FlankSide::Left, node, preformattedCode, collapsed)) {
         ws.leading = edges.leadingNonAscii;
     }
-    if (!edges.trailingAscii.empty() && isFlankedByWhitespace(FlankSide::Right, node, preformattedCode)) {
+    if (!edges.trailingAscii.empty() && isFlankedByWhitespace(FlankSide::Right, node, preformattedCode, collapsed)) {
         ws.trailing = edges.trailingNonAscii;
     }
 
@@ -280,18 +181,18 @@ FlankingWhitespace flankingWhitespace(dom::NodeView node, bool preformattedCode)
 
 /// Determine if a node is blank (contains only whitespace).
 bool isBlank(dom::NodeView node) {
+    return isBlank(node, kUncollapsed);
+}
+
+/// Determine if a node is blank, reading collapsed text.
+bool isBlank(dom::NodeView node, CollapsedWhitespace const& collapsed) {
     if (!node) return false;
     if (node.is_element()) {
         if (isVoid(node) || isMeaningfulWhenBlank(node)) return false;
     }
 
-    std::string text = getNodeText(node);
-    auto codepoints = toCodepoints(text);
-    for (auto const& slice : codepoints) {
-        if (!isUnicodeWhitespace(slice.codepoint)) {
-            return false;
-        }
-    }
+    std::string scratch;
+    if (!isWhitespaceOnly(getNodeTextView(node, collapsed, scratch))) return false;
 
     if (node.is_element()) {
         if (hasVoid(node) || hasMeaningfulWhenBlank(node)) return false;
@@ -301,6 +202,11 @@ bool isBlank(dom::NodeView node) {
 
 /// Check if node is flanked by whitespace on one side.
 bool isFlankedByWhitespace(FlankSide side, dom::NodeView node, bool preformattedCode) {
+    return isFlankedByWhitespace(side, node, preformattedCode, kUncollapsed);
+}
+
+/// Check if node is flanked by whitespace on one side, reading collapsed text.
+bool isFlankedByWhitespace(FlankSide side, dom::NodeView node, bool preformattedCode, CollapsedWhitespace const& collapsed) {
     dom::NodeView sibling = adjacentSibling(node, side);
     if (!sibling) return false;
 
@@ -317,24 +223,329 @@ bool isFlankedByWhitespace(FlankSide side, dom::NodeView node, bool preformatted
         return false;
     }
 
-    std::string text = siblingTextContent(sibling);
+    std::string scratch;
+    std::string_view text = siblingTextContent(sibling, collapsed, scratch);
     if (text.empty()) return false;
     return (side == FlankSide::Left) ? endsWithAsciiSpace(text) : startsWithAsciiSpace(text);
 }
 
 /// Analyze a node and compute all metadata.
 NodeMetadata analyzeNode(dom::NodeView node, bool preformattedCode) {
+    return analyzeNode(node, preformattedCode, kUncollapsed);
+}
+
+/// Analyze a node against the collapse result of the current conversion.
+NodeMetadata analyzeNode(dom::NodeView node, bool preformattedCode, CollapsedWhitespace const& collapsed) {
     NodeMetadata meta;
     if (!node) return meta;
     meta.isBlock = isBlock(node);
     meta.isCode = isCodeNode(node);
-    meta.isBlank = isBlank(node);
+    meta.isBlank = isBlank(node, collapsed);
     meta.isVoid = isVoid(node);
     meta.isMeaningfulWhenBlank = isMeaningfulWhenBlank(node);
     meta.hasMeaningfulWhenBlank = hasMeaningfulWhenBlank(node);
     meta.hasVoidDescendant = hasVoid(node);
-    meta.flankingWhitespace = flankingWhitespace(node, preformattedCode);
+    meta.flankingWhitespace = flankingWhitespace(node, preformattedCode, collapsed);
+    return meta;
+}
+
+namespace {
+
+// True for the node types whose text is read directly (text, whitespace, CDATA).
+bool isTextType(dom::NodeType type) {
+    return type == dom::NodeType::Text || type == dom::NodeType::Whitespace || type == dom::NodeType::CData;
+}
+
+} // namespace
+
+// Byte lengths of the leading and trailing Unicode whitespace of a text,
+// as computeEdgeWhitespace() splits it; a blank text is all leading.
+static std::pair<std::size_t, std::size_t> edgeWhitespaceLengths(std::string_view text) {
+    std::size_t leading = leadingWhitespaceLength(text);
+    if (leading == text.size()) return {leading, 0};
+    return {leading, trailingWhitespaceLength(text)};
+}
+
+/// Extend a whitespace span by another span of the storage, copying it to
+/// the end of the storage first unless it already ends there.
+TextSpan NodeTable::appendWhitespace(TextSpan span, TextSpan piece) {
+    if (piece.length == 0) return span;
+    if (span.length == 0) return piece;
+    if (span.offset + span.length != whitespace_.size()) {
+        auto copyFrom = span.offset;
+        span.offset = static_cast<std::uint32_t>(whitespace_.size());
+        whitespace_.append(whitespace_, copyFrom, span.length);
+    }
+    // Positions rather than views: the append may reallocate the storage.
+    whitespace_.append(whitespace_, piece.offset, piece.length);
+    span.length += piece.length;
+    return span;
+}
+
+/// Copy whitespace from outside the table into the storage.
+TextSpan NodeTable::storeWhitespace(std::string_view text) {
+    TextSpan span{static_cast<std::uint32_t>(whitespace_.size()), static_cast<std::uint32_t>(text.size())};
+    whitespace_.append(text);
+    return span;
+}
+
+namespace {
+
+dom::NodeView asView(dom::NodeView node) {
+    return node;
+}
+
+dom::NodeView asView(dom::detail::BackendAccess::Node node) {
+    return dom::detail::BackendAccess::wrap(node);
+}
+
+// Whether a pruned element holds anything that keeps it from being blank:
+// text other than Unicode whitespace, or a void or meaningful element.
+// Stops at the first such node, usually the element's first child.
+template <dom::DOMNode Node>
+bool hasContent(Node element) {
+    Node node = element.first_child();
+    while (node) {
+        if (isTextType(node.type())) {
+            if (!isWhitespaceOnly(node.text())) return true;
+        } else if (node.type() == dom::NodeType::Element) {
+            dom::TagId tag = node.tag_id();
+            if (dom::kVoidTags.contains(tag) || dom::kMeaningfulWhenBlankTags.contains(tag)) return true;
+            if (Node child = node.first_child()) {
+                node = child;
+                continue;
+            }
+        }
+        while (node != element && !node.next_sibling()) {
+            node = node.parent();
+        }
+        node = node == element ? Node{} : node.next_sibling();
+    }
+    return false;
+}
+
+} // namespace
+
+// Preorder pass: number the nodes and link the tree. Pruned elements are
+// added without their descendants.
+template <dom::DOMNode Node>
+void NodeTable::numberNodes(Node root, dom::TagSet const& pruned) {
+    auto addNode = [&](Node node, std::uint32_t parent, std::uint32_t previous) {
+        NodeInfo info{.node = asView(node), .parent = parent, .firstChild = npos, .previousSibling = previous, .nextSibling = npos};
+        info.type = node.type();
+        info.tag = node.tag_id();
+        info.parentIsElement = parent != npos && nodes_[parent].type == dom::NodeType::Element;
+        info.isBlock = dom::kBlockTags.contains(info.tag);
+        info.isVoid = dom::kVoidTags.contains(info.tag);
+        info.isMeaningfulWhenBlank = dom::kMeaningfulWhenBlankTags.contains(info.tag);
+        if (previous != npos) {
+            NodeInfo const& before = nodes_[previous];
+            info.elementIndex = before.elementIndex + (before.type == dom::NodeType::Element ? 1 : 0);
+        }
+        if (parent == npos) {
+            info.isCode = isCodeNode(info.node);
+            for (dom::NodeView up = info.node; up; up = up.parent()) {
+                if (up.tag_id() == dom::TagId::Pre) info.isPre = true;
+                if (up != info.node && (up.tag_id() == dom::TagId::Ul || up.tag_id() == dom::TagId::Ol)) ++info.listDepth;
+            }
+        } else {
+            NodeInfo const& up = nodes_[parent];
+            info.isPre = up.isPre || info.tag == dom::TagId::Pre;
+            info.listDepth = up.listDepth + (up.tag == dom::TagId::Ul || up.tag == dom::TagId::Ol ? 1 : 0);
+            info.isCode = nodes_[parent].isCode || info.tag == dom::TagId::Code;
+            info.isPruned = pruned.contains(info.tag);
+            // Inert content is not part of the document at all.
+            info.hasPrunedContent = info.isPruned && !dom::kInertTags.contains(info.tag) && hasContent(node);
+        }
+        nodes_.push_back(std::move(info));
+        return static_cast<std::uint32_t>(nodes_.size() - 1);
+    };
+
+    addNode(root, npos, npos);
+    Node node = root;
+    std::uint32_t current = 0;
+    while (true) {
+        Node child = nodes_[current].isPruned ? Node{} : node.first_child();
+        if (child) {
+            std::uint32_t index = addNode(child, current, npos);
+            nodes_[current].firstChild = index;
+            current = index;
+            node = child;
+            continue;
+        }
+        Node sibling;
+        while (current != 0 && !(sibling = node.next_sibling())) {
+            current = nodes_[current].parent;
+            node = node.parent();
+        }
+        if (current == 0) break;
+        std::uint32_t index = addNode(sibling, nodes_[current].parent, current);
+        nodes_[current].nextSibling = index;
+        current = index;
+        node = sibling;
+    }
+}
+
+/// Annotate every node of the tree in two non-recursive passes.
+NodeTable::NodeTable(dom::NodeView root, CollapsedWhitespace const& collapsed, bool preformattedCode,
+                     std::pmr::memory_resource* memory)
+    : nodes_(memory), whitespace_(memory), preformattedCode_(preformattedCode), byHandle_(memory) {
+    if (!root) return;
+
+    // Walk backend trees as backend nodes, so navigation is not dispatched
+    // through the facade for every step.
+    using Access = dom::detail::BackendAccess;
+    if (Access::isBackendNode(root)) {
+        numberNodes(Access::unwrap(root), collapsed.pruned());
+    } else {
+        numberNodes(root, collapsed.pruned());
+    }
+
+    // Bottom-up pass: descendants always have larger indices than their
+    // ancestors, so walking backwards sees every child before its parent.
+    for (std::size_t i = nodes_.size(); i-- > 0;) {
+        NodeInfo& info = nodes_[i];
+        auto ordinal = static_cast<std::uint32_t>(i);
+        if (collapsed.isOmitted(ordinal)) {
+            continue;
+        }
+
+        // A pruned element is a leaf whose text is that of its content.
+        if (isTextType(info.type) || info.isPruned) {
+            std::string_view text = info.isPruned ? collapsed.prunedText(ordinal) : collapsed.text(ordinal, info.node);
+            if (text.empty()) continue;
+            auto [leading, trailing] = edgeWhitespaceLengths(text);
+            info.textLength = text.size();
+            info.firstChar = text.front();
+            info.lastChar = text.back();
+            info.isWhitespaceOnly = leading == text.size();
+            info.leadingWhitespace = storeWhitespace(text.substr(0, leading));
+            info.trailingWhitespace = storeWhitespace(text.substr(text.size() - trailing));
+            continue;
+        }
+
+        if (info.type != dom::NodeType::Element && info.type != dom::NodeType::Document) {
+            continue;
+        }
+
+        std::uint32_t lastElement = npos;
+        for (std::uint32_t c = info.firstChild; c != npos; c = nodes_[c].nextSibling) {
+            NodeInfo const& child = nodes_[c];
+            if (child.type == dom::NodeType::Element) lastElement = c;
+            if (info.type == dom::NodeType::Element && child.type == dom::NodeType::Element) {
+                info.hasPrunedContent = info.hasPrunedContent || child.hasPrunedContent;
+                info.hasVoidDescendant = info.hasVoidDescendant || child.isVoid || child.hasVoidDescendant;
+                info.hasMeaningfulWhenBlank = info.hasMeaningfulWhenBlank ||
+                                              child.isMeaningfulWhenBlank || child.hasMeaningfulWhenBlank;
+            }
+            if (child.textLength == 0) continue;
+
+            if (info.textLength == 0) info.firstChar = child.firstChar;
+            info.lastChar = child.lastChar;
+            info.textLength += child.textLength;
+
+            // A blank child's whole text sits in its leading whitespace.
+            // Spans taken over from a child share its bytes; only extended
+            // spans are copied.
+            if (info.isWhitespaceOnly) {
+                info.leadingWhitespace = appendWhitespace(info.leadingWhitespace, child.leadingWhitespace);
+                if (!child.isWhitespaceOnly) {
+                    info.isWhitespaceOnly = false;
+                    info.trailingWhitespace = child.trailingWhitespace;
+                }
+            } else if (child.isWhitespaceOnly) {
+                info.trailingWhitespace = appendWhitespace(info.trailingWhitespace, child.leadingWhitespace);
+            } else {
+                info.trailingWhitespace = child.trailingWhitespace;
+            }
+        }
+        if (lastElement != npos) nodes_[lastElement].isLastElement = true;
+    }
+}
+
+/// Find the index of a node, building the handle map once, on first use.
+std::uint32_t NodeTable::find(dom::NodeView node) const {
+    std::call_once(*byHandleBuilt_, [this] {
+        byHandle_.reserve(nodes_.size());
+        for (std::size_t i = 0; i < nodes_.size(); ++i) {
+            byHandle_.emplace(nodes_[i].node.handle(), static_cast<std::uint32_t>(i));
+        }
+    });
+    auto it = byHandle_.find(node.handle());
+    return it == byHandle_.end() ? npos : it->second;
+}
+
+/// Determine if an annotated node is blank.
+bool NodeTable::isBlank(std::uint32_t index) const {
+    NodeInfo const& info = nodes_[index];
+    if (info.type == dom::NodeType::Element && (info.isVoid || info.isMeaningfulWhenBlank)) return false;
+    if (!info.isWhitespaceOnly) return false;
+    if (info.type == dom::NodeType::Element && (info.hasVoidDescendant || info.hasMeaningfulWhenBlank)) return false;
+    return !info.hasPrunedContent;
+}
+
+/// Check if an annotated node is flanked by whitespace on one side.
+bool NodeTable::isFlankedByWhitespace(FlankSide side, std::uint32_t index) const {
+    NodeInfo const& info = nodes_[index];
+    if (!info.parentIsElement) return false;
+    std::uint32_t s = side == FlankSide::Left ? info.previousSibling : info.nextSibling;
+    if (s == npos) return false;
+
+    NodeInfo const& sibling = nodes_[s];
+    if (sibling.type == dom::NodeType::Element) {
+        if (preformattedCode_ && sibling.isCode) return false;
+        if (sibling.isBlock) return false;
+    } else if (!isTextType(sibling.type)) {
+        return false;
+    }
+
+    if (sibling.textLength == 0) return false;
+    return (side == FlankSide::Left) ? sibling.lastChar == ' ' : sibling.firstChar == ' ';
+}
+
+/// Compute flanking whitespace for an annotated node.
+FlankingWhitespace NodeTable::flankingWhitespace(std::uint32_t index) const {
+    FlankingWhitespace ws{"", ""};
+    NodeInfo const& info = nodes_[index];
+    if (info.isBlock || (preformattedCode_ && info.isCode)) return ws;
+    if (info.textLength == 0) return ws;
+
+    // Only the edges matter, so any non-whitespace byte can stand in for
+    // the middle of the text.
+    std::string edgesOnly(whitespace(info.leadingWhitespace));
+    if (!info.isWhitespaceOnly) {
+        edgesOnly.push_back('x');
+        edgesOnly.append(whitespace(info.trailingWhitespace));
+    }
+    EdgeWhitespaceParts edges = computeEdgeWhitespace(edgesOnly);
+    ws.leading = edges.leading;
+    ws.trailing = edges.trailing;
+
+    if (!edges.leadingAscii.empty() && isFlankedByWhitespace(FlankSide::Left, index)) {
+        ws.leading = edges.leadingNonAscii;
+    }
+    if (!edges.trailingAscii.empty() && isFlankedByWhitespace(FlankSide::Right, index)) {
+        ws.trailing = edges.trailingNonAscii;
+    }
+
+    ws.leading = encodeNbsp(ws.leading);
+    ws.trailing = encodeNbsp(ws.trailing);
+    return ws;
+}
+
+/// Assemble the metadata of an annotated node.
+NodeMetadata NodeTable::metadata(std::uint32_t index) const {
+    NodeInfo const& info = nodes_[index];
+    NodeMetadata meta;
+    meta.isBlock = info.isBlock;
+    meta.isCode = info.isCode;
+    meta.isBlank = isBlank(index);
+    meta.isVoid = info.isVoid;
+    meta.isMeaningfulWhenBlank = info.isMeaningfulWhenBlank;
+    meta.hasMeaningfulWhenBlank = info.hasMeaningfulWhenBlank;
+    meta.hasVoidDescendant = info.hasVoidDescendant;
+    meta.flankingWhitespace = flankingWhitespace(index);
     return meta;
 }
 
-} // namespace turndown_cpp
\ No newline at end of file
+} // namespace turndown_cpp
@@ -14,14 +14,18 @@
 #include "rules.h"
 #include "dom_adapter.h"
 #include "node.h"
+#include "tag_id.h"
 #include "turndown.h"
 #include "utilities.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cctype>
 #include <cstddef>
+#include <cstdint>
 #include <cstring>
 #include <functional>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -39,39 +43,54 @@ std::vector<std::string> normalizeTags(std::vector<std::string> tags) {
     return tags;
 }
 
+// Tags a tag-name filter can match; empty (any element) when a name has no
+// TagId, i.e. the filter must also see custom elements.
+dom::TagSet declaredTags(std::vector<std::string> const& filters) {
+    dom::TagSet tags;
+    for (auto const& value : filters) {
+        dom::TagId id = dom::tagIdFromName(value);
+        if (id == dom::TagId::Unknown) return {};
+        tags.insert(id);
+    }
+    return tags;
+}
+
 } // namespace
 
 /// Initialize the Rules object with built-in rules.
 Rules::Rules(TurndownOptions const& opts)
-    : options(opts) {
+    : options(std::make_shared<TurndownOptions const>(opts)) {
     blankRule = Rule{
-        [](dom::NodeView, TurndownOptions const&) { return true; },
-        [this](std::string const& content, dom::NodeView node, TurndownOptions const&) {
+        .filter = [](dom::NodeView, TurndownOptions const&) { return true; },
+        .replacement = [](std::string const& content, dom::NodeView node, TurndownOptions const& options) {
             return options.blankReplacement(content, node);
         },
-        nullptr,
-        "blank"
+        .key = "blank",
+        .cacheable = true
     };
 
     keepReplacementRule = Rule{
-        [](dom::NodeView, TurndownOptions const&) { return true; },
-        [this](std::string const& content, dom::NodeView node, TurndownOptions const&) {
+        .filter = [](dom::NodeView, TurndownOptions const&) { return true; },
+        .replacement = [](std::string const& content, dom::NodeView node, TurndownOptions const& options) {
             return options.keepReplacement(content, node);
         },
-        nullptr,
-        "keep-replacement"
+        .key = "keep-replacement",
+        .cacheable = true
     };
 
     defaultRule = Rule{
-        [](dom::NodeView, TurndownOptions const&) { return true; },
-        [this](std::string const& content, dom::NodeView node, TurndownOptions const&) {
+        .filter = [](dom::NodeView, TurndownOptions const&) { return true; },
+        .replacement = [](std::string const& content, dom::NodeView node, TurndownOptions const& options) {
             return options.defaultReplacement(content, node);
         },
-        nullptr,
-        "default"
+        .key = "default",
+        .cacheable = true
     };
 }
 
+// The built-in rules capture nothing, so a member-wise copy is complete.
+Rules::Rules(Rules const& other) = default;
+
 // Defaulted destructor for Rules.
 Rules::~Rules() = default;
 
@@ -79,51 +98,70 @@ Rules::~Rules() = default;
 void Rules::addRule(std::string const& key, Rule rule) {
     rule.key = key;
     rulesArray.insert(rulesArray.begin(), std::move(rule));
+    compiled = false;
 }
 
 // Builds a filter that matches element tags against provided names.
 std::function<bool(dom::NodeView, TurndownOptions const&)> Rules::makeTagFilter(std::vector<std::string> const& filters) const {
-    auto normalized = normalizeTags(filters);
-    return [normalized](dom::NodeView node, TurndownOptions const&) {
+    // Known tags are matched by id; only names outside the TagId table
+    // (custom elements) need the node's name to be materialized.
+    dom::TagSet ids;
+    std::vector<std::string> names;
+    for (auto& value : normalizeTags(filters)) {
+        dom::TagId id = dom::tagIdFromName(value);
+        if (id != dom::TagId::Unknown) {
+            ids.insert(id);
+        } else {
+            names.push_back(std::move(value));
+        }
+    }
+    return [ids, names](dom::NodeView node, TurndownOptions const&) {
         if (!node || !node.is_element()) return false;
-        std::string tag = node.tag_name();
-        for (auto const& value : normalized) {
-            if (value == tag) {
-                return true;
-            }
+        dom::TagId id = node.tag_id();
+        if (id != dom::TagId::Unknown) {
+            return ids.contains(id);
         }
-        return false;
+        if (names.empty()) return false;
+        std::string tag = node.tag_name();
+        return std::find(names.begin(), names.end(), tag) != names.end();
     };
 }
 
 // Adds a keep rule with a generated key suffix.
-void Rules::addKeepRule(std::function<bool(dom::NodeView, TurndownOptions const&)> filter, std::string const& keySuffix) {
+void Rules::addKeepRule(std::function<bool(dom::NodeView, TurndownOptions const&)> filter, std::string const& keySuffix, dom::TagSet tags) {
     Rule rule;
     rule.key = "keep-" + keySuffix;
     rule.filter = std::move(filter);
     rule.replacement = keepReplacementRule.replacement;
+    rule.tags = tags;
+    // A predicate may look anywhere; a tag name only at the element.
+    rule.cacheable = !tags.empty();
     keepRules.insert(keepRules.begin(), std::move(rule));
+    compiled = false;
 }
 
 // Adds a remove rule with a generated key suffix.
-void Rules::addRemoveRule(std::function<bool(dom::NodeView, TurndownOptions const&)> filter, std::string const& keySuffix) {
+void Rules::addRemoveRule(std::function<bool(dom::NodeView, TurndownOptions const&)> filter, std::string const& keySuffix, dom::TagSet tags) {
     Rule rule;
     rule.key = "remove-" + keySuffix;
     rule.filter = std::move(filter);
     rule.replacement = [](std::string const&, dom::NodeView, TurndownOptions const&) {
         return std::string();
     };
+    rule.tags = tags;
+    rule.cacheable = !tags.empty();
     removeRules.insert(removeRules.begin(), std::move(rule));
+    compiled = false;
 }
 
 // Keep rule for a single tag.
 void Rules::keep(std::string const& filter) {
-    addKeepRule(makeTagFilter({filter}), filter);
+    addKeepRule(makeTagFilter({filter}), filter, declaredTags({filter}));
 }
 
 // Keep rule for multiple tags.
 void Rules::keep(std::vector<std::string> const& filters) {
-    addKeepRule(makeTagFilter(filters), "multi");
+    addKeepRule(makeTagFilter(filters), "multi", declaredTags(filters));
 }
 
 // Keep rule using a custom predicate.
@@ -133,12 +171,12 @@ void Rules::keep(std::function<bool(dom::NodeView, TurndownOptions const&)> filt
 
 // Remove rule for a single tag.
 void Rules::remove(std::string const& filter) {
-    addRemoveRule(makeTagFilter({filter}), filter);
+    addRemoveRule(makeTagFilter({filter}), filter, declaredTags({filter}));
 }
 
 // Remove rule for multiple tags.
 void Rules::remove(std::vector<std::string> const& filters) {
-    addRemoveRule(makeTagFilter(filters), "multi");
+    addRemoveRule(makeTagFilter(filters), "multi", declaredTags(filters));
 }
 
 // Remove rule using a custom predicate.
@@ -146,26 +184,130 @@ void Rules::remove(std::function<bool(dom::NodeView, TurndownOptions const&)> fi
     addRemoveRule(std::move(filter), "custom");
 }
 
+// Prefers the traversal filter when the caller has a traversal context.
+bool Rules::matches(Rule const& rule, dom::NodeView node, TurndownOptions const& opts, TraversalContext const* traversal) const {
+    if (traversal && rule.traversalFilter) return rule.traversalFilter(node, opts, *traversal);
+    return rule.filter && rule.filter(node, opts);
+}
+
 // Returns the first rule whose filter matches the node, or nullptr.
-Rule const* Rules::findRule(std::vector<Rule> const& candidates, dom::NodeView node) const {
+Rule const* Rules::findRule(std::vector<Rule> const& candidates, dom::NodeView node, TurndownOptions const& opts,
+                            TraversalContext const* traversal) const {
     for (auto const& rule : candidates) {
-        if (rule.filter(node, options)) {
+        if (matches(rule, node, opts, traversal)) {
             return &rule;
         }
     }
     return nullptr;
 }
 
+// Maps a combined index onto rulesArray, keepRules and removeRules.
+Rule const& Rules::ruleAt(std::uint32_t index) const {
+    if (index < rulesArray.size()) return rulesArray[index];
+    index -= static_cast<std::uint32_t>(rulesArray.size());
+    if (index < keepRules.size()) return keepRules[index];
+    index -= static_cast<std::uint32_t>(keepRules.size());
+    return removeRules[index];
+}
+
+// Groups rule indices by tag, keeping the scan order within each tag.
+void Rules::compile() {
+    std::size_t total = rulesArray.size() + keepRules.size() + removeRules.size();
+    dispatch.clear();
+    for (std::size_t tag = 0; tag < dom::kTagCount; ++tag) {
+        dispatchOffsets[tag] = static_cast<std::uint32_t>(dispatch.size());
+        for (std::uint32_t index = 0; index < total; ++index) {
+            dom::TagSet const& tags = ruleAt(index).tags;
+            if (tags.empty() || tags.contains(static_cast<dom::TagId>(tag))) {
+                dispatch.push_back(index);
+            }
+        }
+    }
+    dispatchOffsets[dom::kTagCount] = static_cast<std::uint32_t>(dispatch.size());
+
+    // A tag is prunable when only remove rules are among its candidates,
+    // one of them naming the tag, or when it is inert and nothing claims it.
+    auto const kept = static_cast<std::uint32_t>(rulesArray.size() + keepRules.size());
+    prunedTags_ = {};
+    for (std::size_t tag = 1; tag < dom::kTagCount; ++tag) {
+        bool claimed = false;
+        bool removed = false;
+        for (std::uint32_t i = dispatchOffsets[tag]; i < dispatchOffsets[tag + 1] && !claimed; ++i) {
+            if (dispatch[i] < kept) {
+                claimed = true;
+            } else if (!ruleAt(dispatch[i]).tags.empty()) {
+                removed = true;
+            }
+        }
+        auto id = static_cast<dom::TagId>(tag);
+        if (!claimed && (removed || dom::kInertTags.contains(id))) prunedTags_.insert(id);
+    }
+    compiled = true;
+    static std::atomic<std::uint64_t> nextRevision{1};
+    compiledRevision = nextRevision.fetch_add(1, std::memory_order_relaxed);
+}
+
+// Returns the first matching rule in priority order, using the dispatch
+// index when it is current.
+Rule const* Rules::findMatchingRule(dom::NodeView node, TurndownOptions const& opts, TraversalContext const* traversal) const {
+    if (!compiled) {
+        if (auto* rule = findRule(rulesArray, node, opts, traversal)) return rule;
+        if (auto* rule = findRule(keepRules, node, opts, traversal)) return rule;
+        return findRule(removeRules, node, opts, traversal);
+    }
+
+    auto tag = static_cast<std::size_t>(node.tag_id());
+    for (std::uint32_t i = dispatchOffsets[tag]; i < dispatchOffsets[tag + 1]; ++i) {
+        Rule const& rule = ruleAt(dispatch[i]);
+        if (matches(rule, node, opts, traversal)) {
+            return &rule;
+        }
+    }
+    return nullptr;
+}
+
+/// Check the candidates forNode() tried before settling on a rule.
+bool Rules::consultsUncacheable(dom::TagId tag, Rule const& rule) const {
+    if (!rule.cacheable) return true;
+    if (&rule == &blankRule) return false; // Chosen before any filter runs
+    if (!compiled) return true;
+    auto index = static_cast<std::size_t>(tag);
+    for (std::uint32_t i = dispatchOffsets[index]; i < dispatchOffsets[index + 1]; ++i) {
+        Rule const& candidate = ruleAt(dispatch[i]);
+        if (&candidate == &rule) return false;
+        if (!candidate.cacheable) return true;
+    }
+    return false;
+}
+
 /// Find the appropriate rule for a node.
 Rule const& Rules::forNode(dom::NodeView node) const {
     if (!isVoid(node) && isBlank(node)) {
         return blankRule;
     }
 
-    if (auto* rule = findRule(rulesArray, node)) return *rule;
-    if (auto* rule = findRule(keepRules, node)) return *rule;
-    if (auto* rule = findRule(removeRules, node)) return *rule;
+    if (auto* rule = findMatchingRule(node, *options, nullptr)) return *rule;
+    return defaultRule;
+}
+
+/// Find the appropriate rule for a node using precomputed metadata.
+Rule const& Rules::forNode(dom::NodeView node, NodeMetadata const& meta) const {
+    if (!meta.isVoid && meta.isBlank) {
+        return blankRule;
+    }
+
+    if (auto* rule = findMatchingRule(node, *options, nullptr)) return *rule;
+    return defaultRule;
+}
+
+/// Find the appropriate rule for a node being converted.
+Rule const& Rules::forNode(dom::NodeView node, NodeMetadata const& meta, TurndownOptions const& opts,
+                           TraversalContext const& traversal) const {
+    if (!meta.isVoid && meta.isBlank) {
+        return blankRule;
+    }
 
+    if (auto* rule = findMatchingRule(node, opts, &traversal)) return *rule;
     return defaultRule;
 }
 
@@ -0,0 +1,67 @@
+/// @file tag_id.cpp
+/// @brief Name lookup for interned HTML tag identifiers
+///
+/// @copyright The MIT License (MIT)
+/// @copyright Copyright (c) 2025 Parsa Amini
+
+#include "tag_id.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <string_view>
+
+namespace turndown_cpp::dom {
+
+namespace {
+
+// Names indexed by TagId; entry 0 belongs to TagId::Unknown.
+constexpr std::array<std::string_view, kTagCount> kTagNames = {
+    std::string_view{},
+#define TURNDOWN_TAG_NAME(id, name) std::string_view{name},
+    TURNDOWN_TAG_LIST(TURNDOWN_TAG_NAME)
+#undef TURNDOWN_TAG_NAME
+};
+
+static_assert(kTagCount <= 256, "TagId must fit in its underlying type");
+static_assert(std::is_sorted(kTagNames.begin() + 1, kTagNames.end()),
+              "TURNDOWN_TAG_LIST must be sorted by name");
+
+constexpr char toLowerAscii(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+// Three-way comparison of a lowercase table name against a name of any case.
+int compareName(std::string_view lowercase, std::string_view name) {
+    std::size_t length = std::min(lowercase.size(), name.size());
+    for (std::size_t i = 0; i < length; ++i) {
+        char c = toLowerAscii(name[i]);
+        if (lowercase[i] != c) {
+            return lowercase[i] < c ? -1 : 1;
+        }
+    }
+    if (lowercase.size() == name.size()) return 0;
+    return lowercase.size() < name.size() ? -1 : 1;
+}
+
+} // namespace
+
+// Binary search over the sorted name table.
+TagId tagIdFromName(std::string_view name) {
+    if (name.empty()) return TagId::Unknown;
+    auto first = kTagNames.begin() + 1;
+    auto it = std::lower_bound(first, kTagNames.end(), name,
+        [](std::string_view entry, std::string_view key) { return compareName(entry, key) < 0; });
+    if (it == kTagNames.end() || compareName(*it, name) != 0) {
+        return TagId::Unknown;
+    }
+    return static_cast<TagId>(it - kTagNames.begin());
+}
+
+// Returns the lowercase name stored for a tag identifier.
+std::string_view tagName(TagId tag) {
+    auto index = static_cast<std::size_t>(tag);
+    return index < kTagNames.size() ? kTagNames[index] : std::string_view{};
+}
+
+} // namespace turndown_cpp::dom
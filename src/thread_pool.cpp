@@ -0,0 +1,154 @@
+/// @file thread_pool.cpp
+/// @brief Work-stealing thread pool implementation
+///
+/// @copyright The MIT License (MIT)
+/// @copyright Copyright (c) 2025 Parsa Amini
+
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+namespace turndown_cpp {
+
+ThreadPool::ThreadPool(std::size_t workers) {
+    if (workers == 0) {
+        workers = std::max<std::size_t>(1, std::thread::hardware_concurrency());
+    }
+    slices_.reserve(workers);
+    for (std::size_t i = 0; i < workers; ++i) {
+        slices_.push_back(std::make_unique<Slice>());
+    }
+    threads_.reserve(workers - 1);
+    for (std::size_t i = 1; i < workers; ++i) {
+        threads_.emplace_back([this, i] { workerLoop(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(stateMutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+// Splits the range evenly, runs worker 0 on the calling thread, then waits
+// for the others to drain their slices and everything they stole.
+void ThreadPool::parallelFor(std::size_t count, Body const& body) {
+    if (count == 0) return;
+    std::lock_guard<std::mutex> job(jobMutex_);
+
+    std::size_t workers = slices_.size();
+    for (std::size_t i = 0; i < workers; ++i) {
+        std::lock_guard<std::mutex> lock(slices_[i]->mutex);
+        slices_[i]->begin = count * i / workers;
+        slices_[i]->end = count * (i + 1) / workers;
+    }
+    {
+        std::lock_guard<std::mutex> lock(stateMutex_);
+        body_ = &body;
+        error_ = nullptr;
+        busyWorkers_ = threads_.size();
+        ++generation_;
+    }
+    wake_.notify_all();
+
+    runSlices(0);
+
+    std::exception_ptr error;
+    {
+        std::unique_lock<std::mutex> lock(stateMutex_);
+        done_.wait(lock, [this] { return busyWorkers_ == 0; });
+        body_ = nullptr;
+        error = error_;
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+// Waits for the next job generation and runs it until the pool stops.
+void ThreadPool::workerLoop(std::size_t worker) {
+    std::size_t seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(stateMutex_);
+            wake_.wait(lock, [&] { return stopping_ || generation_ != seen; });
+            if (stopping_) return;
+            seen = generation_;
+        }
+        runSlices(worker);
+        {
+            std::lock_guard<std::mutex> lock(stateMutex_);
+            --busyWorkers_;
+        }
+        done_.notify_one();
+    }
+}
+
+// Runs indices from the worker's own slice, stealing when it is empty.
+void ThreadPool::runSlices(std::size_t worker) {
+    std::size_t index = 0;
+    while (takeIndex(worker, index) || (steal(worker) && takeIndex(worker, index))) {
+        try {
+            (*body_)(index, worker);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(stateMutex_);
+            if (!error_) error_ = std::current_exception();
+        }
+    }
+}
+
+// Pops the front index of the worker's slice.
+bool ThreadPool::takeIndex(std::size_t worker, std::size_t& index) {
+    Slice& slice = *slices_[worker];
+    std::lock_guard<std::mutex> lock(slice.mutex);
+    if (slice.begin == slice.end) return false;
+    index = slice.begin++;
+    return true;
+}
+
+// Moves the back half of the largest other slice into the worker's slice.
+bool ThreadPool::steal(std::size_t worker) {
+    while (true) {
+        std::size_t victim = worker;
+        std::size_t largest = 0;
+        for (std::size_t i = 0; i < slices_.size(); ++i) {
+            if (i == worker) continue;
+            std::lock_guard<std::mutex> lock(slices_[i]->mutex);
+            std::size_t remaining = slices_[i]->end - slices_[i]->begin;
+            if (remaining > largest) {
+                largest = remaining;
+                victim = i;
+            }
+        }
+        if (largest == 0) return false;
+
+        std::size_t begin = 0;
+        std::size_t end = 0;
+        {
+            Slice& slice = *slices_[victim];
+            std::lock_guard<std::mutex> lock(slice.mutex);
+            std::size_t remaining = slice.end - slice.begin;
+            if (remaining == 0) continue; // drained meanwhile; look again
+            std::size_t half = (remaining + 1) / 2;
+            begin = slice.end - half;
+            end = slice.end;
+            slice.end = begin;
+        }
+        Slice& own = *slices_[worker];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        own.begin = begin;
+        own.end = end;
+        return true;
+    }
+}
+
+} // namespace turndown_cpp
@@ -5,51 +5,85 @@
 /// @copyright Copyright (c) 2025 Parsa Amini
 
 #include "tidy_adapter.h"
+#include "dom_adapter.h"
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <memory_resource>
+#include <new>
 #include <sstream>
 #include <string>
 #include <string_view>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace turndown_cpp::tidy {
 
 namespace {
 
-// Thread-local storage for the current document context
-// Needed because tidy API requires the document for text extraction
-thread_local TidyDoc tl_current_doc = nullptr;
+// Tidy needs the owning TidyDoc to read a text node's value, but a node
+// cannot name its document. Text values are therefore extracted once when a
+// document is parsed, into a cache the document owns through its app data
+// and that is only read afterwards. Tidy keeps the root node as the first
+// member of its document, so a node finds the document through its root.
+using TextCache = std::unordered_map<TidyNode, std::string>;
 
-// Thread-local storage for cached text content from text nodes
-thread_local std::unordered_map<TidyNode, std::string> tl_text_cache;
+bool holds_text(TidyNode node) {
+    TidyNodeType type = tidyNodeGetType(node);
+    return type == TidyNode_Text || type == TidyNode_CDATA || type == TidyNode_Comment;
+}
+
+// Visits every node of the document without recursing.
+template <typename Fn>
+void for_each_node(TidyDoc doc, Fn&& fn) {
+    std::vector<TidyNode> pending;
+    if (TidyNode root = tidyGetRoot(doc)) pending.push_back(root);
+    while (!pending.empty()) {
+        TidyNode node = pending.back();
+        pending.pop_back();
+        fn(node);
+        for (TidyNode child = tidyGetChild(node); child; child = tidyGetNext(child)) {
+            pending.push_back(child);
+        }
+    }
+}
 
-void set_current_doc(TidyDoc doc) {
-    tl_current_doc = doc;
-    tl_text_cache.clear();
+void cache_text_nodes(TidyDoc doc) {
+    auto cache = std::make_unique<TextCache>();
+    for_each_node(doc, [&](TidyNode node) {
+        if (!holds_text(node)) return;
+        TidyBuffer buf;
+        tidyBufInit(&buf);
+        // Use tidyNodeGetValue for raw unescaped text content
+        if (tidyNodeGetValue(doc, node, &buf) && buf.bp) {
+            cache->emplace(node, reinterpret_cast<char*>(buf.bp));
+        }
+        tidyBufFree(&buf);
+    });
+    tidySetAppData(doc, cache.release());
 }
 
-TidyDoc get_current_doc() {
-    return tl_current_doc;
+void release_doc(TidyDoc doc) {
+    delete static_cast<TextCache*>(tidyGetAppData(doc));
+    tidyRelease(doc);
 }
 
-std::string_view get_cached_text(TidyDoc doc, TidyNode node) {
-    auto it = tl_text_cache.find(node);
-    if (it != tl_text_cache.end()) {
-        return it->second;
-    }
-    
-    TidyBuffer buf = {0};
-    // Use tidyNodeGetValue for raw unescaped text content
-    if (tidyNodeGetValue(doc, node, &buf) && buf.bp) {
-        std::string text(reinterpret_cast<char*>(buf.bp));
-        tidyBufFree(&buf);
-        auto [insert_it, _] = tl_text_cache.emplace(node, std::move(text));
-        return insert_it->second;
-    }
-    tidyBufFree(&buf);
-    return {};
+// The cache is complete before any node is handed out and never changes
+// afterwards, so the returned view stays valid while the document lives.
+std::string_view cached_text(TidyNode node) {
+    TidyNode root = node;
+    while (TidyNode parent = tidyGetParent(root)) root = parent;
+    auto const* cache = static_cast<TextCache const*>(tidyGetAppData(reinterpret_cast<TidyDoc>(root)));
+    if (!cache) return {};
+    auto it = cache->find(node);
+    return it != cache->end() ? std::string_view(it->second) : std::string_view{};
 }
 
 dom::NodeType to_node_type(TidyNode node) {
@@ -89,22 +123,15 @@ std::size_t count_attributes(TidyNode node) {
     return count;
 }
 
-void collect_text_impl(TidyDoc doc, TidyNode node, std::ostringstream& out) {
+void collect_text_impl(TidyNode node, std::ostringstream& out) {
     if (!node) return;
     TidyNodeType type = tidyNodeGetType(node);
     
     if (type == TidyNode_Text || type == TidyNode_CDATA) {
-        TidyBuffer buf = {0};
-        // Use tidyNodeGetValue for unescaped text
-        if (tidyNodeGetValue(doc, node, &buf)) {
-            if (buf.bp) {
-                out << reinterpret_cast<char*>(buf.bp);
-            }
-            tidyBufFree(&buf);
-        }
+        out << cached_text(node);
     } else {
         for (TidyNode child = tidyGetChild(node); child; child = tidyGetNext(child)) {
-            collect_text_impl(doc, child, out);
+            collect_text_impl(child, out);
         }
     }
 }
@@ -128,6 +155,25 @@ std::string lookup_tag_name(TidyNode node) {
     return result;
 }
 
+// Maps Tidy's tag id to a TagId. Tidy only exposes names through nodes,
+// so each built-in id is resolved by name the first time a node carries
+// it (slot value is TagId + 1, zero while unresolved).
+dom::TagId lookup_tag_id(TidyNode node) {
+    if (!is_element(node)) return dom::TagId::Unknown;
+    TidyTagId id = tidyNodeGetId(node);
+    if (id == TidyTag_UNKNOWN || id >= N_TIDY_TAGS) {
+        return dom::tagIdFromName(lookup_tag_name(node));
+    }
+    static_assert(dom::kTagCount < 256, "TagId + 1 must fit in a slot");
+    static std::array<std::atomic<std::uint8_t>, N_TIDY_TAGS> memo{};
+    std::uint8_t cached = memo[id].load(std::memory_order_relaxed);
+    if (cached == 0) {
+        cached = static_cast<std::uint8_t>(static_cast<std::uint8_t>(dom::tagIdFromName(lookup_tag_name(node))) + 1);
+        memo[id].store(cached, std::memory_order_relaxed);
+    }
+    return static_cast<dom::TagId>(cached - 1);
+}
+
 bool has_tag(TidyNode node, std::string_view tag) {
     return is_element(node) && lookup_tag_name(node) == tag;
 }
@@ -187,6 +233,9 @@ dom::AttributeView AttributeIterator::operator*() const {
     };
 }
 
+AttributeIterator::AttributeIterator(dom::AttributeCursor cursor)
+    : current_(static_cast<TidyAttr>(const_cast<void*>(cursor.item))) {}
+
 AttributeIterator& AttributeIterator::operator++() {
     if (current_) {
         current_ = tidyAttrNext(current_);
@@ -273,6 +322,10 @@ std::string NodeView::tag_name() const {
     return lookup_tag_name(node_);
 }
 
+dom::TagId NodeView::tag_id() const {
+    return lookup_tag_id(node_);
+}
+
 bool NodeView::has_tag(std::string_view tag) const {
     return node_ && is_element() && lookup_tag_name(node_) == tag;
 }
@@ -296,10 +349,9 @@ NodeView NodeView::first_text_child() const {
 }
 
 std::string NodeView::text_content() const {
-    TidyDoc doc = get_current_doc();
-    if (!doc || !node_) return "";
+    if (!node_) return "";
     std::ostringstream out;
-    collect_text_impl(doc, node_, out);
+    collect_text_impl(node_, out);
     return out.str();
 }
 
@@ -326,9 +378,12 @@ void NodeView::set_text(std::string const& /*text*/) {
 
 std::string_view NodeView::text() const {
     if (!node_ || !is_text_like()) return {};
-    TidyDoc doc = get_current_doc();
-    if (!doc) return {};
-    return get_cached_text(doc, node_);
+    return cached_text(node_);
+}
+
+// Tidy exposes line and column numbers only.
+std::string_view NodeView::source_html() const {
+    return {};
 }
 
 AttributeRange NodeView::attribute_range() const {
@@ -337,9 +392,13 @@ AttributeRange NodeView::attribute_range() const {
 
 // --- Document implementation ---
 
-Document Document::parse(std::string const& html) {
-    TidyDoc doc = tidyCreate();
-    if (!doc) return Document(nullptr);
+namespace {
+
+// Creates and parses a document; null on failure. A null allocator selects
+// Tidy's default one.
+TidyDoc parse_doc(std::string_view html, TidyAllocator* allocator) {
+    TidyDoc doc = allocator ? tidyCreateWithAllocator(allocator) : tidyCreate();
+    if (!doc) return nullptr;
     
     // Configure tidy for parsing - minimal modifications
     tidyOptSetBool(doc, TidyShowWarnings, no);
@@ -366,10 +425,16 @@ Document Document::parse(std::string const& html) {
     // Register common custom elements as inline tags to prevent tidy from stripping them
     tidyOptSetValue(doc, TidyInlineTags, "custom");
     
-    // Parse the HTML
-    if (tidyParseString(doc, html.c_str()) < 0) {
+    // Parse the HTML straight from the caller's bytes; tidy only reads them.
+    TidyBuffer input;
+    tidyBufInit(&input);
+    char* bytes = const_cast<char*>(html.empty() ? "" : html.data());
+    tidyBufAttach(&input, reinterpret_cast<unsigned char*>(bytes), static_cast<unsigned>(html.size()));
+    int status = tidyParseBuffer(doc, &input);
+    tidyBufDetach(&input);
+    if (status < 0) {
         tidyRelease(doc);
-        return Document(nullptr);
+        return nullptr;
     }
     
     // Clean and repair is required for proper DOM structure.
@@ -377,29 +442,112 @@ Document Document::parse(std::string const& html) {
     // which cannot be disabled. This affects whitespace in <code> elements.
     tidyCleanAndRepair(doc);
     
-    // Set as current doc for text extraction
-    set_current_doc(doc);
+    // cached_text() reaches the document through its root node.
+    if (static_cast<void*>(tidyGetRoot(doc)) != static_cast<void*>(doc)) {
+        tidyRelease(doc);
+        return nullptr;
+    }
+
+    // Extract text values up front so any thread can read them
+    cache_text_nodes(doc);
     
-    return Document(doc);
+    return doc;
+}
+
+// A TidyAllocator over a memory resource. Like Tidy's default allocator it
+// panics when memory runs out, since exceptions cannot cross Tidy's frames.
+struct ResourceAllocator : TidyAllocator {
+    explicit ResourceAllocator(std::pmr::memory_resource* resource) : TidyAllocator{&kVtbl}, memory(resource) {}
+
+    static void* TIDY_CALL alloc(TidyAllocator* self, std::size_t bytes) {
+        try {
+            return dom::detail::allocateFrom(static_cast<ResourceAllocator*>(self)->memory, bytes);
+        } catch (std::bad_alloc const&) {
+            panic(self, "Out of memory!");
+            return nullptr;
+        }
+    }
+
+    static void* TIDY_CALL realloc(TidyAllocator* self, void* block, std::size_t bytes) {
+        if (!block) return alloc(self, bytes);
+        try {
+            return dom::detail::reallocateFrom(block, bytes);
+        } catch (std::bad_alloc const&) {
+            panic(self, "Out of memory!");
+            return nullptr;
+        }
+    }
+
+    static void TIDY_CALL free(TidyAllocator*, void* block) { dom::detail::deallocateFrom(block); }
+
+    static void TIDY_CALL panic(TidyAllocator*, ctmbstr msg) {
+        std::fprintf(stderr, "Fatal error: %s\n", msg);
+        std::abort();
+    }
+
+    static constexpr TidyAllocatorVtbl kVtbl{&alloc, &realloc, &free, &panic};
+
+    std::pmr::memory_resource* memory;
+};
+
+} // namespace
+
+Document Document::parse(std::string_view html) {
+    return Document(parse_doc(html, nullptr));
+}
+
+// --- Parser ---
+
+// Without a resource, documents use Tidy's default allocator.
+Parser::Parser(std::pmr::memory_resource* memory) {
+    if (memory) allocator_ = std::make_shared<ResourceAllocator>(memory);
+}
+
+Document Parser::parse(std::string_view html) {
+    Document doc(parse_doc(html, allocator_.get()));
+    if (doc) doc.allocator_ = allocator_;
+    return doc;
+}
+
+void Parser::recycle(Document&& document) {
+    Document released = std::move(document);
+}
+
+// --- DocumentBuilder ---
+
+DocumentBuilder::DocumentBuilder() = default;
+DocumentBuilder::DocumentBuilder(DocumentBuilder&& other) noexcept = default;
+DocumentBuilder& DocumentBuilder::operator=(DocumentBuilder&& other) noexcept = default;
+DocumentBuilder::~DocumentBuilder() = default;
+
+void DocumentBuilder::feed(std::string_view chunk) {
+    html_.append(chunk);
+}
+
+Document DocumentBuilder::finish() {
+    std::string html = std::move(html_);
+    html_.clear();
+    return Document::parse(html);
 }
 
-Document::Document(Document&& other) noexcept : doc_(other.doc_) {
+Document::Document(Document&& other) noexcept : doc_(other.doc_), allocator_(std::move(other.allocator_)) {
     other.doc_ = nullptr;
 }
 
 Document& Document::operator=(Document&& other) noexcept {
     if (this == &other) return *this;
     if (doc_) {
-        tidyRelease(doc_);
+        release_doc(doc_);
     }
     doc_ = other.doc_;
     other.doc_ = nullptr;
+    allocator_ = std::move(other.allocator_);
     return *this;
 }
 
 Document::~Document() {
     if (doc_) {
-        tidyRelease(doc_);
+        release_doc(doc_);
         doc_ = nullptr;
     }
 }
@@ -12,22 +12,90 @@
 #include "turndown.h"
 #include "collapse_whitespace.h"
 #include "commonmark_rules.h"
+#include "conversion_cache.h"
+#include "conversion_context.h"
 #include "dom_source.h"
 #include "dom_adapter.h"
+#include "flat_document.h"
+#include "markdown_buffer.h"
 #include "node.h"
+#include "thread_pool.h"
+#include "utf8_helpers.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
 #include <cstring>
 #include <functional>
 #include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
+#include <ostream>
 #include <string>
 #include <string_view>
+#include <typeinfo>
 #include <utility>
+#include <vector>
 
 namespace turndown_cpp {
 
+// First block of the conversion arena; later blocks grow geometrically.
+constexpr std::size_t kConversionArenaInitialSize = 64 * 1024;
+
+namespace {
+
+using StatsClock = std::chrono::steady_clock;
+
+// Instrumentation policies for the pipeline. Every use is guarded by
+// `if constexpr (Stats::enabled)`, so the pipeline instantiated with NoStats
+// contains no timing or counting code at all.
+struct NoStats {
+    static constexpr bool enabled = false;
+    ConversionStats* stats = nullptr;
+};
+
+struct CollectStats {
+    static constexpr bool enabled = true;
+    ConversionStats* stats = nullptr;
+};
+
+// Forwards to another resource and counts what is requested from it.
+class CountingResource final : public std::pmr::memory_resource {
+public:
+    CountingResource(std::pmr::memory_resource* upstream, ConversionStats& stats)
+        : upstream_(upstream), stats_(stats) {}
+
+private:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+        ++stats_.allocations;
+        stats_.allocatedBytes += bytes;
+        return upstream_->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override {
+        upstream_->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(std::pmr::memory_resource const& other) const noexcept override {
+        return this == &other;
+    }
+
+    std::pmr::memory_resource* upstream_;
+    ConversionStats& stats_;
+};
+
+// The default TurndownOptions::defaultReplacement. Being a named function
+// lets a streaming conversion recognise it (see continuesSpine()).
+std::string defaultElementReplacement(std::string const& content, dom::NodeView node) {
+    return isBlock(node) ? "\n\n" + content + "\n\n" : content;
+}
+
+} // namespace
+
 /**
  * @brief Initialize options with default values
  *
@@ -46,6 +114,9 @@ turndown_cpp::TurndownOptions::TurndownOptions() :
     linkReferenceStyle("full"),
     br("  "),
     preformattedCode(false),
+    useConversionArena(false),
+    useFlatDocument(false),
+    maxDepth(0),
     escapeFunction(advancedEscape),
     keepTags({}),
     blankReplacement([](std::string const& content, dom::NodeView node) -> std::string {
@@ -55,88 +126,319 @@ turndown_cpp::TurndownOptions::TurndownOptions() :
         (void)content;
         return serializeNode(node);
     }),
-    defaultReplacement([](std::string const& content, dom::NodeView node) -> std::string {
-        return isBlock(node) ? "\n\n" + content + "\n\n" : content;
-    })
+    defaultReplacement(defaultElementReplacement)
 {}
 
 /**
- * @brief Trim leading newlines from a string
+ * @brief Encode non-breaking spaces as HTML entities
  *
- * Removes all leading carriage return and line feed characters.
- * Used in the join algorithm to normalize newlines between chunks.
+ * Replaces UTF-8 NBSP bytes (0xC2 0xA0) with "&nbsp;" entities.
+ * This preserves non-breaking spaces in the Markdown output.
  */
-static std::string trimLeadingNewlines(std::string const& text) {
-    std::size_t index = 0;
-    while (index < text.size() && (text[index] == '\n' || text[index] == '\r')) {
-        ++index;
+static void encodeNbsp(std::string& text) {
+    std::string_view const nbsp = "\xC2\xA0";
+    std::size_t pos = text.find(nbsp);
+    if (pos == std::string::npos) return;
+
+    std::string encoded;
+    encoded.reserve(text.size() + 16);
+    std::size_t start = 0;
+    while (pos != std::string::npos) {
+        encoded.append(text, start, pos - start);
+        encoded.append("&nbsp;");
+        start = pos + nbsp.size();
+        pos = text.find(nbsp, start);
     }
-    return text.substr(index);
+    encoded.append(text, start, std::string::npos);
+    text = std::move(encoded);
 }
 
 /**
- * @brief Trim trailing newlines from a string
+ * @brief Finish the joined output of a conversion
  *
- * Removes all trailing carriage return and line feed characters.
- * Uses a simple loop instead of regex to avoid performance issues
- * with match-at-end patterns (see original JS issue #370).
+ * Encodes NBSPs, drops leading newlines and trims trailing whitespace.
+ * "&nbsp;" contains no NBSP bytes, so a single pass over the joined
+ * output also covers text produced by append functions.
  */
-static std::string trimTrailingNewlines(std::string const& text) {
-    std::size_t index = text.size();
-    while (index > 0 && (text[index - 1] == '\n' || text[index - 1] == '\r')) {
-        --index;
+static void finishMarkdown(std::string& markdown) {
+    encodeNbsp(markdown);
+
+    std::size_t begin = 0;
+    while (begin < markdown.size() && (markdown[begin] == '\n' || markdown[begin] == '\r')) {
+        ++begin;
+    }
+    // Match Turndown JS: strip trailing whitespace but keep leading spaces (e.g., indented code)
+    std::size_t end = markdown.size();
+    while (end > begin) {
+        char ch = markdown[end - 1];
+        if (ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r') {
+            --end;
+        } else {
+            break;
+        }
     }
-    return text.substr(0, index);
+    markdown.resize(end);
+    markdown.erase(0, begin);
+}
+
+// Joins what the rules' append functions add at the end of the document.
+static void appendRuleOutput(TurndownOptions const& options, Rules const& rules, ConversionContext& context, MarkdownBuffer& output) {
+    rules.forEach([&](Rule const& rule) {
+        if (rule.contextAppend) {
+            output.append(rule.contextAppend(options, context));
+        } else if (rule.append) {
+            output.append(rule.append(options));
+        }
+    });
 }
 
+namespace {
+
 /**
- * @brief Join replacement to output with appropriate newlines
- *
- * Joins two Markdown chunks together with the appropriate number of
- * newline separators. The separator is determined by the maximum number
- * of newlines trimmed from either side, capped at 2 (blank line).
+ * @brief Hands the settled part of the output buffer to a sink
  *
- * This ensures proper spacing between block elements while avoiding
- * excessive whitespace.
- *
- * @param[in] output The current conversion output
- * @param[in] addition The string to append to the output
- * @return Joined output with proper newline separation
+ * Applies the same finishing as a non-streaming conversion, piece by
+ * piece: leading newlines of the whole output are dropped, NBSPs are
+ * encoded and the trailing whitespace of the whole output is trimmed.
  */
-static std::string joinChunks(std::string const& output, std::string const& addition) {
-    if (output.empty()) return addition;
-    if (addition.empty()) return output;
+class MarkdownStream {
+public:
+    explicit MarkdownStream(TurndownService::MarkdownSink const& sink) : sink_(sink) {}
 
-    std::string left = trimTrailingNewlines(output);
-    std::string right = trimLeadingNewlines(addition);
+    // Passes on the text no later join can change.
+    void flush(MarkdownBuffer& output) { emit(output.takeSettled()); }
 
-    std::size_t leftRemoved = output.size() - left.size();
-    std::size_t rightRemoved = addition.size() - right.size();
-    std::size_t separatorLength = std::max(leftRemoved, rightRemoved);
-    if (separatorLength > 2) separatorLength = 2;
+    // Passes on the rest of the output once the conversion is done.
+    void finish(std::string tail) {
+        std::size_t end = tail.size();
+        while (end > 0 && (tail[end - 1] == ' ' || tail[end - 1] == '\t' || tail[end - 1] == '\n' || tail[end - 1] == '\r')) {
+            --end;
+        }
+        tail.resize(end);
+        emit(std::move(tail));
+    }
 
-    std::string separator(separatorLength, '\n');
-    return left + separator + right;
+private:
+    void emit(std::string text) {
+        if (!started_) {
+            std::size_t begin = 0;
+            while (begin < text.size() && (text[begin] == '\n' || text[begin] == '\r')) {
+                ++begin;
+            }
+            text.erase(0, begin);
+        }
+        if (text.empty()) return;
+        encodeNbsp(text);
+        started_ = true;
+        sink_(text);
+    }
+
+    TurndownService::MarkdownSink const& sink_;
+    bool started_ = false;
+};
+
+} // namespace
+
+// True for the node types converted as text (text, whitespace, CDATA).
+static bool isTextLike(dom::NodeType type) {
+    return type == dom::NodeType::Text || type == dom::NodeType::Whitespace || type == dom::NodeType::CData;
 }
 
-// Forward declarations for the recursive conversion functions
-static std::string processNode(dom::NodeView node, TurndownOptions const& options, Rules& rules);
-static std::string processChildren(dom::NodeView parent, TurndownOptions const& options, Rules& rules);
-static std::string replacementForNode(dom::NodeView node, TurndownOptions const& options, Rules& rules, NodeMetadata const& meta);
+namespace {
+
+// Identity of a callable option: nothing, a plain function pointer, or the
+// captureless lambda the option defaults to, whose type @p stateless names.
+// Other callables have none, since two objects of one closure type may
+// differ in what they captured.
+template <typename R, typename... Args>
+std::optional<std::uint64_t> callableIdentity(std::function<R(Args...)> const& fn, std::type_info const& stateless) {
+    if (!fn) return 0;
+    std::uint64_t identity = fn.target_type().hash_code();
+    if (auto const* function = fn.template target<R (*)(Args...)>()) {
+        return combineHash(identity, reinterpret_cast<std::uintptr_t>(*function));
+    }
+    if (fn.target_type() == stateless) return identity;
+    return std::nullopt;
+}
+
+TurndownOptions const& defaultOptions() {
+    static TurndownOptions const defaults;
+    return defaults;
+}
+
+// Whether the element replacements among the options are their defaults,
+// which read only the element and its subtree. Any other one might read
+// more than a subtree cache key covers, so subtrees are not cached.
+bool defaultElementReplacements(TurndownOptions const& options) {
+    TurndownOptions const& defaults = defaultOptions();
+    using Replacement = std::string (*)(std::string const&, dom::NodeView);
+    auto const* replacement = options.defaultReplacement.target<Replacement>();
+    return replacement && *replacement == &defaultElementReplacement &&
+           options.blankReplacement.target_type() == defaults.blankReplacement.target_type() &&
+           options.keepReplacement.target_type() == defaults.keepReplacement.target_type();
+}
+
+// Tags the collapse pass prunes: those the rules prune, less the ones
+// TurndownOptions::keepTags renders as HTML.
+dom::TagSet prunedTags(TurndownOptions const& options, Rules const& rules) {
+    dom::TagSet pruned = rules.prunedTags();
+    for (std::string const& tag : options.keepTags) {
+        pruned.erase(dom::tagIdFromName(tag));
+    }
+    pruned.erase(dom::TagId::Unknown);
+    return pruned;
+}
+
+// Fingerprint of everything besides the input that the output depends on;
+// none when a function-valued option has no identity, and so the output
+// cannot be cached.
+std::optional<std::uint64_t> configurationFingerprint(TurndownOptions const& options, Rules const& rules) {
+    std::uint64_t h = rules.revision();
+    for (std::string const* text : {&options.headingStyle, &options.hr, &options.bulletListMarker, &options.codeBlockStyle,
+                                    &options.fence, &options.emDelimiter, &options.strongDelimiter, &options.linkStyle,
+                                    &options.linkReferenceStyle, &options.br}) {
+        h = combineHash(h, contentHash(*text));
+    }
+    for (std::string const& tag : options.keepTags) {
+        h = combineHash(h, contentHash(tag));
+    }
+    h = combineHash(h, options.preformattedCode);
+    h = combineHash(h, options.maxDepth);
+    TurndownOptions const& defaults = defaultOptions();
+    for (auto identity : {callableIdentity(options.escapeFunction, defaults.escapeFunction.target_type()),
+                          callableIdentity(options.blankReplacement, defaults.blankReplacement.target_type()),
+                          callableIdentity(options.keepReplacement, defaults.keepReplacement.target_type()),
+                          callableIdentity(options.defaultReplacement, defaults.defaultReplacement.target_type())}) {
+        if (!identity) return std::nullopt;
+        h = combineHash(h, *identity);
+    }
+    return h;
+}
 
 /**
- * @brief Encode non-breaking spaces as HTML entities
+ * @brief Subtree level of a ConversionCache for one conversion
  *
- * Replaces UTF-8 NBSP bytes (0xC2 0xA0) with "&nbsp;" entities.
- * This preserves non-breaking spaces in the Markdown output.
+ * Hashes every subtree of the node table in one bottom-up pass before the
+ * walk, so looking an element up costs no walk of its own. An element's
+ * key adds what its rule can see around it: the parent's tag and
+ * attributes, what its TraversalContext reports (position among its
+ * element siblings, list depth, being inside code or pre) and, with
+ * TurndownOptions::maxDepth, its depth. Rules that may look further are
+ * those not marked Rule::cacheable, so subtrees that consulted one are
+ * left out.
  */
-static void encodeNbsp(std::string& text) {
-    std::string const nbsp = "\xC2\xA0";
-    std::size_t pos = 0;
-    while ((pos = text.find(nbsp, pos)) != std::string::npos) {
-        text.replace(pos, nbsp.size(), "&nbsp;");
-        pos += 6;
+class SubtreeCache {
+public:
+    SubtreeCache(ConversionCache& cache, std::uint64_t config, ConversionContext const& context, bool depthMatters)
+        : cache_(cache), config_(config), nodes_(context.nodes()), depthMatters_(depthMatters),
+          digests_(context.nodes().size(), context.memory()) {
+        CollapsedWhitespace const& collapsed = context.collapsedWhitespace();
+        // Descendants follow their ancestors in the table, so a reverse
+        // pass meets every child before its parent.
+        for (std::uint32_t index = static_cast<std::uint32_t>(nodes_.size()); index-- > 0;) {
+            NodeInfo const& info = nodes_[index];
+            Digest& digest = digests_[index];
+            std::uint64_t h = static_cast<std::uint64_t>(info.type) + 1;
+            std::size_t bytes = 0;
+            if (isTextLike(info.type)) {
+                std::string_view text = collapsed.text(index, info.node);
+                h = contentHash(text, h);
+                bytes = text.size();
+            } else if (info.type == dom::NodeType::Element) {
+                std::string_view tag = info.node.tag_name();
+                h = contentHash(tag, h);
+                bytes = tag.size();
+                for (dom::AttributeView attr : info.node.attribute_range()) {
+                    h = combineHash(h, contentHash(attr.name));
+                    h = combineHash(h, contentHash(attr.value));
+                    bytes += attr.name.size() + attr.value.size();
+                }
+            }
+            // Of a pruned element's content, only whether it makes the
+            // element non-blank and its collapsed text's whitespace reach
+            // the output.
+            if (info.hasPrunedContent) h = combineHash(h, 1);
+            if (info.isPruned) {
+                h = combineHash(h, contentHash(nodes_.whitespace(info.leadingWhitespace)));
+                h = combineHash(h, contentHash(nodes_.whitespace(info.trailingWhitespace)));
+                h = combineHash(h, info.textLength == 0 ? 0u : info.isWhitespaceOnly ? 1u : 2u);
+            }
+            digest.own = h;
+            for (std::uint32_t child = info.firstChild; child != NodeTable::npos; child = nodes_[child].nextSibling) {
+                h = combineHash(h, digests_[child].subtree);
+                bytes += digests_[child].bytes;
+            }
+            digest.subtree = h;
+            digest.bytes = bytes;
+        }
+    }
+
+    // Key of a block element, or none if it is not worth caching.
+    std::optional<ConversionCache::Key> keyFor(std::uint32_t index, std::size_t depth) const {
+        NodeInfo const& info = nodes_[index];
+        Digest const& digest = digests_[index];
+        if (info.type != dom::NodeType::Element || !info.isBlock) return std::nullopt;
+        if (cache_.minSubtreeBytes() == 0 || digest.bytes < cache_.minSubtreeBytes()) return std::nullopt;
+        std::uint64_t context = info.parent == NodeTable::npos ? 0 : digests_[info.parent].own;
+        context = combineHash(context, info.elementIndex);
+        context = combineHash(context, info.listDepth);
+        context = combineHash(context, (info.isLastElement ? 1u : 0u) | (info.isCode ? 2u : 0u) | (info.isPre ? 4u : 0u));
+        if (depthMatters_) context = combineHash(context, depth);
+        return ConversionCache::Key{config_, digest.subtree, context, digest.bytes, CacheLevel::Subtree};
+    }
+
+    std::shared_ptr<std::string const> find(ConversionCache::Key const& key) { return cache_.find(key); }
+
+    void store(std::uint32_t index, std::size_t depth, std::string const& markdown) {
+        if (auto key = keyFor(index, depth)) cache_.insert(*key, markdown);
+    }
+
+    // Rule lookups so far that consulted a rule that is not Rule::cacheable
+    // (see Rules::consultsUncacheable()) or chose one with per-conversion
+    // state or an append function; a subtree in which the count changed
+    // is not stored. In a parallel conversion the count is shared, which
+    // only ever stores less.
+    std::size_t uncacheableRules() const { return uncacheableRules_.load(std::memory_order_relaxed); }
+    void noteRule(Rule const& rule, bool consultsUncacheable) {
+        if (consultsUncacheable || rule.contextReplacement || rule.contextAppend || rule.append) {
+            uncacheableRules_.fetch_add(1, std::memory_order_relaxed);
+        }
     }
+
+private:
+    struct Digest {
+        std::uint64_t subtree = 0; ///< Hash of the node and its descendants
+        std::uint64_t own = 0;     ///< Hash of the node alone (tag and attributes)
+        std::size_t bytes = 0;     ///< Content bytes hashed into #subtree
+    };
+
+    ConversionCache& cache_;
+    std::uint64_t config_;
+    NodeTable const& nodes_;
+    bool depthMatters_;
+    std::pmr::vector<Digest> digests_;
+    std::atomic<std::size_t> uncacheableRules_{0};
+};
+
+} // namespace
+
+// Escapes text outside code and joins it into the output.
+static void processEscapedText(std::string_view text, TurndownOptions const& options, MarkdownBuffer& output) {
+    // The default escaper is called directly: text without Markdown syntax
+    // (the common case) is appended as-is instead of copied.
+    auto const* escaper = options.escapeFunction.target<std::string (*)(std::string const&)>();
+    if (escaper && *escaper == &advancedEscape) {
+        if (!needsAdvancedEscape(text)) {
+            output.append(text);
+            return;
+        }
+        std::string escaped;
+        escaped.reserve(text.size() + text.size() / 8 + 2);
+        advancedEscapeInto(text, escaped);
+        output.append(escaped);
+        return;
+    }
+    output.append(options.escapeFunction(std::string(text)));
 }
 
 /**
@@ -145,106 +447,426 @@ static void encodeNbsp(std::string& text) {
  * Processes a text node, applying Markdown escaping unless the node
  * is inside a code element (where text should be preserved verbatim).
  *
+ * @param[in] index Index of the node in the context's node table
  * @param[in] node The text node to process
  * @param[in] options Conversion options (for escape function)
- * @param[in] meta Node metadata (for isCode check)
- * @return The processed text, escaped if necessary
+ * @param[in] context State of the current conversion (collapsed text)
+ * @param[in] info Node annotation (for isCode check)
+ * @param[in,out] output Buffer the processed text is joined into
+ * @param[in] stats Instrumentation policy (see NoStats)
  */
-static std::string processTextNode(dom::NodeView node, TurndownOptions const& options, NodeMetadata const& meta) {
-    std::string text = getNodeText(node);
-    if (text.empty()) {
-        return "";
+template <typename Stats>
+static void processTextNode(std::uint32_t index, dom::NodeView node, TurndownOptions const& options, ConversionContext const& context, NodeInfo const& info, MarkdownBuffer& output, Stats stats) {
+    if (info.textLength == 0) {
+        return;
+    }
+    // A text node's index is its collapse ordinal; an element flattened by
+    // maxDepth gathers the text of its subtree.
+    std::string scratch;
+    std::string_view text = isTextLike(info.type)
+                                ? context.collapsedWhitespace().text(index, node)
+                                : getNodeTextView(node, context.collapsedWhitespace(), scratch);
+    if (info.isCode) {
+        output.append(text);
+        return;
     }
-    if (meta.isCode) {
-        return text;
+    if constexpr (Stats::enabled) {
+        auto start = StatsClock::now();
+        processEscapedText(text, options, output);
+        stats.stats->escapeTime += StatsClock::now() - start;
+    } else {
+        processEscapedText(text, options, output);
     }
-    return options.escapeFunction(text);
 }
 
 /**
- * @brief Reduce a DOM node to its Markdown string equivalent
+ * @brief Convert an element node to its Markdown equivalent
  *
- * Dispatches processing based on node type:
- * - Text/Whitespace/CData: Process as text (with escaping)
- * - Element: Apply matching rule for conversion
- * - Document: Process all children
+ * Receives the already converted content of the element's children and
+ * returns the matching rule's replacement. Handles flanking whitespace by
+ * trimming content and placing whitespace outside the converted output.
  *
- * @param[in] node The node to convert
+ * @param[in] index Index of the element in the context's node table
+ * @param[in] content Markdown of the element's children
  * @param[in] options Conversion options
- * @param[in,out] rules Rule set for element conversion
- * @return Markdown representation of the node
+ * @param[in] rules Rule set for finding matching rule
+ * @param[in,out] context State of the current conversion
+ * @param[in] stats Instrumentation policy (see NoStats)
+ * @param[in,out] cache Told which rule ran; null without a cache
+ * @return Markdown to join into the output
  */
-static std::string processNode(dom::NodeView node, TurndownOptions const& options, Rules& rules) {
-    if (!node) return "";
-    switch (node.type()) {
-        case dom::NodeType::Text:
-        case dom::NodeType::Whitespace:
-        case dom::NodeType::CData: {
-            NodeMetadata meta = analyzeNode(node, options.preformattedCode);
-            return processTextNode(node, options, meta);
-        }
-        case dom::NodeType::Element: {
-            NodeMetadata meta = analyzeNode(node, options.preformattedCode);
-            return replacementForNode(node, options, rules, meta);
+template <typename Stats>
+static std::string replacementForNode(std::uint32_t index, std::string content, TurndownOptions const& options, Rules const& rules, ConversionContext& context, Stats stats, SubtreeCache* cache) {
+    dom::NodeView node = context.nodes()[index].node;
+
+    for (auto const& keep : options.keepTags) {
+        if (node.is_element() && keep == node.tag_name()) {
+            return options.keepReplacement(content, node);
         }
-        case dom::NodeType::Document:
-            return processChildren(node, options, rules);
-        default:
-            return "";
     }
+
+    NodeMetadata meta = context.nodes().metadata(index);
+    FlankingWhitespace const& flanking = meta.flankingWhitespace;
+    if (!flanking.leading.empty() || !flanking.trailing.empty()) {
+        content = trimStr(content);
+    }
+
+    TraversalContext const traversal(context.nodes(), index);
+    Rule const& rule = rules.forNode(node, meta, options, traversal);
+    if (cache) cache->noteRule(rule, rules.consultsUncacheable(context.nodes()[index].tag, rule));
+    [[maybe_unused]] StatsClock::time_point start;
+    if constexpr (Stats::enabled) {
+        start = StatsClock::now();
+    }
+    std::string converted = rule.contextReplacement     ? rule.contextReplacement(content, node, options, context)
+                            : rule.traversalReplacement ? rule.traversalReplacement(content, node, options, traversal)
+                                                        : rule.replacement(content, node, options);
+    if constexpr (Stats::enabled) {
+        RuleStats& ruleStats = stats.stats->rules[rule.key];
+        ++ruleStats.hits;
+        ruleStats.replacementTime += StatsClock::now() - start;
+    }
+    if (flanking.leading.empty() && flanking.trailing.empty()) {
+        return converted;
+    }
+    return flanking.leading + converted + flanking.trailing;
+}
+
+/**
+ * @brief Check whether a streaming conversion can convert an element inline
+ *
+ * True for block elements converted by the default replacement: their
+ * Markdown is their children's between blank lines, so joining "\n\n"
+ * before and after the children into the enclosing segment produces the
+ * same text as converting them in a segment of their own.
+ */
+static bool continuesSpine(std::uint32_t index, NodeInfo const& info, TurndownOptions const& options, Rules const& rules, ConversionContext const& context) {
+    if (info.type != dom::NodeType::Element || !info.isBlock) return false;
+    using Replacement = std::string (*)(std::string const&, dom::NodeView);
+    auto const* replacement = options.defaultReplacement.target<Replacement>();
+    if (!replacement || *replacement != &defaultElementReplacement) return false;
+    for (auto const& keep : options.keepTags) {
+        if (keep == info.node.tag_name()) return false;
+    }
+    TraversalContext const traversal(context.nodes(), index);
+    return rules.isDefaultRule(rules.forNode(info.node, context.nodes().metadata(index), options, traversal));
 }
 
 /**
- * @brief Process all children of a node
+ * @brief Convert the descendants of a node in one post-order walk
  *
- * Iterates through all child nodes, converting each to Markdown
- * and joining the results with appropriate spacing.
+ * Walks the node table without recursion. Entering an element or nested
+ * document opens a segment of the output buffer and pushes a frame on a
+ * heap-allocated stack; once the last child has been converted, the frame
+ * is popped and its segment becomes the content handed to the element's
+ * rule. Text is joined into whichever segment is open.
  *
- * @param[in] parent The parent node whose children to process
+ * Elements nested deeper than TurndownOptions::maxDepth are not given to
+ * rules: their text content is joined as if it were a single text node.
+ *
+ * When streaming, elements that continue the "spine" from the root (see
+ * continuesSpine()) are converted inline instead of in a segment. Whenever
+ * no segment is open, the settled output is flushed to @p stream.
+ *
+ * With a cache, a block element found in it is joined from there without
+ * entering it; one that is not is stored once converted, unless a rule
+ * with per-conversion state ran inside it.
+ *
+ * With limits, each node is checked before it is visited. Once a limit is
+ * reached no further node is entered: the elements still open are given
+ * to their rules with the content converted so far, and nothing is cached.
+ *
+ * @param[in] parent Index of the node whose children to convert
  * @param[in] options Conversion options
- * @param[in,out] rules Rule set for element conversion
- * @return Combined Markdown of all children
+ * @param[in] rules Rule set for element conversion
+ * @param[in,out] context State of the current conversion
+ * @param[in,out] output Buffer the combined Markdown is joined into
+ * @param[in] stats Instrumentation policy (see NoStats)
+ * @param[in,out] stream Receives settled output; null when not streaming
+ * @param[in,out] cache Subtree cache; null without one
+ * @param[in,out] limits Checked before each node; null for no limits
+ * @param[in] baseDepth Nesting depth of @p parent's children in the document
  */
-static std::string processChildren(dom::NodeView parent, TurndownOptions const& options, Rules& rules) {
-    if (!parent) return "";
+template <typename Stats>
+static void processChildren(std::uint32_t parent, TurndownOptions const& options, Rules const& rules, ConversionContext& context, MarkdownBuffer& output, Stats stats, MarkdownStream* stream, SubtreeCache* cache, detail::LimitGuard* limits, std::size_t baseDepth = 0) {
+    // Frames of spine elements own no segment; frames of elements not to
+    // be cached record no rule count.
+    constexpr std::size_t kSpine = static_cast<std::size_t>(-1);
+    constexpr std::size_t kUncached = static_cast<std::size_t>(-1);
+    struct Frame {
+        std::uint32_t index;
+        std::size_t segment;
+        std::size_t uncacheableRules;
+    };
+    NodeTable const& nodes = context.nodes();
+    std::pmr::vector<Frame> stack(context.memory());
+    std::size_t openSegments = 0;
+    bool stopped = false;
+
+    std::uint32_t current = nodes[parent].firstChild;
+    while (true) {
+        while (current != NodeTable::npos) {
+            NodeInfo const& info = nodes[current];
+            if (limits && limits->visit(output.str().size())) {
+                stopped = true;
+                break;
+            }
+            if constexpr (Stats::enabled) {
+                ++stats.stats->nodesVisited;
+                if (info.type == dom::NodeType::Element) ++stats.stats->elementsVisited;
+                if (isTextLike(info.type)) ++stats.stats->textNodesVisited;
+            }
+            bool container = info.type == dom::NodeType::Element || info.type == dom::NodeType::Document;
+            if (isTextLike(info.type) ||
+                (container && options.maxDepth != 0 && baseDepth + stack.size() >= options.maxDepth)) {
+                processTextNode(current, info.node, options, context, info, output, stats);
+                if (stream && openSegments == 0) stream->flush(output);
+            } else if (container) {
+                if (limits && limits->enter(baseDepth + stack.size())) {
+                    stopped = true;
+                    break;
+                }
+                if (stream && openSegments == 0 && continuesSpine(current, info, options, rules, context)) {
+                    output.append("\n\n");
+                    stack.push_back({current, kSpine, kUncached});
+                    current = info.firstChild;
+                    continue;
+                }
+                std::size_t uncacheableRules = kUncached;
+                if (cache) {
+                    if (auto key = cache->keyFor(current, baseDepth + stack.size())) {
+                        if (auto cached = cache->find(*key)) {
+                            output.append(*cached);
+                            if (stream && openSegments == 0) stream->flush(output);
+                            current = info.nextSibling;
+                            continue;
+                        }
+                        uncacheableRules = cache->uncacheableRules();
+                    }
+                }
+                stack.push_back({current, output.beginSegment(), uncacheableRules});
+                ++openSegments;
+                current = info.firstChild;
+                continue;
+            }
+            current = info.nextSibling;
+        }
 
-    std::string output;
-    for (auto child : parent.child_range()) {
-        std::string addition = processNode(child, options, rules);
-        output = joinChunks(output, addition);
+        if (stack.empty()) return;
+        Frame frame = stack.back();
+        stack.pop_back();
+        if (frame.segment == kSpine) {
+            output.append("\n\n");
+        } else {
+            std::string content = output.takeSegment(frame.segment);
+            --openSegments;
+            if (nodes[frame.index].type == dom::NodeType::Element) {
+                std::string replacement = replacementForNode(frame.index, std::move(content), options, rules, context, stats, cache);
+                if (!stopped && frame.uncacheableRules != kUncached && cache->uncacheableRules() == frame.uncacheableRules) {
+                    cache->store(frame.index, baseDepth + stack.size(), replacement);
+                }
+                output.append(replacement);
+            } else {
+                // Children of a nested document are joined among themselves
+                // before the result is joined to the surrounding output.
+                output.append(content);
+            }
+        }
+        if (stream && openSegments == 0) stream->flush(output);
+        current = stopped ? NodeTable::npos : nodes[frame.index].nextSibling;
     }
-    return output;
+}
+
+// Converts one block of a parallel conversion to the text a sequential walk
+// would join for it.
+static std::string convertBlock(std::uint32_t index, std::size_t depth, TurndownOptions const& options, Rules const& rules, ConversionContext& context, SubtreeCache* cache) {
+    std::optional<ConversionCache::Key> key;
+    std::size_t uncacheableRules = 0;
+    if (cache && (key = cache->keyFor(index, depth))) {
+        if (auto cached = cache->find(*key)) return *cached;
+        uncacheableRules = cache->uncacheableRules();
+    }
+    MarkdownBuffer content;
+    processChildren(index, options, rules, context, content, NoStats{}, nullptr, cache, nullptr, depth + 1);
+    if (context.nodes()[index].type != dom::NodeType::Element) {
+        // A nested document: its children's text, as joined among themselves.
+        return content.release();
+    }
+    std::string replacement = replacementForNode(index, content.release(), options, rules, context, NoStats{}, cache);
+    if (key && cache->uncacheableRules() == uncacheableRules) cache->store(index, depth, replacement);
+    return replacement;
 }
 
 /**
- * @brief Convert an element node to its Markdown equivalent
+ * @brief Convert the top-level blocks of a document on a thread pool
  *
- * Applies the matching rule's replacement function to convert an element
- * to Markdown. Handles flanking whitespace by trimming content and
- * placing whitespace outside the converted output.
+ * Flattens the spine from the root (see continuesSpine()) into steps: the
+ * blank lines each spine element contributes, text met along it and the
+ * blocks hanging off it. The blocks are converted in parallel, in
+ * contiguous groups that each have a context of their own, then joined
+ * into @p output in document order, which gives the text of a sequential
+ * walk.
  *
- * @param[in] node The element node to convert
- * @param[in] options Conversion options
- * @param[in,out] rules Rule set for finding matching rule
- * @param[in] meta Pre-computed metadata including flanking whitespace
- * @return Markdown representation with proper whitespace
+ * Rules with per-conversion state number what they collect from
+ * ConversionContext::priorApplications(). Before the conversion, each
+ * group counts, in parallel, the elements those rules will be given; the
+ * groups' rule states are merged into @p context in order afterwards.
+ *
+ * Workers share, and only read, @p options, @p rules, the NodeTable and
+ * CollapsedWhitespace of @p context (whose handle indexes are built under
+ * std::call_once) and the DOM behind them. Each group writes only its own
+ * ConversionContext part, its slots of the counts and converted vectors
+ * and, through @p cache, the ConversionCache (locked per shard) and the
+ * atomic stateful-rule count. Rules must keep to the same contract: a
+ * replacement function that mutates captured state is not safe here and
+ * should hold that state in ConversionContext::ruleState() instead. The
+ * threaded tests run under ThreadSanitizer in CI.
+ *
+ * @return false, with nothing joined and no rule state in @p context, if
+ *         the document has fewer than two blocks or a rule state cannot be
+ *         merged; the caller then converts sequentially
  */
-static std::string replacementForNode(dom::NodeView node, TurndownOptions const& options, Rules& rules, NodeMetadata const& meta) {
-    for (auto const& keep : options.keepTags) {
-        if (node.is_element() && keep == node.tag_name()) {
-            std::string kept = processChildren(node, options, rules);
-            return options.keepReplacement(kept, node);
+static bool convertInParallel(TurndownOptions const& options, Rules const& rules, ConversionContext& context, MarkdownBuffer& output, SubtreeCache* cache, ThreadPool& pool) {
+    enum class StepKind : std::uint8_t { BlankLines, Text, Block };
+    struct Step {
+        StepKind kind;
+        std::uint32_t index;
+        std::uint32_t depth;
+    };
+    NodeTable const& nodes = context.nodes();
+
+    std::vector<Step> steps;
+    std::vector<std::uint32_t> blocks; ///< Positions of the Block steps
+    std::vector<std::uint32_t> spine;
+    std::uint32_t current = nodes[0].firstChild;
+    while (true) {
+        while (current != NodeTable::npos) {
+            NodeInfo const& info = nodes[current];
+            auto depth = static_cast<std::uint32_t>(spine.size());
+            bool container = info.type == dom::NodeType::Element || info.type == dom::NodeType::Document;
+            if (isTextLike(info.type) || (container && options.maxDepth != 0 && depth >= options.maxDepth)) {
+                steps.push_back({StepKind::Text, current, depth});
+            } else if (container) {
+                if (continuesSpine(current, info, options, rules, context)) {
+                    steps.push_back({StepKind::BlankLines, current, depth});
+                    spine.push_back(current);
+                    current = info.firstChild;
+                    continue;
+                }
+                blocks.push_back(static_cast<std::uint32_t>(steps.size()));
+                steps.push_back({StepKind::Block, current, depth});
+            }
+            current = info.nextSibling;
         }
+        if (spine.empty()) break;
+        steps.push_back({StepKind::BlankLines, spine.back(), static_cast<std::uint32_t>(spine.size() - 1)});
+        current = nodes[spine.back()].nextSibling;
+        spine.pop_back();
     }
+    if (blocks.size() < 2) return false;
 
-    std::string content = processChildren(node, options, rules);
-    if (!meta.flankingWhitespace.leading.empty() || !meta.flankingWhitespace.trailing.empty()) {
-        content = trimStr(content);
+    // One past the last node of a subtree: descendants follow a node directly.
+    auto subtreeEnd = [&](std::uint32_t index) {
+        while (index != NodeTable::npos) {
+            if (nodes[index].nextSibling != NodeTable::npos) return nodes[index].nextSibling;
+            index = nodes[index].parent;
+        }
+        return static_cast<std::uint32_t>(nodes.size());
+    };
+
+    // Contiguous groups of blocks of about equal node counts, a few per
+    // worker so that stealing can even out the rest.
+    std::size_t const target = std::max<std::size_t>(nodes.size() / (pool.size() * 4), 1);
+    std::vector<std::size_t> groupStarts; ///< Into blocks; one extra end entry
+    std::size_t groupNodes = 0;
+    for (std::size_t b = 0; b < blocks.size(); ++b) {
+        if (groupNodes == 0) groupStarts.push_back(b);
+        std::uint32_t index = steps[blocks[b]].index;
+        groupNodes += subtreeEnd(index) - index;
+        if (groupNodes >= target) groupNodes = 0;
+    }
+    groupStarts.push_back(blocks.size());
+    std::size_t const groups = groupStarts.size() - 1;
+
+    std::vector<Rule const*> stateful;
+    rules.forEach([&](Rule const& rule) {
+        if (rule.contextReplacement) stateful.push_back(&rule);
+    });
+    std::vector<std::size_t> counts(groups * stateful.size(), 0);
+    if (!stateful.empty()) {
+        pool.parallelFor(groups, [&](std::size_t group, std::size_t) {
+            std::vector<std::uint32_t> depths;
+            for (std::size_t b = groupStarts[group]; b < groupStarts[group + 1]; ++b) {
+                Step const& step = steps[blocks[b]];
+                std::uint32_t const begin = step.index;
+                std::uint32_t const end = subtreeEnd(begin);
+                depths.assign(end - begin, 0);
+                for (std::uint32_t i = begin; i < end; ++i) {
+                    NodeInfo const& info = nodes[i];
+                    std::uint32_t depth = i == begin ? step.depth : depths[info.parent - begin] + 1;
+                    depths[i - begin] = depth;
+                    // Elements deeper than maxDepth and kept tags never reach a rule.
+                    if (info.type != dom::NodeType::Element) continue;
+                    if (options.maxDepth != 0 && depth >= options.maxDepth) continue;
+                    if (std::find(options.keepTags.begin(), options.keepTags.end(), info.node.tag_name()) != options.keepTags.end()) {
+                        continue;
+                    }
+                    bool candidate = std::any_of(stateful.begin(), stateful.end(), [&](Rule const* rule) {
+                        return rule->tags.empty() || rule->tags.contains(info.tag);
+                    });
+                    if (!candidate) continue;
+                    Rule const& rule = rules.forNode(info.node, nodes.metadata(i), options, TraversalContext(nodes, i));
+                    for (std::size_t k = 0; k < stateful.size(); ++k) {
+                        if (&rule == stateful[k]) ++counts[group * stateful.size() + k];
+                    }
+                }
+            }
+        });
+    }
+
+    std::vector<std::unique_ptr<ConversionContext>> parts;
+    parts.reserve(groups);
+    std::vector<std::size_t> prior(stateful.size(), 0);
+    for (std::size_t group = 0; group < groups; ++group) {
+        std::vector<std::pair<std::string, std::size_t>> applications;
+        for (std::size_t k = 0; k < stateful.size(); ++k) {
+            applications.emplace_back(stateful[k]->key, prior[k]);
+            prior[k] += counts[group * stateful.size() + k];
+        }
+        parts.push_back(std::make_unique<ConversionContext>(context, std::move(applications)));
+    }
+
+    std::vector<std::string> converted(blocks.size());
+    pool.parallelFor(groups, [&](std::size_t group, std::size_t) {
+        for (std::size_t b = groupStarts[group]; b < groupStarts[group + 1]; ++b) {
+            Step const& step = steps[blocks[b]];
+            converted[b] = convertBlock(step.index, step.depth, options, rules, *parts[group], cache);
+        }
+    });
+    for (auto& part : parts) {
+        if (!context.mergeRuleStates(*part)) {
+            context.clearRuleStates();
+            return false;
+        }
     }
 
-    Rule const& rule = rules.forNode(node);
-    std::string converted = rule.replacement(content, node, options);
-    return meta.flankingWhitespace.leading + converted + meta.flankingWhitespace.trailing;
+    std::size_t block = 0;
+    for (Step const& step : steps) {
+        switch (step.kind) {
+            case StepKind::BlankLines:
+                output.append("\n\n");
+                break;
+            case StepKind::Text: {
+                NodeInfo const& info = nodes[step.index];
+                processTextNode(step.index, info.node, options, context, info, output, NoStats{});
+                break;
+            }
+            case StepKind::Block:
+                output.append(converted[block++]);
+                break;
+        }
+    }
+    return true;
 }
 
 /**
@@ -259,16 +881,28 @@ TurndownService::TurndownService()
 TurndownService::TurndownService(TurndownOptions options)
     : options_(std::move(options)) {}
 
+// Copies the configuration and shares the built rule set.
+TurndownService::TurndownService(TurndownService const& other)
+    : options_(other.options_),
+      rules_(other.ensureRulesForSharing()),
+      preRuleFactories_(other.preRuleFactories_),
+      postRuleFactories_(other.postRuleFactories_),
+      ruleMutations_(other.ruleMutations_),
+      cache_(other.cache_) {}
+
+TurndownService TurndownService::clone() const {
+    return TurndownService(*this);
+}
+
 /**
  * @brief Configure options using a callback
  *
- * Allows modifying options after construction. Invalidates cached
- * rules so they will be rebuilt with new options.
+ * Allows modifying options after construction. Rules read the options
+ * when they are called, so the rule set is kept.
  */
 TurndownService& TurndownService::configureOptions(std::function<void(TurndownOptions&)> fn) {
     if (fn) {
         fn(options_);
-        invalidateRules();
     }
     return *this;
 }
@@ -296,8 +930,8 @@ TurndownService& TurndownService::use(Plugin plugin) {
  * Returns the TurndownService instance for chaining.
  */
 TurndownService& TurndownService::addRule(std::string const& key, Rule rule) {
-    enqueueRuleMutation([key, rule = std::move(rule)](Rules& rules) mutable {
-        rules.addRule(key, std::move(rule));
+    enqueueRuleMutation([key, rule = std::move(rule)](Rules& rules) {
+        rules.addRule(key, rule);
     });
     return *this;
 }
@@ -379,21 +1013,195 @@ TurndownService& TurndownService::remove(std::vector<std::string> const& tags) {
 }
 
 /// The entry point for converting a string to Markdown.
-std::string TurndownService::turndown(std::string const& html) {
-    HtmlStringSource source(html);
-    return turndown(source.root());
+std::string TurndownService::turndown(std::string const& html) const {
+    return convertHtml(html, nullptr);
+}
+
+// Converts an HTML string, converting its top-level blocks on a pool.
+std::string TurndownService::turndown(std::string const& html, ThreadPool& pool) const {
+    return convertHtml(html, &pool);
+}
+
+// Converts a root node, converting its top-level blocks on a pool.
+std::string TurndownService::turndown(dom::NodeView root, ThreadPool& pool) const {
+    return runPipeline(root, NoStats{}, nullptr, &pool);
+}
+
+// Parses and converts an HTML string, answering from the cache if it can.
+// Results cut short by a limit are not stored.
+std::string TurndownService::convertHtml(std::string_view html, ThreadPool* pool, detail::LimitGuard* limits,
+                                         dom::Parser* parser) const {
+    std::optional<ConversionCache::Key> key;
+    if (cache_) key = documentKey(html);
+    if (key) {
+        if (auto cached = cache_->find(*key)) {
+            if (!limits) return *cached;
+            std::string markdown = *cached;
+            limits->limitOutput(markdown);
+            return markdown;
+        }
+    }
+    std::string markdown;
+    if (options_.useFlatDocument) {
+        dom::FlatDocument flat = dom::FlatDocument::parse(html);
+        markdown = runPipeline(flat.root(), NoStats{}, nullptr, pool, limits);
+    } else if (parser) {
+        dom::Document document = parser->parse(html);
+        markdown = runPipeline(document.root(), NoStats{}, nullptr, pool, limits);
+        parser->recycle(std::move(document));
+    } else {
+        dom::Document document = dom::Document::parse(html);
+        markdown = runPipeline(document.root(), NoStats{}, nullptr, pool, limits);
+    }
+    if (key && (!limits || limits->reached() == LimitKind::None)) cache_->insert(*key, markdown);
+    return markdown;
+}
+
+namespace {
+
+// True for a snippet every parser returns as one text node, unchanged:
+// no markup or character references, no control characters, a BOM or
+// C1 controls a parser would drop or replace, and valid UTF-8.
+bool isPlainTextFragment(std::string_view html) {
+    for (std::size_t i = 0; i < html.size();) {
+        auto c = static_cast<unsigned char>(html[i]);
+        if (c < 0x80) {
+            if (c == '<' || c == '&' || c == 0x7F || (c < 0x20 && c != '\t' && c != '\n' && c != '\r')) return false;
+            ++i;
+            continue;
+        }
+        utf8::CodepointSlice slice;
+        utf8::decodeAt(html, i, slice);
+        if (slice.length == 1 || slice.codepoint <= 0x9F || slice.codepoint == 0xFEFF) return false;
+        i += slice.length;
+    }
+    return true;
+}
+
+// The text a collapse pass leaves of a lone text node in a block: runs of
+// ASCII whitespace become one space, dropped at either edge.
+std::string collapsePlainText(std::string_view text) {
+    auto isSpace = [](char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; };
+    std::string out;
+    out.reserve(text.size());
+    bool pendingSpace = false;
+    for (char c : text) {
+        if (isSpace(c)) {
+            pendingSpace = !out.empty();
+            continue;
+        }
+        if (pendingSpace) out.push_back(' ');
+        pendingSpace = false;
+        out.push_back(c);
+    }
+    return out;
+}
+
+} // namespace
+
+// Snippets without markup skip the parser: their Markdown is their
+// collapsed, escaped text, plus what append functions add to a document
+// in which no element was converted. That only holds while no added, keep
+// or remove rule can match the elements a parser wraps text in (html,
+// body, and libxml2's implied p), so services with rules of their own
+// always parse. The rest are parsed with a parser kept per thread.
+std::string TurndownService::turndownFragment(std::string_view html) const {
+    bool stockRules = ruleMutations_.empty() && preRuleFactories_.empty() && postRuleFactories_.empty() &&
+                      options_.keepTags.empty();
+    if (stockRules && options_.maxDepth == 0 && isPlainTextFragment(html)) {
+        std::shared_ptr<Rules const> ruleSet = ensureRules();
+        MarkdownBuffer output;
+        std::string text = collapsePlainText(html);
+        if (!text.empty()) processEscapedText(text, options_, output);
+        ConversionContext context(dom::NodeView{}, CollapsedWhitespace(), options_.preformattedCode);
+        appendRuleOutput(options_, *ruleSet, context, output);
+        std::string markdown = output.release();
+        finishMarkdown(markdown);
+        return markdown;
+    }
+    if (options_.useFlatDocument) return convertHtml(html, nullptr);
+    thread_local dom::Parser parser;
+    return convertHtml(html, nullptr, nullptr, &parser);
+}
+
+// Converts an HTML string within the given limits.
+LimitedConversion TurndownService::turndown(std::string const& html, ConversionLimits const& limits) const {
+    detail::LimitGuard guard(limits);
+    std::string markdown = convertHtml(html, nullptr, &guard);
+    return {std::move(markdown), guard.reached()};
+}
+
+// Converts a root node within the given limits.
+LimitedConversion TurndownService::turndown(dom::NodeView root, ConversionLimits const& limits) const {
+    detail::LimitGuard guard(limits);
+    std::string markdown = runPipeline(root, NoStats{}, nullptr, nullptr, &guard);
+    return {std::move(markdown), guard.reached()};
 }
 
 // Converts a gumbo root node to Markdown.
-std::string TurndownService::turndown(dom::NodeView root) {
-    return runPipeline(root);
+std::string TurndownService::turndown(dom::NodeView root) const {
+    return runPipeline(root, NoStats{});
 }
 
 // Converts a DomSource to Markdown.
-std::string TurndownService::turndown(DomSource const& dom) {
+std::string TurndownService::turndown(DomSource const& dom) const {
     return turndown(dom.root());
 }
 
+// Converts an HTML string, timing the parse as well as the pipeline.
+std::string TurndownService::turndown(std::string const& html, ConversionStats& stats) const {
+    auto start = StatsClock::now();
+    // The snapshot is part of the parse time.
+    dom::Document document;
+    dom::FlatDocument flat;
+    dom::NodeView root;
+    if (options_.useFlatDocument) {
+        flat = dom::FlatDocument::parse(html);
+        root = flat.root();
+    } else {
+        document = dom::Document::parse(html);
+        root = document.root();
+    }
+    auto parsed = StatsClock::now();
+
+    std::string markdown = turndown(root, stats);
+    stats.parseTime = parsed - start;
+    stats.totalTime += stats.parseTime;
+    stats.bytesIn = html.size();
+    return markdown;
+}
+
+// Converts a root node with the instrumented pipeline.
+std::string TurndownService::turndown(dom::NodeView root, ConversionStats& stats) const {
+    stats = ConversionStats{};
+    auto start = StatsClock::now();
+    std::string markdown = runPipeline(root, CollectStats{&stats});
+    stats.totalTime = StatsClock::now() - start;
+    stats.bytesOut = markdown.size();
+    return markdown;
+}
+
+// Streams the conversion of an HTML string.
+void TurndownService::turndown(std::string const& html, MarkdownSink const& sink) const {
+    if (options_.useFlatDocument) {
+        dom::FlatDocument flat = dom::FlatDocument::parse(html);
+        turndown(flat.root(), sink);
+        return;
+    }
+    dom::Document document = dom::Document::parse(html);
+    turndown(document.root(), sink);
+}
+
+// Streams the conversion of a root node.
+void TurndownService::turndown(dom::NodeView root, MarkdownSink const& sink) const {
+    runPipeline(root, NoStats{}, &sink);
+}
+
+// Streams the conversion of an HTML string into an output stream.
+void TurndownService::turndown(std::string const& html, std::ostream& out) const {
+    turndown(html, [&out](std::string_view chunk) { out.write(chunk.data(), static_cast<std::streamsize>(chunk.size())); });
+}
+
 /// Escape Markdown syntax.
 std::string TurndownService::escape(std::string const& text) const {
     return options_.escapeFunction ? options_.escapeFunction(text) : text;
@@ -409,36 +1217,71 @@ TurndownOptions const& TurndownService::options() const {
     return options_;
 }
 
+// Attaches or detaches a conversion cache.
+TurndownService& TurndownService::setCache(std::shared_ptr<ConversionCache> cache) {
+    cache_ = std::move(cache);
+    return *this;
+}
+
+// Key of a whole document under the current options and rules; none when
+// the configuration cannot be fingerprinted.
+std::optional<ConversionCache::Key> TurndownService::documentKey(std::string_view html) const {
+    std::shared_ptr<Rules const> rules = ensureRules();
+    std::optional<std::uint64_t> configuration = configurationFingerprint(options_, *rules);
+    if (!configuration) return std::nullopt;
+    return ConversionCache::Key{*configuration, contentHash(html), 0, html.size(), CacheLevel::Document};
+}
+
 // Clears cached rules so they will be rebuilt.
 void TurndownService::invalidateRules() {
+    std::lock_guard<std::mutex> lock(rulesMutex_);
     rules_.reset();
 }
 
 // Lazily builds or returns cached rules.
-Rules& TurndownService::ensureRules() {
+//
+// Conversions hold their own reference to the rule set, so the lock only
+// covers the (rare) rebuild and the pointer copy, never a conversion.
+std::shared_ptr<Rules const> TurndownService::ensureRules() const {
+    return ensureRulesForSharing();
+}
+
+// Builds the rule set if needed and returns it for another service to share.
+std::shared_ptr<Rules> TurndownService::ensureRulesForSharing() const {
+    std::lock_guard<std::mutex> lock(rulesMutex_);
     if (!rules_) {
-        rules_ = std::make_unique<Rules>(options_);
-        defineCommonMarkRules(*rules_, options_);
+        auto rules = std::make_shared<Rules>(options_);
+        defineCommonMarkRules(*rules, options_);
         for (auto& factory : preRuleFactories_) {
-            factory(*rules_);
+            factory(*rules);
         }
         for (auto& factory : postRuleFactories_) {
-            factory(*rules_);
+            factory(*rules);
         }
         for (auto& mutation : ruleMutations_) {
-            mutation(*rules_);
+            mutation(*rules);
         }
+        rules->compile();
+        rules_ = std::move(rules);
     }
-    return *rules_;
+    return rules_;
 }
 
 // Applies a pending rule mutation and caches it for future rebuilds.
+//
+// A rule set still referenced by a running conversion or by a clone is
+// never modified in place; the mutation is applied to a copy of it, which
+// gives the same rules as a rebuild without rerunning the factories.
 void TurndownService::enqueueRuleMutation(std::function<void(Rules&)> fn) {
     if (!fn) return;
     ruleMutations_.push_back(fn);
-    if (rules_) {
-        fn(*rules_);
+    std::lock_guard<std::mutex> lock(rulesMutex_);
+    if (!rules_) return;
+    if (rules_.use_count() != 1) {
+        rules_ = std::make_shared<Rules>(*rules_);
     }
+    fn(*rules_);
+    rules_->compile();
 }
 
 /**
@@ -446,47 +1289,95 @@ void TurndownService::enqueueRuleMutation(std::function<void(Rules&)> fn) {
  *
  * Executes the complete HTML to Markdown conversion:
  * -# Collapse whitespace in the DOM tree
- * -# Process all nodes recursively
+ * -# Convert all nodes in one post-order walk
  * -# Apply rule append functions (e.g., for reference links)
  * -# Encode NBSPs and trim edges
  *
+ * With a sink, the output is streamed to it during the walk and the
+ * return value is empty. With a pool (and neither a sink nor statistics),
+ * the top-level blocks are converted on it (see convertInParallel()).
+ * With limits, the conversion stops early as described in
+ * conversion_limits.h; they are not combined with a sink or a pool.
+ *
+ * @tparam Stats NoStats, or CollectStats to fill a ConversionStats
  * @param[in] root The root node to convert
+ * @param[in] stats Instrumentation policy
+ * @param[in] sink Receives the output in pieces; null to return it
+ * @param[in] pool Converts the top-level blocks in parallel; null for none
+ * @param[in,out] limits Budgets checked during the conversion; null for none
  * @return The final Markdown output
  */
-std::string TurndownService::runPipeline(dom::NodeView root) {
+template <typename Stats>
+std::string TurndownService::runPipeline(dom::NodeView root, Stats stats, MarkdownSink const* sink, ThreadPool* pool,
+                                         detail::LimitGuard* limits) const {
     if (!root) return "";
 
-    Rules& rules = ensureRules();
-    CollapsedWhitespace collapsed = collapseWhitespace(root, options_.preformattedCode);
-    setWhitespaceCollapseContext(collapsed.textReplacements, collapsed.nodesToOmit);
+    // Marks the end of a stage: adds the time since the previous mark.
+    [[maybe_unused]] StatsClock::time_point mark;
+    auto endStage = [&]([[maybe_unused]] std::chrono::nanoseconds ConversionStats::* stage) {
+        if constexpr (Stats::enabled) {
+            auto now = StatsClock::now();
+            stats.stats->*stage += now - mark;
+            mark = now;
+        }
+    };
 
-    std::string markdown = processChildren(root, options_, rules);
-    clearWhitespaceCollapseContext();
+    std::shared_ptr<Rules const> ruleSet = ensureRules();
+    Rules const& rules = *ruleSet;
+    // The arena is declared before the context so it outlives everything
+    // allocated from it.
+    std::optional<std::pmr::monotonic_buffer_resource> arena;
+    std::pmr::memory_resource* memory = std::pmr::get_default_resource();
+    if (options_.useConversionArena) {
+        memory = &arena.emplace(kConversionArenaInitialSize);
+    }
+    [[maybe_unused]] std::optional<CountingResource> counting;
+    if constexpr (Stats::enabled) {
+        memory = &counting.emplace(memory, *stats.stats);
+        mark = StatsClock::now();
+    }
+    std::optional<CollapsedWhitespace> collapsed;
+    try {
+        collapsed.emplace(collapseWhitespace(root, options_.preformattedCode, memory, prunedTags(options_, rules), limits));
+    } catch (ConversionLimitExceeded const&) {
+        // Nothing has been converted yet, so the partial result is empty.
+        if (!limits || limits->throws()) throw;
+        return "";
+    }
+    endStage(&ConversionStats::collapseTime);
+    ConversionContext context(root, std::move(*collapsed), options_.preformattedCode, memory);
+    std::optional<SubtreeCache> subtrees;
+    if (cache_ && cache_->minSubtreeBytes() > 0 && defaultElementReplacements(options_)) {
+        if (std::optional<std::uint64_t> configuration = configurationFingerprint(options_, rules)) {
+            subtrees.emplace(*cache_, *configuration, context, options_.maxDepth != 0);
+        }
+    }
+    endStage(&ConversionStats::annotateTime);
 
-    encodeNbsp(markdown);
+    MarkdownBuffer output;
+    std::optional<MarkdownStream> stream;
+    if (sink) stream.emplace(*sink);
+    bool converted = false;
+    if constexpr (!Stats::enabled) {
+        if (pool && !sink) converted = convertInParallel(options_, rules, context, output, subtrees ? &*subtrees : nullptr, *pool);
+    }
+    if (!converted) {
+        processChildren(0, options_, rules, context, output, stats, stream ? &*stream : nullptr, subtrees ? &*subtrees : nullptr, limits);
+    }
+    endStage(&ConversionStats::convertTime);
 
-    rules.forEach([&](Rule const& rule) {
-        if (rule.append) {
-            markdown = joinChunks(markdown, rule.append(options_));
-        }
-    });
-    encodeNbsp(markdown);
+    appendRuleOutput(options_, rules, context, output);
+    endStage(&ConversionStats::appendTime);
 
-    markdown = trimLeadingNewlines(markdown);
-    // Match Turndown JS: strip trailing whitespace but keep leading spaces (e.g., indented code)
-    auto trimTrailingWhitespace = [](std::string_view text) {
-        std::size_t end = text.size();
-        while (end > 0) {
-            char ch = text[end - 1];
-            if (ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r') {
-                --end;
-            } else {
-                break;
-            }
-        }
-        return std::string(text.substr(0, end));
-    };
-    markdown = trimTrailingWhitespace(markdown);
+    if (stream) {
+        stream->finish(output.release());
+        return "";
+    }
+
+    std::string markdown = output.release();
+    finishMarkdown(markdown);
+    if (limits) limits->limitOutput(markdown);
+    endStage(&ConversionStats::finalizeTime);
     return markdown;
 }
 
@@ -11,7 +11,10 @@
 /// @copyright Copyright (c) 2017 Dom Christie
 /// @copyright C++ port copyright (c) 2025 Parsa Amini
 
+#include "collapse_whitespace.h"
 #include "dom_adapter.h"
+#include "simd_scan.h"
+#include "tag_id.h"
 #include "turndown.h"
 #include "utf8_helpers.h"
 #include "utilities.h"
@@ -23,154 +26,96 @@
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
-#include <span>
 #include <string>
 #include <string_view>
-#include <unordered_map>
-#include <unordered_set>
 #include <vector>
 
 namespace turndown_cpp {
 
 namespace {
 
-std::unordered_map<dom::NodeHandle, std::string> const kEmptyCollapsedText{};
-std::unordered_set<dom::NodeHandle> const kEmptyCollapsedSkip{};
+using utf8::CodepointSlice;
 
-struct CollapseContext {
-    std::unordered_map<dom::NodeHandle, std::string> const* text = &kEmptyCollapsedText;
-    std::unordered_set<dom::NodeHandle> const* skip = &kEmptyCollapsedSkip;
-    bool engaged = false;
-};
-
-CollapseContext gCollapse{};
-
-} // namespace
-
-// Sets the optional whitespace collapse context for gumbo nodes.
-void setWhitespaceCollapseContext(
-    std::unordered_map<dom::NodeHandle, std::string> const& collapsedText,
-    std::unordered_set<dom::NodeHandle> const& nodesToOmit) {
-    gCollapse.text = &collapsedText;
-    gCollapse.skip = &nodesToOmit;
-    gCollapse.engaged = true;
+// Next node of a preorder walk over the subtree of root, or a null view
+// once the walk is done. With descend false the children of node are
+// skipped. The walk follows parent and sibling links, so it needs no stack
+// however deep the tree is.
+dom::NodeView nextInSubtree(dom::NodeView node, dom::NodeView root, bool descend) {
+    if (descend) {
+        if (dom::NodeView child = node.first_child()) return child;
+    }
+    while (node != root) {
+        if (dom::NodeView sibling = node.next_sibling()) return sibling;
+        node = node.parent();
+    }
+    return {};
 }
 
-// Clears the whitespace collapse context.
-void clearWhitespaceCollapseContext() {
-    gCollapse.text = &kEmptyCollapsedText;
-    gCollapse.skip = &kEmptyCollapsedSkip;
-    gCollapse.engaged = false;
+// True if any element descendant's tag is in the provided set.
+bool hasDescendantWithTag(dom::NodeView node, dom::TagSet const& tags) {
+    if (!node.is_element()) return false;
+    for (dom::NodeView current = nextInSubtree(node, node, true); current;) {
+        if (tags.contains(current.tag_id())) return true;
+        current = nextInSubtree(current, node, current.is_element());
+    }
+    return false;
 }
 
-namespace {
-
-using utf8::Utf8Char;
-
-// Decodes `text` into Unicode code points while remembering where each
-// character started in the original byte stream. Invalid sequences degrade to
-// a single-byte code point so callers don't skip over potentially malformed
-// input.
-// Decodes `text` into Unicode code points while remembering where each
-// character started in the original byte stream. Invalid sequences degrade to
-// a single-byte code point so callers don't skip over potentially malformed
-// input.
-std::vector<Utf8Char> decodeUtf8(std::string const& text) {
-    std::vector<Utf8Char> result;
-    result.reserve(text.size());
-
-    auto decode_one = [&](std::size_t i) -> Utf8Char {
-        unsigned char lead = static_cast<unsigned char>(text[i]);
-
-        // ASCII fast-path.
-        if (utf8::isAsciiLead(lead)) {
-            return Utf8Char{lead, i, 1};
-        }
-
-        // Determine expected length from the leading byte.
-        std::size_t expected_len = utf8::expectedLength(lead);
-
-        // If the prefix is invalid or truncated, treat as a single byte.
-        if (expected_len == 1 || i + expected_len > text.size()) {
-            return Utf8Char{lead, i, 1};
+// Gathers the text pieces of a subtree. The first non-empty piece is only
+// borrowed; the scratch string is written to once a second one turns up.
+class TextCollector {
+public:
+    explicit TextCollector(std::string& scratch) : scratch_(scratch) {}
+
+    void add(std::string_view piece) {
+        if (piece.empty()) return;
+        if (!spilled_ && borrowed_.empty()) {
+            borrowed_ = piece;
+            return;
         }
-
-        // Build code point while validating continuation bytes.
-        std::uint32_t codepoint = lead & (utf8::kLeadPayloadMask >> expected_len); // strip leading prefix bits
-        for (std::size_t j = 1; j < expected_len; ++j) {
-            unsigned char cont = static_cast<unsigned char>(text[i + j]);
-            if (!utf8::isContinuation(cont)) {
-                return Utf8Char{lead, i, 1};
-            }
-            codepoint = (codepoint << 6) | (cont & utf8::kContinuationPayload);
+        if (!spilled_) {
+            scratch_.assign(borrowed_);
+            spilled_ = true;
         }
-
-        // Reject overlong sequences, surrogates, or out-of-range code points.
-        if (utf8::isInvalidCodepoint(codepoint, expected_len)) {
-            return Utf8Char{lead, i, 1};
-        }
-
-        return Utf8Char{codepoint, i, expected_len};
-    };
-
-    for (std::size_t i = 0; i < text.size();) {
-        Utf8Char decoded = decode_one(i);
-        result.push_back(decoded);
-        i += decoded.length;
+        scratch_.append(piece);
     }
 
-    return result;
-}
-
-using TagList = std::span<std::string_view const>;
-
-// True if the node's tag matches any in the provided list.
-bool nodeHasTag(dom::NodeView node, TagList tags) {
-    if (!node.is_element()) return false;
-    std::string tag = node.tag_name();
-    return std::any_of(tags.begin(), tags.end(),
-        [&](std::string_view candidate) { return tag == candidate; });
-        }
+    std::string_view view() const { return spilled_ ? std::string_view(scratch_) : borrowed_; }
 
-// True if any descendant matches a tag in the provided list.
-bool hasDescendantWithTag(dom::NodeView node, TagList tags) {
-    if (!node.is_element()) return false;
-    return std::any_of(node.child_range().begin(), node.child_range().end(),
-        [&](dom::NodeView child) {
-            return nodeHasTag(child, tags) || hasDescendantWithTag(child, tags);
-        });
-        }
+private:
+    std::string& scratch_;
+    std::string_view borrowed_;
+    bool spilled_ = false;
+};
 
-// Collects text content for a node, honoring collapse context omissions.
-std::string collectText(dom::NodeView node) {
-    if (!node) return "";
-    dom::NodeHandle handle = node.handle();
-    if (gCollapse.engaged && gCollapse.skip->count(handle)) {
-        return "";
-    }
-    switch (node.type()) {
-        case dom::NodeType::Text:
-        case dom::NodeType::Whitespace:
-        case dom::NodeType::CData: {
-            if (gCollapse.engaged) {
-                auto it = gCollapse.text->find(handle);
-                if (it != gCollapse.text->end()) {
-                    return it->second;
-                }
-            }
-            std::string text(node.text());
-            return text;
+// Collects text content for a node, honoring collapse omissions and
+// replacements when a collapse result is supplied.
+// The collapse result numbers nodes in preorder, so only the root's ordinal
+// is looked up: while no subtree is skipped, each node's ordinal is one
+// more than the previous node's.
+void collectText(dom::NodeView root, CollapsedWhitespace const* collapsed, TextCollector& text) {
+    constexpr std::uint32_t npos = CollapsedWhitespace::npos;
+    std::uint32_t ordinal = collapsed ? collapsed->ordinal(root) : npos;
+    for (dom::NodeView node = root; node;) {
+        bool descend = false;
+        switch (node.type()) {
+            case dom::NodeType::Text:
+            case dom::NodeType::Whitespace:
+            case dom::NodeType::CData:
+                text.add(collapsed ? collapsed->text(ordinal, node) : node.text());
+                break;
+            case dom::NodeType::Element:
+            case dom::NodeType::Document:
+                descend = !collapsed || (!collapsed->isOmitted(ordinal) && !collapsed->pruned().contains(node.tag_id()));
+                break;
+            default:
+                break;
         }
-        case dom::NodeType::Element:
-        case dom::NodeType::Document: {
-            std::string text;
-            for (auto child : node.child_range()) {
-                text += collectText(child);
-            }
-            return text;
+        bool skipsChildren = !descend && node.first_child();
+        node = nextInSubtree(node, root, descend);
+        if (ordinal != npos) {
+            ordinal = skipsChildren ? (node ? collapsed->ordinal(node) : npos) : ordinal + 1;
         }
-        default:
-            return "";
     }
 }
 
@@ -178,10 +123,15 @@ std::string collectText(dom::NodeView node) {
 
 namespace {
 
-// Escapes HTML text or attribute values.
-std::string escapeHtml(std::string const& text, bool attribute) {
-    std::string output;
-    output.reserve(text.size());
+// Appends HTML text or an attribute value to @p output, escaped. Text with
+// nothing to escape, the common case, is appended in one piece.
+void appendEscapedHtml(std::string_view text, bool attribute, std::string& output) {
+    std::string_view const special = attribute ? std::string_view("&<>\"'") : std::string_view("&<>");
+    if (text.find_first_of(special) == std::string_view::npos) {
+        output.append(text);
+        return;
+    }
+    output.reserve(output.size() + text.size());
     for (char c : text) {
         switch (c) {
             case '&': output += "&amp;"; break;
@@ -198,60 +148,73 @@ std::string escapeHtml(std::string const& text, bool attribute) {
                 break;
         }
     }
-    return output;
 }
 
-// Serializes a gumbo node back to HTML.
-void serializeNodeRecursive(dom::NodeView node, std::string& output) {
-    if (!node) return;
-
+// Writes a node's own markup: text, a comment or an element's start tag.
+// Returns true if its children and end tag follow.
+bool serializeOpening(dom::NodeView node, std::string& output) {
     switch (node.type()) {
         case dom::NodeType::Text:
         case dom::NodeType::Whitespace:
-        case dom::NodeType::CData: {
-            std::string text(node.text());
-            output += escapeHtml(text, false);
-            break;
-        }
-        case dom::NodeType::Comment: {
-            std::string comment(node.text());
-            output += "<!--" + comment + "-->";
-            break;
-        }
-        case dom::NodeType::Document: {
-            for (auto child : node.child_range()) {
-                serializeNodeRecursive(child, output);
-            }
-            break;
-        }
+        case dom::NodeType::CData:
+            appendEscapedHtml(node.text(), false, output);
+            return false;
+        case dom::NodeType::Comment:
+            output += "<!--";
+            output += node.text();
+            output += "-->";
+            return false;
+        case dom::NodeType::Document:
+            return true;
         case dom::NodeType::Element: {
-            std::string tag = node.tag_name();
             output += "<";
-            output += tag;
+            output += node.tag_name();
 
             for (auto attr : node.attribute_range()) {
                 output += " ";
                 output += attr.name;
                 output += "=\"";
-                output += escapeHtml(std::string(attr.value), true);
+                appendEscapedHtml(attr.value, true, output);
                 output += "\"";
             }
-
-            bool voidElement = isVoid(node);
             output += ">";
+            return !isVoid(node);
+        }
+        default:
+            return false;
+    }
+}
+
+// Writes the end tag of an element whose children have been written.
+void serializeClosing(dom::NodeView node, std::string& output) {
+    if (!node.is_element()) return;
+    output += "</";
+    output += node.tag_name();
+    output += ">";
+}
 
-            if (!voidElement) {
-                for (auto child : node.child_range()) {
-                    serializeNodeRecursive(child, output);
-                }
-                output += "</";
-                output += tag;
-                output += ">";
+// Serializes a gumbo node back to HTML, walking the subtree without
+// recursion and closing each element when the walk climbs out of it.
+void serializeSubtree(dom::NodeView root, std::string& output) {
+    dom::NodeView node = root;
+    while (node) {
+        bool open = serializeOpening(node, output);
+        if (open) {
+            if (dom::NodeView child = node.first_child()) {
+                node = child;
+                continue;
             }
-            break;
+            serializeClosing(node, output);
+        }
+        while (true) {
+            if (node == root) return;
+            if (dom::NodeView sibling = node.next_sibling()) {
+                node = sibling;
+                break;
+            }
+            node = node.parent();
+            serializeClosing(node, output);
         }
-        default:
-            break;
     }
 }
 
@@ -306,15 +269,7 @@ bool isAsciiWhitespace(char c) {
  * List matches the original JavaScript Turndown blockElements array.
  */
 bool isBlock(dom::NodeView node) {
-    static constexpr auto kBlockTags = std::to_array<std::string_view>({
-        "address", "article", "aside", "audio", "blockquote", "body", "canvas",
-        "center", "dd", "dir", "div", "dl", "dt", "fieldset", "figcaption",
-        "figure", "footer", "form", "frameset", "h1", "h2", "h3", "h4", "h5",
-        "h6", "header", "hgroup", "hr", "html", "isindex", "li", "main", "menu",
-        "nav", "noframes", "noscript", "ol", "output", "p", "pre", "section",
-        "table", "tbody", "td", "tfoot", "th", "thead", "tr", "ul"
-    });
-    return nodeHasTag(node, kBlockTags);
+    return dom::kBlockTags.contains(node.tag_id());
 }
 
 /**
@@ -326,27 +281,20 @@ bool isBlock(dom::NodeView node) {
  * List matches the original JavaScript Turndown voidElements array.
  */
 bool isVoid(dom::NodeView node) {
-    static constexpr auto kVoidTags = std::to_array<std::string_view>({
-        "area", "base", "br", "col", "command", "embed", "hr",
-        "img", "input", "keygen", "link", "meta", "param",
-        "source", "track", "wbr"
-    });
-    return nodeHasTag(node, kVoidTags);
+    return dom::kVoidTags.contains(node.tag_id());
 }
 
 // True if node has <pre> tag.
 bool isPre(dom::NodeView node) {
-    return node.has_tag("pre");
+    return node.tag_id() == dom::TagId::Pre;
 }
 
 // True if node is a <code> element or has a <code> ancestor.
 bool isCodeNode(dom::NodeView node) {
-    if (!node) return false;
-    if (node.type() == dom::NodeType::Element && node.tag_name() == "code") {
-        return true;
+    for (; node; node = node.parent()) {
+        if (node.tag_id() == dom::TagId::Code) return true;
     }
-    auto parent = node.parent();
-    return parent ? isCodeNode(parent) : false;
+    return false;
 }
 
 /**
@@ -360,128 +308,159 @@ bool isCodeNode(dom::NodeView node) {
  * List matches the original JavaScript Turndown meaningfulWhenBlankElements.
  */
 bool isMeaningfulWhenBlank(dom::NodeView node) {
-    static constexpr auto kMeaningfulTags = std::to_array<std::string_view>({
-        "a", "table", "thead", "tbody", "tfoot", "th", "td",
-        "iframe", "script", "audio", "video"
-    });
-    return nodeHasTag(node, kMeaningfulTags);
+    return dom::kMeaningfulWhenBlankTags.contains(node.tag_id());
 }
 
 // True if any descendant is meaningful when blank.
 bool hasMeaningfulWhenBlank(dom::NodeView node) {
-    static constexpr auto kMeaningfulTags = std::to_array<std::string_view>({
-        "a", "table", "thead", "tbody", "tfoot", "th", "td",
-        "iframe", "script", "audio", "video"
-    });
-    return hasDescendantWithTag(node, kMeaningfulTags);
+    return hasDescendantWithTag(node, dom::kMeaningfulWhenBlankTags);
 }
 
 // True if any descendant is a void element.
 bool hasVoid(dom::NodeView node) {
-    static constexpr auto kVoidTags = std::to_array<std::string_view>({
-        "area", "base", "br", "col", "command", "embed", "hr",
-        "img", "input", "keygen", "link", "meta", "param",
-        "source", "track", "wbr"
-    });
-    return hasDescendantWithTag(node, kVoidTags);
+    return hasDescendantWithTag(node, dom::kVoidTags);
 }
 
 // Returns concatenated text content from a gumbo node.
 std::string getNodeText(dom::NodeView node) {
-    return collectText(node);
+    std::string scratch;
+    TextCollector text(scratch);
+    collectText(node, nullptr, text);
+    return std::string(text.view());
 }
 
-// Trims Unicode whitespace from both ends of a UTF-8 string.
-std::string trimStr(std::string const& s) {
-    if (s.empty()) return "";
-    auto chars = decodeUtf8(s);
-    if (chars.empty()) return "";
-
-    auto not_ws_front = std::find_if(chars.begin(), chars.end(), [](Utf8Char const& ch) {
-        return !isUnicodeWhitespace(ch.codepoint);
-    });
-    if (not_ws_front == chars.end()) {
-        return "";
-    }
-
-    auto not_ws_back = std::find_if(chars.rbegin(), chars.rend(), [](Utf8Char const& ch) {
-        return !isUnicodeWhitespace(ch.codepoint);
-    });
+// Gets text content after whitespace collapsing.
+std::string getNodeText(dom::NodeView node, CollapsedWhitespace const& collapsed) {
+    std::string scratch;
+    return std::string(getNodeTextView(node, collapsed, scratch));
+}
 
-    std::size_t startByte = not_ws_front->start;
-    std::size_t endByte = not_ws_back->start + not_ws_back->length;
-    return s.substr(startByte, endByte - startByte);
+// Borrows the collapsed text when it is a single piece, else builds it in scratch.
+std::string_view getNodeTextView(dom::NodeView node, CollapsedWhitespace const& collapsed, std::string& scratch) {
+    TextCollector text(scratch);
+    collectText(node, &collapsed, text);
+    return text.view();
 }
 
+// Trims Unicode whitespace from both ends of a UTF-8 string.
+std::string trimStr(std::string const& s) {
+    std::size_t leading = leadingWhitespaceLength(s);
+    if (leading == s.size()) return "";
+    return s.substr(leading, s.size() - leading - trailingWhitespaceLength(s));
+}
 
-/// Advanced escape function for Markdown syntax.
-std::string advancedEscape(std::string const& input) {
-    auto escape_char = [](std::string& text, char needle, std::string const& replacement) {
-        std::string result;
-        result.reserve(text.size() + 8);
-        for (char c : text) {
-            if (c == needle) {
-                result += replacement;
-            } else {
-                result.push_back(c);
-            }
+// Skips ASCII whitespace runs with the vector scan and decodes only at the
+// non-ASCII bytes it stops on.
+std::size_t leadingWhitespaceLength(std::string_view text) {
+    std::size_t index = 0;
+    while (true) {
+        index = simd::findFirstNotOf<' ', '\t', '\n', '\v', '\f', '\r'>(text, index);
+        if (index == std::string_view::npos) return text.size();
+        CodepointSlice slice;
+        if (utf8::isAsciiLead(static_cast<unsigned char>(text[index])) || !utf8::decodeAt(text, index, slice) ||
+            !isUnicodeWhitespace(slice.codepoint)) {
+            return index;
         }
-        text.swap(result);
-    };
+        index += slice.length;
+    }
+}
 
-    std::string output = input;
+// The same from the end; decodeBefore() keeps the code point boundaries a
+// forward decode would find.
+std::size_t trailingWhitespaceLength(std::string_view text) {
+    std::size_t end = text.size();
+    while (true) {
+        std::size_t last = simd::findLastNotOf<' ', '\t', '\n', '\v', '\f', '\r'>(text, end);
+        if (last == std::string_view::npos) return text.size();
+        CodepointSlice slice;
+        if (utf8::isAsciiLead(static_cast<unsigned char>(text[last])) || !utf8::decodeBefore(text, last + 1, slice) ||
+            !isUnicodeWhitespace(slice.codepoint)) {
+            return text.size() - last - 1;
+        }
+        end = slice.start;
+    }
+}
 
-    escape_char(output, '\\', "\\\\"); // backslash
-    escape_char(output, '*', "\\*");   // asterisk
+bool isWhitespaceOnly(std::string_view text) {
+    return leadingWhitespaceLength(text) == text.size();
+}
 
-    if (!output.empty() && output.front() == '-') { // leading dash
-        output.insert(0, "\\");
-    }
 
-    if (output.size() >= 2 && output[0] == '+' && output[1] == ' ') { // leading plus+space
-        output.insert(0, "\\");
-    }
+namespace {
 
-    if (!output.empty() && output.front() == '=') { // leading equals
+// Offset before which a line-start escape is needed, or npos.
+//
+// Only the start of the text can look like a block construct, and at most
+// one of the prefixes can apply since they all begin with different bytes.
+std::size_t linePrefixEscapeOffset(std::string_view input) {
+    if (input.empty()) return std::string_view::npos;
+    switch (input.front()) {
+    case '-': // unordered list or setext underline
+    case '=': // setext heading
+    case '>': // blockquote
+        return 0;
+    case '+': // unordered list
+        return input.size() >= 2 && input[1] == ' ' ? 0 : std::string_view::npos;
+    case '~': // fenced code
+        return input.starts_with("~~~") ? 0 : std::string_view::npos;
+    case '#': { // atx heading
         std::size_t count = 0;
-        while (count < output.size() && output[count] == '=') ++count;
-        output.insert(0, "\\");
+        while (count < input.size() && input[count] == '#') ++count;
+        bool heading = count <= 6 && count < input.size() && input[count] == ' ';
+        return heading ? 0 : std::string_view::npos;
     }
-
-    if (!output.empty() && output.front() == '#') { // heading prefix
-        std::size_t count = 0;
-        while (count < output.size() && output[count] == '#') ++count;
-        if (count >= 1 && count <= 6 && output.size() > count && output[count] == ' ') {
-            output.insert(0, "\\");
-        }
+    default:
+        break;
     }
-
-    escape_char(output, '`', "\\`"); // backtick
-
-    if (output.rfind("~~~", 0) == 0) { // fenced code ~~~ at start
-        output.insert(0, "\\");
+    // Ordered list: the backslash goes between the digits and ". ".
+    std::size_t digits = 0;
+    while (digits < input.size() && std::isdigit(static_cast<unsigned char>(input[digits]))) ++digits;
+    if (digits > 0 && digits + 1 < input.size() && input[digits] == '.' && input[digits + 1] == ' ') {
+        return digits;
     }
+    return std::string_view::npos;
+}
 
-    escape_char(output, '[', "\\[");
-    escape_char(output, ']', "\\]");
+// Offset of the next byte that is escaped wherever it appears.
+std::size_t findInlineSpecial(std::string_view input, std::size_t from) {
+    return simd::findAny<'\\', '*', '`', '[', ']', '_'>(input, from);
+}
 
-    if (!output.empty() && output.front() == '>') { // blockquote
-        output.insert(0, "\\");
-    }
+} // namespace
 
-    escape_char(output, '_', "\\_");
+// True if advancedEscapeInto() would change the text.
+bool needsAdvancedEscape(std::string_view input) {
+    return linePrefixEscapeOffset(input) != std::string_view::npos ||
+           findInlineSpecial(input, 0) != std::string_view::npos;
+}
 
-    // ordered list prefix: digits + ". "
-    if (!output.empty() && std::isdigit(static_cast<unsigned char>(output[0]))) {
-        std::size_t idx = 0;
-        while (idx < output.size() && std::isdigit(static_cast<unsigned char>(output[idx]))) {
-            ++idx;
-        }
-        if (idx + 1 < output.size() && output[idx] == '.' && output[idx + 1] == ' ') {
-            output.insert(idx, "\\");
-        }
+// Single pass: the line-start prefix first, then each special byte found
+// by the vector scan, copying the ordinary runs in between wholesale.
+void advancedEscapeInto(std::string_view input, std::string& output) {
+    std::size_t pos = 0;
+    if (std::size_t prefix = linePrefixEscapeOffset(input); prefix != std::string_view::npos) {
+        output.append(input.substr(0, prefix));
+        output.push_back('\\');
+        pos = prefix;
+    }
+    for (std::size_t special = findInlineSpecial(input, pos); special != std::string_view::npos;
+         special = findInlineSpecial(input, pos)) {
+        output.append(input.substr(pos, special - pos));
+        output.push_back('\\');
+        output.push_back(input[special]);
+        pos = special + 1;
     }
+    output.append(input.substr(pos));
+}
 
+/// Advanced escape function for Markdown syntax.
+std::string advancedEscape(std::string const& input) {
+    if (!needsAdvancedEscape(input)) {
+        return input;
+    }
+    std::string output;
+    output.reserve(input.size() + input.size() / 8 + 2);
+    advancedEscapeInto(input, output);
     return output;
 }
 
@@ -512,9 +491,17 @@ std::string repeatChar(char c, int count) {
 // Serializes a gumbo node to HTML string.
 std::string serializeNode(dom::NodeView node) {
     std::string html;
-    serializeNodeRecursive(node, html);
+    if (node) serializeSubtree(node, html);
     return html;
 }
 
+// Copies the node's source bytes when the backend kept them.
+std::string serializeNodeSource(dom::NodeView node) {
+    if (!node) return {};
+    std::string_view source = node.source_html();
+    if (!source.empty()) return std::string(source);
+    return serializeNode(node);
+}
+
 
 } // namespace turndown_cpp
\ No newline at end of file
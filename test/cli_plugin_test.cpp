@@ -168,3 +168,14 @@ TEST(CliPluginTests, LoadsRuntimePlugin) {
     EXPECT_EQ(out, "Hello ==world==");
 }
 
+TEST(CliPluginTests, RegisterPluginConvertsOnOneThread) {
+    std::string out = runCli({"--plugin", TURNDOWN_PLUGIN_PATH, "-j", "4"}, "<mark>x</mark>");
+    EXPECT_EQ(out, "Plugin 'cli_sample_plugin_mark' is not thread-safe; converting on one thread\n==x==");
+}
+
+TEST(CliPluginTests, LoadsDescriptorPlugin) {
+    std::string html = "<p>Hello <ins>new</ins> <ins data-skip=\"1\">old</ins></p><aside>Ad</aside>";
+    std::string out = runCli({"--plugin", TURNDOWN_PLUGIN_V2_PATH, "--plugin", TURNDOWN_PLUGIN_PATH}, html + "<mark>x</mark>");
+    EXPECT_EQ(out, "Hello ++new++ old\n\n==x==");
+}
+
@@ -1,4 +1,4 @@
-// A minimal runtime plugin for turndown_cli used by tests.
+// A minimal version 1 (register-style) runtime plugin for turndown_cli used by tests.
 //
 // This is built as a shared library and loaded via `--plugin <path>`.
 
@@ -10,7 +10,7 @@
 #include <string>
 
 extern "C" TURNDOWN_CPP_CLI_PLUGIN_EXPORT std::uint32_t turndown_cpp_cli_plugin_abi_version() {
-    return turndown_cpp::cli_plugin::kAbiVersion;
+    return turndown_cpp::cli_plugin::kAbiVersionLegacy;
 }
 
 extern "C" TURNDOWN_CPP_CLI_PLUGIN_EXPORT char const* turndown_cpp_cli_plugin_name() {
@@ -0,0 +1,46 @@
+// A minimal version 2 (descriptor) runtime plugin for turndown_cli used by tests.
+//
+// Only the C declarations are included and turndown_cpp is not linked: the
+// host reaches back into the conversion through the function table alone.
+
+#include "../include/cli_plugin_abi.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace {
+
+char const* const kInsTags[] = {"ins", nullptr};
+char const* const kAsideTags[] = {"aside", nullptr};
+
+// Elements marked data-skip fall through to the default rule.
+int insFilter(void*, turndown_cpp_plugin_host const* host, turndown_cpp_plugin_node const* node,
+              turndown_cpp_plugin_options const*) {
+    return host->attribute(node, "data-skip").size == 0;
+}
+
+void insReplacement(void*, turndown_cpp_plugin_host const* host, turndown_cpp_plugin_string content,
+                    turndown_cpp_plugin_node const*, turndown_cpp_plugin_options const*,
+                    turndown_cpp_plugin_output* output) {
+    host->append(output, "++", 2);
+    host->append(output, content.data, content.size);
+    host->append(output, "++", 2);
+}
+
+turndown_cpp_plugin_rule const kRules[] = {
+    {"ins", kInsTags, 0, insFilter, insReplacement, nullptr},
+    {"aside", kAsideTags, TURNDOWN_CPP_RULE_REMOVE, nullptr, nullptr, nullptr},
+};
+
+turndown_cpp_plugin_descriptor const kDescriptor = {
+    "cli_sample_plugin_ins", TURNDOWN_CPP_PLUGIN_THREAD_SAFE, kRules, sizeof kRules / sizeof kRules[0]};
+
+} // namespace
+
+extern "C" TURNDOWN_CPP_CLI_PLUGIN_EXPORT std::uint32_t turndown_cpp_cli_plugin_abi_version() {
+    return 2;
+}
+
+extern "C" TURNDOWN_CPP_CLI_PLUGIN_EXPORT turndown_cpp_plugin_descriptor const* turndown_cpp_cli_plugin_descriptor() {
+    return &kDescriptor;
+}
@@ -7,6 +7,7 @@
 #include <cstring>
 #include <filesystem>
 #include <fstream>
+#include <iterator>
 #include <chrono>
 #include <optional>
 #include <stdexcept>
@@ -169,5 +170,78 @@ TEST(CliTests, AppliesOptions) {
     EXPECT_EQ(out, "```\ncode\n```");
 }
 
+std::string readFile(std::filesystem::path const& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+TEST(CliTests, BatchConvertsDirectoryAndList) {
+    namespace fs = std::filesystem;
+    fs::path input = makeTempPath("turndown_cli_batch_in_", "");
+    fs::path output = makeTempPath("turndown_cli_batch_out_", "");
+    fs::create_directories(input / "nested");
+    std::ofstream(input / "a.html") << "<h1>A</h1>";
+    std::ofstream(input / "nested" / "b.htm") << "<p>B</p>";
+    std::ofstream(input / "empty.html");
+
+    std::string summary = runCli({"--batch", input.string(), "--output-dir", output.string(), "-j", "2", "--atx-headings"}, "");
+    EXPECT_NE(summary.find("Converted 3 of 3 files (0 failed)"), std::string::npos) << summary;
+    EXPECT_EQ(readFile(output / "a.md"), "# A");
+    EXPECT_EQ(readFile(output / "nested" / "b.md"), "B");
+    EXPECT_TRUE(fs::exists(output / "empty.md"));
+
+    fs::path listed = makeTempPath("turndown_cli_batch_list_out_", "");
+    auto list = writeTempFile("turndown_cli_batch_list_", ".txt", (input / "a.html").string() + "\n\n" + (input / "nested" / "b.htm").string() + "\n");
+    runCli({"--batch", list.string(), "--output-dir", listed.string()}, "");
+    EXPECT_EQ(readFile(listed / "a.md"), "A\n=");
+    EXPECT_EQ(readFile(listed / "nested" / "b.md"), "B");
+
+    // Listed files of the same name keep their directories apart, and a
+    // second input for the same output fails instead of overwriting it.
+    fs::create_directories(input / "other");
+    std::ofstream(input / "other" / "a.html") << "<p>other</p>";
+    std::ofstream(input / "a.htm") << "<p>htm</p>";
+    fs::path same = makeTempPath("turndown_cli_batch_same_out_", "");
+    auto sameList = writeTempFile("turndown_cli_batch_same_", ".txt",
+                                  (input / "a.html").string() + "\n" + (input / "other" / "a.html").string() + "\n" + (input / "a.htm").string() + "\n");
+    EXPECT_THROW(runCli({"--batch", sameList.string(), "--output-dir", same.string()}, ""), std::runtime_error);
+    EXPECT_EQ(readFile(same / "a.md"), "A\n=");
+    EXPECT_EQ(readFile(same / "other" / "a.md"), "other");
+
+    std::ofstream(list, std::ios::app) << (input / "missing.html").string() << "\n";
+    EXPECT_THROW(runCli({"--batch", list.string(), "--output-dir", listed.string()}, ""), std::runtime_error);
+
+    std::error_code ec;
+    fs::remove_all(input, ec);
+    fs::remove_all(output, ec);
+    fs::remove_all(listed, ec);
+    fs::remove_all(same, ec);
+    fs::remove(list, ec);
+    fs::remove(sameList, ec);
+}
+
+TEST(CliTests, ServesFramedRequests) {
+    std::string first = "<h1>One</h1>";
+    std::string second = "<h1>Two</h1><p>a<br>b</p>";
+    std::string requests = std::to_string(first.size()) + "\n" + first +
+                           std::to_string(second.size()) + " headingStyle=atx br=%5C\n" + second +
+                           std::to_string(first.size()) + " bogus=1\n" + first;
+    std::string out = runCli({"--serve"}, requests);
+    EXPECT_EQ(out, "ok 7\nOne\n===" "ok 11\n# Two\n\na\\\nb" "error 22\nunknown option 'bogus'");
+}
+
+TEST(CliTests, ServeRejectsOversizedRequests) {
+    // The length overflows std::size_t; the server must answer, not abort.
+    for (std::string header : {"99999999999999999999\n", "9\n"}) {
+        try {
+            runCli({"--serve", "--max-request-bytes", "8"}, header + "<p>x</p>");
+            ADD_FAILURE() << "oversized request accepted: " << header;
+        } catch (std::runtime_error const& e) {
+            EXPECT_NE(std::string(e.what()).find("error 41\nrequest body exceeds the limit of 8 bytes"), std::string::npos) << e.what();
+        }
+    }
+    EXPECT_EQ(runCli({"--serve", "--max-request-bytes", "8"}, "8\n<p>x</p>"), "ok 1\nx");
+}
+
 } // namespace
 
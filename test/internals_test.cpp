@@ -1,11 +1,30 @@
 // turndown.cpp/test/internals_test.cpp
 #include <gtest/gtest.h>
 
+#include "../include/collapse_whitespace.h"
+#include "../include/conversion_cache.h"
+#include "../include/markdown_buffer.h"
 #include "../include/node.h"
+#include "../include/utilities.h"
 
 #include "dom_adapter.h"
+#include "flat_document.h"
+#include "simd_scan.h"
+#include "tag_id.h"
+#include "thread_pool.h"
+#include "turndown.h"
+#include "utf8_helpers.h"
 
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory_resource>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -90,6 +109,537 @@ TEST(InternalsTest, EdgeWhitespaceDetection) {
 }
 
 
+TEST(InternalsTest, MarkdownBufferJoinsInPlace) {
+    MarkdownBuffer buffer;
+    buffer.append("\n\nfirst\n");
+    buffer.append("\n\n\nsecond");
+    buffer.append("");
+    buffer.append(" third\n");
+    buffer.append("fourth");
+    ASSERT_EQ(buffer.str(), "\n\nfirst\n\nsecond third\nfourth");
+}
+
+TEST(InternalsTest, MarkdownBufferTakesSettledText) {
+    MarkdownBuffer buffer;
+    buffer.append("first");
+    ASSERT_EQ(buffer.takeSettled(), "first");
+    ASSERT_TRUE(buffer.str().empty());
+    // Still joined against the text that was taken.
+    buffer.append("\n\n\n\nsecond  \n");
+    ASSERT_EQ(buffer.takeSettled(), "\n\nsecond");
+    ASSERT_EQ(buffer.str(), "  \n");
+
+    std::size_t segment = buffer.beginSegment();
+    buffer.append("inner");
+    ASSERT_TRUE(buffer.takeSettled().empty());
+    buffer.takeSegment(segment);
+}
+
+TEST(InternalsTest, MarkdownBufferSegmentsJoinInIsolation) {
+    MarkdownBuffer buffer;
+    buffer.append("before\n\n");
+
+    std::size_t segment = buffer.beginSegment();
+    ASSERT_TRUE(buffer.segmentEmpty());
+    buffer.append("\ninner");
+    buffer.append("\n\nmore");
+    std::string content = buffer.takeSegment(segment);
+
+    // The first chunk of a segment is not joined against the outer text.
+    ASSERT_EQ(content, "\ninner\n\nmore");
+    ASSERT_EQ(buffer.str(), "before\n\n");
+
+    buffer.append("\n" + content + "\n");
+    ASSERT_EQ(buffer.release(), "before\n\ninner\n\nmore\n");
+    ASSERT_TRUE(buffer.str().empty());
+}
+
+TEST(InternalsTest, NodeTableMatchesNodeAnalysis) {
+    std::string html =
+        "<div> <p>Hello <em> big </em><strong>\xC2\xA0world</strong> </p>"
+        "<ul><li> one <a href=\"#\"> </a></li><li><br> </li></ul>"
+        "text <code> x </code> <span> <img src=\"a.png\"> </span>"
+        "<table><tr><td> </td></tr></table><!-- note --> tail </div>";
+    dom::Document document = dom::Document::parse(html);
+    dom::NodeView root = document.root();
+    ASSERT_TRUE(root);
+
+    for (bool preformattedCode : {false, true}) {
+        CollapsedWhitespace collapsed = collapseWhitespace(root, preformattedCode);
+        NodeTable table(root, collapsed, preformattedCode);
+        ASSERT_GT(table.size(), 1u);
+        ASSERT_EQ(table.find(root), 0u);
+
+        // The root is converted through its children only, so its own
+        // siblings are never consulted; start at its first descendant.
+        for (std::uint32_t i = 1; i < table.size(); ++i) {
+            dom::NodeView node = table[i].node;
+            ASSERT_EQ(table.find(node), i);
+            ASSERT_EQ(table[i].textLength, getNodeText(node, collapsed).size());
+
+            NodeMetadata expected = analyzeNode(node, preformattedCode, collapsed);
+            NodeMetadata actual = table.metadata(i);
+            EXPECT_EQ(actual.isBlock, expected.isBlock) << "node " << i;
+            EXPECT_EQ(actual.isCode, expected.isCode) << "node " << i;
+            EXPECT_EQ(actual.isBlank, expected.isBlank) << "node " << i;
+            EXPECT_EQ(actual.isVoid, expected.isVoid) << "node " << i;
+            EXPECT_EQ(actual.isMeaningfulWhenBlank, expected.isMeaningfulWhenBlank) << "node " << i;
+            EXPECT_EQ(actual.hasMeaningfulWhenBlank, expected.hasMeaningfulWhenBlank) << "node " << i;
+            EXPECT_EQ(actual.hasVoidDescendant, expected.hasVoidDescendant) << "node " << i;
+            EXPECT_EQ(actual.flankingWhitespace.leading, expected.flankingWhitespace.leading) << "node " << i;
+            EXPECT_EQ(actual.flankingWhitespace.trailing, expected.flankingWhitespace.trailing) << "node " << i;
+        }
+    }
+}
+
+TEST(InternalsTest, DocumentBuilderMatchesWholeParse) {
+    // Chunk boundaries land inside tags, entities, attribute values and the
+    // multi-byte UTF-8 sequences; a literal "a < b" must stay text.
+    std::string html =
+        "<h1>Caf\xC3\xA9 \xE2\x9C\x93</h1><p>If a < b &amp; <a href=\"/x?q=1&amp;r=2\">go</a></p>"
+        "<pre><code>x &lt; y\n</code></pre><ul><li>one</li><li>two</li></ul>";
+    TurndownService service;
+    std::string expected = service.turndown(html);
+
+    for (std::size_t chunkSize : {std::size_t{1}, std::size_t{3}, std::size_t{64}}) {
+        dom::DocumentBuilder builder;
+        for (std::size_t offset = 0; offset < html.size(); offset += chunkSize) {
+            builder.feed(std::string_view(html).substr(offset, chunkSize));
+        }
+        dom::Document document = builder.finish();
+        ASSERT_TRUE(document) << "chunk size " << chunkSize;
+        EXPECT_EQ(service.turndown(document.root()), expected) << "chunk size " << chunkSize;
+    }
+
+    // No input behaves like parsing an empty string.
+    dom::DocumentBuilder empty;
+    EXPECT_EQ(static_cast<bool>(empty.finish()), static_cast<bool>(dom::Document::parse("")));
+}
+
+TEST(InternalsTest, ParserReusesStateAcrossDocuments) {
+    std::vector<std::string> pages = {
+        "<h1>First</h1><p>One <a href=\"/1\" title=\"T\">link</a></p>",
+        "<ul><li>a</li><li>b &lt; c</li></ul>",
+        "",
+        "<pre><code>x = 1\n</code></pre><p>If a < b</p>",
+    };
+    TurndownService service;
+    dom::Parser parser;
+    // A document still in use is unaffected by later parses.
+    dom::Document kept = parser.parse(pages[0]);
+    for (int round = 0; round < 2; ++round) {
+        for (auto const& page : pages) {
+            dom::Document document = parser.parse(page);
+            EXPECT_EQ(static_cast<bool>(document), static_cast<bool>(dom::Document::parse(page)));
+            EXPECT_EQ(service.turndown(document.root()), service.turndown(page)) << page;
+            parser.recycle(std::move(document));
+            EXPECT_FALSE(document);
+        }
+    }
+    EXPECT_EQ(service.turndown(kept.root()), service.turndown(pages[0]));
+    parser.recycle(dom::Document::parse(pages[1]));
+}
+
+namespace {
+
+// Counts what is outstanding, passing the requests on to a pool.
+struct CountingResource : std::pmr::memory_resource {
+    std::pmr::unsynchronized_pool_resource pool;
+    std::size_t allocations = 0;
+    std::size_t outstanding = 0;
+
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+        ++allocations;
+        outstanding += bytes;
+        return pool.allocate(bytes, alignment);
+    }
+    void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override {
+        outstanding -= bytes;
+        pool.deallocate(p, bytes, alignment);
+    }
+    bool do_is_equal(std::pmr::memory_resource const& other) const noexcept override { return this == &other; }
+};
+
+} // namespace
+
+TEST(InternalsTest, BackendBlocksRememberTheirResource) {
+    // The gumbo and Tidy allocator callbacks pass no resource or size back;
+    // the blocks carry both.
+    CountingResource memory;
+    auto* block = static_cast<char*>(dom::detail::allocateFrom(&memory, 5));
+    std::memcpy(block, "abcde", 5);
+    EXPECT_EQ(memory.allocations, 1u);
+    EXPECT_EQ(dom::detail::reallocateFrom(block, 3), block);
+
+    auto* grown = static_cast<char*>(dom::detail::reallocateFrom(block, 4096));
+    EXPECT_EQ(std::string_view(grown, 5), "abcde");
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(grown) % alignof(std::max_align_t), 0u);
+    EXPECT_EQ(memory.allocations, 2u);
+
+    dom::detail::deallocateFrom(grown);
+    dom::detail::deallocateFrom(nullptr);
+    EXPECT_EQ(memory.outstanding, 0u);
+}
+
+TEST(InternalsTest, ParserAllocatesFromCallerMemory) {
+#if defined(TURNDOWN_PARSER_BACKEND_LEXBOR) || defined(TURNDOWN_PARSER_BACKEND_LIBXML2) || \
+    (defined(TURNDOWN_PARSER_BACKEND_GUMBO) && !defined(TURNDOWN_GUMBO_HAS_ALLOCATOR))
+    GTEST_SKIP() << "Skipped: the parser backend has no per-parser allocator";
+#endif
+    std::vector<std::string> pages = {
+        "<h1>First</h1><p>One <a href=\"/1\" title=\"T\">link</a> <img src=\"i.png\" alt=\"I\"></p>",
+        "<ul><li>a</li><li>b &lt; c</li></ul>",
+        "",
+    };
+    TurndownService service;
+    CountingResource memory;
+    {
+        dom::Parser parser(&memory);
+        for (int round = 0; round < 2; ++round) {
+            for (auto const& page : pages) {
+                dom::Document document = parser.parse(page);
+                EXPECT_EQ(service.turndown(document.root()), service.turndown(page)) << page;
+                parser.recycle(std::move(document));
+            }
+        }
+        EXPECT_GT(memory.allocations, 0u);
+
+        // Documents may outlive their parser, as long as the memory does.
+        dom::Document kept = parser.parse(pages[0]);
+        parser = dom::Parser();
+        EXPECT_EQ(service.turndown(kept.root()), service.turndown(pages[0]));
+    }
+    EXPECT_EQ(memory.outstanding, 0u);
+
+    // Without a resource, a parser allocates as Parser() does.
+    dom::Parser unpooled(nullptr);
+    EXPECT_EQ(service.turndown(unpooled.parse(pages[0]).root()), service.turndown(pages[0]));
+}
+
+TEST(InternalsTest, ParserBackendIsSelectablePerParse) {
+    std::string html = "<h1>Title</h1><p>Some <em>text</em> and <a href=\"/x\" title=\"X\">a link</a>.</p>"
+                       "<ul><li>one</li><li>two</li></ul>";
+    TurndownService service;
+    std::string expected = service.turndown(html);
+
+    std::vector<dom::ParserBackend> backends = dom::availableParserBackends();
+    ASSERT_FALSE(backends.empty());
+    EXPECT_EQ(backends.front(), dom::defaultParserBackend());
+    for (dom::ParserBackend backend : backends) {
+        dom::Document document = dom::Document::parse(html, backend);
+        ASSERT_TRUE(document) << dom::toString(backend);
+        EXPECT_EQ(document.backend(), backend);
+        EXPECT_EQ(service.turndown(document.root()), expected) << dom::toString(backend);
+    }
+
+    // Auto keeps small inputs on the default backend and sends large ones
+    // to lexbor when it is there.
+    EXPECT_EQ(dom::selectParserBackend(dom::ParserBackend::Auto, 100), dom::defaultParserBackend());
+    dom::ParserBackend large = dom::selectParserBackend(dom::ParserBackend::Auto, dom::kAutoLargeInputBytes);
+    EXPECT_EQ(large, dom::isParserBackendAvailable(dom::ParserBackend::Lexbor) ? dom::ParserBackend::Lexbor
+                                                                              : dom::defaultParserBackend());
+    EXPECT_EQ(dom::Document::parse(html, dom::ParserBackend::Auto).backend(), dom::defaultParserBackend());
+
+    for (dom::ParserBackend backend : {dom::ParserBackend::Gumbo, dom::ParserBackend::Tidy,
+                                       dom::ParserBackend::Lexbor, dom::ParserBackend::Libxml2}) {
+        if (!dom::isParserBackendAvailable(backend)) {
+            EXPECT_THROW(dom::Document::parse(html, backend), std::invalid_argument) << dom::toString(backend);
+        }
+    }
+}
+
+TEST(InternalsTest, FlatDocumentMirrorsBackendTree) {
+    std::string html =
+        "<h1 id=\"top\">Title</h1><p>Some <em>text</em> and <a href=\"/x\" title=\"X\">a link</a>.</p>"
+        "<pre><code class=\"language-js\">let a = 1;\n</code></pre><!-- note -->"
+        "<ul><li>one</li><li>two <img src=\"a.png\" alt=\"A\"></li></ul><table><tr><td>cell</td></tr></table>";
+    dom::Document document = dom::Document::parse(html);
+    dom::FlatDocument flat = dom::FlatDocument::build(document.root());
+    ASSERT_TRUE(flat);
+
+    // Walk both trees in preorder, in lockstep.
+    std::vector<std::pair<dom::NodeView, dom::NodeView>> pending{{document.root(), flat.root()}};
+    std::size_t count = 0;
+    while (!pending.empty()) {
+        auto [expected, actual] = pending.back();
+        pending.pop_back();
+        ++count;
+        ASSERT_EQ(actual.type(), expected.type());
+        EXPECT_EQ(actual.tag_id(), expected.tag_id());
+        EXPECT_EQ(actual.tag_name(), expected.tag_name());
+        EXPECT_EQ(actual.text(), expected.text());
+        EXPECT_EQ(actual.is_text_like(), expected.is_text_like());
+        EXPECT_EQ(actual.attribute("HREF"), expected.attribute("HREF"));
+        EXPECT_EQ(actual.has_attribute("title"), expected.has_attribute("title"));
+        std::vector<std::pair<std::string, std::string>> expectedAttrs;
+        std::vector<std::pair<std::string, std::string>> actualAttrs;
+        for (auto attr : expected.attribute_range()) expectedAttrs.emplace_back(attr.name, attr.value);
+        for (auto attr : actual.attribute_range()) actualAttrs.emplace_back(attr.name, attr.value);
+        EXPECT_EQ(actualAttrs, expectedAttrs);
+        EXPECT_EQ(actual.attribute_range().size(), expectedAttrs.size());
+        EXPECT_EQ(expected.attribute_range().empty(), expectedAttrs.empty());
+
+        std::vector<dom::NodeView> expectedChildren = expected.children();
+        std::vector<dom::NodeView> actualChildren = actual.children();
+        ASSERT_EQ(actualChildren.size(), expectedChildren.size());
+        for (std::size_t i = 0; i < actualChildren.size(); ++i) {
+            EXPECT_EQ(actualChildren[i].parent(), actual);
+            pending.emplace_back(expectedChildren[i], actualChildren[i]);
+        }
+    }
+    EXPECT_EQ(flat.size(), count);
+    EXPECT_EQ(flat.root().text_content(), document.root().text_content());
+
+    // The pipeline gives identical Markdown, kept HTML included.
+    TurndownService service;
+    service.keep(std::vector<std::string>{"table"});
+    EXPECT_EQ(service.turndown(flat.root()), service.turndown(document.root()));
+
+    // A parsed snapshot outlives the backend tree it was copied from.
+    dom::FlatDocument parsed = dom::FlatDocument::parse(html);
+    EXPECT_EQ(parsed.size(), flat.size());
+    EXPECT_EQ(service.turndown(parsed.root()), service.turndown(document.root()));
+}
+
+TEST(InternalsTest, TagIdsMapNamesAndClassify) {
+    EXPECT_EQ(dom::tagIdFromName("blockquote"), dom::TagId::Blockquote);
+    EXPECT_EQ(dom::tagIdFromName("IMG"), dom::TagId::Img);
+    EXPECT_EQ(dom::tagIdFromName("x-widget"), dom::TagId::Unknown);
+    EXPECT_EQ(dom::tagIdFromName(""), dom::TagId::Unknown);
+    EXPECT_EQ(dom::tagName(dom::TagId::H3), "h3");
+    EXPECT_EQ(dom::tagName(dom::TagId::Unknown), "");
+
+    EXPECT_TRUE(dom::kBlockTags.contains(dom::TagId::P));
+    EXPECT_FALSE(dom::kBlockTags.contains(dom::TagId::Span));
+    EXPECT_TRUE(dom::kVoidTags.contains(dom::TagId::Br));
+    EXPECT_TRUE(dom::kMeaningfulWhenBlankTags.contains(dom::TagId::Td));
+    EXPECT_FALSE(dom::kBlockTags.contains(dom::TagId::Unknown));
+
+    dom::Document document = dom::Document::parse("<p>text<br><x-widget>w</x-widget></p>");
+    dom::NodeView p = document.body().find_child("p");
+    ASSERT_TRUE(p);
+    std::vector<dom::TagId> tags;
+    for (auto child : p.child_range()) {
+        tags.push_back(child.tag_id());
+    }
+    EXPECT_EQ(p.tag_id(), dom::TagId::P);
+    ASSERT_EQ(tags.size(), 3u);
+    EXPECT_EQ(tags[0], dom::TagId::Unknown); // text node
+    EXPECT_EQ(tags[1], dom::TagId::Br);
+    EXPECT_EQ(tags[2], dom::TagId::Unknown);
+}
+
+TEST(InternalsTest, CollapseInstantiationsAgree) {
+    dom::Document document = dom::Document::parse(
+        "<div> <p> one  <em> two </em>\n three </p><pre>  kept  </pre><br>  four <img src=\"x\"> five </div>");
+    dom::NodeView root = document.root();
+
+    // The facade overload walks the backend's own nodes; the template
+    // instantiated on dom::NodeView goes through the facade for every step.
+    CollapsedWhitespace native = collapseWhitespace(root, false);
+    CollapsedWhitespace generic = collapseWhitespace<dom::NodeView>(root, false);
+    ASSERT_EQ(native.size(), generic.size());
+    for (std::uint32_t i = 0; i < native.size(); ++i) {
+        EXPECT_EQ(native.isOmitted(i), generic.isOmitted(i)) << "ordinal " << i;
+        EXPECT_EQ(native.isReplaced(i), generic.isReplaced(i)) << "ordinal " << i;
+    }
+
+    // Ordinals number every node in preorder, preformatted content included.
+    std::uint32_t ordinal = 0;
+    for (dom::NodeView node = root; node; ++ordinal) {
+        ASSERT_EQ(native.ordinal(node), ordinal);
+        EXPECT_EQ(native.text(node), generic.text(ordinal, node));
+        if (dom::NodeView child = node.first_child()) {
+            node = child;
+            continue;
+        }
+        while (node && !node.next_sibling()) node = node.parent();
+        if (node) node = node.next_sibling();
+    }
+    EXPECT_EQ(native.size(), ordinal);
+}
+
+TEST(InternalsTest, CollapsedTextIsBorrowedUnlessRewritten) {
+#ifdef TURNDOWN_PARSER_BACKEND_TIDY
+    GTEST_SKIP() << "Skipped: Tidy normalizes whitespace in text nodes";
+#endif
+    dom::Document document = dom::Document::parse("<div><p>plain text</p><p>a  \n b</p></div>");
+    dom::NodeView div = document.body().find_child("div");
+    ASSERT_TRUE(div);
+    CollapsedWhitespace collapsed = collapseWhitespace(div, false);
+
+    dom::NodeView plain = div.first_child().first_text_child();
+    dom::NodeView spaced = div.first_child().next_sibling().first_text_child();
+    ASSERT_TRUE(plain);
+    ASSERT_TRUE(spaced);
+    EXPECT_EQ(collapsed.text(plain), "plain text");
+    EXPECT_EQ(collapsed.text(plain).data(), plain.text().data());
+    EXPECT_EQ(collapsed.text(spaced), "a b");
+    EXPECT_EQ(collapsed.rewrittenCount(), 1u);
+
+    std::string scratch;
+    std::string_view text = getNodeTextView(div.first_child(), collapsed, scratch);
+    EXPECT_EQ(text.data(), plain.text().data());
+    EXPECT_TRUE(scratch.empty());
+    EXPECT_EQ(getNodeTextView(div, collapsed, scratch), "plain texta b");
+}
+
+TEST(InternalsTest, SimdScanMatchesScalar) {
+    // Place a needle at every offset of a text longer than two vectors so
+    // both the vector loop and the scalar tail report it.
+    std::string base(80, 'a');
+    for (std::size_t at = 0; at < base.size(); ++at) {
+        std::string text = base;
+        text[at] = '_';
+        EXPECT_EQ((simd::findAny<'*', '_'>(text)), at);
+        EXPECT_EQ((simd::findAny<'*', '_'>(text, at)), at);
+        EXPECT_EQ((simd::findAny<'*', '_'>(text, at + 1)), std::string_view::npos);
+        EXPECT_EQ((simd::findAnyScalar<'*', '_'>(text)), at);
+    }
+    EXPECT_EQ((simd::findAny<'*'>(base)), std::string_view::npos);
+    EXPECT_EQ((simd::findAny<'*'>(std::string_view{})), std::string_view::npos);
+
+    std::string spaces(80, ' ');
+    for (std::size_t at = 0; at < spaces.size(); ++at) {
+        std::string text = spaces;
+        text[at] = 'x';
+        EXPECT_EQ((simd::findFirstNotOf<' ', '\t'>(text)), at);
+        EXPECT_EQ((simd::findLastNotOf<' ', '\t'>(text)), at);
+        EXPECT_EQ((simd::findLastNotOf<' ', '\t'>(text, at)), std::string_view::npos);
+        EXPECT_EQ((simd::findFirstNotOf<' ', '\t'>(text, at + 1)), std::string_view::npos);
+    }
+    EXPECT_EQ((simd::findFirstNotOf<' '>(spaces)), std::string_view::npos);
+    EXPECT_EQ((simd::findLastNotOf<' '>(std::string_view{})), std::string_view::npos);
+}
+
+TEST(InternalsTest, WhitespaceScanMatchesFullDecode) {
+    // Pieces include Unicode spaces, stray continuation bytes that decode
+    // to U+0085 and U+00A0, and a truncated sequence.
+    std::vector<std::string> const pieces = {" ", "\t\n", "a", "\xC2\xA0", "\xE2\x80\x83", "\xA0",
+                                             "\x85", "\xE2\x80", "\xC3\xA9", std::string(40, ' ')};
+    auto reference = [](std::string_view text) {
+        std::vector<utf8::CodepointSlice> slices;
+        utf8::CodepointSlice slice;
+        for (std::size_t i = 0; utf8::decodeAt(text, i, slice); i += slice.length) slices.push_back(slice);
+        std::size_t leading = 0;
+        while (leading < slices.size() && isUnicodeWhitespace(slices[leading].codepoint)) ++leading;
+        std::size_t trailing = slices.size();
+        while (trailing > 0 && isUnicodeWhitespace(slices[trailing - 1].codepoint)) --trailing;
+        std::size_t leadingBytes = leading == slices.size() ? text.size() : slices[leading].start;
+        std::size_t trailingBytes = trailing == 0 ? text.size()
+                                                  : text.size() - slices[trailing - 1].start - slices[trailing - 1].length;
+        return std::pair{leadingBytes, trailingBytes};
+    };
+    std::uint32_t seed = 7;
+    for (int round = 0; round < 2000; ++round) {
+        std::string text;
+        for (int n = round % 9; n > 0; --n) {
+            seed = seed * 1103515245u + 12345u;
+            text += pieces[(seed >> 16) % pieces.size()];
+        }
+        auto [leading, trailing] = reference(text);
+        EXPECT_EQ(leadingWhitespaceLength(text), leading) << text;
+        EXPECT_EQ(trailingWhitespaceLength(text), trailing) << text;
+        EXPECT_EQ(isWhitespaceOnly(text), leading == text.size()) << text;
+    }
+}
+
+TEST(InternalsTest, AdvancedEscapeSinglePass) {
+    std::vector<std::pair<std::string, std::string>> cases = {
+        {"plain text", "plain text"},
+        {"", ""},
+        {"- item", "\\- item"},
+        {"+ item", "\\+ item"},
+        {"+item", "+item"},
+        {"=== heading", "\\=== heading"},
+        {"## heading", "\\## heading"},
+        {"####### seven", "####### seven"},
+        {"#hashtag", "#hashtag"},
+        {"~~~ fence", "\\~~~ fence"},
+        {"~~ strike", "~~ strike"},
+        {"> quote", "\\> quote"},
+        {"1984. A great year", "1984\\. A great year"},
+        {"1984.", "1984."},
+        {"*_[`]\\", "\\*\\_\\[\\`\\]\\\\"},
+        {"- *a* - b", "\\- \\*a\\* - b"},
+        {"12. _x_", "12\\. \\_x\\_"},
+    };
+    for (auto const& [input, expected] : cases) {
+        EXPECT_EQ(advancedEscape(input), expected) << input;
+        EXPECT_EQ(needsAdvancedEscape(input), input != expected) << input;
+        std::string buffer = "prefix:";
+        advancedEscapeInto(input, buffer);
+        EXPECT_EQ(buffer, "prefix:" + expected) << input;
+    }
+
+    // Specials spread across vector boundaries.
+    std::string text(100, 'x');
+    std::string expected;
+    for (std::size_t i = 0; i < text.size(); ++i) {
+        if (i % 7 == 3) text[i] = '*';
+        if (text[i] == '*') expected.push_back('\\');
+        expected.push_back(text[i]);
+    }
+    EXPECT_EQ(advancedEscape(text), expected);
+}
+
+TEST(InternalsTest, ConversionCacheEvictsLeastRecentlyUsed) {
+    EXPECT_EQ(contentHash("abc"), contentHash("abc"));
+    EXPECT_NE(contentHash("abc"), contentHash("abd"));
+    EXPECT_NE(contentHash("abc", 1), contentHash("abc"));
+    EXPECT_NE(combineHash(1, 2), combineHash(2, 1));
+
+    // One shard's share of the capacity holds two entries.
+    constexpr std::size_t kShardCapacity = 2 * (ConversionCache::kEntryOverhead + 8);
+    ConversionCache cache(16 * kShardCapacity, 0);
+    auto key = [](std::uint64_t n) {
+        ConversionCache::Key k;
+        k.content = n; // the top bits pick the shard: all of these share one
+        return k;
+    };
+    cache.insert(key(1), "markdown");
+    cache.insert(key(2), "markdown");
+    ASSERT_TRUE(cache.find(key(1)));
+    cache.insert(key(3), "markdown");
+    EXPECT_TRUE(cache.find(key(1)));
+    EXPECT_FALSE(cache.find(key(2)));
+    EXPECT_TRUE(cache.find(key(3)));
+    cache.insert(key(4), std::string(kShardCapacity, 'x')); // too large to store
+
+    ConversionCacheStats stats = cache.stats();
+    EXPECT_EQ(stats.insertions, 3u);
+    EXPECT_EQ(stats.evictions, 1u);
+    EXPECT_EQ(stats.entries, 2u);
+    EXPECT_EQ(stats.bytes, kShardCapacity);
+    EXPECT_EQ(stats.documentHits, 3u);
+    EXPECT_EQ(stats.documentMisses, 1u);
+}
+
+TEST(InternalsTest, ThreadPoolRunsEveryIndexOnce) {
+    ThreadPool pool(4);
+    EXPECT_EQ(pool.size(), 4u);
+    for (std::size_t count : {std::size_t{1}, std::size_t{3}, std::size_t{1000}}) {
+        std::vector<std::atomic<int>> hits(count);
+        std::vector<std::atomic<int>> workers(pool.size());
+        pool.parallelFor(count, [&](std::size_t index, std::size_t worker) {
+            // Make the first items slow so the other workers have to steal.
+            if (index < 4) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            hits[index].fetch_add(1);
+            workers[worker].fetch_add(1);
+        });
+        for (std::size_t i = 0; i < count; ++i) {
+            EXPECT_EQ(hits[i].load(), 1) << "index " << i << " of " << count;
+        }
+    }
+
+    EXPECT_THROW(pool.parallelFor(10, [](std::size_t index, std::size_t) {
+        if (index == 7) throw std::runtime_error("boom");
+    }), std::runtime_error);
+    std::atomic<int> afterError{0};
+    pool.parallelFor(10, [&](std::size_t, std::size_t) { afterError.fetch_add(1); });
+    EXPECT_EQ(afterError.load(), 10);
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
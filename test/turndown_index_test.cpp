@@ -14,6 +14,7 @@
 #include <string_view>
 #include <vector>
 #include <map>
+#include <memory>
 #include <sstream>
 #include <cctype>
 #include <cstddef>
@@ -21,14 +22,27 @@
 #include <cstring>
 
 // Include the actual turndown implementation
+#include "thread_pool.h"
 #include "turndown.h"
 #include "utilities.h"
 
 using namespace turndown_cpp;
 
+// How turndownPort() feeds the HTML in and gets the Markdown out.
+enum class PortMode {
+    Whole,         // one string in, one string out
+    FlatDocument,  // through a dom::FlatDocument snapshot
+    Chunked,       // fed to a dom::DocumentBuilder in 7-byte chunks
+    Streamed,      // collected from the streaming overload's sink
+    Cached,        // converted twice with every block element cached
+    Parallel,      // top-level blocks converted on a thread pool
+};
+
 // Wrapper function to convert options map to TurndownOptions
-std::string turndownPort(std::string const& htmlInput, std::map<std::string, std::string> const& options = {}) {
+std::string turndownPort(std::string const& htmlInput, std::map<std::string, std::string> const& options = {},
+                         PortMode mode = PortMode::Whole) {
     turndown_cpp::TurndownOptions opts;
+    opts.useFlatDocument = mode == PortMode::FlatDocument;
     
     // Apply options from map
     if (options.find("headingStyle") != options.end()) {
@@ -65,6 +79,34 @@ std::string turndownPort(std::string const& htmlInput, std::map<std::string, std
         opts.preformattedCode = (options.at("preformattedCode") == "true");
     }
     
+    if (mode == PortMode::Chunked) {
+        constexpr std::size_t kChunkSize = 7;
+        dom::DocumentBuilder builder;
+        for (std::size_t offset = 0; offset < htmlInput.size(); offset += kChunkSize) {
+            builder.feed(std::string_view(htmlInput).substr(offset, kChunkSize));
+        }
+        dom::Document document = builder.finish();
+        return TurndownService(opts).turndown(document.root());
+    }
+    if (mode == PortMode::Cached) {
+        // The first conversion reuses repeated subtrees of the document,
+        // the second is answered from the cache.
+        TurndownService service(opts);
+        service.setCache(std::make_shared<ConversionCache>(ConversionCache::kDefaultCapacity, 1));
+        dom::Document document = dom::Document::parse(htmlInput);
+        std::string first = service.turndown(document.root());
+        std::string second = service.turndown(document.root());
+        return first == second ? first : "cached conversion differs:\n" + first + "\n---\n" + second;
+    }
+    if (mode == PortMode::Parallel) {
+        static ThreadPool pool(4);
+        return TurndownService(opts).turndown(htmlInput, pool);
+    }
+    if (mode == PortMode::Streamed) {
+        std::string markdown;
+        TurndownService(opts).turndown(htmlInput, [&](std::string_view chunk) { markdown.append(chunk); });
+        return markdown;
+    }
     return turndown(htmlInput, opts);
 }
 
@@ -90,6 +132,27 @@ std::string multiline(std::vector<std::string> const& lines) {
     return oss.str();
 }
 
+// Code-dense documentation page: many inline code spans and fenced blocks
+// that contain backticks and fence-like lines. Registered with the other
+// cases so it is also benchmarked, guarding the code rules against
+// per-node regex construction creeping back in.
+TestCase codeDenseCase(int sections = 200) {
+    std::string html;
+    std::vector<std::string> expected;
+    for (int i = 0; i < sections; ++i) {
+        html += "<p>Call <code>f(`x`)</code> then <code>`tick</code></p>"
+                "<pre><code class=\"lang language-cpp\">int a;\n```\nb\n</code></pre>";
+        expected.push_back("Call ``f(`x`)`` then `` `tick ``");
+        expected.push_back("````cpp\nint a;\n```\nb\n````");
+    }
+    std::string markdown;
+    for (std::size_t i = 0; i < expected.size(); ++i) {
+        if (i) markdown += "\n\n";
+        markdown += expected[i];
+    }
+    return {"code dense documentation", html, markdown, {{"codeBlockStyle", "fenced"}}};
+}
+
 // All test cases from test/index.html, test/internals-test.js, and test/turndown-test.js
 static std::vector<TestCase> ALL_TEST_CASES = {
     // Basic paragraph tests
@@ -498,6 +561,8 @@ static std::vector<TestCase> ALL_TEST_CASES = {
      "fasdf *883 asdf wer qweasd fsd asdf asdfaqwe rqwefrsdf",
      "fasdf \\*883 asdf wer qweasd fsd asdf asdfaqwe rqwefrsdf"},
     
+    codeDenseCase(),
+
     // Non-ASCII whitespace tests (from internals-test.js)
     // Note: These test the edgeWhitespace function specifically, which may need separate handling
     // For now, we include them as regular conversion tests
@@ -528,6 +593,16 @@ TEST_P(TurndownTests, ConvertsCorrectly)
     std::string result = turndownPort(tc.html, tc.options);
     EXPECT_EQ(result, tc.expected) 
         << "Failure in test case: " << tc.name;
+    EXPECT_EQ(turndownPort(tc.html, tc.options, PortMode::FlatDocument), tc.expected)
+        << "Failure in test case (flat document): " << tc.name;
+    EXPECT_EQ(turndownPort(tc.html, tc.options, PortMode::Chunked), tc.expected)
+        << "Failure in test case (fed in chunks): " << tc.name;
+    EXPECT_EQ(turndownPort(tc.html, tc.options, PortMode::Streamed), tc.expected)
+        << "Failure in test case (streamed): " << tc.name;
+    EXPECT_EQ(turndownPort(tc.html, tc.options, PortMode::Cached), tc.expected)
+        << "Failure in test case (cached): " << tc.name;
+    EXPECT_EQ(turndownPort(tc.html, tc.options, PortMode::Parallel), tc.expected)
+        << "Failure in test case (parallel): " << tc.name;
 }
 
 static std::string SanitizeName(std::string const& input, int index) {
@@ -2,12 +2,32 @@
 #include <gtest/gtest.h>
 
 #include "turndown.h"
+#include "batch_converter.h"
+#include "commonmark_rules.h"
+#include "conversion_context.h"
+#include "incremental_converter.h"
 #include "rules.h"
 #include "dom_source.h"
 #include "dom_adapter.h"
+#include "node.h"
+#include "thread_pool.h"
+#include "utilities.h"
 
+#include <algorithm>
 #include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <fstream>
+#include <sstream>
+#include <stop_token>
+#include <stdexcept>
+#include <string_view>
 #include <string>
+#include <thread>
+#include <vector>
 
 using namespace turndown_cpp;
 
@@ -175,6 +195,447 @@ TEST(TurndownTest, Blockquote) {
     ASSERT_EQ(turndown("<blockquote><p>This is a paragraph within a blockquote.</p><p>This is another paragraph within a blockquote.</p></blockquote>", options), "> This is a paragraph within a blockquote.\n> \n> This is another paragraph within a blockquote.");
 }
 
+TEST(TurndownTest, WideSiblingList) {
+    TurndownOptions options;
+    std::string html = "<ul>";
+    std::string expected;
+    for (int i = 0; i < 5000; ++i) {
+        html += "<li>Item " + std::to_string(i) + "</li>";
+        if (i > 0) expected += "\n";
+        expected += "*   Item " + std::to_string(i);
+    }
+    html += "</ul>";
+    ASSERT_EQ(turndown(html, options), expected);
+}
+
+TEST(TurndownServiceTest, ConstServiceConvertsConcurrently) {
+    TurndownService const service;
+    std::vector<std::string> inputs;
+    std::vector<std::string> expected;
+    for (int i = 0; i < 8; ++i) {
+        std::string n = std::to_string(i);
+        inputs.push_back("<p>  Doc   " + n + " <em> spaced </em>  text </p><ul><li>item " + n + "</li></ul>");
+        expected.push_back("Doc " + n + " _spaced_ text\n\n*   item " + n);
+    }
+
+    std::vector<std::vector<std::string>> results(inputs.size());
+    std::vector<std::thread> threads;
+    for (std::size_t t = 0; t < inputs.size(); ++t) {
+        threads.emplace_back([&, t] {
+            for (int round = 0; round < 50; ++round) {
+                results[t].push_back(service.turndown(inputs[t]));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (std::size_t t = 0; t < inputs.size(); ++t) {
+        for (auto const& result : results[t]) {
+            ASSERT_EQ(result, expected[t]);
+        }
+    }
+}
+
+TEST(TurndownServiceTest, ConversionArenaMatchesDefaultAllocation) {
+    std::string html =
+        "<h1>Title</h1><p>  Some <em> spaced </em>\n text with <code>a  b</code> and "
+        "<a href=\"http://example.com\" title=\"t\">a link</a>.</p>"
+        "<ul><li>one <b> </b></li><li>two\t\tspaced</li></ul>"
+        "<pre><code class=\"language-js\">let x = 1;\n</code></pre>"
+        "<blockquote><p>\xC2\xA0quoted\xC2\xA0</p></blockquote>";
+    TurndownOptions options;
+    options.linkStyle = "referenced";
+    std::string expected = TurndownService(options).turndown(html);
+
+    options.useConversionArena = true;
+    TurndownService service(options);
+    EXPECT_EQ(service.turndown(html), expected);
+    EXPECT_EQ(service.turndown(html), expected);
+}
+
+TEST(TurndownServiceTest, ConversionStatsCountStagesAndRules) {
+    std::string html = "<h1>Title</h1><p>One <em>two</em> <em>three</em> *four*</p>";
+    TurndownService service;
+    std::string expected = service.turndown(html);
+
+    ConversionStats stats;
+    EXPECT_EQ(service.turndown(html, stats), expected);
+    EXPECT_EQ(stats.bytesIn, html.size());
+    EXPECT_EQ(stats.bytesOut, expected.size());
+    EXPECT_EQ(stats.rules["emphasis"].hits, 2u);
+    EXPECT_EQ(stats.rules["h1"].hits, 1u);
+    EXPECT_EQ(stats.rules["paragraph"].hits, 1u);
+    EXPECT_EQ(stats.elementsVisited, 4u);
+    EXPECT_GE(stats.textNodesVisited, 4u);
+    EXPECT_EQ(stats.nodesVisited, stats.elementsVisited + stats.textNodesVisited);
+    EXPECT_GT(stats.allocations, 0u);
+    EXPECT_GT(stats.totalTime.count(), 0);
+    EXPECT_GE(stats.totalTime, stats.parseTime + stats.collapseTime + stats.convertTime);
+    EXPECT_GE(stats.convertTime, stats.escapeTime);
+
+    // Stats are overwritten, not accumulated, by the next conversion.
+    service.turndown("<p>x</p>", stats);
+    EXPECT_EQ(stats.rules.count("emphasis"), 0u);
+}
+
+TEST(TurndownServiceTest, StreamingFlushesBlocksBeforeTheEnd) {
+    std::string html = "<main><div><h1>Title</h1><p>One&nbsp;<a href=\"/a\">a</a></p></div>"
+                       "<blockquote><p>Quoted</p></blockquote><p>Two <a href=\"/b\">b</a></p></main>";
+    TurndownOptions options;
+    options.linkStyle = "referenced";
+    TurndownService service(options);
+    std::string expected = service.turndown(html);
+
+    std::vector<std::string> chunks;
+    service.turndown(html, [&](std::string_view chunk) { chunks.emplace_back(chunk); });
+    std::string joined;
+    for (auto const& chunk : chunks) joined += chunk;
+    EXPECT_EQ(joined, expected);
+    // Blocks below the default-converted <main> and <div> arrive one by one;
+    // the link definitions come last.
+    ASSERT_GE(chunks.size(), 4u);
+    EXPECT_EQ(chunks.front(), "Title\n=====");
+    EXPECT_EQ(chunks.back().find("[1]: /a"), chunks.back().find_first_not_of('\n'));
+
+    std::ostringstream out;
+    service.turndown(html, out);
+    EXPECT_EQ(out.str(), expected);
+
+    // A rule on the enclosing element holds its content back until it is done.
+    service.keep("main");
+    chunks.clear();
+    service.turndown(html, [&](std::string_view chunk) { chunks.emplace_back(chunk); });
+    ASSERT_FALSE(chunks.empty());
+    EXPECT_TRUE(chunks.front().starts_with("<main>") && chunks.front().ends_with("</main>")) << chunks.front();
+}
+
+TEST(TurndownServiceTest, MaxDepthFlattensDeepElements) {
+    // Kept below the nesting limit some parser backends impose.
+    std::string html;
+    for (int i = 0; i < 200; ++i) html += "<div>";
+    html += "<p>a <em>b</em> *c*</p>";
+    for (int i = 0; i < 200; ++i) html += "</div>";
+
+    TurndownService unlimited;
+    EXPECT_EQ(unlimited.turndown(html), "a _b_ \\*c\\*");
+
+    TurndownOptions options;
+    options.maxDepth = 50;
+    TurndownService limited(options);
+    ConversionStats stats;
+    EXPECT_EQ(limited.turndown(html, stats), "a b \\*c\\*");
+    EXPECT_LE(stats.elementsVisited, 52u);
+}
+
+TEST(TurndownServiceTest, BatchConverterKeepsOrderAndReportsErrors) {
+    TurndownService service;
+    service.addRule("explode", {
+        .filter = [](dom::NodeView node, TurndownOptions const&) { return node.has_tag("blink"); },
+        .replacement = [](std::string const&, dom::NodeView, TurndownOptions const&) -> std::string {
+            throw std::runtime_error("blink is not supported");
+        }
+    });
+
+    std::vector<std::string> html;
+    for (int i = 0; i < 64; ++i) {
+        html.push_back(i == 5 ? "<p><blink>no</blink></p>" : "<h1>Doc " + std::to_string(i) + "</h1>");
+    }
+    std::vector<std::string_view> documents(html.begin(), html.end());
+
+    BatchConverter batch(service, 4);
+    EXPECT_EQ(batch.workers(), 4u);
+    std::vector<BatchResult> results = batch.convert(documents);
+    ASSERT_EQ(results.size(), documents.size());
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        if (i == 5) {
+            EXPECT_FALSE(results[i].ok());
+            EXPECT_EQ(results[i].error, "blink is not supported");
+            EXPECT_TRUE(results[i].markdown.empty());
+            continue;
+        }
+        EXPECT_TRUE(results[i].ok()) << results[i].error;
+        std::string title = "Doc " + std::to_string(i);
+        EXPECT_EQ(results[i].markdown, title + "\n" + std::string(title.size(), '='));
+        EXPECT_LT(results[i].worker, batch.workers());
+        EXPECT_GE(results[i].parseTime.count(), 0);
+    }
+    EXPECT_TRUE(batch.convert({}).empty());
+}
+
+TEST(TurndownServiceTest, ConversionCacheAnswersRepeatedDocuments) {
+    auto cache = std::make_shared<ConversionCache>();
+    TurndownService service;
+    service.setCache(cache);
+    std::string const html = "<h1>Title</h1><p>Some <em>text</em></p>";
+    std::string const expected = TurndownService().turndown(html);
+
+    EXPECT_EQ(service.turndown(html), expected);
+    EXPECT_EQ(service.turndown(html), expected);
+    ConversionCacheStats stats = cache->stats();
+    EXPECT_EQ(stats.documentMisses, 1u);
+    EXPECT_EQ(stats.documentHits, 1u);
+
+    // A rule change starts afresh.
+    service.addRule("loud", {
+        .filter = [](dom::NodeView node, TurndownOptions const&) { return node.has_tag("em"); },
+        .replacement = [](std::string const& content, dom::NodeView, TurndownOptions const&) { return content + "!"; }
+    });
+    EXPECT_EQ(service.turndown(html), "Title\n=====\n\nSome text!");
+    EXPECT_EQ(cache->stats().documentMisses, 2u);
+
+    // So does an option change made in place.
+    service.options().headingStyle = "atx";
+    EXPECT_EQ(service.turndown(html), "# Title\n\nSome text!");
+
+    std::vector<std::string_view> documents(8, html);
+    BatchConverter batch(service, 2);
+    for (BatchResult const& result : batch.convert(documents)) {
+        EXPECT_TRUE(result.cached);
+        EXPECT_EQ(result.markdown, "# Title\n\nSome text!");
+    }
+    cache->clear();
+    EXPECT_EQ(cache->stats().entries, 0u);
+    EXPECT_EQ(cache->stats().documentHits, 0u);
+
+    // Lambdas of one closure type may capture different state, so a
+    // capturing function-valued option turns the cache off.
+    auto marking = [](std::string mark) {
+        return [mark](std::string const& content, dom::NodeView) { return mark + content; };
+    };
+    std::string const unknown = "<x-a>one</x-a><x-b>two</x-b>";
+    for (std::string mark : {"1:", "2:"}) {
+        service.options().defaultReplacement = marking(mark);
+        EXPECT_EQ(service.turndown(unknown), mark + "one" + mark + "two");
+    }
+    EXPECT_EQ(cache->stats().entries, 0u);
+    EXPECT_EQ(cache->stats().documentHits, 0u);
+}
+
+TEST(TurndownServiceTest, ConversionCacheReusesSubtreesInContext) {
+    std::string const nav = "<nav><ul><li><a href=\"/home\">Home</a></li><li><a href=\"/about\">About us</a></li></ul></nav>";
+    std::string const item = "<li>A list item long enough to be cached on its own</li>";
+    std::vector<std::string> pages = {
+        nav + "<p>First page</p><ol>" + item + item + "</ol>",
+        "<div>" + nav + "</div><p>Second page</p><ol start=\"7\">" + item + item + item + "</ol>",
+    };
+    TurndownOptions referenced;
+    referenced.linkStyle = "referenced";
+
+    for (TurndownOptions const& options : {TurndownOptions(), referenced}) {
+        auto cache = std::make_shared<ConversionCache>(ConversionCache::kDefaultCapacity, 32);
+        TurndownService service(options);
+        service.setCache(cache);
+        TurndownService uncached(options);
+        for (std::string const& page : pages) {
+            EXPECT_EQ(service.turndown(page), uncached.turndown(page)) << page;
+        }
+        ConversionCacheStats stats = cache->stats();
+        EXPECT_EQ(stats.documentHits, 0u);
+        if (options.linkStyle == "referenced") {
+            // Reference links carry per-conversion state, so the nav is never stored.
+            EXPECT_EQ(stats.subtreeHits, 0u);
+        } else {
+            EXPECT_GT(stats.subtreeHits, 0u);
+        }
+    }
+
+    // A rule that reads past what the key covers (here a grandparent)
+    // keeps its subtrees out of the cache; one that opts in shares them.
+    std::string const paragraph = "<p>A paragraph long enough to be cached on its own</p>";
+    std::vector<std::string> const notes = {
+        "<section class=\"note\"><div>" + paragraph + "</div></section>",
+        "<section class=\"plain\"><div>" + paragraph + "</div></section>",
+    };
+    Rule noted;
+    noted.filter = [](dom::NodeView node, TurndownOptions const&) { return node.has_tag("p"); };
+    noted.replacement = [](std::string const& content, dom::NodeView node, TurndownOptions const&) {
+        bool note = node.parent().parent().attribute("class") == "note";
+        return "\n\n" + (note ? "Note: " + content : content) + "\n\n";
+    };
+    noted.tags = {dom::TagId::P};
+    Rule shouted = noted;
+    shouted.replacement = [](std::string const& content, dom::NodeView, TurndownOptions const&) {
+        return "\n\n" + content + "!\n\n";
+    };
+    shouted.cacheable = true;
+    for (Rule const& rule : {noted, shouted}) {
+        auto cache = std::make_shared<ConversionCache>(ConversionCache::kDefaultCapacity, 32);
+        TurndownService service;
+        service.addRule("paragraph", rule);
+        service.setCache(cache);
+        TurndownService uncached;
+        uncached.addRule("paragraph", rule);
+        for (std::string const& page : notes) {
+            EXPECT_EQ(service.turndown(page), uncached.turndown(page)) << page;
+        }
+        if (rule.cacheable) {
+            EXPECT_GT(cache->stats().subtreeHits, 0u);
+        } else {
+            EXPECT_EQ(cache->stats().subtreeHits, 0u);
+        }
+    }
+}
+
+TEST(TurndownServiceTest, IncrementalConverterReconvertsOnlyEditedBlocks) {
+    auto article = [](int edited, bool extraLink) {
+        std::string html = "<article><h1>Title</h1>";
+        for (int i = 0; i < 40; ++i) {
+            std::string n = std::to_string(i);
+            html += "<section><h2>Part " + n + "</h2><p>Paragraph " + n + (i == edited ? " was edited" : "") +
+                    " with enough text to be remembered between saves.</p>";
+            if (i % 10 == 0) html += "<p>See <a href=\"/p/" + n + "\">page " + n + "</a>.</p>";
+            if (extraLink && i == 5) html += "<p>Also <a href=\"/new\">new</a>.</p>";
+            html += "</section>";
+        }
+        return html + "</article>";
+    };
+    TurndownOptions referenced;
+    referenced.linkStyle = "referenced";
+
+    for (TurndownOptions const& options : {TurndownOptions(), referenced}) {
+        TurndownService service(options);
+        IncrementalConverter converter(service);
+        EXPECT_EQ(converter.convert(article(-1, false)), service.turndown(article(-1, false)));
+        std::size_t const firstConverted = converter.lastStats().convertedSubtrees;
+
+        EXPECT_EQ(converter.convert(article(-1, false)), service.turndown(article(-1, false)));
+        EXPECT_TRUE(converter.lastStats().unchanged);
+
+        // One edited paragraph: its section, and the sections holding the
+        // links in referenced style, are converted again.
+        EXPECT_EQ(converter.convert(article(17, false)), service.turndown(article(17, false)));
+        EXPECT_FALSE(converter.lastStats().unchanged);
+        EXPECT_GT(converter.lastStats().reusedSubtrees, 30u);
+        EXPECT_LT(converter.lastStats().convertedSubtrees, firstConverted / 4);
+
+        // A new link renumbers the references after it.
+        EXPECT_EQ(converter.convert(article(17, true)), service.turndown(article(17, true)));
+    }
+
+    TurndownService service;
+    IncrementalConverter converter(service);
+    converter.convert(article(-1, false));
+    converter.reset();
+    converter.convert(article(-1, false));
+    EXPECT_EQ(converter.lastStats().reusedSubtrees, 0u);
+}
+
+TEST(TurndownServiceTest, ParallelConversionMatchesSequential) {
+    std::string html = "<html><body><main><h1>Title</h1>";
+    for (int i = 0; i < 200; ++i) {
+        std::string n = std::to_string(i);
+        html += "<section><h2>Part " + n + "</h2><p>See <a href=\"/p/" + n + "\">page " + n +
+                "</a> and <a href=\"/q/" + n + "\" title=\"Q\">q</a>.</p>";
+        html += "<ol start=\"" + n + "\"><li>one</li><li>two <em>x</em></li></ol></section>\n text " + n;
+    }
+    html += "</main><p>End</p></body></html>";
+
+    ThreadPool pool(4);
+    TurndownOptions referenced;
+    referenced.linkStyle = "referenced";
+    TurndownOptions limited;
+    limited.maxDepth = 4;
+    for (TurndownOptions const& options : {TurndownOptions(), referenced, limited}) {
+        TurndownService service(options);
+        EXPECT_EQ(service.turndown(html, pool), service.turndown(html));
+    }
+
+    // References are numbered in document order.
+    TurndownService service(referenced);
+    std::string markdown = service.turndown(html, pool);
+    EXPECT_NE(markdown.find("[page 199][399]"), std::string::npos);
+    EXPECT_NE(markdown.find("[399]: /p/199\n[400]: /q/199 \"Q\""), std::string::npos);
+
+    // Rules run on the pool's threads.
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+    service.addRule("sections", {
+        .filter = [](dom::NodeView node, TurndownOptions const&) { return node.has_tag("section"); },
+        .replacement = [&](std::string const& content, dom::NodeView, TurndownOptions const&) {
+            std::lock_guard<std::mutex> lock(mutex);
+            threads.insert(std::this_thread::get_id());
+            return "\n\n" + content + "\n\n";
+        }
+    });
+    EXPECT_EQ(service.turndown(html, pool), markdown);
+    EXPECT_GT(threads.size(), 1u);
+
+    // State that cannot be merged makes the conversion sequential.
+    struct Counter : RuleState {
+        int sections = 0;
+    };
+    Rule numbered;
+    numbered.filter = [](dom::NodeView node, TurndownOptions const&) { return node.has_tag("h2"); };
+    numbered.contextReplacement = [](std::string const& content, dom::NodeView, TurndownOptions const&,
+                                     ConversionContext& context) {
+        int n = ++context.ruleState<Counter>("numbered").sections;
+        return "\n\n## " + std::to_string(n) + ". " + content + "\n\n";
+    };
+    service.addRule("numbered", std::move(numbered));
+    markdown = service.turndown(html, pool);
+    EXPECT_EQ(markdown, service.turndown(html));
+    EXPECT_NE(markdown.find("## 200. Part 199"), std::string::npos);
+}
+
+TEST(TurndownServiceTest, ReferenceLinksAreCollectedPerConversion) {
+    TurndownOptions options;
+    options.linkStyle = "referenced";
+    TurndownService const service(options);
+
+    std::string const html = "<p><a href=\"http://a.example\">a</a> <a href=\"http://b.example\">b</a></p>";
+    std::string const expected = "[a][1] [b][2]\n\n[1]: http://a.example\n[2]: http://b.example";
+
+    std::vector<std::string> results(6);
+    std::vector<std::thread> threads;
+    for (std::size_t t = 0; t < results.size(); ++t) {
+        threads.emplace_back([&, t] {
+            for (int round = 0; round < 50; ++round) {
+                std::string markdown = service.turndown(html);
+                if (markdown != expected) {
+                    results[t] = markdown;
+                    return;
+                }
+            }
+            results[t] = expected;
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (auto const& result : results) {
+        ASSERT_EQ(result, expected);
+    }
+    ASSERT_EQ(service.turndown(html), expected);
+}
+
+TEST(TurndownServiceTest, ContextReplacementKeepsStatePerConversion) {
+    struct CounterState : RuleState {
+        int count = 0;
+    };
+
+    TurndownService service;
+    Rule counter;
+    counter.filter = [](dom::NodeView node, TurndownOptions const&) {
+        return node.has_tag("mark");
+    };
+    counter.contextReplacement = [](std::string const& content, dom::NodeView, TurndownOptions const&,
+                                    ConversionContext& context) {
+        int n = ++context.ruleState<CounterState>("counter").count;
+        return content + "(" + std::to_string(n) + ")";
+    };
+    counter.contextAppend = [](TurndownOptions const&, ConversionContext& context) {
+        return "total " + std::to_string(context.ruleState<CounterState>("counter").count);
+    };
+    service.addRule("counter", std::move(counter));
+
+    std::string const html = "<p><mark>a</mark> <mark>b</mark></p>";
+    EXPECT_EQ(service.turndown(html), "a(1) b(2)\n\ntotal 2");
+    EXPECT_EQ(service.turndown(html), "a(1) b(2)\n\ntotal 2");
+}
+
 TEST(TurndownServiceTest, PluginAddsRule) {
     TurndownService service;
     service.use([](TurndownService& svc) {
@@ -200,6 +661,37 @@ TEST(TurndownServiceTest, KeepPredicateUsesOuterHtml) {
     EXPECT_NE(result.find("<custom data-id=\"1\">special</custom>"), std::string::npos);
 }
 
+TEST(TurndownServiceTest, KeepCanCopySourceVerbatim) {
+    std::string const element = "<custom data-id='1'  class=a>special &amp; <b>bold</b></custom>";
+    std::string const html = "<p>x " + element + " y</p>";
+
+    // Source slices, where the backend keeps them, are bytes of the input.
+    dom::Document doc = dom::Document::parse(html);
+    dom::NodeView custom;
+    for (dom::NodeView node = doc.root(); node;) {
+        std::string_view source = node.source_html();
+        if (!source.empty()) {
+            EXPECT_NE(std::string_view(html).find(source), std::string_view::npos);
+        }
+        if (node.is_element() && node.tag_name() == "custom") custom = node;
+        if (dom::NodeView child = node.first_child()) {
+            node = child;
+            continue;
+        }
+        while (node && !node.next_sibling()) node = node.parent();
+        if (node) node = node.next_sibling();
+    }
+    ASSERT_TRUE(custom);
+    std::string const expected = custom.source_html().empty() ? serializeNode(custom) : element;
+    EXPECT_EQ(serializeNodeSource(custom), expected);
+
+    TurndownOptions options;
+    options.keepReplacement = [](std::string const&, dom::NodeView node) { return serializeNodeSource(node); };
+    TurndownService service(options);
+    service.keep("custom");
+    EXPECT_EQ(service.turndown(html), "x " + expected + " y");
+}
+
 TEST(TurndownServiceTest, RemovePredicateStripsNodes) {
     TurndownService service;
     service.remove([](dom::NodeView node, TurndownOptions const&) {
@@ -209,6 +701,183 @@ TEST(TurndownServiceTest, RemovePredicateStripsNodes) {
     EXPECT_EQ(service.turndown("<p>safe<script>alert('x')</script>content</p>"), "safecontent");
 }
 
+TEST(TurndownServiceTest, RemovedTagsArePrunedBeforeConversion) {
+    TurndownService pruning;
+    pruning.remove(std::vector<std::string>{"nav", "script", "style"});
+    // A predicate declares no tags, so the same removal is applied per node.
+    TurndownService visiting;
+    visiting.remove([](dom::NodeView node, TurndownOptions const&) {
+        return node.has_tag("nav") || node.has_tag("script") || node.has_tag("style");
+    });
+
+    std::vector<std::string> const documents = {
+        "<p>a</p><nav><ul><li><a href=\"/x\">x</a></li></ul></nav><p>b</p>",
+        "<p>a</p><nav> </nav><p>b</p>",
+        "<p>safe<script>alert('x')</script>content</p>",
+        "<div><nav><img src=\"i.png\"></nav></div><p>c</p>",
+    };
+    for (auto const& html : documents) {
+        EXPECT_EQ(pruning.turndown(html), visiting.turndown(html)) << html;
+    }
+    EXPECT_EQ(pruning.turndown(documents[0]), "a\n\nb");
+    // Pruned content still decides the whitespace around it.
+    std::vector<std::string> const spaced = {
+        "<div>a <style>p { color: red }</style> b</div>",
+        "<div>a <style> p </style> b</div>",
+        "<div>a<style> p </style>b</div>",
+        "<div>a <nav><p>x</p></nav> b</div>",
+        "<p>a <nav> x <span>y </span></nav> <em>b</em></p>",
+        "<p>a<script> </script>b</p>",
+        "<p>a <nav><img src=\"i.png\"> </nav> b <nav>c <style>d</style> </nav></p>",
+        "<p><em><img src=\"i.png\"><nav><pre> x </pre></nav></em></p>",
+    };
+    for (auto const& html : spaced) {
+        EXPECT_EQ(pruning.turndown(html), visiting.turndown(html)) << html;
+    }
+
+    TurndownOptions defaults;
+    Rules rules(defaults);
+    defineCommonMarkRules(rules, defaults);
+    rules.remove(std::vector<std::string>{"nav", "a"});
+    rules.compile();
+    EXPECT_TRUE(rules.prunedTags().contains(dom::TagId::Nav));
+    EXPECT_TRUE(rules.prunedTags().contains(dom::TagId::Template));
+    EXPECT_FALSE(rules.prunedTags().contains(dom::TagId::A)); // The link rules come first
+
+    // Template content is not part of the document unless a rule claims it.
+    TurndownService service;
+    EXPECT_EQ(service.turndown("<p>a<template><b>t</b></template>b</p>"), "ab");
+    Rule shown;
+    shown.filter = [](dom::NodeView node, TurndownOptions const&) { return node.has_tag("template"); };
+    shown.replacement = [](std::string const& content, dom::NodeView, TurndownOptions const&) { return "[" + content + "]"; };
+    shown.tags = {dom::TagId::Template};
+    service.addRule("shown", std::move(shown));
+    EXPECT_EQ(service.turndown("<p>a<template><b>t</b></template>b</p>"), "a[**t**]b");
+
+    // keepTags wins over a remove rule, so the element is still visited.
+    TurndownOptions options;
+    options.keepTags = {"nav"};
+    TurndownService keeping(options);
+    keeping.remove("nav");
+    EXPECT_EQ(keeping.turndown("<p>a</p><nav>x</nav>"), "a\n\n<nav>x</nav>");
+}
+
+TEST(TurndownServiceTest, TraversalRulesReadPositionsFromTheNodeTable) {
+    TurndownService service;
+    std::string html = "<ol start=\"3\">";
+    std::string expected;
+    for (int i = 0; i < 200; ++i) {
+        html += " <li>item</li>";
+        expected += (expected.empty() ? "" : "\n") + std::to_string(3 + i) + ".  item";
+    }
+    EXPECT_EQ(service.turndown(html + "</ol>"), expected);
+    EXPECT_EQ(service.turndown("<ul><li>a<ul><li>b</li></ul></li><li>c</li></ul>"), "*   a\n    *   b\n*   c");
+
+    // A rule can match by depth and position without walking the tree.
+    Rule depth;
+    depth.traversalFilter = [](dom::NodeView node, TurndownOptions const&, TraversalContext const& traversal) {
+        return node.has_tag("span") && traversal.listDepth() > 0;
+    };
+    depth.traversalReplacement = [](std::string const& content, dom::NodeView, TurndownOptions const&,
+                                    TraversalContext const& traversal) {
+        return content + "@" + std::to_string(traversal.listDepth()) + ":" + std::to_string(traversal.elementIndex());
+    };
+    depth.tags = {dom::TagId::Span};
+    service.addRule("depth", std::move(depth));
+    EXPECT_EQ(service.turndown("<span>out</span><ul><li><b>b</b><span>in</span></li></ul>"), "out\n\n*   **b**in@1:1");
+}
+
+TEST(TurndownServiceTest, LimitsStopTheConversionEarly) {
+    TurndownService service;
+    std::string html;
+    for (int i = 0; i < 1000; ++i) html += "<p>paragraph " + std::to_string(i) + "</p>";
+    std::string const full = service.turndown(html);
+
+    LimitKind const none = LimitKind::None;
+    LimitedConversion unlimited = service.turndown(html, ConversionLimits{});
+    EXPECT_EQ(unlimited.markdown, full);
+    EXPECT_EQ(unlimited.limit, none);
+
+    ConversionLimits nodes;
+    nodes.maxNodes = 100;
+    LimitedConversion partial = service.turndown(html, nodes);
+    EXPECT_EQ(partial.limit, LimitKind::Nodes);
+    EXPECT_FALSE(partial.markdown.empty());
+    EXPECT_LT(partial.markdown.size(), full.size());
+    EXPECT_EQ(full.compare(0, partial.markdown.size(), partial.markdown), 0);
+
+    ConversionLimits output;
+    output.maxOutputBytes = 500;
+    partial = service.turndown(html, output);
+    EXPECT_EQ(partial.limit, LimitKind::OutputBytes);
+    EXPECT_LE(partial.markdown.size(), 500u);
+    // The cut never splits a character.
+    output.maxOutputBytes = 2;
+    EXPECT_EQ(service.turndown("<p>a\xC3\xA9</p>", output).markdown, "a");
+
+    // Open elements are still closed by their rules.
+    ConversionLimits depth;
+    depth.maxNestingDepth = 4;
+    partial = service.turndown("<ul><li>a<ul><li>b<ul><li>c</li></ul></li></ul></li></ul>", depth);
+    EXPECT_EQ(partial.limit, LimitKind::Depth);
+    EXPECT_EQ(partial.markdown, "*   a\n    *   b");
+
+    ConversionLimits expired;
+    expired.deadline = std::chrono::steady_clock::now();
+    partial = service.turndown(html, expired);
+    EXPECT_EQ(partial.limit, LimitKind::Deadline);
+    EXPECT_EQ(partial.markdown, "");
+
+    std::stop_source source;
+    source.request_stop();
+    ConversionLimits cancelled;
+    cancelled.cancellation = source.get_token();
+    cancelled.onLimit = LimitAction::Throw;
+    try {
+        (void)service.turndown(html, cancelled);
+        ADD_FAILURE() << "expected ConversionLimitExceeded";
+    } catch (ConversionLimitExceeded const& e) {
+        EXPECT_EQ(e.kind(), LimitKind::Cancelled);
+    }
+
+    // Truncated results do not reach the document cache.
+    service.setCache(std::make_shared<ConversionCache>());
+    EXPECT_EQ(service.turndown(html, nodes).limit, LimitKind::Nodes);
+    EXPECT_EQ(service.turndown(html), full);
+    EXPECT_EQ(service.turndown(html, nodes).limit, LimitKind::None);
+}
+
+TEST(TurndownServiceTest, ClonesShareRulesAndOptionsNeedNoRebuild) {
+    int builds = 0;
+    TurndownService base;
+    base.registerRuleFactory([&builds](Rules&) { ++builds; });
+    base.keep("kbd");
+    std::string const html = "<p><em>a</em> <strong>b</strong> <kbd>k</kbd> <mark>m</mark></p>";
+    EXPECT_EQ(base.turndown(html), "_a_ **b** <kbd>k</kbd> m");
+    EXPECT_EQ(builds, 1);
+
+    base.configureOptions([](TurndownOptions& o) { o.emDelimiter = "*"; });
+    EXPECT_EQ(base.turndown(html), "*a* **b** <kbd>k</kbd> m");
+    EXPECT_EQ(builds, 1);
+
+    TurndownService tenant = base.clone();
+    tenant.configureOptions([](TurndownOptions& o) { o.strongDelimiter = "__"; });
+    Rule mark;
+    mark.filter = [](dom::NodeView node, TurndownOptions const&) { return node.has_tag("mark"); };
+    mark.replacement = [](std::string const& content, dom::NodeView, TurndownOptions const& options) {
+        return options.strongDelimiter + content + options.strongDelimiter;
+    };
+    tenant.addRule("mark", std::move(mark));
+    EXPECT_EQ(tenant.turndown(html), "*a* __b__ <kbd>k</kbd> __m__");
+    EXPECT_EQ(base.turndown(html), "*a* **b** <kbd>k</kbd> m");
+    EXPECT_EQ(builds, 1);
+
+    // A fresh factory still rebuilds, from the clone's own configuration.
+    tenant.registerRuleFactory([](Rules&) {});
+    EXPECT_EQ(tenant.turndown(html), "*a* __b__ <kbd>k</kbd> __m__");
+    EXPECT_EQ(builds, 2);
+}
+
 TEST(TurndownServiceTest, RuleFactoryBeforeDefaultsOverridesParagraph) {
     TurndownService service;
     service.registerRuleFactory([](Rules& rules) {
@@ -235,6 +904,132 @@ TEST(TurndownServiceTest, NodeViewSourceAllowsExistingTree) {
     EXPECT_NE(markdown.find("*   B"), std::string::npos);
 }
 
+TEST(TurndownServiceTest, MappedFileSourceParsesFromTheMapping) {
+    TurndownService service;
+    std::string html = "<h1>Mapped</h1><p>Read <em>in place</em>, a < b</p>";
+    auto path = std::filesystem::temp_directory_path() / "turndown_mapped_file_source.html";
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << html;
+    }
+    {
+        MappedFileSource source(path);
+        EXPECT_EQ(source.html(), html);
+        EXPECT_EQ(service.turndown(source), service.turndown(html));
+    }
+    std::filesystem::remove(path);
+
+    // A view into a larger buffer parses only its own bytes.
+    std::string padded = html + "<p>not part of the view</p>";
+    dom::Document document = dom::Document::parse(std::string_view(padded).substr(0, html.size()));
+    EXPECT_EQ(service.turndown(document.root()), service.turndown(html));
+
+    EXPECT_THROW(MappedFileSource{path}, std::runtime_error);
+}
+
+TEST(TurndownServiceTest, CompiledDispatchMatchesFullScan) {
+    TurndownOptions options;
+    Rules rules(options);
+    defineCommonMarkRules(rules, options);
+    rules.keep("x-widget");
+    rules.remove(std::vector<std::string>{"del", "s"});
+    Rule highlighted;
+    highlighted.filter = [](dom::NodeView node, TurndownOptions const&) {
+        return node.has_attribute("data-highlight");
+    };
+    highlighted.replacement = [](std::string const& content, dom::NodeView, TurndownOptions const&) {
+        return "==" + content + "==";
+    };
+    rules.addRule("highlighted", std::move(highlighted));
+
+    dom::Document doc = dom::Document::parse(
+        "<h2>T</h2><p>a <em>b</em> <em data-highlight=\"1\">c</em> <del>d</del> "
+        "<x-widget>e</x-widget> <a href=\"/u\">f</a> <code>g</code></p>"
+        "<pre><code>h</code></pre><ul><li>i</li></ul><hr><img src=\"j.png\">");
+
+    std::vector<dom::NodeView> elements;
+    std::vector<dom::NodeView> pending{doc.root()};
+    while (!pending.empty()) {
+        dom::NodeView node = pending.back();
+        pending.pop_back();
+        if (node.is_element()) elements.push_back(node);
+        for (auto child : node.child_range()) pending.push_back(child);
+    }
+
+    std::vector<std::string> scanned;
+    ASSERT_FALSE(rules.isCompiled());
+    for (auto node : elements) scanned.push_back(rules.forNode(node).key);
+
+    rules.compile();
+    ASSERT_TRUE(rules.isCompiled());
+    for (std::size_t i = 0; i < elements.size(); ++i) {
+        EXPECT_EQ(rules.forNode(elements[i]).key, scanned[i]) << elements[i].tag_name();
+    }
+    EXPECT_NE(std::find(scanned.begin(), scanned.end(), "highlighted"), scanned.end());
+    EXPECT_NE(std::find(scanned.begin(), scanned.end(), "keep-x-widget"), scanned.end());
+    EXPECT_NE(std::find(scanned.begin(), scanned.end(), "remove-multi"), scanned.end());
+
+    rules.remove("code");
+    EXPECT_FALSE(rules.isCompiled());
+}
+
+TEST(TurndownServiceTest, FragmentMatchesDocumentConversion) {
+    std::vector<std::string> const snippets = {
+        "",
+        "   \n\t ",
+        "plain text",
+        "  spaced\n\n  out\t text  ",
+        "*a* _b_ # x",
+        "> quoted",
+        "1. not a list",
+        "- dash",
+        "a\xc2\xa0" "b",
+        "caf\xc3\xa9 \xe2\x80\x94 \xf0\x9f\x98\x80",
+        "a\xc2\x85" "b",
+        "bad \xff utf-8",
+        "\xef\xbb\xbf" "bom",
+        "fish &amp; chips",
+        "<b>bold</b> and <a href=\"https://example.com\" title=\"t\">link</a>",
+        "<p>one</p><p>two</p>",
+        "<pre><code>x  y</code></pre>",
+    };
+
+    TurndownService service;
+    TurndownOptions referenced;
+    referenced.linkStyle = "referenced";
+    TurndownService references(referenced);
+    TurndownOptions custom;
+    custom.escapeFunction = [](std::string const& text) { return "[" + text + "]"; };
+    TurndownService escaping(custom);
+
+    for (TurndownService const* s : {&service, &references, &escaping}) {
+        for (auto const& snippet : snippets) {
+            EXPECT_EQ(s->turndownFragment(snippet), s->turndown(snippet)) << snippet;
+        }
+    }
+    // Rules of the service's own may match the elements the parser wraps
+    // bare text in, so plain text is converted like a document then too.
+    TurndownService wrapping;
+    Rule paragraph;
+    paragraph.filter = [](dom::NodeView node, TurndownOptions const&) { return node.has_tag("p"); };
+    paragraph.replacement = [](std::string const& content, dom::NodeView, TurndownOptions const&) {
+        return "<<" + content + ">>";
+    };
+    wrapping.addRule("paragraph", paragraph);
+    TurndownService keeping;
+    keeping.keep(std::vector<std::string>{"body", "p"});
+    for (TurndownService const* s : {&wrapping, &keeping}) {
+        for (auto const& snippet : snippets) {
+            EXPECT_EQ(s->turndownFragment(snippet), s->turndown(snippet)) << snippet;
+        }
+    }
+
+    // The per-thread parser is reused across snippets.
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_EQ(service.turndownFragment("<em>x</em>"), "_x_");
+    }
+}
+
 // More tests to be added based on Javascript tests...
 
 